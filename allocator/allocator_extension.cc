@@ -6,6 +6,11 @@
 #include "base/allocator/buildflags.h"
 #include "base/logging.h"
 
+#if BUILDFLAG(USE_PARTITION_ALLOC_AS_MALLOC)
+#include "base/allocator/allocator_shim_default_dispatch_to_partition_alloc.h"
+#include "base/allocator/partition_allocator/partition_alloc.h"
+#endif
+
 #if defined(USE_TCMALLOC)
 #if BUILDFLAG(USE_NEW_TCMALLOC)
 #include "third_party/tcmalloc/chromium/src/gperftools/heap-profiler.h"
@@ -24,6 +29,9 @@ namespace allocator {
 void ReleaseFreeMemory() {
 #if defined(USE_TCMALLOC)
   ::MallocExtension::instance()->ReleaseFreeMemory();
+#elif BUILDFLAG(USE_PARTITION_ALLOC_AS_MALLOC)
+  MallocPartitionRoot()->PurgeMemory(PartitionPurgeDecommitEmptyPages |
+                                     PartitionPurgeDiscardUnusedSystemPages);
 #endif
 }
 
@@ -0,0 +1,282 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/allocator/allocator_shim_default_dispatch_to_partition_alloc.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+
+#include "base/allocator/allocator_shim.h"
+#include "base/allocator/partition_allocator/page_allocator.h"
+#include "base/allocator/partition_allocator/partition_alloc.h"
+#include "base/allocator/partition_allocator/spin_lock.h"
+#include "base/bits.h"
+#include "base/compiler_specific.h"
+#include "base/logging.h"
+#include "base/numerics/checked_math.h"
+
+// This translation unit defines a default dispatch for the allocator shim which
+// routes allocations to a PartitionAlloc partition.
+//
+// Aligned allocations rely on the natural alignment of slots: slot spans start
+// at partition page boundaries, so all the slots of a bucket whose size is a
+// multiple of a power of two up to kPartitionPageSize are aligned to it. In
+// DCHECK builds, cookies surround each allocation and break this property.
+// Larger alignments are served by dedicated mappings, see AllocAlignedMap().
+#if DCHECK_IS_ON()
+#error "PartitionAlloc can't serve malloc() in builds with DCHECKs."
+#endif
+
+namespace {
+
+using base::PartitionRootGeneric;
+using base::allocator::AllocatorDispatch;
+
+// malloc() must return memory suitably aligned for any object type.
+constexpr size_t kMallocAlignment = alignof(max_align_t);
+
+// The partition serving malloc() can't be allocated with malloc(), and can't
+// be a function-level static either, as its initialization would allocate
+// memory. Instead, it is constructed in place on the first allocation, under
+// a spin lock which doesn't allocate. It is never destroyed, as malloc() can
+// be called until the process exits.
+alignas(PartitionRootGeneric) char g_root_storage[sizeof(PartitionRootGeneric)];
+std::atomic<PartitionRootGeneric*> g_root(nullptr);
+base::subtle::SpinLock g_root_lock;
+
+// A thread which forks while another one holds a lock of the partition would
+// leave the child with a lock which is never released. The locks are taken
+// before forking, so that they are in a known state in both processes.
+void BeforeFork() {
+  g_root_lock.lock();
+  g_root.load(std::memory_order_relaxed)->lock.lock();
+}
+
+void AfterFork() {
+  // Spin locks have no owner, so the child can release them too.
+  g_root.load(std::memory_order_relaxed)->lock.unlock();
+  g_root_lock.unlock();
+}
+
+NOINLINE PartitionRootGeneric* CreateRoot() {
+  base::subtle::SpinLock::Guard guard(g_root_lock);
+  PartitionRootGeneric* root = g_root.load(std::memory_order_relaxed);
+  if (root)
+    return root;
+  root = new (g_root_storage) PartitionRootGeneric();
+  // Thread caches are stored in base::ThreadLocalStorage, whose setup
+  // allocates memory and would come back here.
+  root->Init(/* enable_thread_cache= */ false);
+  g_root.store(root, std::memory_order_release);
+  // After |g_root| is set, as pthread_atfork() may allocate memory.
+  pthread_atfork(&BeforeFork, &AfterFork, &AfterFork);
+  return root;
+}
+
+ALWAYS_INLINE PartitionRootGeneric* Root() {
+  PartitionRootGeneric* root = g_root.load(std::memory_order_acquire);
+  if (LIKELY(root))
+    return root;
+  return CreateRoot();
+}
+
+// Alignments larger than kPartitionPageSize are served by a dedicated mapping.
+// The allocation starts |alignment| bytes into
+// the mapping, which is aligned to |alignment| and to super pages. An
+// AlignedMapHeader is stored where PartitionAlloc would keep the metadata of
+// the super page which precedes the allocation.
+//
+// A slot of PartitionAlloc never starts a super page, so the metadata found
+// this way is that of its own super page, whose first field is the root.
+// Free() reads that page anyway, so telling the two apart costs one load.
+struct AlignedMapHeader {
+  // Takes the place of PartitionSuperPageExtentEntry::root.
+  const void* marker;
+  char* map_base;
+  size_t map_size;
+};
+static_assert(offsetof(base::internal::PartitionSuperPageExtentEntry, root) ==
+                  offsetof(AlignedMapHeader, marker),
+              "The marker must overlap the root of a super page");
+
+// Only its address matters.
+const char kAlignedMapMarker = 0;
+
+ALWAYS_INLINE AlignedMapHeader* GetAlignedMapHeader(void* address) {
+  uintptr_t super_page =
+      (reinterpret_cast<uintptr_t>(address) - 1) & base::kSuperPageBaseMask;
+  return reinterpret_cast<AlignedMapHeader*>(
+      base::internal::PartitionSuperPageToMetadataArea(
+          reinterpret_cast<char*>(super_page)));
+}
+
+ALWAYS_INLINE bool IsAlignedMap(void* address) {
+  return GetAlignedMapHeader(address)->marker == &kAlignedMapMarker;
+}
+
+void* AllocAlignedMap(size_t alignment, size_t size) {
+  base::CheckedNumeric<size_t> checked_map_size = alignment;
+  // malloc(0) returns a unique pointer.
+  checked_map_size += std::max<size_t>(size, 1);
+  checked_map_size += base::kPageAllocationGranularityOffsetMask;
+  size_t map_size;
+  if (!checked_map_size.AssignIfValid(&map_size))
+    return nullptr;
+  map_size &= base::kPageAllocationGranularityBaseMask;
+  const size_t map_alignment = std::max(alignment, base::kSuperPageSize);
+  // AllocPages() may map |map_alignment| more bytes to align the mapping, and
+  // crashes if that overflows.
+  if (!base::CheckAdd(map_size, map_alignment).IsValid())
+    return nullptr;
+
+  char* map_base = reinterpret_cast<char*>(base::AllocPages(
+      nullptr, map_size, map_alignment, base::PageReadWrite));
+  if (!map_base)
+    return nullptr;
+  char* address = map_base + alignment;
+  AlignedMapHeader* header = GetAlignedMapHeader(address);
+  header->marker = &kAlignedMapMarker;
+  header->map_base = map_base;
+  header->map_size = map_size;
+  return address;
+}
+
+size_t GetAlignedMapSize(void* address) {
+  const AlignedMapHeader* header = GetAlignedMapHeader(address);
+  return header->map_base + header->map_size - static_cast<char*>(address);
+}
+
+void FreeAlignedMap(void* address) {
+  // The header is unmapped along with the rest.
+  const AlignedMapHeader header = *GetAlignedMapHeader(address);
+  base::FreePages(header.map_base, header.map_size);
+}
+
+// Returns the size to allocate for a request of |size| bytes, so that the
+// allocation has |alignment|, a power of two no larger than
+// kPartitionPageSize. Larger sizes can't be allocated and are left as is.
+ALWAYS_INLINE size_t AdjustSize(size_t size, size_t alignment) {
+  if (UNLIKELY(size > base::kGenericMaxDirectMapped))
+    return size;
+  // malloc(0) returns a unique pointer.
+  return base::bits::Align(std::max<size_t>(size, 1), alignment);
+}
+
+void* PartitionAllocMalloc(const AllocatorDispatch*,
+                           size_t size,
+                           void* context) {
+  return Root()->AllocFlags(base::PartitionAllocReturnNull,
+                            AdjustSize(size, kMallocAlignment), "");
+}
+
+void* PartitionAllocCalloc(const AllocatorDispatch*,
+                           size_t n,
+                           size_t size,
+                           void* context) {
+  size_t total;
+  if (!base::CheckMul(n, size).AssignIfValid(&total))
+    return nullptr;
+  return Root()->AllocFlags(
+      base::PartitionAllocReturnNull | base::PartitionAllocZeroFill,
+      AdjustSize(total, kMallocAlignment), "");
+}
+
+void* PartitionAllocMemalign(const AllocatorDispatch* self,
+                             size_t alignment,
+                             size_t size,
+                             void* context) {
+  if (alignment <= kMallocAlignment)
+    return PartitionAllocMalloc(self, size, context);
+  // Like glibc, round up alignments which aren't powers of two.
+  if (!base::bits::IsPowerOfTwo(alignment)) {
+    const size_t shift = base::kBitsPerSizeT -
+                         base::bits::CountLeadingZeroBitsSizeT(alignment);
+    if (shift == base::kBitsPerSizeT)
+      return nullptr;
+    alignment = static_cast<size_t>(1) << shift;
+  }
+  if (UNLIKELY(alignment > base::kPartitionPageSize))
+    return AllocAlignedMap(alignment, size);
+  return Root()->AllocFlags(base::PartitionAllocReturnNull,
+                            AdjustSize(size, alignment), "");
+}
+
+void* PartitionAllocRealloc(const AllocatorDispatch* self,
+                            void* address,
+                            size_t size,
+                            void* context) {
+  if (!address)
+    return PartitionAllocMalloc(self, size, context);
+  if (UNLIKELY(IsAlignedMap(address))) {
+    // Like glibc, realloc() doesn't preserve alignments beyond malloc()'s.
+    void* new_address = nullptr;
+    if (size) {
+      new_address = PartitionAllocMalloc(self, size, context);
+      if (!new_address)
+        return nullptr;
+      memcpy(new_address, address,
+             std::min(size, GetAlignedMapSize(address)));
+    }
+    FreeAlignedMap(address);
+    return new_address;
+  }
+  // realloc(address, 0) frees |address|.
+  const size_t new_size = size ? AdjustSize(size, kMallocAlignment) : 0;
+  return Root()->TryRealloc(address, new_size, "");
+}
+
+void PartitionAllocFree(const AllocatorDispatch*,
+                        void* address,
+                        void* context) {
+  if (UNLIKELY(address && IsAlignedMap(address))) {
+    FreeAlignedMap(address);
+    return;
+  }
+  Root()->Free(address);
+}
+
+size_t PartitionAllocGetSizeEstimate(const AllocatorDispatch*,
+                                     void* address,
+                                     void* context) {
+  // malloc_usable_size(nullptr) returns 0.
+  if (!address)
+    return 0;
+  if (UNLIKELY(IsAlignedMap(address)))
+    return GetAlignedMapSize(address);
+  return base::PartitionAllocGetSize(address);
+}
+
+}  // namespace
+
+namespace base {
+namespace allocator {
+
+PartitionRootGeneric* MallocPartitionRoot() {
+  return Root();
+}
+
+}  // namespace allocator
+}  // namespace base
+
+const AllocatorDispatch AllocatorDispatch::default_dispatch = {
+    &PartitionAllocMalloc,          /* alloc_function */
+    &PartitionAllocCalloc,          /* alloc_zero_initialized_function */
+    &PartitionAllocMemalign,        /* alloc_aligned_function */
+    &PartitionAllocRealloc,         /* realloc_function */
+    &PartitionAllocFree,            /* free_function */
+    &PartitionAllocGetSizeEstimate, /* get_size_estimate_function */
+    nullptr,                        /* batch_malloc_function */
+    nullptr,                        /* batch_free_function */
+    nullptr,                        /* free_definite_size_function */
+    nullptr,                        /* aligned_malloc_function */
+    nullptr,                        /* aligned_realloc_function */
+    nullptr,                        /* aligned_free_function */
+    nullptr,                        /* next */
+};
@@ -0,0 +1,29 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_ALLOCATOR_ALLOCATOR_SHIM_DEFAULT_DISPATCH_TO_PARTITION_ALLOC_H_
+#define BASE_ALLOCATOR_ALLOCATOR_SHIM_DEFAULT_DISPATCH_TO_PARTITION_ALLOC_H_
+
+#include "base/base_export.h"
+
+namespace base {
+
+struct PartitionRootGeneric;
+
+namespace allocator {
+
+// Returns the partition which serves malloc(), operator new and the other
+// allocation functions of the process when PartitionAlloc is the default
+// allocator. It is created by the first allocation and never destroyed.
+//
+// Its statistics can be dumped with PartitionRootGeneric::DumpStats(). It
+// isn't registered with the PartitionAllocMemoryReclaimer, as registering
+// allocates memory; callers which want its free memory to be reclaimed
+// periodically should register it once the process is initialized.
+BASE_EXPORT PartitionRootGeneric* MallocPartitionRoot();
+
+}  // namespace allocator
+}  // namespace base
+
+#endif  // BASE_ALLOCATOR_ALLOCATOR_SHIM_DEFAULT_DISPATCH_TO_PARTITION_ALLOC_H_
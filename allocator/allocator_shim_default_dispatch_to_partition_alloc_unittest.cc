@@ -0,0 +1,236 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/allocator/allocator_shim_default_dispatch_to_partition_alloc.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <limits>
+
+#include "base/allocator/allocator_shim.h"
+#include "base/allocator/partition_allocator/partition_alloc.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/threading/platform_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace allocator {
+
+namespace {
+
+const AllocatorDispatch* Dispatch() {
+  return &AllocatorDispatch::default_dispatch;
+}
+
+void* Malloc(size_t size) {
+  return Dispatch()->alloc_function(Dispatch(), size, nullptr);
+}
+
+void* Calloc(size_t n, size_t size) {
+  return Dispatch()->alloc_zero_initialized_function(Dispatch(), n, size,
+                                                     nullptr);
+}
+
+void* Memalign(size_t alignment, size_t size) {
+  return Dispatch()->alloc_aligned_function(Dispatch(), alignment, size,
+                                            nullptr);
+}
+
+void* Realloc(void* address, size_t size) {
+  return Dispatch()->realloc_function(Dispatch(), address, size, nullptr);
+}
+
+void Free(void* address) {
+  Dispatch()->free_function(Dispatch(), address, nullptr);
+}
+
+size_t GetSizeEstimate(void* address) {
+  return Dispatch()->get_size_estimate_function(Dispatch(), address, nullptr);
+}
+
+bool IsAligned(void* ptr, size_t alignment) {
+  return !(reinterpret_cast<uintptr_t>(ptr) & (alignment - 1));
+}
+
+// Allocates and frees memory until stopped.
+class AllocatingThread : public PlatformThread::Delegate {
+ public:
+  void ThreadMain() override {
+    size_t size = 1;
+    while (!stop_.load(std::memory_order_relaxed)) {
+      Free(Malloc(size));
+      size = size < 2000000 ? size * 3 : 1;
+    }
+  }
+
+  void Stop() { stop_.store(true, std::memory_order_relaxed); }
+
+ private:
+  std::atomic<bool> stop_{false};
+};
+
+}  // namespace
+
+TEST(PartitionAllocAsMallocTest, Malloc) {
+  for (size_t size : {0, 1, 8, 24, 100, 1000, 10000, 100000, 2000000}) {
+    void* ptr = Malloc(size);
+    ASSERT_TRUE(ptr) << size;
+    EXPECT_TRUE(IsAligned(ptr, alignof(max_align_t))) << size;
+    EXPECT_LE(size, GetSizeEstimate(ptr));
+    // The usable size can be written to.
+    memset(ptr, 'A', GetSizeEstimate(ptr));
+    Free(ptr);
+  }
+}
+
+TEST(PartitionAllocAsMallocTest, ServedByMallocPartition) {
+  PartitionRootGeneric* root = MallocPartitionRoot();
+  ASSERT_TRUE(root);
+  EXPECT_EQ(root, MallocPartitionRoot());
+
+  const size_t total_size_before = root->total_size_of_committed_pages;
+  void* ptrs[100];
+  for (void*& ptr : ptrs)
+    ptr = Malloc(10000);
+  EXPECT_LT(total_size_before, root->total_size_of_committed_pages);
+  for (void* ptr : ptrs) {
+    EXPECT_EQ(PartitionAllocGetSize(ptr), GetSizeEstimate(ptr));
+    Free(ptr);
+  }
+}
+
+TEST(PartitionAllocAsMallocTest, FreeNull) {
+  Free(nullptr);
+  EXPECT_EQ(0u, GetSizeEstimate(nullptr));
+}
+
+TEST(PartitionAllocAsMallocTest, TooLarge) {
+  EXPECT_FALSE(Malloc(std::numeric_limits<size_t>::max()));
+  EXPECT_FALSE(Malloc(kGenericMaxDirectMapped + 1));
+}
+
+TEST(PartitionAllocAsMallocTest, Calloc) {
+  // Dirty a slot, so that the next allocation is likely to reuse it.
+  char* ptr = static_cast<char*>(Malloc(100));
+  memset(ptr, 'A', 100);
+  Free(ptr);
+
+  ptr = static_cast<char*>(Calloc(10, 10));
+  ASSERT_TRUE(ptr);
+  for (size_t i = 0; i < 100; ++i)
+    EXPECT_EQ(0, ptr[i]);
+  Free(ptr);
+
+  EXPECT_FALSE(Calloc(std::numeric_limits<size_t>::max() / 2, 3));
+}
+
+TEST(PartitionAllocAsMallocTest, Memalign) {
+  for (size_t alignment = 1; alignment <= kPartitionPageSize; alignment *= 2) {
+    for (size_t size : {1, 17, 100, 5000, 70000, 2000000}) {
+      void* ptr = Memalign(alignment, size);
+      ASSERT_TRUE(ptr) << alignment << " " << size;
+      EXPECT_TRUE(IsAligned(ptr, alignment)) << alignment << " " << size;
+      EXPECT_LE(size, GetSizeEstimate(ptr));
+      memset(ptr, 'A', size);
+      Free(ptr);
+    }
+  }
+}
+
+TEST(PartitionAllocAsMallocTest, MemalignNonPowerOfTwo) {
+  void* ptr = Memalign(48, 100);
+  ASSERT_TRUE(ptr);
+  EXPECT_TRUE(IsAligned(ptr, 64));
+  Free(ptr);
+}
+
+TEST(PartitionAllocAsMallocTest, MemalignLarge) {
+  for (size_t alignment = kPartitionPageSize * 2;
+       alignment <= kSuperPageSize * 4; alignment *= 2) {
+    for (size_t size : {0, 1, 100, 70000, 3000000}) {
+      void* ptr = Memalign(alignment, size);
+      ASSERT_TRUE(ptr) << alignment << " " << size;
+      EXPECT_TRUE(IsAligned(ptr, alignment)) << alignment << " " << size;
+      EXPECT_LE(size, GetSizeEstimate(ptr));
+      memset(ptr, 'A', GetSizeEstimate(ptr));
+      Free(ptr);
+    }
+  }
+
+  EXPECT_FALSE(Memalign(kSuperPageSize, std::numeric_limits<size_t>::max()));
+  EXPECT_FALSE(Memalign(std::numeric_limits<size_t>::max(), 100));
+}
+
+TEST(PartitionAllocAsMallocTest, ReallocLargeAlignment) {
+  char* ptr = static_cast<char*>(Memalign(kSuperPageSize, 100));
+  ASSERT_TRUE(ptr);
+  for (size_t i = 0; i < 100; ++i)
+    ptr[i] = static_cast<char>(i);
+
+  ptr = static_cast<char*>(Realloc(ptr, 200));
+  ASSERT_TRUE(ptr);
+  for (size_t i = 0; i < 100; ++i)
+    EXPECT_EQ(static_cast<char>(i), ptr[i]);
+  Free(ptr);
+
+  // Frees the allocation.
+  EXPECT_FALSE(Realloc(Memalign(kSuperPageSize, 100), 0));
+}
+
+TEST(PartitionAllocAsMallocTest, Realloc) {
+  char* ptr = static_cast<char*>(Realloc(nullptr, 10));
+  ASSERT_TRUE(ptr);
+  for (size_t i = 0; i < 10; ++i)
+    ptr[i] = static_cast<char>(i);
+
+  for (size_t size : {100, 10000, 2000000, 20}) {
+    ptr = static_cast<char*>(Realloc(ptr, size));
+    ASSERT_TRUE(ptr) << size;
+    EXPECT_TRUE(IsAligned(ptr, alignof(max_align_t))) << size;
+    EXPECT_LE(size, GetSizeEstimate(ptr));
+    for (size_t i = 0; i < 10; ++i)
+      EXPECT_EQ(static_cast<char>(i), ptr[i]) << size;
+  }
+
+  // Fails without freeing the allocation.
+  EXPECT_FALSE(Realloc(ptr, std::numeric_limits<size_t>::max()));
+  EXPECT_EQ(9, ptr[9]);
+
+  // Frees the allocation.
+  EXPECT_FALSE(Realloc(ptr, 0));
+}
+
+TEST(PartitionAllocAsMallocTest, ForkWhileAllocating) {
+  AllocatingThread allocating_thread;
+  PlatformThreadHandle handle;
+  ASSERT_TRUE(PlatformThread::Create(0, &allocating_thread, &handle));
+
+  for (int i = 0; i < 50; ++i) {
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+      // A lock left held by the allocating thread would hang the child, which
+      // is then killed.
+      alarm(10);
+      Free(Malloc(100));
+      Free(Malloc(2000000));
+      _exit(0);
+    }
+    int status;
+    ASSERT_EQ(pid, HANDLE_EINTR(waitpid(pid, &status, 0)));
+    ASSERT_TRUE(WIFEXITED(status)) << i;
+    ASSERT_EQ(0, WEXITSTATUS(status)) << i;
+  }
+
+  allocating_thread.Stop();
+  PlatformThread::Join(handle);
+}
+
+}  // namespace allocator
+}  // namespace base
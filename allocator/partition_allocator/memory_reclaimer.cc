@@ -4,7 +4,10 @@
 
 #include "base/allocator/partition_allocator/memory_reclaimer.h"
 
+#include <algorithm>
+
 #include "base/allocator/partition_allocator/partition_alloc.h"
+#include "base/allocator/partition_allocator/thread_cache.h"
 #include "base/bind.h"
 #include "base/location.h"
 #include "base/metrics/histogram_functions.h"
@@ -27,9 +30,14 @@ bool IsDeprecatedDecommitEnabled() {
   return !FeatureList::IsEnabled(internal::kPartitionAllocPeriodicDecommit);
 }
 
+constexpr int kReclaimAllFlags =
+    PartitionPurgeDecommitEmptyPages | PartitionPurgeDiscardUnusedSystemPages;
+
 }  // namespace
 
 constexpr TimeDelta PartitionAllocMemoryReclaimer::kStatsRecordingTimeDelta;
+constexpr TimeDelta PartitionAllocMemoryReclaimer::kMinReclaimInterval;
+constexpr TimeDelta PartitionAllocMemoryReclaimer::kMaxReclaimInterval;
 
 // static
 PartitionAllocMemoryReclaimer* PartitionAllocMemoryReclaimer::Instance() {
@@ -57,6 +65,7 @@ void PartitionAllocMemoryReclaimer::Start(
     scoped_refptr<SequencedTaskRunner> task_runner) {
   DCHECK(!timer_);
   DCHECK(task_runner);
+  DCHECK(task_runner->RunsTasksInCurrentSequence());
 
   {
     AutoLock lock(lock_);
@@ -80,15 +89,21 @@ void PartitionAllocMemoryReclaimer::Start(
   // seconds is useful. Since this is meant to run during idle time only, it is
   // a reasonable starting point balancing effectivenes vs cost. See
   // crbug.com/942512 for details and experimental results.
-  constexpr TimeDelta kInterval = TimeDelta::FromSeconds(4);
+  interval_ = kMinReclaimInterval;
 
-  timer_ = std::make_unique<RepeatingTimer>();
+  timer_ = std::make_unique<OneShotTimer>();
   timer_->SetTaskRunner(task_runner);
   // Here and below, |Unretained(this)| is fine as |this| lives forever, as a
   // singleton.
-  timer_->Start(
-      FROM_HERE, kInterval,
-      BindRepeating(&PartitionAllocMemoryReclaimer::Reclaim, Unretained(this)));
+  timer_->Start(FROM_HERE, interval_,
+                BindOnce(&PartitionAllocMemoryReclaimer::ReclaimAndReschedule,
+                         Unretained(this)));
+
+  // Notifications are delivered on the current sequence, which is the one of
+  // |task_runner|.
+  memory_pressure_listener_ = std::make_unique<MemoryPressureListener>(
+      BindRepeating(&PartitionAllocMemoryReclaimer::OnMemoryPressure,
+                    Unretained(this)));
 
   task_runner->PostDelayedTask(
       FROM_HERE,
@@ -101,6 +116,10 @@ PartitionAllocMemoryReclaimer::PartitionAllocMemoryReclaimer() = default;
 PartitionAllocMemoryReclaimer::~PartitionAllocMemoryReclaimer() = default;
 
 void PartitionAllocMemoryReclaimer::Reclaim() {
+  ReclaimWithFlags(kReclaimAllFlags);
+}
+
+void PartitionAllocMemoryReclaimer::ReclaimWithFlags(int flags) {
   TRACE_EVENT0("base", "PartitionAllocMemoryReclaimer::Reclaim()");
   // Reclaim will almost always call into the kernel, so tail latency of this
   // task would likely be affected by descheduling.
@@ -108,13 +127,16 @@ void PartitionAllocMemoryReclaimer::Reclaim() {
   // On Linux (and Android) at least, ThreadTicks also includes kernel time, so
   // this is a good measure of the true cost of decommit.
   ElapsedThreadTimer timer;
-  constexpr int kFlags =
-      PartitionPurgeDecommitEmptyPages | PartitionPurgeDiscardUnusedSystemPages;
+
+  // Return the slots held by thread caches first, so that the pages they empty
+  // can be decommitted below. Other threads only purge their cache the next
+  // time they free memory, so their slots are reclaimed by the next call.
+  internal::ThreadCacheRegistry::Instance().PurgeAll();
 
   {
     AutoLock lock(lock_);  // Has to protect from concurrent (Un)Register calls.
     for (auto* partition : partitions_)
-      partition->PurgeMemory(kFlags);
+      partition->PurgeMemory(flags);
   }
 
   has_called_reclaim_ = true;
@@ -122,6 +144,43 @@ void PartitionAllocMemoryReclaimer::Reclaim() {
     total_reclaim_thread_time_ += timer.Elapsed();
 }
 
+void PartitionAllocMemoryReclaimer::ReclaimAndReschedule() {
+  switch (memory_pressure_level_) {
+    case MemoryPressureListener::MEMORY_PRESSURE_LEVEL_NONE:
+      // Nothing needs the memory, so let the system take it only if it ends
+      // up needing it, and reclaim less often.
+      ReclaimWithFlags(kReclaimAllFlags | PartitionPurgeColdBucketsOnly |
+                       PartitionPurgeLazily);
+      interval_ = std::min(interval_ * 2, kMaxReclaimInterval);
+      break;
+    case MemoryPressureListener::MEMORY_PRESSURE_LEVEL_MODERATE:
+      ReclaimWithFlags(kReclaimAllFlags | PartitionPurgeColdBucketsOnly);
+      interval_ = kMinReclaimInterval;
+      break;
+    case MemoryPressureListener::MEMORY_PRESSURE_LEVEL_CRITICAL:
+      ReclaimWithFlags(kReclaimAllFlags);
+      interval_ = kMinReclaimInterval;
+      break;
+  }
+  memory_pressure_level_ = MemoryPressureListener::MEMORY_PRESSURE_LEVEL_NONE;
+
+  timer_->Start(FROM_HERE, interval_,
+                BindOnce(&PartitionAllocMemoryReclaimer::ReclaimAndReschedule,
+                         Unretained(this)));
+}
+
+void PartitionAllocMemoryReclaimer::OnMemoryPressure(
+    MemoryPressureListener::MemoryPressureLevel level) {
+  memory_pressure_level_ = std::max(memory_pressure_level_, level);
+  // Don't wait for the next periodic reclaim, which can be a while away.
+  if (level == MemoryPressureListener::MEMORY_PRESSURE_LEVEL_CRITICAL &&
+      timer_->IsRunning()) {
+    timer_->Start(FROM_HERE, TimeDelta(),
+                  BindOnce(&PartitionAllocMemoryReclaimer::ReclaimAndReschedule,
+                           Unretained(this)));
+  }
+}
+
 void PartitionAllocMemoryReclaimer::DeprecatedReclaim() {
   if (!IsDeprecatedDecommitEnabled())
     return;
@@ -147,6 +206,9 @@ void PartitionAllocMemoryReclaimer::ResetForTesting() {
   has_called_reclaim_ = false;
   total_reclaim_thread_time_ = TimeDelta();
   timer_ = nullptr;
+  interval_ = kMinReclaimInterval;
+  memory_pressure_listener_ = nullptr;
+  memory_pressure_level_ = MemoryPressureListener::MEMORY_PRESSURE_LEVEL_NONE;
   partitions_.clear();
 }
 
@@ -12,6 +12,7 @@
 #include "base/callback.h"
 #include "base/feature_list.h"
 #include "base/location.h"
+#include "base/memory/memory_pressure_listener.h"
 #include "base/no_destructor.h"
 #include "base/single_thread_task_runner.h"
 #include "base/thread_annotations.h"
@@ -31,6 +32,12 @@ BASE_EXPORT extern const Feature kPartitionAllocPeriodicDecommit;
 
 // Posts and handles memory reclaim tasks for PartitionAlloc.
 //
+// Periodic reclaim adapts to the process: it leaves alone the buckets which
+// recently reused their empty slot spans, as purging them would only cause
+// page faults, and backs off while there is no memory pressure. Under moderate
+// pressure, it goes back to its initial frequency. Under critical pressure, it
+// reclaims all it can right away.
+//
 // Thread safety: |RegisterPartition()| and |UnregisterPartition()| can be
 // called from any thread, concurrently with reclaim. Reclaim itself runs in the
 // context of the provided |SequencedTaskRunner|, meaning that the caller must
@@ -48,28 +55,40 @@ class BASE_EXPORT PartitionAllocMemoryReclaimer {
   // Internal. Do not use.
   // Unregisters a partition to be tracked by the reclaimer.
   void UnregisterPartition(internal::PartitionRootBase* partition);
-  // Starts the periodic reclaim. Should be called once.
+  // Starts the periodic reclaim. Should be called once, on the sequence of
+  // |task_runner|.
   void Start(scoped_refptr<SequencedTaskRunner> task_runner);
-  // Triggers an explicit reclaim now.
+  // Triggers an explicit reclaim of all the memory which can be, now.
   void Reclaim();
   // Triggers a reclaim. Do not add new callers.
   void DeprecatedReclaim();
 
   static constexpr TimeDelta kStatsRecordingTimeDelta =
       TimeDelta::FromMinutes(5);
+  // Bounds of the interval between two periodic reclaims.
+  static constexpr TimeDelta kMinReclaimInterval = TimeDelta::FromSeconds(4);
+  static constexpr TimeDelta kMaxReclaimInterval = TimeDelta::FromSeconds(64);
 
  private:
   PartitionAllocMemoryReclaimer();
   ~PartitionAllocMemoryReclaimer();
+  // |flags| is an OR of base::PartitionPurgeFlags.
+  void ReclaimWithFlags(int flags);
   void ReclaimAndReschedule();
+  void OnMemoryPressure(MemoryPressureListener::MemoryPressureLevel level);
   void RecordStatistics();
   void ResetForTesting();
 
   // Total time spent in |Reclaim()|.
   bool has_called_reclaim_ = false;
   TimeDelta total_reclaim_thread_time_;
-  // Schedules periodic |Reclaim()|.
-  std::unique_ptr<RepeatingTimer> timer_;
+  // Schedules the next |ReclaimAndReschedule()|, |interval_| from now.
+  std::unique_ptr<OneShotTimer> timer_;
+  TimeDelta interval_ = kMinReclaimInterval;
+  std::unique_ptr<MemoryPressureListener> memory_pressure_listener_;
+  // Highest level reported since the last periodic reclaim.
+  MemoryPressureListener::MemoryPressureLevel memory_pressure_level_ =
+      MemoryPressureListener::MEMORY_PRESSURE_LEVEL_NONE;
 
   Lock lock_;
   std::set<internal::PartitionRootBase*> partitions_ GUARDED_BY(lock_);
@@ -8,6 +8,7 @@
 #include <utility>
 
 #include "base/allocator/partition_allocator/partition_alloc.h"
+#include "base/memory/memory_pressure_listener.h"
 #include "base/test/metrics/histogram_tester.h"
 #include "base/test/scoped_feature_list.h"
 #include "base/test/scoped_task_environment.h"
@@ -147,6 +148,56 @@ TEST_F(PartitionAllocMemoryReclaimerTest, DeprecatedReclaim) {
   }
 }
 
+TEST_F(PartitionAllocMemoryReclaimerTest, BacksOffWithoutMemoryPressure) {
+  StartReclaimer();
+  TimeDelta interval = PartitionAllocMemoryReclaimer::kMinReclaimInterval;
+  EXPECT_EQ(interval, task_environment_.NextMainThreadPendingTaskDelay());
+
+  while (interval < PartitionAllocMemoryReclaimer::kMaxReclaimInterval) {
+    task_environment_.FastForwardBy(interval);
+    interval *= 2;
+    EXPECT_EQ(interval, task_environment_.NextMainThreadPendingTaskDelay());
+  }
+  task_environment_.FastForwardBy(interval);
+  EXPECT_EQ(PartitionAllocMemoryReclaimer::kMaxReclaimInterval,
+            task_environment_.NextMainThreadPendingTaskDelay());
+}
+
+TEST_F(PartitionAllocMemoryReclaimerTest, ModerateMemoryPressure) {
+  StartReclaimer();
+  task_environment_.FastForwardBy(
+      PartitionAllocMemoryReclaimer::kMinReclaimInterval);
+  TimeDelta delay = task_environment_.NextMainThreadPendingTaskDelay();
+  EXPECT_EQ(2 * PartitionAllocMemoryReclaimer::kMinReclaimInterval, delay);
+
+  // Waits for the next periodic reclaim, then reclaims often again.
+  MemoryPressureListener::SimulatePressureNotification(
+      MemoryPressureListener::MEMORY_PRESSURE_LEVEL_MODERATE);
+  task_environment_.RunUntilIdle();
+  EXPECT_EQ(delay, task_environment_.NextMainThreadPendingTaskDelay());
+  task_environment_.FastForwardBy(delay);
+  EXPECT_EQ(PartitionAllocMemoryReclaimer::kMinReclaimInterval,
+            task_environment_.NextMainThreadPendingTaskDelay());
+}
+
+TEST_F(PartitionAllocMemoryReclaimerTest, CriticalMemoryPressure) {
+  PartitionRootGeneric* root = allocator_->root();
+  StartReclaimer();
+  task_environment_.FastForwardBy(
+      PartitionAllocMemoryReclaimer::kMinReclaimInterval);
+
+  AllocateAndFree();
+  size_t committed_before = root->total_size_of_committed_pages;
+
+  // Reclaims right away.
+  MemoryPressureListener::SimulatePressureNotification(
+      MemoryPressureListener::MEMORY_PRESSURE_LEVEL_CRITICAL);
+  task_environment_.RunUntilIdle();
+  EXPECT_LT(root->total_size_of_committed_pages, committed_before);
+  EXPECT_EQ(PartitionAllocMemoryReclaimer::kMinReclaimInterval,
+            task_environment_.NextMainThreadPendingTaskDelay());
+}
+
 TEST_F(PartitionAllocMemoryReclaimerTest, StatsRecording) {
   // No stats reported if the timer is not.
   if (!ElapsedThreadTimer().is_supported())
@@ -219,6 +219,29 @@ void DiscardSystemPages(void* address, size_t length) {
   DiscardSystemPagesInternal(address, length);
 }
 
+void DecommitSystemPagesLazily(void* address, size_t length) {
+  DCHECK_EQ(0UL, length & kSystemPageOffsetMask);
+  DecommitSystemPagesLazilyInternal(address, length);
+}
+
+void DiscardSystemPagesLazily(void* address, size_t length) {
+  DCHECK_EQ(0UL, length & kSystemPageOffsetMask);
+  DiscardSystemPagesLazilyInternal(address, length);
+}
+
+bool HugePagesAvailable() {
+  return HugePagesAvailableInternal();
+}
+
+bool AdviseHugePages(void* address, size_t length) {
+  DCHECK_EQ(0UL, length & kSystemPageOffsetMask);
+  return AdviseHugePagesInternal(address, length);
+}
+
+size_t GetHugePageResidentBytes(const void* address, size_t length) {
+  return GetHugePageResidentBytesInternal(address, length);
+}
+
 bool ReserveAddressSpace(size_t size) {
   // To avoid deadlock, call only SystemAllocPages.
   subtle::SpinLock::Guard guard(GetReserveLock());
@@ -142,6 +142,36 @@ BASE_EXPORT WARN_UNUSED_RESULT bool RecommitSystemPages(
 // based on the original page content, or a page of zeroes.
 BASE_EXPORT void DiscardSystemPages(void* address, size_t length);
 
+// Returns whether the system can back memory with transparent huge pages, as
+// requested by AdviseHugePages().
+BASE_EXPORT bool HugePagesAvailable();
+
+// Hints that the pages starting at |address| and continuing for |length| bytes
+// should be backed by transparent huge pages. Only the naturally aligned huge
+// pages which are entirely within a mapping of uniform permissions can be.
+// |address| and |length| must be multiples of |kSystemPageSize|.
+//
+// Returns false if the hint was rejected, in which case the pages are left
+// as they were.
+BASE_EXPORT bool AdviseHugePages(void* address, size_t length);
+
+// Returns the number of bytes starting at |address| and continuing for
+// |length| bytes which are currently backed by transparent huge pages, or 0 if
+// the system doesn't report it. This is slow, but doesn't allocate memory, so
+// it can be called by allocators.
+BASE_EXPORT size_t GetHugePageResidentBytes(const void* address,
+                                            size_t length);
+
+// Same as DecommitSystemPages(), except that the system may only reclaim the
+// physical pages when it runs short of memory, which makes reusing them
+// cheaper until then. This uses MADV_FREE on Linux, and is the same as
+// DecommitSystemPages() elsewhere.
+BASE_EXPORT void DecommitSystemPagesLazily(void* address, size_t length);
+
+// Same as DiscardSystemPages(), except that the system may only reclaim the
+// physical pages when it runs short of memory. See DecommitSystemPagesLazily().
+BASE_EXPORT void DiscardSystemPagesLazily(void* address, size_t length);
+
 // Rounds up |address| to the next multiple of |kSystemPageSize|. Returns
 // 0 for an |address| of 0.
 constexpr ALWAYS_INLINE uintptr_t RoundUpToSystemPage(uintptr_t address) {
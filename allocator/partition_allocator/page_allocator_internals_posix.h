@@ -21,6 +21,16 @@
 
 #include <algorithm>
 #endif
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "base/posix/eintr_wrapper.h"
+#endif
 
 #ifndef MAP_ANONYMOUS
 #define MAP_ANONYMOUS MAP_ANON
@@ -180,6 +190,124 @@ void DiscardSystemPagesInternal(void* address, size_t length) {
 #endif
 }
 
+void DiscardSystemPagesLazilyInternal(void* address, size_t length) {
+#if (defined(OS_LINUX) || defined(OS_ANDROID)) && defined(MADV_FREE)
+  // The pages are reclaimed only under memory pressure, and writing to them
+  // before that cancels the discard. Fails on kernels older than 4.5.
+  if (!madvise(address, length, MADV_FREE))
+    return;
+#endif
+  DiscardSystemPagesInternal(address, length);
+}
+
+void DecommitSystemPagesLazilyInternal(void* address, size_t length) {
+  // See DecommitSystemPagesInternal().
+  DiscardSystemPagesLazilyInternal(address, length);
+}
+
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+
+namespace {
+
+// Accumulates into |*huge_page_bytes| the huge page usage reported by |line|
+// of /proc/self/smaps, for the part of the current mapping which overlaps
+// [|begin|, |end|). |*overlap| is the size of that part.
+void ParseSmapsLine(const char* line,
+                    uintptr_t begin,
+                    uintptr_t end,
+                    size_t* overlap,
+                    size_t* huge_page_bytes) {
+  static constexpr char kAnonHugePages[] = "AnonHugePages:";
+  if (!strncmp(line, kAnonHugePages, sizeof(kAnonHugePages) - 1)) {
+    const size_t kilobytes =
+        strtoul(line + sizeof(kAnonHugePages) - 1, nullptr, 10);
+    *huge_page_bytes += std::min(kilobytes * 1024, *overlap);
+    return;
+  }
+
+  // Mappings start with a "<start>-<end> " line, in hexadecimal.
+  char* separator;
+  const uintptr_t mapping_begin = strtoul(line, &separator, 16);
+  if (separator == line || *separator != '-')
+    return;
+  const uintptr_t mapping_end = strtoul(separator + 1, nullptr, 16);
+  const uintptr_t overlap_begin = std::max(begin, mapping_begin);
+  const uintptr_t overlap_end = std::min(end, mapping_end);
+  *overlap = overlap_begin < overlap_end ? overlap_end - overlap_begin : 0;
+}
+
+}  // namespace
+
+bool HugePagesAvailableInternal() {
+  int fd = HANDLE_EINTR(
+      open("/sys/kernel/mm/transparent_hugepage/enabled", O_RDONLY | O_CLOEXEC));
+  if (fd < 0)
+    return false;
+  char buffer[128];
+  ssize_t size = HANDLE_EINTR(read(fd, buffer, sizeof(buffer) - 1));
+  IGNORE_EINTR(close(fd));
+  if (size <= 0)
+    return false;
+  buffer[size] = '\0';
+  // Both "[always]" and "[madvise]" honor MADV_HUGEPAGE.
+  return !strstr(buffer, "[never]");
+}
+
+bool AdviseHugePagesInternal(void* address, size_t length) {
+#if defined(MADV_HUGEPAGE)
+  return !madvise(address, length, MADV_HUGEPAGE);
+#else
+  return false;
+#endif
+}
+
+size_t GetHugePageResidentBytesInternal(const void* address, size_t length) {
+  int fd = HANDLE_EINTR(open("/proc/self/smaps", O_RDONLY | O_CLOEXEC));
+  if (fd < 0)
+    return 0;
+
+  const uintptr_t begin = reinterpret_cast<uintptr_t>(address);
+  const uintptr_t end = begin + length;
+  size_t overlap = 0;
+  size_t huge_page_bytes = 0;
+  // The file is read in chunks, and split in lines of which only the
+  // beginning matters, with fixed-size buffers.
+  char line[128];
+  size_t line_length = 0;
+  char buffer[4096];
+  ssize_t size;
+  while ((size = HANDLE_EINTR(read(fd, buffer, sizeof(buffer)))) > 0) {
+    for (ssize_t i = 0; i < size; ++i) {
+      if (buffer[i] != '\n') {
+        if (line_length < sizeof(line) - 1)
+          line[line_length++] = buffer[i];
+        continue;
+      }
+      line[line_length] = '\0';
+      line_length = 0;
+      ParseSmapsLine(line, begin, end, &overlap, &huge_page_bytes);
+    }
+  }
+  IGNORE_EINTR(close(fd));
+  return huge_page_bytes;
+}
+
+#else
+
+bool HugePagesAvailableInternal() {
+  return false;
+}
+
+bool AdviseHugePagesInternal(void* address, size_t length) {
+  return false;
+}
+
+size_t GetHugePageResidentBytesInternal(const void* address, size_t length) {
+  return 0;
+}
+
+#endif  // defined(OS_LINUX) || defined(OS_ANDROID)
+
 }  // namespace base
 
 #endif  // BASE_ALLOCATOR_PARTITION_ALLOCATOR_PAGE_ALLOCATOR_INTERNALS_POSIX_H_
@@ -139,6 +139,28 @@ void DiscardSystemPagesInternal(void* address, size_t length) {
   }
 }
 
+void DecommitSystemPagesLazilyInternal(void* address, size_t length) {
+  DecommitSystemPagesInternal(address, length);
+}
+
+void DiscardSystemPagesLazilyInternal(void* address, size_t length) {
+  DiscardSystemPagesInternal(address, length);
+}
+
+bool HugePagesAvailableInternal() {
+  // Large pages require a privilege, and can't be requested after the memory
+  // is allocated.
+  return false;
+}
+
+bool AdviseHugePagesInternal(void* address, size_t length) {
+  return false;
+}
+
+size_t GetHugePageResidentBytesInternal(const void* address, size_t length) {
+  return 0;
+}
+
 }  // namespace base
 
 #endif  // BASE_ALLOCATOR_PARTITION_ALLOCATOR_PAGE_ALLOCATOR_INTERNALS_WIN_H_
@@ -133,6 +133,41 @@ TEST(PageAllocatorTest, AllocAndFreePages) {
   FreePages(buffer, kPageAllocationGranularity);
 }
 
+TEST(PageAllocatorTest, HugePages) {
+  constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+  constexpr size_t kLength = 4 * kHugePageSize;
+  char* buffer = static_cast<char*>(AllocPages(nullptr, kLength, kHugePageSize,
+                                               PageReadWrite,
+                                               PageTag::kChromium, true));
+  ASSERT_TRUE(buffer);
+  if (HugePagesAvailable())
+    EXPECT_TRUE(AdviseHugePages(buffer, kLength));
+  memset(buffer, 'A', kLength);
+  // Whether the system found free huge pages isn't known.
+  EXPECT_GE(kLength, GetHugePageResidentBytes(buffer, kLength));
+  EXPECT_GE(kHugePageSize, GetHugePageResidentBytes(buffer, kHugePageSize));
+  FreePages(buffer, kLength);
+}
+
+TEST(PageAllocatorTest, LazilyReleasedPages) {
+  char* buffer = static_cast<char*>(AllocPages(
+      nullptr, kPageAllocationGranularity, kPageAllocationGranularity,
+      PageReadWrite, PageTag::kChromium, true));
+  ASSERT_TRUE(buffer);
+  memset(buffer, 'A', kSystemPageSize);
+
+  // The pages stay usable, with unspecified contents.
+  DiscardSystemPagesLazily(buffer, kSystemPageSize);
+  buffer[0] = 'B';
+  EXPECT_EQ('B', buffer[0]);
+
+  DecommitSystemPagesLazily(buffer, kSystemPageSize);
+  EXPECT_TRUE(RecommitSystemPages(buffer, kSystemPageSize, PageReadWrite));
+  buffer[0] = 'C';
+  EXPECT_EQ('C', buffer[0]);
+  FreePages(buffer, kPageAllocationGranularity);
+}
+
 // Test permission setting on POSIX, where we can set a trap handler.
 #if defined(OS_POSIX)
 
@@ -15,6 +15,7 @@
 #include "base/allocator/partition_allocator/spin_lock.h"
 #include "base/logging.h"
 #include "base/no_destructor.h"
+#include "base/strings/stringprintf.h"
 
 namespace base {
 
@@ -53,7 +54,10 @@ internal::PartitionRootBase::~PartitionRootBase() = default;
 PartitionRoot::PartitionRoot() = default;
 PartitionRoot::~PartitionRoot() = default;
 PartitionRootGeneric::PartitionRootGeneric() = default;
-PartitionRootGeneric::~PartitionRootGeneric() = default;
+PartitionRootGeneric::~PartitionRootGeneric() {
+  if (with_thread_cache)
+    internal::ThreadCache::Shutdown(this);
+}
 PartitionAllocatorGeneric::PartitionAllocatorGeneric() = default;
 
 subtle::SpinLock& GetLock() {
@@ -203,7 +207,7 @@ void PartitionRoot::Init(size_t num_buckets, size_t max_allocation) {
   }
 }
 
-void PartitionRootGeneric::Init() {
+void PartitionRootGeneric::Init(bool enable_thread_cache, size_t num_shards) {
   subtle::SpinLock::Guard guard(this->lock);
 
   PartitionAllocBaseInit(this);
@@ -286,6 +290,20 @@ void PartitionRootGeneric::Init() {
   // And there's one last bucket lookup that will be hit for e.g. malloc(-1),
   // which tries to overflow to a non-existant order.
   *bucket_ptr = internal::PartitionBucket::get_sentinel_bucket();
+
+  if (enable_thread_cache) {
+    internal::ThreadCache::Init(this);
+    this->with_thread_cache = true;
+  }
+
+  if (num_shards > 1) {
+    CHECK(!enable_thread_cache)
+        << "A partition can't have both thread caches and shards";
+    this->num_shards = num_shards;
+    this->shards.reset(new PartitionRootGeneric[num_shards]);
+    for (size_t i = 0; i < num_shards; ++i)
+      this->shards[i].Init();
+  }
 }
 
 bool PartitionReallocDirectMappedInPlace(PartitionRootGeneric* root,
@@ -451,7 +469,10 @@ void* PartitionRootGeneric::TryRealloc(void* ptr,
                                       new_size, type_name);
 }
 
-static size_t PartitionPurgePage(internal::PartitionPage* page, bool discard) {
+// Discards the unused system pages of |page| with |discard|, if not null.
+// Returns the number of discardable bytes.
+static size_t PartitionPurgePage(internal::PartitionPage* page,
+                                 void (*discard)(void*, size_t)) {
   const internal::PartitionBucket* bucket = page->bucket;
   size_t slot_size = bucket->slot_size;
   if (slot_size < kSystemPageSize || !page->num_allocated_slots)
@@ -468,7 +489,7 @@ static size_t PartitionPurgePage(internal::PartitionPage* page, bool discard) {
       char* ptr =
           reinterpret_cast<char*>(internal::PartitionPage::ToPointer(page));
       ptr += used_bytes;
-      DiscardSystemPages(ptr, discardable_bytes);
+      discard(ptr, discardable_bytes);
     }
     return discardable_bytes;
   }
@@ -514,7 +535,7 @@ static size_t PartitionPurgePage(internal::PartitionPage* page, bool discard) {
     DCHECK(num_slots);
   }
   // First, do the work of calculating the discardable bytes. Don't actually
-  // discard anything unless the discard flag was passed in.
+  // discard anything unless a discard function was passed in.
   if (truncated_slots) {
     size_t unprovisioned_bytes = 0;
     char* begin_ptr = ptr + (num_slots * slot_size);
@@ -555,7 +576,7 @@ static size_t PartitionPurgePage(internal::PartitionPage* page, bool discard) {
           internal::PartitionFreelistEntry::Transform(page->freelist_head);
       DCHECK(num_new_entries == num_slots - page->num_allocated_slots);
       // Discard the memory.
-      DiscardSystemPages(begin_ptr, unprovisioned_bytes);
+      discard(begin_ptr, unprovisioned_bytes);
     }
   }
 
@@ -584,43 +605,64 @@ static size_t PartitionPurgePage(internal::PartitionPage* page, bool discard) {
       size_t partial_slot_bytes = end_ptr - begin_ptr;
       discardable_bytes += partial_slot_bytes;
       if (discard)
-        DiscardSystemPages(begin_ptr, partial_slot_bytes);
+        discard(begin_ptr, partial_slot_bytes);
     }
   }
   return discardable_bytes;
 }
 
-static void PartitionPurgeBucket(internal::PartitionBucket* bucket) {
+static void PartitionPurgeBucket(internal::PartitionBucket* bucket,
+                                 void (*discard)(void*, size_t)) {
   if (bucket->active_pages_head !=
       internal::PartitionPage::get_sentinel_page()) {
     for (internal::PartitionPage* page = bucket->active_pages_head; page;
          page = page->next_page) {
       DCHECK(page != internal::PartitionPage::get_sentinel_page());
-      PartitionPurgePage(page, true);
+      PartitionPurgePage(page, discard);
     }
   }
 }
 
 void PartitionRoot::PurgeMemory(int flags) {
   if (flags & PartitionPurgeDecommitEmptyPages)
-    DecommitEmptyPages();
+    DecommitEmptyPages(flags);
   // We don't currently do anything for PartitionPurgeDiscardUnusedSystemPages
   // here because that flag is only useful for allocations >= system page size.
   // We only have allocations that large inside generic partitions at the
   // moment.
+  ResetChurningBuckets();
+}
+
+bool PartitionRootGeneric::EnableHugePages() {
+  for (size_t i = 0; i < this->num_shards; ++i) {
+    if (!this->shards[i].EnableHugePages())
+      return false;
+  }
+  subtle::SpinLock::Guard guard(this->lock);
+  return PartitionRootBase::EnableHugePages();
 }
 
 void PartitionRootGeneric::PurgeMemory(int flags) {
+  for (size_t i = 0; i < this->num_shards; ++i)
+    this->shards[i].PurgeMemory(flags);
+
   subtle::SpinLock::Guard guard(this->lock);
   if (flags & PartitionPurgeDecommitEmptyPages)
-    DecommitEmptyPages();
+    DecommitEmptyPages(flags);
   if (flags & PartitionPurgeDiscardUnusedSystemPages) {
+    const bool cold_buckets_only = flags & PartitionPurgeColdBucketsOnly;
+    auto* discard = flags & PartitionPurgeLazily ? &DiscardSystemPagesLazily
+                                                 : &DiscardSystemPages;
     for (size_t i = 0; i < kGenericNumBuckets; ++i) {
       internal::PartitionBucket* bucket = &this->buckets[i];
-      if (bucket->slot_size >= kSystemPageSize)
-        PartitionPurgeBucket(bucket);
+      if (bucket->slot_size < kSystemPageSize)
+        continue;
+      if (cold_buckets_only && IsBucketChurning(bucket))
+        continue;
+      PartitionPurgeBucket(bucket, discard);
     }
   }
+  ResetChurningBuckets();
 }
 
 static void PartitionDumpPageStats(PartitionBucketMemoryStats* stats_out,
@@ -632,7 +674,7 @@ static void PartitionDumpPageStats(PartitionBucketMemoryStats* stats_out,
     return;
   }
 
-  stats_out->discardable_bytes += PartitionPurgePage(page, false);
+  stats_out->discardable_bytes += PartitionPurgePage(page, nullptr);
 
   size_t raw_size = page->get_raw_size();
   if (raw_size) {
@@ -703,15 +745,94 @@ static void PartitionDumpBucketStats(PartitionBucketMemoryStats* stats_out,
   }
 }
 
+namespace {
+
+// Most partitions have few super page extents, as super pages are allocated
+// next to each other when possible.
+constexpr size_t kMaxReportableExtents = 16;
+
+struct SuperPageExtents {
+  size_t count = 0;
+  const char* begin[kMaxReportableExtents];
+  const char* end[kMaxReportableExtents];
+};
+
+void PartitionCollectSuperPageExtents(const internal::PartitionRootBase* root,
+                                      SuperPageExtents* extents) {
+  for (const internal::PartitionSuperPageExtentEntry* extent =
+           root->first_extent;
+       extent && extents->count < kMaxReportableExtents;
+       extent = extent->next, ++extents->count) {
+    extents->begin[extents->count] = extent->super_page_base;
+    extents->end[extents->count] = extent->super_pages_end;
+  }
+}
+
+// Reads the huge page usage from the system, which is slow, so the partition
+// lock must not be held.
+size_t PartitionHugePageResidentBytes(const SuperPageExtents& extents) {
+  size_t resident_bytes = 0;
+  for (size_t i = 0; i < extents.count; ++i) {
+    resident_bytes += GetHugePageResidentBytes(
+        extents.begin[i], extents.end[i] - extents.begin[i]);
+  }
+  return resident_bytes;
+}
+
+// Forwards the statistics of a shard to another dumper, and keeps its totals
+// to add them to those of the sharded partition.
+class ShardStatsDumper : public PartitionStatsDumper {
+ public:
+  explicit ShardStatsDumper(PartitionStatsDumper* dumper) : dumper_(dumper) {}
+
+  void PartitionDumpTotals(const char* partition_name,
+                           const PartitionMemoryStats* stats) override {
+    totals_ = *stats;
+    dumper_->PartitionDumpTotals(partition_name, stats);
+  }
+
+  void PartitionsDumpBucketStats(
+      const char* partition_name,
+      const PartitionBucketMemoryStats* stats) override {
+    dumper_->PartitionsDumpBucketStats(partition_name, stats);
+  }
+
+  const PartitionMemoryStats& totals() const { return totals_; }
+
+ private:
+  PartitionStatsDumper* const dumper_;
+  PartitionMemoryStats totals_ = {};
+};
+
+}  // namespace
+
 void PartitionRootGeneric::DumpStats(const char* partition_name,
                                      bool is_light_dump,
                                      PartitionStatsDumper* dumper) {
   PartitionMemoryStats stats = {0};
-  stats.total_mmapped_bytes =
+  for (size_t i = 0; i < this->num_shards; ++i) {
+    ShardStatsDumper shard_dumper(dumper);
+    this->shards[i].DumpStats(
+        StringPrintf("%s/shard_%zu", partition_name, i).c_str(), is_light_dump,
+        &shard_dumper);
+    const PartitionMemoryStats& shard_stats = shard_dumper.totals();
+    stats.total_mmapped_bytes += shard_stats.total_mmapped_bytes;
+    stats.total_committed_bytes += shard_stats.total_committed_bytes;
+    stats.total_resident_bytes += shard_stats.total_resident_bytes;
+    stats.total_active_bytes += shard_stats.total_active_bytes;
+    stats.total_decommittable_bytes += shard_stats.total_decommittable_bytes;
+    stats.total_discardable_bytes += shard_stats.total_discardable_bytes;
+    stats.total_huge_page_bytes += shard_stats.total_huge_page_bytes;
+    stats.total_huge_page_resident_bytes +=
+        shard_stats.total_huge_page_resident_bytes;
+  }
+
+  stats.total_mmapped_bytes +=
       this->total_size_of_super_pages + this->total_size_of_direct_mapped_pages;
-  stats.total_committed_bytes = this->total_size_of_committed_pages;
+  stats.total_committed_bytes += this->total_size_of_committed_pages;
 
   size_t direct_mapped_allocations_total_size = 0;
+  SuperPageExtents huge_page_extents;
 
   static const size_t kMaxReportableDirectMaps = 4096;
 
@@ -756,7 +877,13 @@ void PartitionRootGeneric::DumpStats(const char* partition_name,
         continue;
       direct_map_lengths[num_direct_mapped_allocations] = slot_size;
     }
+
+    stats.total_huge_page_bytes += this->total_size_of_huge_page_super_pages;
+    if (!is_light_dump && this->total_size_of_huge_page_super_pages)
+      PartitionCollectSuperPageExtents(this, &huge_page_extents);
   }
+  stats.total_huge_page_resident_bytes +=
+      PartitionHugePageResidentBytes(huge_page_extents);
 
   if (!is_light_dump) {
     // Call |PartitionsDumpBucketStats| after collecting stats because it can
@@ -784,6 +911,15 @@ void PartitionRootGeneric::DumpStats(const char* partition_name,
 
   stats.total_resident_bytes += direct_mapped_allocations_total_size;
   stats.total_active_bytes += direct_mapped_allocations_total_size;
+
+  stats.has_thread_cache = this->with_thread_cache;
+  if (stats.has_thread_cache) {
+    internal::ThreadCacheRegistry::Instance().DumpStats(
+        true, &stats.current_thread_cache_stats);
+    internal::ThreadCacheRegistry::Instance().DumpStats(
+        false, &stats.all_thread_caches_stats);
+  }
+
   dumper->PartitionDumpTotals(partition_name, &stats);
 }
 
@@ -794,6 +930,13 @@ void PartitionRoot::DumpStats(const char* partition_name,
   stats.total_mmapped_bytes = this->total_size_of_super_pages;
   stats.total_committed_bytes = this->total_size_of_committed_pages;
   DCHECK(!this->total_size_of_direct_mapped_pages);
+  stats.total_huge_page_bytes = this->total_size_of_huge_page_super_pages;
+  if (!is_light_dump && this->total_size_of_huge_page_super_pages) {
+    SuperPageExtents huge_page_extents;
+    PartitionCollectSuperPageExtents(this, &huge_page_extents);
+    stats.total_huge_page_resident_bytes =
+        PartitionHugePageResidentBytes(huge_page_extents);
+  }
 
   static constexpr size_t kMaxReportableBuckets = 4096 / sizeof(void*);
   std::unique_ptr<PartitionBucketMemoryStats[]> memory_stats;
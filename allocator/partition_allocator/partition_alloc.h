@@ -63,6 +63,8 @@
 #include <limits.h>
 #include <string.h>
 
+#include <memory>
+
 #include "base/allocator/partition_allocator/memory_reclaimer.h"
 #include "base/allocator/partition_allocator/page_allocator.h"
 #include "base/allocator/partition_allocator/partition_alloc_constants.h"
@@ -71,6 +73,7 @@
 #include "base/allocator/partition_allocator/partition_page.h"
 #include "base/allocator/partition_allocator/partition_root_base.h"
 #include "base/allocator/partition_allocator/spin_lock.h"
+#include "base/allocator/partition_allocator/thread_cache.h"
 #include "base/base_export.h"
 #include "base/bits.h"
 #include "base/compiler_specific.h"
@@ -83,6 +86,10 @@
 #include <stdlib.h>
 #endif
 
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+#include <sched.h>
+#endif
+
 // We use this to make MEMORY_TOOL_REPLACES_ALLOCATOR behave the same for max
 // size as other alloc code.
 #define CHECK_MAX_SIZE_OR_RETURN_NULLPTR(size, flags) \
@@ -97,16 +104,6 @@ namespace base {
 
 class PartitionStatsDumper;
 
-enum PartitionPurgeFlags {
-  // Decommitting the ring list of empty pages is reasonably fast.
-  PartitionPurgeDecommitEmptyPages = 1 << 0,
-  // Discarding unused system pages is slower, because it involves walking all
-  // freelists in all active partition pages of all buckets >= system page
-  // size. It often frees a similar amount of memory to decommitting the empty
-  // pages, though.
-  PartitionPurgeDiscardUnusedSystemPages = 1 << 1,
-};
-
 // Never instantiate a PartitionRoot directly, instead use PartitionAlloc.
 struct BASE_EXPORT PartitionRoot : public internal::PartitionRootBase {
   PartitionRoot();
@@ -152,9 +149,25 @@ struct BASE_EXPORT PartitionRootGeneric : public internal::PartitionRootBase {
       bucket_lookups[((kBitsPerSizeT + 1) * kGenericNumBucketsPerOrder) + 1] =
           {};
   internal::PartitionBucket buckets[kGenericNumBuckets] = {};
+  // Whether small allocations go through per-thread caches. See
+  // internal::ThreadCache.
+  bool with_thread_cache = false;
+  // Sub-partitions serving allocations up to |kGenericMaxShardedSize|, each
+  // with its own lock and buckets. Empty if the partition isn't sharded, see
+  // Init().
+  size_t num_shards = 0;
+  std::unique_ptr<PartitionRootGeneric[]> shards;
 
   // Public API.
-  void Init();
+  // |enable_thread_cache| can only be true for one partition at a time.
+  //
+  // If |num_shards| is greater than 1, small allocations are served by that
+  // many shards, selected by the CPU which the calling thread runs on, so
+  // that threads running on different CPUs don't contend on a lock. A slot is
+  // always returned to the shard it was allocated from. Sharding costs memory,
+  // as each shard has its own partially used slot spans, and is an
+  // alternative to thread caches: both can't be enabled.
+  void Init(bool enable_thread_cache = false, size_t num_shards = 0);
 
   ALWAYS_INLINE void* Alloc(size_t size, const char* type_name);
   ALWAYS_INLINE void* AllocFlags(int flags, size_t size, const char* type_name);
@@ -167,8 +180,23 @@ struct BASE_EXPORT PartitionRootGeneric : public internal::PartitionRootBase {
 
   ALWAYS_INLINE size_t ActualSize(size_t size);
 
+  // Returns the index of |bucket| in |buckets|, or kGenericNumBuckets or more
+  // if it's the bucket of a direct-mapped allocation.
+  ALWAYS_INLINE size_t GetBucketIndex(
+      const internal::PartitionBucket* bucket) const;
+
+  // Same as PartitionRootBase::EnableHugePages(), for the shards as well.
+  bool EnableHugePages();
+
+  // Returns the shard serving small allocations on the current CPU. The
+  // partition must be sharded.
+  ALWAYS_INLINE PartitionRootGeneric* GetCurrentShard();
+
   void PurgeMemory(int flags) override;
 
+  // The statistics of each shard are reported as those of a partition named
+  // "|partition_name|/shard_<index>". The totals of the partition include
+  // them.
   void DumpStats(const char* partition_name,
                  bool is_light_dump,
                  PartitionStatsDumper* partition_stats_dumper);
@@ -183,6 +211,16 @@ struct PartitionMemoryStats {
   size_t total_active_bytes;     // Total active bytes in the partition.
   size_t total_decommittable_bytes;  // Total bytes that could be decommitted.
   size_t total_discardable_bytes;    // Total bytes that could be discarded.
+  size_t total_huge_page_bytes;  // Total bytes of super pages advised to use
+                                 // huge pages.
+  size_t total_huge_page_resident_bytes;  // Total bytes of super pages backed
+                                          // by huge pages. Only reported by
+                                          // detailed dumps.
+
+  // Slots held by thread caches are counted as active above.
+  bool has_thread_cache;
+  ThreadCacheStats current_thread_cache_stats;
+  ThreadCacheStats all_thread_caches_stats;
 };
 
 // Struct used to retrieve memory statistics about a partition bucket. Used by
@@ -418,8 +456,28 @@ ALWAYS_INLINE void* PartitionAllocGenericFlags(PartitionRootGeneric* root,
   }
   size_t requested_size = size;
   size = internal::PartitionCookieSizeAdjustAdd(size);
+  if (root->num_shards && size <= kGenericMaxShardedSize)
+    root = root->GetCurrentShard();
   internal::PartitionBucket* bucket = PartitionGenericSizeToBucket(root, size);
-  {
+  result = nullptr;
+  if (root->with_thread_cache) {
+    internal::ThreadCache* thread_cache = internal::ThreadCache::Get();
+    if (UNLIKELY(!thread_cache))
+      thread_cache = internal::ThreadCache::Create(root);
+    result = thread_cache->GetFromCache(root->GetBucketIndex(bucket));
+    if (LIKELY(result)) {
+      // Cached slots keep their cookies, only their content is reset.
+      const bool zero_fill = flags & PartitionAllocZeroFill;
+#if DCHECK_IS_ON()
+      memset(result, zero_fill ? 0 : kUninitializedByte,
+             internal::PartitionCookieSizeAdjustSubtract(bucket->slot_size));
+#else
+      if (zero_fill)
+        memset(result, 0, size);
+#endif
+    }
+  }
+  if (!result) {
     subtle::SpinLock::Guard guard(root->lock);
     result = root->AllocFromBucket(bucket, flags, size);
   }
@@ -458,12 +516,23 @@ ALWAYS_INLINE void PartitionRootGeneric::Free(void* ptr) {
       return;
   }
 
-  ptr = internal::PartitionCookieFreePointerAdjust(ptr);
-  internal::PartitionPage* page = internal::PartitionPage::FromPointer(ptr);
+  internal::PartitionPage* page = internal::PartitionPage::FromPointer(
+      internal::PartitionCookieFreePointerAdjust(ptr));
   // TODO(palmer): See if we can afford to make this a CHECK.
   DCHECK(IsValidPage(page));
+  if (with_thread_cache) {
+    internal::ThreadCache* thread_cache = internal::ThreadCache::Get();
+    if (LIKELY(thread_cache) &&
+        thread_cache->MaybePutInCache(ptr, GetBucketIndex(page->bucket))) {
+      return;
+    }
+  }
+  // The slot may belong to a shard, whose lock guards it.
+  PartitionRootGeneric* root =
+      num_shards ? static_cast<PartitionRootGeneric*>(FromPage(page)) : this;
+  ptr = internal::PartitionCookieFreePointerAdjust(ptr);
   {
-    subtle::SpinLock::Guard guard(this->lock);
+    subtle::SpinLock::Guard guard(root->lock);
     page->Free(ptr);
   }
 #endif
@@ -493,6 +562,34 @@ ALWAYS_INLINE size_t PartitionRootGeneric::ActualSize(size_t size) {
 #endif
 }
 
+ALWAYS_INLINE size_t PartitionRootGeneric::GetBucketIndex(
+    const internal::PartitionBucket* bucket) const {
+  // Compares addresses rather than pointers, as the bucket of a direct-mapped
+  // allocation isn't in |buckets|. Such buckets wrap around to large indices.
+  return (reinterpret_cast<uintptr_t>(bucket) -
+          reinterpret_cast<uintptr_t>(&buckets[0])) /
+         sizeof(internal::PartitionBucket);
+}
+
+ALWAYS_INLINE PartitionRootGeneric* PartitionRootGeneric::GetCurrentShard() {
+  DCHECK_GT(num_shards, 1u);
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+  // Usually doesn't make a system call, as the C library reads the CPU number
+  // from rseq or the vDSO. The thread may migrate right after, which is fine,
+  // as shards only exist to reduce contention.
+  int cpu = sched_getcpu();
+  if (UNLIKELY(cpu < 0))
+    cpu = 0;
+  const size_t index = static_cast<size_t>(cpu);
+#else
+  // The CPU number isn't cheaply available. Spread threads across shards by
+  // the address of their stack instead.
+  char stack_variable;
+  const size_t index = reinterpret_cast<uintptr_t>(&stack_variable) >> 20;
+#endif
+  return &shards[index % num_shards];
+}
+
 template <size_t N>
 class SizeSpecificPartitionAllocator {
  public:
@@ -526,8 +623,8 @@ class BASE_EXPORT PartitionAllocatorGeneric {
         &partition_root_);
   }
 
-  void init() {
-    partition_root_.Init();
+  void init(bool enable_thread_cache = false, size_t num_shards = 0) {
+    partition_root_.Init(enable_thread_cache, num_shards);
     PartitionAllocMemoryReclaimer::Instance()->RegisterPartition(
         &partition_root_);
   }
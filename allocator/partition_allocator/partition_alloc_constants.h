@@ -160,9 +160,34 @@ static const size_t kGenericMinDirectMappedDownsize = kGenericMaxBucketed + 1;
 static const size_t kGenericMaxDirectMapped =
     (1UL << 31) + kPageAllocationGranularity;  // 2 GiB plus 1 more page.
 static const size_t kBitsPerSizeT = sizeof(void*) * CHAR_BIT;
+// Allocations up to this size, cookies included, are served by the shards of
+// a sharded PartitionRootGeneric. Larger ones are less frequent, and would
+// waste more memory in the partially used slot spans of each shard.
+static const size_t kGenericMaxShardedSize = 1 << 12;  // 4 KiB.
 
 // Constant for the memory reclaim logic.
 static const size_t kMaxFreeableSpans = 16;
+// Number of churning buckets which a partition tracks between two purges, see
+// PartitionPurgeColdBucketsOnly.
+static const size_t kMaxChurningBuckets = 16;
+
+enum PartitionPurgeFlags {
+  // Decommitting the ring list of empty pages is reasonably fast.
+  PartitionPurgeDecommitEmptyPages = 1 << 0,
+  // Discarding unused system pages is slower, because it involves walking all
+  // freelists in all active partition pages of all buckets >= system page
+  // size. It often frees a similar amount of memory to decommitting the empty
+  // pages, though.
+  PartitionPurgeDiscardUnusedSystemPages = 1 << 1,
+  // Leaves alone the buckets which reused an empty or decommitted slot span
+  // since the last purge. Their memory is likely to be needed again soon, and
+  // purging it would only cause page faults.
+  PartitionPurgeColdBucketsOnly = 1 << 2,
+  // Lets the system reclaim the purged memory only when it runs short of
+  // memory, so that reusing it is cheaper in the meantime. See
+  // DecommitSystemPagesLazily().
+  PartitionPurgeLazily = 1 << 3,
+};
 
 // If the total size in bytes of allocated but not committed pages exceeds this
 // value (probably it is a "out of virtual address space" crash), a special
@@ -2,8 +2,18 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <stdint.h>
+#include <string.h>
+
+#include <memory>
+#include <tuple>
 #include <vector>
 #include "base/allocator/partition_allocator/partition_alloc.h"
+#include "base/logging.h"
+#include "base/strings/stringprintf.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/system/sys_info.h"
+#include "base/threading/platform_thread.h"
 #include "base/time/time.h"
 #include "base/timer/lap_timer.h"
 
@@ -27,6 +37,9 @@ constexpr int kMultiBucketMinimumSize = 24;
 constexpr int kMultiBucketIncrement = 13;
 // Final size is 24 + (13 * 22) = 310 bytes.
 constexpr int kMultiBucketRounds = 22;
+// Number of times each thread allocates and frees kMultiBucketRounds objects in
+// the multi-threaded tests.
+constexpr int kMultiThreadedIterations = 20000;
 
 class MemoryAllocationPerfTest : public testing::Test {
  public:
@@ -165,6 +178,170 @@ TEST_F(MemoryAllocationPerfTest, MultiBucketWithFree) {
       timer_.LapsPerSecond() * kMultiBucketRounds, "runs/s", true);
 }
 
+// Allocates and frees objects of kMultiBucketRounds sizes in a loop, once
+// |start_event| is signaled.
+class AllocatingThread : public PlatformThread::Delegate {
+ public:
+  AllocatingThread(PartitionRootGeneric* root, WaitableEvent* start_event)
+      : root_(root), start_event_(start_event) {
+    CHECK(PlatformThread::Create(0, this, &handle_));
+  }
+
+  ~AllocatingThread() override { PlatformThread::Join(handle_); }
+
+  void ThreadMain() override {
+    void* elems[kMultiBucketRounds];
+    start_event_->Wait();
+    for (int i = 0; i < kMultiThreadedIterations; i++) {
+      for (int j = 0; j < kMultiBucketRounds; j++) {
+        elems[j] = root_->Alloc(
+            kMultiBucketMinimumSize + (j * kMultiBucketIncrement), "<testing>");
+        CHECK_NE(elems[j], nullptr);
+      }
+      for (int j = 0; j < kMultiBucketRounds; j++)
+        root_->Free(elems[j]);
+    }
+  }
+
+ private:
+  PartitionRootGeneric* const root_;
+  WaitableEvent* const start_event_;
+  PlatformThreadHandle handle_;
+
+  DISALLOW_COPY_AND_ASSIGN(AllocatingThread);
+};
+
+// How small allocations avoid contending on the partition lock, if they do.
+enum class PartitionMode {
+  kLocked,
+  kThreadCache,
+  kSharded,
+};
+
+// Parameterized by the number of threads, and the PartitionMode.
+class MultiThreadedMemoryAllocationPerfTest
+    : public testing::TestWithParam<std::tuple<int, PartitionMode>> {
+ public:
+  void SetUp() override {
+    switch (std::get<1>(GetParam())) {
+      case PartitionMode::kLocked:
+        alloc_.init();
+        break;
+      case PartitionMode::kThreadCache:
+        alloc_.init(true);
+        break;
+      case PartitionMode::kSharded:
+        alloc_.init(false, SysInfo::NumberOfProcessors());
+        break;
+    }
+  }
+  void TearDown() override {
+    alloc_.root()->PurgeMemory(PartitionPurgeDecommitEmptyPages |
+                               PartitionPurgeDiscardUnusedSystemPages);
+  }
+  PartitionAllocatorGeneric alloc_;
+};
+
+TEST_P(MultiThreadedMemoryAllocationPerfTest, MultiBucketWithFree) {
+  const int num_threads = std::get<0>(GetParam());
+  WaitableEvent start_event;
+  TimeDelta elapsed;
+  {
+    std::vector<std::unique_ptr<AllocatingThread>> threads;
+    for (int i = 0; i < num_threads; i++) {
+      threads.push_back(
+          std::make_unique<AllocatingThread>(alloc_.root(), &start_event));
+    }
+    const TimeTicks start = TimeTicks::Now();
+    start_event.Signal();
+    // Joins the threads.
+    threads.clear();
+    elapsed = TimeTicks::Now() - start;
+  }
+
+  const double num_allocations = static_cast<double>(num_threads) *
+                                 kMultiThreadedIterations * kMultiBucketRounds;
+  const char* mode = "";
+  switch (std::get<1>(GetParam())) {
+    case PartitionMode::kLocked:
+      break;
+    case PartitionMode::kThreadCache:
+      mode = ", thread cache";
+      break;
+    case PartitionMode::kSharded:
+      mode = ", sharded";
+      break;
+  }
+  perf_test::PrintResult(
+      "MemoryAllocationPerfTest",
+      StringPrintf(" multi-bucket allocation + free, %d threads%s",
+                   num_threads, mode),
+      "", num_allocations / elapsed.InSecondsF(), "runs/s", true);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    ,
+    MultiThreadedMemoryAllocationPerfTest,
+    testing::Combine(testing::Values(1, 2, 4, 8, 16, 32, 64),
+                     testing::Values(PartitionMode::kLocked,
+                                     PartitionMode::kThreadCache,
+                                     PartitionMode::kSharded)));
+
+// Much larger than what the TLB covers with 4 KiB pages, but not with 2 MiB
+// huge pages.
+constexpr size_t kRandomAccessWorkingSetSize = 256 * 1024 * 1024;
+constexpr size_t kRandomAccessObjectSize = 4096;
+constexpr int kRandomAccessReadsPerLap = 1000;
+
+// Parameterized by whether the partition uses huge pages.
+class RandomAccessPerfTest : public MemoryAllocationPerfTest,
+                             public testing::WithParamInterface<bool> {};
+
+TEST_P(RandomAccessPerfTest, ReadObjects) {
+  if (GetParam() && !alloc_.root()->EnableHugePages()) {
+    LOG(WARNING) << "Huge pages are not available";
+    return;
+  }
+
+  std::vector<uint64_t*> objects;
+  for (size_t i = 0; i < kRandomAccessWorkingSetSize / kRandomAccessObjectSize;
+       ++i) {
+    void* ptr = alloc_.root()->Alloc(kRandomAccessObjectSize, "<testing>");
+    CHECK_NE(ptr, nullptr);
+    memset(ptr, static_cast<int>(i), kRandomAccessObjectSize);
+    objects.push_back(static_cast<uint64_t*>(ptr));
+  }
+
+  constexpr size_t kWordsPerObject = kRandomAccessObjectSize / sizeof(uint64_t);
+  uint64_t random = 0x2545F4914F6CDD1D;
+  uint64_t sum = 0;
+  timer_.Reset();
+  do {
+    for (int i = 0; i < kRandomAccessReadsPerLap; ++i) {
+      // xorshift64.
+      random ^= random << 13;
+      random ^= random >> 7;
+      random ^= random << 17;
+      sum += objects[random % objects.size()][(random >> 32) % kWordsPerObject];
+    }
+    timer_.NextLap();
+  } while (!timer_.HasTimeLimitExpired());
+  // Keeps the reads from being optimized out.
+  CHECK_NE(sum, 1u);
+
+  for (uint64_t* ptr : objects)
+    alloc_.root()->Free(ptr);
+
+  perf_test::PrintResult(
+      "MemoryAllocationPerfTest",
+      StringPrintf(" random access to a %zu MiB working set%s",
+                   kRandomAccessWorkingSetSize / (1024 * 1024),
+                   GetParam() ? ", huge pages" : ""),
+      "", timer_.LapsPerSecond() * kRandomAccessReadsPerLap, "reads/s", true);
+}
+
+INSTANTIATE_TEST_SUITE_P(, RandomAccessPerfTest, testing::Bool());
+
 }  // anonymous namespace
 
 }  // namespace base
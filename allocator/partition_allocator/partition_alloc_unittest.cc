@@ -9,6 +9,8 @@
 
 #include <limits>
 #include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "base/allocator/partition_allocator/address_space_randomization.h"
@@ -1792,6 +1794,68 @@ TEST_F(PartitionAllocTest, Purge) {
   CHECK_PAGE_IN_CORE(big_ptr - kPointerOffset, false);
 }
 
+// Tests that purging cold buckets only leaves alone the empty slot spans of
+// the buckets which reused one since the last purge.
+TEST_F(PartitionAllocTest, PurgeColdBucketsOnly) {
+  PartitionRootGeneric* root = generic_allocator.root();
+  const size_t size = 2048 - kExtraAllocSize;
+  const int flags =
+      PartitionPurgeDecommitEmptyPages | PartitionPurgeColdBucketsOnly;
+
+  // The second allocation reuses the empty slot span of the first one.
+  root->Free(root->Alloc(size, type_name));
+  void* ptr = root->Alloc(size, type_name);
+  PartitionBucket* bucket =
+      PartitionPage::FromPointer(PartitionCookieFreePointerAdjust(ptr))
+          ->bucket;
+  EXPECT_TRUE(root->IsBucketChurning(bucket));
+  root->Free(ptr);
+
+  root->PurgeMemory(flags);
+  {
+    MockPartitionStatsDumper dumper;
+    root->DumpStats("mock_generic_allocator", false /* detailed dump */,
+                    &dumper);
+    const PartitionBucketMemoryStats* stats = dumper.GetBucketStats(2048);
+    EXPECT_TRUE(stats);
+    EXPECT_TRUE(stats->is_valid);
+    EXPECT_EQ(kSystemPageSize, stats->decommittable_bytes);
+    EXPECT_EQ(kSystemPageSize, stats->resident_bytes);
+  }
+  EXPECT_FALSE(root->IsBucketChurning(bucket));
+
+  // No reuse since the last purge, the slot span is decommitted.
+  root->PurgeMemory(flags);
+  {
+    MockPartitionStatsDumper dumper;
+    root->DumpStats("mock_generic_allocator", false /* detailed dump */,
+                    &dumper);
+    const PartitionBucketMemoryStats* stats = dumper.GetBucketStats(2048);
+    EXPECT_TRUE(stats);
+    EXPECT_TRUE(stats->is_valid);
+    EXPECT_EQ(0u, stats->decommittable_bytes);
+    EXPECT_EQ(0u, stats->resident_bytes);
+  }
+}
+
+TEST_F(PartitionAllocTest, PurgeLazily) {
+  PartitionRootGeneric* root = generic_allocator.root();
+  const size_t size = 2048 - kExtraAllocSize;
+  root->Free(root->Alloc(size, type_name));
+  size_t committed_before = root->total_size_of_committed_pages;
+
+  root->PurgeMemory(PartitionPurgeDecommitEmptyPages | PartitionPurgeLazily);
+  EXPECT_LT(root->total_size_of_committed_pages, committed_before);
+
+  // The memory is usable again, and zero-filled allocations are still zeroed.
+  char* ptr = reinterpret_cast<char*>(
+      root->AllocFlags(PartitionAllocZeroFill, size, type_name));
+  EXPECT_EQ(committed_before, root->total_size_of_committed_pages);
+  for (size_t i = 0; i < size; ++i)
+    EXPECT_EQ(0, ptr[i]);
+  root->Free(ptr);
+}
+
 // Tests that we prefer to allocate into a non-empty partition page over an
 // empty one. This is an important aspect of minimizing memory usage for some
 // allocation sizes, particularly larger ones.
@@ -2283,6 +2347,190 @@ TEST_F(PartitionAllocTest, OverrideHooks) {
   free(overridden_allocation);
 }
 
+namespace {
+
+constexpr size_t kTestNumShards = 4;
+
+// Records the totals of each partition, by name.
+class ShardedStatsDumper : public PartitionStatsDumper {
+ public:
+  void PartitionDumpTotals(const char* partition_name,
+                           const PartitionMemoryStats* stats) override {
+    totals_.emplace_back(partition_name, *stats);
+  }
+  void PartitionsDumpBucketStats(
+      const char* partition_name,
+      const PartitionBucketMemoryStats* stats) override {}
+
+  const std::vector<std::pair<std::string, PartitionMemoryStats>>& totals()
+      const {
+    return totals_;
+  }
+
+ private:
+  std::vector<std::pair<std::string, PartitionMemoryStats>> totals_;
+};
+
+size_t ActiveBytes(PartitionRootGeneric* root) {
+  ShardedStatsDumper dumper;
+  root->DumpStats("test", true, &dumper);
+  return dumper.totals().back().second.total_active_bytes;
+}
+
+}  // namespace
+
+TEST(PartitionAllocShardsTest, SmallAllocationsAreSharded) {
+  PartitionAllocatorGeneric sharded_allocator;
+  sharded_allocator.init(false, kTestNumShards);
+  PartitionRootGeneric* root = sharded_allocator.root();
+  ASSERT_EQ(kTestNumShards, root->num_shards);
+
+  void* ptr = root->Alloc(kTestAllocSize, type_name);
+  ASSERT_TRUE(ptr);
+  PartitionRootBase* owner = PartitionRootBase::FromPage(
+      PartitionPage::FromPointer(PartitionCookieFreePointerAdjust(ptr)));
+  EXPECT_NE(root, owner);
+  EXPECT_LE(&root->shards[0], owner);
+  EXPECT_GT(&root->shards[kTestNumShards], owner);
+  root->Free(ptr);
+
+  // Larger allocations are served by the partition itself.
+  ptr = root->Alloc(kGenericMaxShardedSize * 2, type_name);
+  ASSERT_TRUE(ptr);
+  owner = PartitionRootBase::FromPage(
+      PartitionPage::FromPointer(PartitionCookieFreePointerAdjust(ptr)));
+  EXPECT_EQ(root, owner);
+  root->Free(ptr);
+}
+
+TEST(PartitionAllocShardsTest, FreeReturnsToOwningShard) {
+  PartitionAllocatorGeneric sharded_allocator;
+  sharded_allocator.init(false, kTestNumShards);
+  PartitionRootGeneric* root = sharded_allocator.root();
+
+  // Regardless of the CPU the thread runs on when freeing.
+  std::vector<void*> ptrs;
+  for (size_t i = 0; i < kTestNumShards; ++i)
+    ptrs.push_back(root->shards[i].Alloc(kTestAllocSize, type_name));
+  for (size_t i = 0; i < kTestNumShards; ++i)
+    EXPECT_NE(0u, ActiveBytes(&root->shards[i]));
+  EXPECT_NE(0u, ActiveBytes(root));
+
+  for (void* ptr : ptrs)
+    root->Free(ptr);
+  for (size_t i = 0; i < kTestNumShards; ++i)
+    EXPECT_EQ(0u, ActiveBytes(&root->shards[i]));
+  EXPECT_EQ(0u, ActiveBytes(root));
+}
+
+TEST(PartitionAllocShardsTest, Realloc) {
+  PartitionAllocatorGeneric sharded_allocator;
+  sharded_allocator.init(false, kTestNumShards);
+  PartitionRootGeneric* root = sharded_allocator.root();
+
+  char* ptr = static_cast<char*>(root->Alloc(kTestAllocSize, type_name));
+  ASSERT_TRUE(ptr);
+  memset(ptr, 'A', kTestAllocSize);
+  // Moves from a shard to the partition and back.
+  for (size_t size : {kGenericMaxShardedSize * 2, kTestAllocSize * 2}) {
+    ptr = static_cast<char*>(root->Realloc(ptr, size, type_name));
+    ASSERT_TRUE(ptr);
+    for (size_t i = 0; i < kTestAllocSize; ++i)
+      EXPECT_EQ('A', ptr[i]);
+  }
+  root->Free(ptr);
+  EXPECT_EQ(0u, ActiveBytes(root));
+}
+
+TEST(PartitionAllocShardsTest, DumpStats) {
+  PartitionAllocatorGeneric sharded_allocator;
+  sharded_allocator.init(false, kTestNumShards);
+  PartitionRootGeneric* root = sharded_allocator.root();
+  void* small_ptr = root->shards[1].Alloc(kTestAllocSize, type_name);
+  void* large_ptr = root->Alloc(kGenericMaxShardedSize * 2, type_name);
+
+  ShardedStatsDumper dumper;
+  root->DumpStats("test", false, &dumper);
+  const auto& totals = dumper.totals();
+  ASSERT_EQ(kTestNumShards + 1, totals.size());
+  size_t shards_active_bytes = 0;
+  size_t shards_committed_bytes = 0;
+  for (size_t i = 0; i < kTestNumShards; ++i) {
+    EXPECT_EQ("test/shard_" + std::to_string(i), totals[i].first);
+    shards_active_bytes += totals[i].second.total_active_bytes;
+    shards_committed_bytes += totals[i].second.total_committed_bytes;
+  }
+  EXPECT_EQ(0u, totals[0].second.total_active_bytes);
+  EXPECT_NE(0u, totals[1].second.total_active_bytes);
+
+  // The totals of the partition include those of its shards.
+  EXPECT_EQ("test", totals.back().first);
+  const PartitionMemoryStats& stats = totals.back().second;
+  EXPECT_EQ(shards_active_bytes +
+                PartitionCookieSizeAdjustAdd(PartitionAllocGetSize(large_ptr)),
+            stats.total_active_bytes);
+  EXPECT_EQ(shards_committed_bytes + root->total_size_of_committed_pages,
+            stats.total_committed_bytes);
+
+  root->Free(small_ptr);
+  root->Free(large_ptr);
+}
+
+TEST(PartitionAllocShardsTest, PurgeMemory) {
+  PartitionAllocatorGeneric sharded_allocator;
+  sharded_allocator.init(false, kTestNumShards);
+  PartitionRootGeneric* root = sharded_allocator.root();
+  PartitionRootGeneric* shard = &root->shards[2];
+
+  void* ptr = shard->Alloc(kTestAllocSize, type_name);
+  const size_t committed = shard->total_size_of_committed_pages;
+  root->Free(ptr);
+  root->PurgeMemory(PartitionPurgeDecommitEmptyPages);
+  EXPECT_GT(committed, shard->total_size_of_committed_pages);
+}
+
+TEST(PartitionAllocHugePagesTest, SuperPages) {
+  PartitionAllocatorGeneric huge_page_allocator;
+  huge_page_allocator.init();
+  PartitionRootGeneric* root = huge_page_allocator.root();
+  if (!root->EnableHugePages())
+    return;
+
+  // Fill several super pages, all of whose pages must be accessible.
+  constexpr size_t kSize = 100000;
+  std::vector<void*> ptrs;
+  while (root->total_size_of_super_pages < 3 * kSuperPageSize) {
+    void* ptr = root->Alloc(kSize, type_name);
+    ASSERT_TRUE(ptr);
+    memset(ptr, 'A', kSize);
+    ptrs.push_back(ptr);
+  }
+  EXPECT_EQ(root->total_size_of_super_pages,
+            root->total_size_of_huge_page_super_pages);
+
+  ShardedStatsDumper dumper;
+  root->DumpStats("test", false, &dumper);
+  const PartitionMemoryStats& stats = dumper.totals().back().second;
+  EXPECT_EQ(root->total_size_of_super_pages, stats.total_huge_page_bytes);
+  // Whether the system found free huge pages isn't known.
+  EXPECT_GE(stats.total_huge_page_bytes, stats.total_huge_page_resident_bytes);
+
+  for (void* ptr : ptrs)
+    root->Free(ptr);
+  root->PurgeMemory(PartitionPurgeDecommitEmptyPages |
+                    PartitionPurgeDiscardUnusedSystemPages);
+}
+
+TEST(PartitionAllocHugePagesTest, NotEnabled) {
+  PartitionAllocatorGeneric regular_allocator;
+  regular_allocator.init();
+  PartitionRootGeneric* root = regular_allocator.root();
+  void* ptr = root->Alloc(kTestAllocSize, type_name);
+  EXPECT_NE(0u, root->total_size_of_super_pages);
+  EXPECT_EQ(0u, root->total_size_of_huge_page_super_pages);
+  root->Free(ptr);
+}
+
 }  // namespace internal
 }  // namespace base
 
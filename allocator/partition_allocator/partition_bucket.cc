@@ -227,6 +227,15 @@ ALWAYS_INLINE void* PartitionBucket::AllocNewSlotSpan(
   root->total_size_of_super_pages += kSuperPageSize;
   root->IncreaseCommittedPages(total_size);
 
+  // If the system rejects the hint, go back to regular super pages for good.
+  bool use_huge_pages = false;
+  if (root->use_huge_pages) {
+    use_huge_pages = AdviseHugePages(super_page, kSuperPageSize);
+    root->use_huge_pages = use_huge_pages;
+  }
+  if (use_huge_pages)
+    root->total_size_of_huge_page_super_pages += kSuperPageSize;
+
   // |total_size| MUST be less than kSuperPageSize - (kPartitionPageSize*2).
   // This is a trustworthy value because num_partition_pages is not user
   // controlled.
@@ -236,26 +245,30 @@ ALWAYS_INLINE void* PartitionBucket::AllocNewSlotSpan(
   char* ret = super_page + kPartitionPageSize;
   root->next_partition_page = ret + total_size;
   root->next_partition_page_end = root->next_super_page - kPartitionPageSize;
-  // Make the first partition page in the super page a guard page, but leave a
-  // hole in the middle.
-  // This is where we put page metadata and also a tiny amount of extent
-  // metadata.
-  SetSystemPagesAccess(super_page, kSystemPageSize, PageInaccessible);
-  SetSystemPagesAccess(super_page + (kSystemPageSize * 2),
-                       kPartitionPageSize - (kSystemPageSize * 2),
-                       PageInaccessible);
-  //  SetSystemPagesAccess(super_page + (kSuperPageSize -
-  //  kPartitionPageSize),
-  //                             kPartitionPageSize, PageInaccessible);
-  // All remaining slotspans for the unallocated PartitionPages inside the
-  // SuperPage are conceptually decommitted. Correctly set the state here
-  // so they do not occupy resources.
-  //
-  // TODO(ajwong): Refactor Page Allocator API so the SuperPage comes in
-  // decommited initially.
-  SetSystemPagesAccess(super_page + kPartitionPageSize + total_size,
-                       (kSuperPageSize - kPartitionPageSize - total_size),
-                       PageInaccessible);
+  // A huge page must be mapped with uniform permissions, so super pages
+  // backed by one keep all their pages accessible.
+  if (!use_huge_pages) {
+    // Make the first partition page in the super page a guard page, but leave
+    // a hole in the middle.
+    // This is where we put page metadata and also a tiny amount of extent
+    // metadata.
+    SetSystemPagesAccess(super_page, kSystemPageSize, PageInaccessible);
+    SetSystemPagesAccess(super_page + (kSystemPageSize * 2),
+                         kPartitionPageSize - (kSystemPageSize * 2),
+                         PageInaccessible);
+    //  SetSystemPagesAccess(super_page + (kSuperPageSize -
+    //  kPartitionPageSize),
+    //                             kPartitionPageSize, PageInaccessible);
+    // All remaining slotspans for the unallocated PartitionPages inside the
+    // SuperPage are conceptually decommitted. Correctly set the state here
+    // so they do not occupy resources.
+    //
+    // TODO(ajwong): Refactor Page Allocator API so the SuperPage comes in
+    // decommited initially.
+    SetSystemPagesAccess(super_page + kPartitionPageSize + total_size,
+                         (kSuperPageSize - kPartitionPageSize - total_size),
+                         PageInaccessible);
+  }
 
   // If we were after a specific address, but didn't get it, assume that
   // the system chose a lousy address. Here most OS'es have a default
@@ -519,6 +532,7 @@ void* PartitionBucket::SlowPathAlloc(PartitionRootBase* root,
       // *is_already_zeroed = true;
     }
     DCHECK(new_page);
+    root->RecordSlotSpanReuse(this);
   } else {
     // Third. If we get here, we need a brand new page.
     uint16_t num_partition_pages = this->get_pages_per_slot_span();
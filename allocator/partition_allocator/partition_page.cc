@@ -67,7 +67,7 @@ ALWAYS_INLINE void PartitionRegisterEmptyPage(PartitionPage* page) {
   // The page might well have been re-activated, filled up, etc. before we get
   // around to looking at it here.
   if (page_to_decommit)
-    page_to_decommit->DecommitIfPossible(root);
+    page_to_decommit->DecommitIfPossible(root, false);
 
   // We put the empty slot span on our global list of "pages that were once
   // empty". thus providing it a bit of breathing room to get re-used before
@@ -134,11 +134,14 @@ void PartitionPage::FreeSlowPath() {
   }
 }
 
-void PartitionPage::Decommit(PartitionRootBase* root) {
+void PartitionPage::Decommit(PartitionRootBase* root, bool lazily) {
   DCHECK(is_empty());
   DCHECK(!bucket->is_direct_mapped());
   void* addr = PartitionPage::ToPointer(this);
-  root->DecommitSystemPages(addr, bucket->get_bytes_per_span());
+  if (lazily)
+    root->DecommitSystemPagesLazily(addr, bucket->get_bytes_per_span());
+  else
+    root->DecommitSystemPages(addr, bucket->get_bytes_per_span());
 
   // We actually leave the decommitted page in the active list. We'll sweep
   // it on to the decommitted page list when we next walk the active page
@@ -151,13 +154,13 @@ void PartitionPage::Decommit(PartitionRootBase* root) {
   DCHECK(is_decommitted());
 }
 
-void PartitionPage::DecommitIfPossible(PartitionRootBase* root) {
+void PartitionPage::DecommitIfPossible(PartitionRootBase* root, bool lazily) {
   DCHECK(empty_cache_index >= 0);
   DCHECK(static_cast<unsigned>(empty_cache_index) < kMaxFreeableSpans);
   DCHECK(this == root->global_empty_page_ring[empty_cache_index]);
   empty_cache_index = -1;
   if (is_empty())
-    Decommit(root);
+    Decommit(root, lazily);
 }
 
 }  // namespace internal
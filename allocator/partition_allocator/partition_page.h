@@ -64,8 +64,10 @@ struct PartitionPage {
   BASE_EXPORT NOINLINE void FreeSlowPath();
   ALWAYS_INLINE void Free(void* ptr);
 
-  void Decommit(PartitionRootBase* root);
-  void DecommitIfPossible(PartitionRootBase* root);
+  // If |lazily| is true, the system may only reclaim the memory when it runs
+  // short of it, see DecommitSystemPagesLazily().
+  void Decommit(PartitionRootBase* root, bool lazily);
+  void DecommitIfPossible(PartitionRootBase* root, bool lazily);
 
   // Pointer manipulation functions. These must be static as the input |page|
   // pointer may be the result of an offset calculation and therefore cannot
@@ -27,14 +27,50 @@ NOINLINE void PartitionRootBase::OutOfMemory() {
   OOM_CRASH();
 }
 
-void PartitionRootBase::DecommitEmptyPages() {
+bool PartitionRootBase::EnableHugePages() {
+  if (!HugePagesAvailable())
+    return false;
+  use_huge_pages = true;
+  return true;
+}
+
+void PartitionRootBase::DecommitEmptyPages(int flags) {
+  const bool cold_buckets_only = flags & PartitionPurgeColdBucketsOnly;
+  const bool lazily = flags & PartitionPurgeLazily;
   for (size_t i = 0; i < kMaxFreeableSpans; ++i) {
     internal::PartitionPage* page = global_empty_page_ring[i];
-    if (page)
-      page->DecommitIfPossible(this);
+    if (!page)
+      continue;
+    // Stays in the ring, and is decommitted by the next purge if its bucket
+    // cools down by then.
+    if (cold_buckets_only && IsBucketChurning(page->bucket))
+      continue;
+    page->DecommitIfPossible(this, lazily);
     global_empty_page_ring[i] = nullptr;
   }
 }
 
+void PartitionRootBase::RecordSlotSpanReuse(PartitionBucket* bucket) {
+  if (IsBucketChurning(bucket))
+    return;
+  if (num_churning_buckets < kMaxChurningBuckets)
+    churning_buckets[num_churning_buckets] = bucket;
+  ++num_churning_buckets;
+}
+
+bool PartitionRootBase::IsBucketChurning(const PartitionBucket* bucket) const {
+  if (num_churning_buckets > kMaxChurningBuckets)
+    return true;
+  for (size_t i = 0; i < num_churning_buckets; ++i) {
+    if (churning_buckets[i] == bucket)
+      return true;
+  }
+  return false;
+}
+
+void PartitionRootBase::ResetChurningBuckets() {
+  num_churning_buckets = 0;
+}
+
 }  // namespace internal
 }  // namespace base
@@ -44,6 +44,10 @@ struct BASE_EXPORT PartitionRootBase {
   unsigned num_buckets = 0;
   unsigned max_allocation = 0;
   bool initialized = false;
+  // Whether new super pages are backed by huge pages, see EnableHugePages().
+  bool use_huge_pages = false;
+  // Part of |total_size_of_super_pages| advised to use huge pages.
+  size_t total_size_of_huge_page_super_pages = 0;
   char* next_super_page = nullptr;
   char* next_partition_page = nullptr;
   char* next_partition_page_end = nullptr;
@@ -52,10 +56,21 @@ struct BASE_EXPORT PartitionRootBase {
   PartitionDirectMapExtent* direct_map_list = nullptr;
   PartitionPage* global_empty_page_ring[kMaxFreeableSpans] = {};
   int16_t global_empty_page_ring_index = 0;
+  // Buckets which reused an empty or decommitted slot span since the last
+  // purge. Past |kMaxChurningBuckets|, all buckets are considered churning.
+  PartitionBucket* churning_buckets[kMaxChurningBuckets] = {};
+  uint8_t num_churning_buckets = 0;
   uintptr_t inverted_self = 0;
 
   // Public API
 
+  // Asks for the super pages allocated from now on to be backed by
+  // transparent huge pages, which reduces TLB misses when accessing large
+  // heaps. These super pages have no guard pages, as they would split the
+  // mapping of the huge page, and are fully resident once touched. Returns
+  // false if the system doesn't support huge pages.
+  bool EnableHugePages();
+
   // Allocates out of the given bucket. Properly, this function should probably
   // be in PartitionBucket, but because the implementation needs to be inlined
   // for performance, and because it needs to inspect PartitionPage,
@@ -80,12 +95,21 @@ struct BASE_EXPORT PartitionRootBase {
   ALWAYS_INLINE void IncreaseCommittedPages(size_t len);
   ALWAYS_INLINE void DecreaseCommittedPages(size_t len);
   ALWAYS_INLINE void DecommitSystemPages(void* address, size_t length);
+  ALWAYS_INLINE void DecommitSystemPagesLazily(void* address, size_t length);
   ALWAYS_INLINE void RecommitSystemPages(void* address, size_t length);
 
   // Frees memory from this partition, if possible, by decommitting pages.
   // |flags| is an OR of base::PartitionPurgeFlags.
   virtual void PurgeMemory(int flags) = 0;
-  void DecommitEmptyPages();
+  // Decommits the empty slot spans of the ring, according to |flags|.
+  void DecommitEmptyPages(int flags);
+
+  // Records that |bucket| reused an empty or decommitted slot span.
+  void RecordSlotSpanReuse(PartitionBucket* bucket);
+  // Whether |bucket| reused an empty or decommitted slot span since the last
+  // call to ResetChurningBuckets().
+  bool IsBucketChurning(const PartitionBucket* bucket) const;
+  void ResetChurningBuckets();
 };
 
 ALWAYS_INLINE void* PartitionRootBase::AllocFromBucket(PartitionBucket* bucket,
@@ -185,6 +209,13 @@ ALWAYS_INLINE void PartitionRootBase::DecommitSystemPages(void* address,
   DecreaseCommittedPages(length);
 }
 
+ALWAYS_INLINE void PartitionRootBase::DecommitSystemPagesLazily(
+    void* address,
+    size_t length) {
+  ::base::DecommitSystemPagesLazily(address, length);
+  DecreaseCommittedPages(length);
+}
+
 ALWAYS_INLINE void PartitionRootBase::RecommitSystemPages(void* address,
                                                           size_t length) {
   CHECK(::base::RecommitSystemPages(address, length, PageReadWrite));
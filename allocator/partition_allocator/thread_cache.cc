@@ -0,0 +1,244 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/allocator/partition_allocator/thread_cache.h"
+
+#include <algorithm>
+#include <new>
+
+#include "base/allocator/partition_allocator/partition_alloc.h"
+#include "base/allocator/partition_allocator/partition_page.h"
+#include "base/threading/thread_local_storage.h"
+
+namespace base {
+namespace internal {
+
+namespace {
+
+// The partition which has thread caches, if any.
+PartitionRootGeneric* g_thread_cache_root = nullptr;
+
+// Holds the ThreadCache of each thread. Created by the first
+// ThreadCache::Init() and never destroyed.
+ThreadLocalStorage::Slot* g_thread_cache_slot = nullptr;
+
+}  // namespace
+
+constexpr size_t ThreadCache::kSizeThreshold;
+constexpr size_t ThreadCache::kBucketCount;
+constexpr uint16_t ThreadCache::kMinCountPerBucket;
+constexpr uint16_t ThreadCache::kMaxCountPerBucket;
+constexpr size_t ThreadCache::kMaxCachedBytesPerBucket;
+
+// static
+ThreadCacheRegistry& ThreadCacheRegistry::Instance() {
+  static NoDestructor<ThreadCacheRegistry> instance;
+  return *instance;
+}
+
+ThreadCacheRegistry::ThreadCacheRegistry() = default;
+
+void ThreadCacheRegistry::RegisterThreadCache(ThreadCache* cache) {
+  AutoLock lock(lock_);
+  DCHECK(!cache->next_);
+  DCHECK(!cache->prev_);
+  cache->next_ = list_head_;
+  if (list_head_)
+    list_head_->prev_ = cache;
+  list_head_ = cache;
+}
+
+void ThreadCacheRegistry::UnregisterThreadCache(ThreadCache* cache) {
+  AutoLock lock(lock_);
+  if (cache->prev_)
+    cache->prev_->next_ = cache->next_;
+  else
+    list_head_ = cache->next_;
+  if (cache->next_)
+    cache->next_->prev_ = cache->prev_;
+  cache->next_ = nullptr;
+  cache->prev_ = nullptr;
+}
+
+void ThreadCacheRegistry::DumpStats(bool my_thread_only,
+                                    ThreadCacheStats* stats) {
+  memset(stats, 0, sizeof(*stats));
+  if (my_thread_only) {
+    ThreadCache* cache = ThreadCache::Get();
+    if (cache)
+      cache->AccumulateStats(stats);
+    return;
+  }
+
+  AutoLock lock(lock_);
+  for (ThreadCache* cache = list_head_; cache; cache = cache->next_)
+    cache->AccumulateStats(stats);
+}
+
+void ThreadCacheRegistry::PurgeAll() {
+  ThreadCache* current_thread_cache = ThreadCache::Get();
+
+  {
+    AutoLock lock(lock_);
+    for (ThreadCache* cache = list_head_; cache; cache = cache->next_) {
+      if (cache != current_thread_cache)
+        cache->SetShouldPurge();
+    }
+  }
+
+  // Purging takes the partition lock, so don't hold |lock_| while doing it.
+  if (current_thread_cache)
+    current_thread_cache->Purge();
+}
+
+// static
+void ThreadCache::Init(PartitionRootGeneric* root) {
+  CHECK(!g_thread_cache_root) << "Only one partition can have thread caches";
+  DCHECK_EQ(kSizeThreshold, root->buckets[kBucketCount - 1].slot_size);
+  static NoDestructor<ThreadLocalStorage::Slot> thread_cache_slot(
+      &ThreadCache::Delete);
+  g_thread_cache_slot = thread_cache_slot.get();
+  g_thread_cache_root = root;
+}
+
+// static
+void ThreadCache::Shutdown(PartitionRootGeneric* root) {
+  DCHECK_EQ(root, g_thread_cache_root);
+  ThreadCache* cache = Get();
+  if (cache) {
+    g_thread_cache_slot->Set(nullptr);
+    Delete(cache);
+  }
+  g_thread_cache_root = nullptr;
+}
+
+// static
+ThreadCache* ThreadCache::Get() {
+  if (!g_thread_cache_slot)
+    return nullptr;
+  return static_cast<ThreadCache*>(g_thread_cache_slot->Get());
+}
+
+// static
+ThreadCache* ThreadCache::Create(PartitionRootGeneric* root) {
+  DCHECK_EQ(root, g_thread_cache_root);
+  DCHECK(!Get());
+
+  // Allocate from the partition directly, as operator new might be routed to
+  // it and come back here.
+  const size_t raw_size = PartitionCookieSizeAdjustAdd(sizeof(ThreadCache));
+  PartitionBucket* bucket = PartitionGenericSizeToBucket(root, raw_size);
+  void* buffer;
+  {
+    subtle::SpinLock::Guard guard(root->lock);
+    buffer = root->AllocFromBucket(bucket, 0, raw_size);
+  }
+  ThreadCache* cache = new (buffer) ThreadCache(root);
+  g_thread_cache_slot->Set(cache);
+  return cache;
+}
+
+// static
+void ThreadCache::Delete(void* thread_cache) {
+  auto* cache = static_cast<ThreadCache*>(thread_cache);
+  PartitionRootGeneric* root = cache->root_;
+  cache->~ThreadCache();
+
+  void* ptr = PartitionCookieFreePointerAdjust(cache);
+  PartitionPage* page = PartitionPage::FromPointer(ptr);
+  subtle::SpinLock::Guard guard(root->lock);
+  page->Free(ptr);
+}
+
+ThreadCache::ThreadCache(PartitionRootGeneric* root) : root_(root) {
+  for (size_t index = 0; index < kBucketCount; ++index) {
+    const PartitionBucket& root_bucket = root->buckets[index];
+    Bucket& bucket = buckets_[index];
+    bucket.slot_size = root_bucket.slot_size;
+    // Pseudo buckets are never allocated from, see
+    // PartitionRootGeneric::Init().
+    if (!root_bucket.active_pages_head)
+      continue;
+    const size_t limit = kMaxCachedBytesPerBucket / bucket.slot_size;
+    bucket.limit = static_cast<uint16_t>(
+        std::min<size_t>(std::max<size_t>(limit, kMinCountPerBucket),
+                         kMaxCountPerBucket));
+  }
+  ThreadCacheRegistry::Instance().RegisterThreadCache(this);
+}
+
+ThreadCache::~ThreadCache() {
+  Purge();
+  ThreadCacheRegistry::Instance().UnregisterThreadCache(this);
+}
+
+void ThreadCache::Purge() {
+  should_purge_.store(false, std::memory_order_relaxed);
+  for (Bucket& bucket : buckets_)
+    ClearBucket(&bucket, 0);
+}
+
+void ThreadCache::SetShouldPurge() {
+  should_purge_.store(true, std::memory_order_relaxed);
+}
+
+void ThreadCache::AccumulateStats(ThreadCacheStats* stats) const {
+  stats->count++;
+  stats->alloc_count += alloc_count_.load(std::memory_order_relaxed);
+  stats->alloc_hits += alloc_hits_.load(std::memory_order_relaxed);
+  stats->alloc_miss_empty += alloc_miss_empty_.load(std::memory_order_relaxed);
+  stats->alloc_miss_too_large +=
+      alloc_miss_too_large_.load(std::memory_order_relaxed);
+  stats->cache_fill_count += cache_fill_count_.load(std::memory_order_relaxed);
+  stats->cache_flush_count +=
+      cache_flush_count_.load(std::memory_order_relaxed);
+  for (const Bucket& bucket : buckets_) {
+    stats->bucket_total_memory +=
+        bucket.count.load(std::memory_order_relaxed) * bucket.slot_size;
+  }
+  stats->metadata_overhead += sizeof(*this);
+}
+
+void ThreadCache::FillBucket(size_t bucket_index) {
+  Increment(&cache_fill_count_);
+  Bucket& bucket = buckets_[bucket_index];
+  PartitionBucket* root_bucket = &root_->buckets[bucket_index];
+  const size_t count = bucket.limit / 2;
+  size_t allocated = 0;
+
+  subtle::SpinLock::Guard guard(root_->lock);
+  for (; allocated < count; ++allocated) {
+    // Stop at the first failure, and let the caller handle out-of-memory
+    // conditions on the regular path.
+    void* ptr = root_->AllocFromBucket(root_bucket, PartitionAllocReturnNull,
+                                       bucket.slot_size);
+    if (!ptr)
+      break;
+    auto* entry = static_cast<PartitionFreelistEntry*>(ptr);
+    entry->next = PartitionFreelistEntry::Transform(bucket.freelist_head);
+    bucket.freelist_head = entry;
+  }
+  bucket.count.store(bucket.count.load(std::memory_order_relaxed) + allocated,
+                     std::memory_order_relaxed);
+}
+
+void ThreadCache::ClearBucket(Bucket* bucket, size_t limit) {
+  size_t count = bucket->count.load(std::memory_order_relaxed);
+  if (count <= limit)
+    return;
+  Increment(&cache_flush_count_);
+
+  subtle::SpinLock::Guard guard(root_->lock);
+  for (; count > limit; --count) {
+    PartitionFreelistEntry* entry = bucket->freelist_head;
+    DCHECK(entry);
+    bucket->freelist_head = PartitionFreelistEntry::Transform(entry->next);
+    void* slot = PartitionCookieFreePointerAdjust(entry);
+    PartitionPage::FromPointer(slot)->Free(slot);
+  }
+  bucket->count.store(count, std::memory_order_relaxed);
+}
+
+}  // namespace internal
+}  // namespace base
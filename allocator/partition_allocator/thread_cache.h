@@ -0,0 +1,259 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_ALLOCATOR_PARTITION_ALLOCATOR_THREAD_CACHE_H_
+#define BASE_ALLOCATOR_PARTITION_ALLOCATOR_THREAD_CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+
+#include "base/allocator/partition_allocator/partition_alloc_constants.h"
+#include "base/allocator/partition_allocator/partition_cookie.h"
+#include "base/allocator/partition_allocator/partition_freelist_entry.h"
+#include "base/base_export.h"
+#include "base/compiler_specific.h"
+#include "base/logging.h"
+#include "base/macros.h"
+#include "base/no_destructor.h"
+#include "base/synchronization/lock.h"
+#include "base/thread_annotations.h"
+
+namespace base {
+
+struct PartitionRootGeneric;
+
+// Struct used to retrieve statistics about the thread caches of a partition.
+// Used by PartitionStatsDumper implementation.
+struct ThreadCacheStats {
+  uint64_t count;  // Total number of thread caches.
+
+  uint64_t alloc_count;           // Total allocation requests.
+  uint64_t alloc_hits;            // Allocations served from a thread cache.
+  uint64_t alloc_miss_empty;      // Allocations which had to refill a bucket.
+  uint64_t alloc_miss_too_large;  // Allocations too large to be cached.
+
+  uint64_t cache_fill_count;   // Number of batches moved from the partition.
+  uint64_t cache_flush_count;  // Number of batches moved to the partition.
+
+  uint64_t bucket_total_memory;  // Memory held in the thread caches, in bytes.
+  uint64_t metadata_overhead;    // Memory used by the thread caches themselves.
+};
+
+namespace internal {
+
+class ThreadCache;
+
+// Keeps track of the thread caches, to dump their statistics and to purge
+// them. Thread-safe.
+class BASE_EXPORT ThreadCacheRegistry {
+ public:
+  static ThreadCacheRegistry& Instance();
+
+  void RegisterThreadCache(ThreadCache* cache);
+  void UnregisterThreadCache(ThreadCache* cache);
+
+  // Sets |*stats| to the statistics of the thread cache of the current thread,
+  // or of all the thread caches if |my_thread_only| is false. Statistics of
+  // other threads are read while these threads use their cache, so they are
+  // approximate.
+  void DumpStats(bool my_thread_only, ThreadCacheStats* stats);
+
+  // Returns the memory held by the thread cache of the current thread to the
+  // partition, and asks the other threads to do the same the next time they
+  // free memory.
+  void PurgeAll();
+
+ private:
+  friend class NoDestructor<ThreadCacheRegistry>;
+
+  ThreadCacheRegistry();
+
+  Lock lock_;
+  ThreadCache* list_head_ GUARDED_BY(lock_) = nullptr;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadCacheRegistry);
+};
+
+// A per-thread cache of free slots, in front of a PartitionRootGeneric.
+//
+// Each thread that allocates from the partition gets a ThreadCache, which
+// holds a bounded freelist for each small bucket. Allocations and frees of
+// small sizes are served from these freelists without taking the partition
+// lock. When a freelist is empty, it is refilled with a batch of slots
+// allocated from the partition's bucket, and when it overflows, half of it is
+// returned to the partition, in both cases under a single acquisition of the
+// lock.
+//
+// Only one partition per process can have thread caches, see
+// PartitionRootGeneric::Init(). Except for its static methods, a ThreadCache
+// is only used by the thread which owns it. It is destroyed when the thread
+// exits, returning its slots to the partition.
+class BASE_EXPORT ThreadCache {
+ public:
+  // Allocations up to this size, cookies included, are cached.
+  static constexpr size_t kSizeThreshold = 512;
+  // Number of buckets of a PartitionRootGeneric up to |kSizeThreshold|. The
+  // buckets of an order are those from the power of two starting it, and
+  // |kGenericMinBucketedOrder| starts at 8 bytes.
+  static constexpr size_t kBucketCount =
+      (10 - kGenericMinBucketedOrder) * kGenericNumBucketsPerOrder + 1;
+  // Bounds on the number of slots a bucket can hold. Within them, a bucket
+  // holds at most |kMaxCachedBytesPerBucket|.
+  static constexpr uint16_t kMinCountPerBucket = 8;
+  static constexpr uint16_t kMaxCountPerBucket = 128;
+  static constexpr size_t kMaxCachedBytesPerBucket = 16 * 1024;
+
+  // Enables thread caches for |root|. Must be called while |root| is being
+  // initialized, and only if no other partition has thread caches.
+  static void Init(PartitionRootGeneric* root);
+
+  // Disables thread caches for |root|, which is being destroyed, and destroys
+  // the thread cache of the current thread. The other threads which used
+  // |root| must have exited.
+  static void Shutdown(PartitionRootGeneric* root);
+
+  // Returns the thread cache of the current thread, or nullptr if it doesn't
+  // have one yet.
+  static ThreadCache* Get();
+
+  // Creates the thread cache of the current thread, and returns it.
+  static ThreadCache* Create(PartitionRootGeneric* root);
+
+  // Puts |ptr|, a slot of the bucket at |bucket_index| as returned to the
+  // application, in the cache (see PartitionRootGeneric::GetBucketIndex()).
+  // Returns false if the bucket isn't cached, in which case the caller must
+  // free the slot.
+  ALWAYS_INLINE bool MaybePutInCache(void* ptr, size_t bucket_index);
+
+  // Returns a slot of the bucket at |bucket_index|, pointing where the
+  // application data starts, or nullptr if the bucket isn't cached or if it
+  // couldn't be refilled. The content of the slot is undefined.
+  ALWAYS_INLINE void* GetFromCache(size_t bucket_index);
+
+  // Returns all the cached slots to the partition.
+  void Purge();
+
+  // Asks the owning thread to Purge() the next time it frees memory. Can be
+  // called from any thread.
+  void SetShouldPurge();
+
+  void AccumulateStats(ThreadCacheStats* stats) const;
+
+  size_t bucket_count_for_testing(size_t index) const {
+    return buckets_[index].count.load(std::memory_order_relaxed);
+  }
+
+ private:
+  friend class ThreadCacheRegistry;
+
+  struct Bucket {
+    PartitionFreelistEntry* freelist_head = nullptr;
+    // Only written by the owning thread; atomic for AccumulateStats().
+    std::atomic<uint16_t> count{0};
+    uint16_t limit = 0;
+    uint32_t slot_size = 0;
+  };
+
+  explicit ThreadCache(PartitionRootGeneric* root);
+  ~ThreadCache();
+
+  // Destructor of the thread-local storage slot.
+  static void Delete(void* thread_cache);
+
+  // Counters are only written by the owning thread, so they don't need
+  // atomic read-modify-write operations.
+  static ALWAYS_INLINE void Increment(std::atomic<uint64_t>* counter) {
+    counter->store(counter->load(std::memory_order_relaxed) + 1,
+                   std::memory_order_relaxed);
+  }
+
+  void FillBucket(size_t bucket_index);
+  // Returns slots of |bucket| to the partition until it holds |limit| slots.
+  void ClearBucket(Bucket* bucket, size_t limit);
+
+  PartitionRootGeneric* const root_;
+  std::atomic<bool> should_purge_{false};
+
+  std::atomic<uint64_t> alloc_count_{0};
+  std::atomic<uint64_t> alloc_hits_{0};
+  std::atomic<uint64_t> alloc_miss_empty_{0};
+  std::atomic<uint64_t> alloc_miss_too_large_{0};
+  std::atomic<uint64_t> cache_fill_count_{0};
+  std::atomic<uint64_t> cache_flush_count_{0};
+
+  Bucket buckets_[kBucketCount];
+
+  // Intrusive list of the thread caches, guarded by the lock of the
+  // ThreadCacheRegistry.
+  ThreadCache* next_ = nullptr;
+  ThreadCache* prev_ = nullptr;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadCache);
+};
+
+ALWAYS_INLINE bool ThreadCache::MaybePutInCache(void* ptr,
+                                                size_t bucket_index) {
+  if (UNLIKELY(should_purge_.load(std::memory_order_relaxed)))
+    Purge();
+
+  if (UNLIKELY(bucket_index >= kBucketCount))
+    return false;
+  Bucket& bucket = buckets_[bucket_index];
+  DCHECK(bucket.limit);
+
+#if DCHECK_IS_ON()
+  // The cookies stay in place while the slot is cached, as the freelist entry
+  // is written after the leading one. PartitionPage::Free() checks them again
+  // when the slot goes back to the partition.
+  const size_t payload_size =
+      PartitionCookieSizeAdjustSubtract(bucket.slot_size);
+  PartitionCookieCheckValue(static_cast<char*>(ptr) - kCookieSize);
+  PartitionCookieCheckValue(static_cast<char*>(ptr) + payload_size);
+  memset(ptr, kFreedByte, payload_size);
+#endif
+
+  auto* entry = static_cast<PartitionFreelistEntry*>(ptr);
+  // Catches an immediate double free.
+  CHECK(entry != bucket.freelist_head);
+  entry->next = PartitionFreelistEntry::Transform(bucket.freelist_head);
+  bucket.freelist_head = entry;
+  const uint16_t count = bucket.count.load(std::memory_order_relaxed) + 1;
+  bucket.count.store(count, std::memory_order_relaxed);
+
+  if (UNLIKELY(count > bucket.limit))
+    ClearBucket(&bucket, bucket.limit / 2);
+  return true;
+}
+
+ALWAYS_INLINE void* ThreadCache::GetFromCache(size_t bucket_index) {
+  Increment(&alloc_count_);
+  if (UNLIKELY(bucket_index >= kBucketCount)) {
+    Increment(&alloc_miss_too_large_);
+    return nullptr;
+  }
+  Bucket& bucket = buckets_[bucket_index];
+  if (LIKELY(bucket.freelist_head)) {
+    Increment(&alloc_hits_);
+  } else {
+    Increment(&alloc_miss_empty_);
+    FillBucket(bucket_index);
+    // The partition is out of memory, let the caller handle it.
+    if (UNLIKELY(!bucket.freelist_head))
+      return nullptr;
+  }
+
+  PartitionFreelistEntry* entry = bucket.freelist_head;
+  bucket.freelist_head = PartitionFreelistEntry::Transform(entry->next);
+  bucket.count.store(bucket.count.load(std::memory_order_relaxed) - 1,
+                     std::memory_order_relaxed);
+  return entry;
+}
+
+}  // namespace internal
+}  // namespace base
+
+#endif  // BASE_ALLOCATOR_PARTITION_ALLOCATOR_THREAD_CACHE_H_
@@ -0,0 +1,299 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/allocator/partition_allocator/thread_cache.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "base/allocator/partition_allocator/memory_reclaimer.h"
+#include "base/allocator/partition_allocator/partition_alloc.h"
+#include "base/bind.h"
+#include "base/callback.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/platform_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+// With *SAN, PartitionAlloc is replaced in partition_alloc.h by ASAN, so we
+// cannot test the thread cache.
+#if !defined(MEMORY_TOOL_REPLACES_ALLOCATOR)
+
+namespace base {
+namespace internal {
+
+namespace {
+
+constexpr size_t kSmallSize = 12;
+constexpr size_t kLargeSize = ThreadCache::kSizeThreshold * 2;
+
+class LambdaThreadDelegate : public PlatformThread::Delegate {
+ public:
+  explicit LambdaThreadDelegate(RepeatingClosure f) : f_(f) {}
+  void ThreadMain() override { f_.Run(); }
+
+ private:
+  RepeatingClosure f_;
+};
+
+// Runs |f| on a new thread, and waits for the thread to exit.
+void RunOnThread(RepeatingClosure f) {
+  LambdaThreadDelegate delegate(f);
+  PlatformThreadHandle thread_handle;
+  ASSERT_TRUE(PlatformThread::Create(0, &delegate, &thread_handle));
+  PlatformThread::Join(thread_handle);
+}
+
+}  // namespace
+
+class ThreadCacheTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    allocator_ = std::make_unique<PartitionAllocatorGeneric>();
+    allocator_->init(true);
+  }
+
+  void TearDown() override { allocator_ = nullptr; }
+
+  PartitionRootGeneric* root() { return allocator_->root(); }
+
+  size_t GetBucketIndex(size_t size) {
+    return root()->GetBucketIndex(PartitionGenericSizeToBucket(
+        root(), PartitionCookieSizeAdjustAdd(size)));
+  }
+
+  size_t GetBucketLimit(size_t size) {
+    const size_t slot_size = root()->buckets[GetBucketIndex(size)].slot_size;
+    return std::min<size_t>(
+        std::max<size_t>(ThreadCache::kMaxCachedBytesPerBucket / slot_size,
+                         ThreadCache::kMinCountPerBucket),
+        ThreadCache::kMaxCountPerBucket);
+  }
+
+  // Returns the number of cached slots of the size class of |size|, in the
+  // thread cache of the current thread.
+  size_t GetBucketCount(size_t size) {
+    ThreadCache* thread_cache = ThreadCache::Get();
+    if (!thread_cache)
+      return 0;
+    return thread_cache->bucket_count_for_testing(GetBucketIndex(size));
+  }
+
+  void FillThreadCacheAndReturnSomething() {
+    void* data = root()->Alloc(kSmallSize, "");
+    ASSERT_TRUE(data);
+    root()->Free(data);
+  }
+
+  ThreadCacheStats GetStats(bool my_thread_only) {
+    ThreadCacheStats stats;
+    ThreadCacheRegistry::Instance().DumpStats(my_thread_only, &stats);
+    return stats;
+  }
+
+ protected:
+  std::unique_ptr<PartitionAllocatorGeneric> allocator_;
+};
+
+TEST_F(ThreadCacheTest, Simple) {
+  EXPECT_FALSE(ThreadCache::Get());
+  void* ptr = root()->Alloc(kSmallSize, "");
+  ASSERT_TRUE(ptr);
+  ASSERT_TRUE(ThreadCache::Get());
+
+  // The first allocation refills the bucket with a batch of slots.
+  const size_t batch_size = GetBucketLimit(kSmallSize) / 2;
+  EXPECT_EQ(batch_size - 1, GetBucketCount(kSmallSize));
+
+  root()->Free(ptr);
+  EXPECT_EQ(batch_size, GetBucketCount(kSmallSize));
+
+  // The slot is reused, without going through the partition.
+  void* ptr2 = root()->Alloc(kSmallSize, "");
+  EXPECT_EQ(ptr, ptr2);
+  EXPECT_EQ(batch_size - 1, GetBucketCount(kSmallSize));
+  root()->Free(ptr2);
+}
+
+TEST_F(ThreadCacheTest, FlushesHalfWhenFull) {
+  const size_t limit = GetBucketLimit(kSmallSize);
+  std::vector<void*> ptrs;
+  for (size_t i = 0; i < 2 * limit; ++i)
+    ptrs.push_back(root()->Alloc(kSmallSize, ""));
+
+  // Allocations drain the bucket, and refill it when it's empty.
+  EXPECT_LT(GetBucketCount(kSmallSize), limit / 2);
+
+  for (void* ptr : ptrs) {
+    root()->Free(ptr);
+    EXPECT_LE(GetBucketCount(kSmallSize), limit);
+  }
+  EXPECT_GE(GetBucketCount(kSmallSize), limit / 2);
+  EXPECT_LT(0u, GetStats(true).cache_flush_count);
+}
+
+TEST_F(ThreadCacheTest, LargeAllocationsAreNotCached) {
+  FillThreadCacheAndReturnSomething();
+  ThreadCacheStats stats_before = GetStats(true);
+
+  void* ptr = root()->Alloc(kLargeSize, "");
+  ASSERT_TRUE(ptr);
+  root()->Free(ptr);
+  // Direct-mapped allocations aren't cached either.
+  ptr = root()->Alloc(kGenericMaxBucketed + 1, "");
+  ASSERT_TRUE(ptr);
+  root()->Free(ptr);
+
+  ThreadCacheStats stats = GetStats(true);
+  EXPECT_EQ(stats_before.alloc_miss_too_large + 2, stats.alloc_miss_too_large);
+  EXPECT_EQ(stats_before.bucket_total_memory, stats.bucket_total_memory);
+}
+
+TEST_F(ThreadCacheTest, ZeroFill) {
+  char* ptr = static_cast<char*>(root()->Alloc(kSmallSize, ""));
+  memset(ptr, 'A', kSmallSize);
+  root()->Free(ptr);
+
+  char* ptr2 = static_cast<char*>(
+      root()->AllocFlags(PartitionAllocZeroFill, kSmallSize, ""));
+  EXPECT_EQ(ptr, ptr2);
+  for (size_t i = 0; i < kSmallSize; ++i)
+    EXPECT_EQ(0, ptr2[i]);
+  root()->Free(ptr2);
+}
+
+TEST_F(ThreadCacheTest, MultipleThreadCaches) {
+  FillThreadCacheAndReturnSomething();
+
+  RunOnThread(BindRepeating(
+      [](ThreadCacheTest* test) {
+        EXPECT_FALSE(ThreadCache::Get());
+        test->FillThreadCacheAndReturnSomething();
+        EXPECT_NE(0u, test->GetBucketCount(kSmallSize));
+        EXPECT_EQ(2u, test->GetStats(false).count);
+      },
+      Unretained(this)));
+
+  // The thread cache of the other thread was destroyed when it exited.
+  EXPECT_EQ(1u, GetStats(false).count);
+  EXPECT_NE(0u, GetBucketCount(kSmallSize));
+}
+
+TEST_F(ThreadCacheTest, CrossThreadFree) {
+  void* ptr = nullptr;
+  RunOnThread(BindRepeating(
+      [](ThreadCacheTest* test, void** ptr) {
+        *ptr = test->root()->Alloc(kSmallSize, "");
+      },
+      Unretained(this), &ptr));
+  ASSERT_TRUE(ptr);
+
+  FillThreadCacheAndReturnSomething();
+  const size_t count = GetBucketCount(kSmallSize);
+  // Goes to the thread cache of the thread which frees it.
+  root()->Free(ptr);
+  EXPECT_EQ(count + 1, GetBucketCount(kSmallSize));
+}
+
+TEST_F(ThreadCacheTest, PurgeAll) {
+  FillThreadCacheAndReturnSomething();
+  EXPECT_NE(0u, GetBucketCount(kSmallSize));
+  ThreadCacheRegistry::Instance().PurgeAll();
+  // The cache of the current thread is purged right away.
+  EXPECT_EQ(0u, GetBucketCount(kSmallSize));
+  EXPECT_EQ(0u, GetStats(true).bucket_total_memory);
+}
+
+TEST_F(ThreadCacheTest, PurgeAllOtherThread) {
+  WaitableEvent other_thread_filled_cache;
+  WaitableEvent purge_requested;
+  LambdaThreadDelegate delegate(BindRepeating(
+      [](ThreadCacheTest* test, WaitableEvent* other_thread_filled_cache,
+         WaitableEvent* purge_requested) {
+        test->FillThreadCacheAndReturnSomething();
+        EXPECT_NE(0u, test->GetBucketCount(kSmallSize));
+        other_thread_filled_cache->Signal();
+        purge_requested->Wait();
+
+        // Purged on the next free.
+        EXPECT_NE(0u, test->GetBucketCount(kSmallSize));
+        void* ptr = test->root()->Alloc(kLargeSize, "");
+        test->root()->Free(ptr);
+        EXPECT_EQ(0u, test->GetBucketCount(kSmallSize));
+      },
+      Unretained(this), &other_thread_filled_cache, &purge_requested));
+  PlatformThreadHandle thread_handle;
+  ASSERT_TRUE(PlatformThread::Create(0, &delegate, &thread_handle));
+
+  other_thread_filled_cache.Wait();
+  ThreadCacheRegistry::Instance().PurgeAll();
+  purge_requested.Signal();
+  PlatformThread::Join(thread_handle);
+}
+
+TEST_F(ThreadCacheTest, PurgedByMemoryReclaimer) {
+  FillThreadCacheAndReturnSomething();
+  EXPECT_NE(0u, GetBucketCount(kSmallSize));
+  PartitionAllocMemoryReclaimer::Instance()->Reclaim();
+  EXPECT_EQ(0u, GetBucketCount(kSmallSize));
+}
+
+namespace {
+
+class ThreadCacheStatsDumper : public PartitionStatsDumper {
+ public:
+  void PartitionDumpTotals(const char* partition_name,
+                           const PartitionMemoryStats* stats) override {
+    stats_ = *stats;
+  }
+  void PartitionsDumpBucketStats(
+      const char* partition_name,
+      const PartitionBucketMemoryStats* stats) override {}
+
+  const PartitionMemoryStats& stats() const { return stats_; }
+
+ private:
+  PartitionMemoryStats stats_ = {};
+};
+
+}  // namespace
+
+TEST_F(ThreadCacheTest, DumpStats) {
+  void* ptr = root()->Alloc(kSmallSize, "");
+  root()->Free(ptr);
+  ptr = root()->Alloc(kSmallSize, "");
+  root()->Free(ptr);
+
+  ThreadCacheStatsDumper dumper;
+  root()->DumpStats("test", true, &dumper);
+  const PartitionMemoryStats& stats = dumper.stats();
+  EXPECT_TRUE(stats.has_thread_cache);
+  EXPECT_EQ(1u, stats.current_thread_cache_stats.count);
+  EXPECT_EQ(2u, stats.current_thread_cache_stats.alloc_count);
+  EXPECT_EQ(1u, stats.current_thread_cache_stats.alloc_hits);
+  EXPECT_EQ(1u, stats.current_thread_cache_stats.alloc_miss_empty);
+  EXPECT_EQ(1u, stats.current_thread_cache_stats.cache_fill_count);
+  const size_t slot_size =
+      root()->buckets[GetBucketIndex(kSmallSize)].slot_size;
+  EXPECT_EQ(GetBucketCount(kSmallSize) * slot_size,
+            stats.current_thread_cache_stats.bucket_total_memory);
+  EXPECT_EQ(sizeof(ThreadCache),
+            stats.current_thread_cache_stats.metadata_overhead);
+  EXPECT_EQ(1u, stats.all_thread_caches_stats.count);
+}
+
+TEST_F(ThreadCacheTest, NoStatsWithoutThreadCache) {
+  PartitionAllocatorGeneric other_allocator;
+  other_allocator.init();
+  ThreadCacheStatsDumper dumper;
+  other_allocator.root()->DumpStats("test", true, &dumper);
+  EXPECT_FALSE(dumper.stats().has_thread_cache);
+}
+
+}  // namespace internal
+}  // namespace base
+
+#endif  // !defined(MEMORY_TOOL_REPLACES_ALLOCATOR)
@@ -0,0 +1,141 @@
+// Copyright 2019 The Basic Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "basic/container/btree_map.h"
+#include "basic/container/btree_set.h"
+
+namespace {
+
+// Returns |n| distinct keys in random order.
+std::vector<int64_t> GenerateKeys(int64_t n) {
+  std::vector<int64_t> keys(n);
+  for (int64_t i = 0; i < n; ++i) keys[i] = 2 * i;
+  std::shuffle(keys.begin(), keys.end(), std::mt19937_64(n));
+  return keys;
+}
+
+template <typename Map>
+Map GenerateMap(const std::vector<int64_t>& keys) {
+  Map map;
+  for (int64_t key : keys) map.insert({key, key});
+  return map;
+}
+
+// Inserts |state.range(0)| random keys in an empty container.
+template <typename Map>
+void BM_Insert(benchmark::State& state) {
+  const std::vector<int64_t> keys = GenerateKeys(state.range(0));
+  for (auto _ : state) {
+    Map map;
+    for (int64_t key : keys) map.insert({key, key});
+    benchmark::DoNotOptimize(map);
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+// Looks up random keys, of which half are present, in a container of
+// |state.range(0)| keys.
+template <typename Map>
+void BM_Lookup(benchmark::State& state) {
+  const std::vector<int64_t> keys = GenerateKeys(state.range(0));
+  const Map map = GenerateMap<Map>(keys);
+  std::vector<int64_t> lookups(keys);
+  for (size_t i = 0; i < lookups.size(); i += 2) ++lookups[i];
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.find(lookups[i]));
+    if (++i == lookups.size()) i = 0;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Scans ranges of 100 values, starting at random keys, in a container of
+// |state.range(0)| keys.
+template <typename Map>
+void BM_RangeScan(benchmark::State& state) {
+  constexpr int kRangeSize = 100;
+  const std::vector<int64_t> keys = GenerateKeys(state.range(0));
+  const Map map = GenerateMap<Map>(keys);
+  size_t i = 0;
+  for (auto _ : state) {
+    int64_t sum = 0;
+    int n = 0;
+    for (auto it = map.lower_bound(keys[i]); it != map.end() && n < kRangeSize;
+         ++it, ++n) {
+      sum += it->second;
+    }
+    benchmark::DoNotOptimize(sum);
+    if (++i == keys.size()) i = 0;
+  }
+  state.SetItemsProcessed(state.iterations() * kRangeSize);
+}
+
+// Erases and reinserts random keys in a container of |state.range(0)| keys,
+// so that its size stays the same.
+template <typename Map>
+void BM_EraseInsert(benchmark::State& state) {
+  const std::vector<int64_t> keys = GenerateKeys(state.range(0));
+  Map map = GenerateMap<Map>(keys);
+  size_t i = 0;
+  for (auto _ : state) {
+    map.erase(keys[i]);
+    map.insert({keys[i], keys[i]});
+    if (++i == keys.size()) i = 0;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+using StdMap = std::map<int64_t, int64_t>;
+using BtreeMap = basic::btree_map<int64_t, int64_t>;
+
+#define BTREE_BENCHMARK(name, type)                                     \
+  BENCHMARK_TEMPLATE(name, type)->RangeMultiplier(10)->Range(1000, 1e8)
+
+BTREE_BENCHMARK(BM_Insert, StdMap);
+BTREE_BENCHMARK(BM_Insert, BtreeMap);
+BTREE_BENCHMARK(BM_Lookup, StdMap);
+BTREE_BENCHMARK(BM_Lookup, BtreeMap);
+BTREE_BENCHMARK(BM_RangeScan, StdMap);
+BTREE_BENCHMARK(BM_RangeScan, BtreeMap);
+BTREE_BENCHMARK(BM_EraseInsert, StdMap);
+BTREE_BENCHMARK(BM_EraseInsert, BtreeMap);
+
+// Sequential insertions, which fill btree nodes entirely.
+template <typename Set>
+void BM_InsertSequential(benchmark::State& state) {
+  const int64_t n = state.range(0);
+  for (auto _ : state) {
+    Set set;
+    for (int64_t i = 0; i < n; ++i) set.insert(set.end(), i);
+    benchmark::DoNotOptimize(set);
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK_TEMPLATE(BM_InsertSequential, std::set<int64_t>)
+    ->RangeMultiplier(10)
+    ->Range(1000, 1e7);
+BENCHMARK_TEMPLATE(BM_InsertSequential, basic::btree_set<int64_t>)
+    ->RangeMultiplier(10)
+    ->Range(1000, 1e7);
+
+}  // namespace
@@ -0,0 +1,397 @@
+// Copyright 2019 The Basic Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "basic/container/btree_map.h"
+#include "basic/container/btree_set.h"
+#include "basic/strings/str_cat.h"
+#include "basic/strings/string_view.h"
+
+namespace basic {
+namespace container_internal {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
+using ::testing::Pair;
+
+// Runs the same random sequence of operations on a btree container and on the
+// corresponding STL container, and checks that they agree, including on the
+// structure of the btree.
+template <typename Tree, typename Checker, typename MakeValue>
+void RandomOperations(int n, MakeValue make_value) {
+  std::mt19937 rng(n);
+  std::uniform_int_distribution<int> key_dist(0, n);
+  Tree tree;
+  Checker checker;
+
+  for (int i = 0; i < 4 * n; ++i) {
+    const int op = i < n ? 0 : rng() % 3;
+    const auto value = make_value(key_dist(rng));
+    if (op == 2) {
+      EXPECT_EQ(checker.erase(Tree::params_type_key(value)),
+                tree.erase(Tree::params_type_key(value)));
+    } else {
+      checker.insert(value);
+      tree.insert(value);
+    }
+    if (i % 64 == 0) tree.verify();
+  }
+  tree.verify();
+  ASSERT_EQ(checker.size(), tree.size());
+  EXPECT_TRUE(std::equal(tree.begin(), tree.end(), checker.begin()));
+  EXPECT_TRUE(std::equal(tree.rbegin(), tree.rend(), checker.rbegin()));
+
+  // Lookups of both present and absent keys.
+  for (int k = -1; k <= n + 1; ++k) {
+    const auto key = Tree::params_type_key(make_value(k));
+    EXPECT_EQ(checker.count(key), tree.count(key));
+    auto lower = tree.lower_bound(key);
+    auto checker_lower = checker.lower_bound(key);
+    ASSERT_EQ(checker_lower == checker.end(), lower == tree.end());
+    if (lower != tree.end()) {
+      EXPECT_TRUE(*lower == *checker_lower);
+    }
+    auto upper = tree.upper_bound(key);
+    auto checker_upper = checker.upper_bound(key);
+    ASSERT_EQ(checker_upper == checker.end(), upper == tree.end());
+    if (upper != tree.end()) {
+      EXPECT_TRUE(*upper == *checker_upper);
+    }
+  }
+
+  // Erase everything through iterators, from both ends.
+  while (!tree.empty()) {
+    auto it = rng() % 2 ? tree.begin() : std::prev(tree.end());
+    auto next = std::next(it);
+    const bool at_end = next == tree.end();
+    const auto expected_next =
+        at_end ? typename Checker::value_type() : *next;
+    checker.erase(checker.find(Tree::params_type_key(*it)));
+    auto res = tree.erase(it);
+    if (at_end) {
+      EXPECT_TRUE(res == tree.end());
+    } else {
+      EXPECT_TRUE(*res == expected_next);
+    }
+    if (tree.size() % 64 == 0) tree.verify();
+  }
+  EXPECT_TRUE(checker.empty());
+}
+
+template <typename K>
+struct TestSet : btree_set<K> {
+  static const K &params_type_key(const K &k) { return k; }
+};
+template <typename K>
+struct TestMultiset : btree_multiset<K> {
+  static const K &params_type_key(const K &k) { return k; }
+};
+template <typename K, typename V>
+struct TestMap : btree_map<K, V> {
+  template <typename P>
+  static const K &params_type_key(const P &p) {
+    return p.first;
+  }
+};
+template <typename K, typename V>
+struct TestMultimap : btree_multimap<K, V> {
+  template <typename P>
+  static const K &params_type_key(const P &p) {
+    return p.first;
+  }
+};
+
+int IntValue(int i) { return i; }
+std::string StringValue(int i) { return StrCat("key", i); }
+std::pair<int, std::string> IntStringValue(int i) {
+  return {i, StrCat("value", i)};
+}
+std::pair<std::string, int> StringIntValue(int i) {
+  return {StringValue(i), i};
+}
+
+TEST(Btree, RandomSet) {
+  for (int n : {10, 100, 1000, 10000}) {
+    SCOPED_TRACE(n);
+    RandomOperations<TestSet<int>, std::set<int>>(n, IntValue);
+    RandomOperations<TestSet<std::string>, std::set<std::string>>(n,
+                                                                  StringValue);
+  }
+}
+
+TEST(Btree, RandomMultiset) {
+  for (int n : {10, 100, 1000, 10000}) {
+    SCOPED_TRACE(n);
+    RandomOperations<TestMultiset<int>, std::multiset<int>>(n, IntValue);
+    RandomOperations<TestMultiset<std::string>, std::multiset<std::string>>(
+        n, StringValue);
+  }
+}
+
+TEST(Btree, RandomMap) {
+  for (int n : {10, 100, 1000, 10000}) {
+    SCOPED_TRACE(n);
+    RandomOperations<TestMap<int, std::string>, std::map<int, std::string>>(
+        n, IntStringValue);
+    RandomOperations<TestMap<std::string, int>, std::map<std::string, int>>(
+        n, StringIntValue);
+  }
+}
+
+TEST(Btree, RandomMultimap) {
+  for (int n : {10, 100, 1000, 10000}) {
+    SCOPED_TRACE(n);
+    RandomOperations<TestMultimap<int, std::string>,
+                     std::multimap<int, std::string>>(n, IntStringValue);
+  }
+}
+
+TEST(Btree, SequentialInsertAndErase) {
+  constexpr int kSize = 100000;
+  btree_set<int> ascending;
+  btree_set<int> descending;
+  for (int i = 0; i < kSize; ++i) {
+    ascending.insert(ascending.end(), i);
+    descending.insert(descending.begin(), kSize - i - 1);
+  }
+  ascending.verify();
+  descending.verify();
+  EXPECT_TRUE(ascending == descending);
+  EXPECT_EQ(kSize, std::distance(ascending.begin(), ascending.end()));
+
+  // Range erase in the middle, then from the front.
+  auto it = ascending.erase(ascending.find(1000), ascending.find(90000));
+  EXPECT_EQ(90000, *it);
+  ascending.verify();
+  EXPECT_EQ(kSize - 89000u, ascending.size());
+  while (!descending.empty()) descending.erase(descending.begin());
+  descending.verify();
+  EXPECT_TRUE(descending.begin() == descending.end());
+}
+
+TEST(Btree, Hints) {
+  btree_set<int> s;
+  auto hint = s.end();
+  for (int i = 0; i < 1000; i += 2) hint = std::next(s.insert(hint, i));
+  // A wrong hint falls back to a regular insertion.
+  s.insert(s.begin(), 501);
+  s.insert(s.end(), 3);
+  // An existing value isn't inserted again.
+  EXPECT_EQ(4, *s.insert(s.find(4), 4));
+  s.verify();
+  EXPECT_EQ(502u, s.size());
+  EXPECT_TRUE(s.contains(501));
+  EXPECT_TRUE(s.contains(3));
+
+  btree_multiset<int> ms;
+  for (int i = 0; i < 100; ++i) ms.insert(ms.end(), i / 10);
+  ms.insert(ms.begin(), 5);
+  ms.verify();
+  EXPECT_EQ(11u, ms.count(5));
+  EXPECT_TRUE(std::is_sorted(ms.begin(), ms.end()));
+}
+
+TEST(Btree, MapApi) {
+  btree_map<std::string, int> m;
+  m["b"] = 2;
+  EXPECT_TRUE(m.try_emplace("a", 1).second);
+  EXPECT_FALSE(m.try_emplace("a", 3).second);
+  EXPECT_TRUE(m.insert({"c", 3}).second);
+  EXPECT_TRUE(m.emplace("d", 4).second);
+  EXPECT_THAT(m, ElementsAre(Pair("a", 1), Pair("b", 2), Pair("c", 3),
+                             Pair("d", 4)));
+  EXPECT_EQ(1, m.at("a"));
+  ++m["a"];
+  EXPECT_EQ(2, m.at("a"));
+  EXPECT_EQ(1u, m.erase("a"));
+  EXPECT_EQ(0u, m.erase("a"));
+#ifdef ABSL_HAVE_EXCEPTIONS
+  EXPECT_THROW(m.at("a"), std::out_of_range);
+#endif
+
+  btree_multimap<int, int> mm = {{1, 1}, {2, 2}, {1, 3}};
+  mm.emplace(1, 4);
+  EXPECT_THAT(mm, ElementsAre(Pair(1, 1), Pair(1, 3), Pair(1, 4), Pair(2, 2)));
+  auto range = mm.equal_range(1);
+  EXPECT_EQ(3, std::distance(range.first, range.second));
+  EXPECT_EQ(3u, mm.erase(1));
+  EXPECT_THAT(mm, ElementsAre(Pair(2, 2)));
+}
+
+// A transparent `std::less`, which is C++14.
+struct TransparentLess {
+  using is_transparent = void;
+
+  template <class T, class U>
+  bool operator()(const T& a, const U& b) const {
+    return a < b;
+  }
+};
+
+TEST(Btree, HeterogeneousLookup) {
+  btree_set<std::string, TransparentLess> s = {"a", "b", "c"};
+  EXPECT_TRUE(s.contains(basic::string_view("b")));
+  EXPECT_TRUE(s.find("c") != s.end());
+  EXPECT_EQ(1u, s.count(basic::string_view("a")));
+  EXPECT_EQ("b", *s.lower_bound(basic::string_view("aa")));
+  EXPECT_EQ(1u, s.erase(basic::string_view("b")));
+  EXPECT_THAT(s, ElementsAre("a", "c"));
+
+  btree_map<std::string, int, TransparentLess> m = {{"x", 1}};
+  EXPECT_EQ(1, m.at(basic::string_view("x")));
+}
+
+TEST(Btree, CustomComparator) {
+  btree_set<int, std::greater<int>> s;
+  for (int i = 0; i < 1000; ++i) s.insert(i);
+  s.verify();
+  EXPECT_EQ(999, *s.begin());
+  EXPECT_EQ(0, *s.rbegin());
+  EXPECT_EQ(500, *s.lower_bound(500));
+  EXPECT_EQ(499, *s.upper_bound(500));
+}
+
+TEST(Btree, CopyMoveAndSwap) {
+  btree_map<int, std::string> m;
+  for (int i = 0; i < 1000; ++i) m[i] = StrCat(i);
+
+  btree_map<int, std::string> copy(m);
+  copy.verify();
+  EXPECT_TRUE(copy == m);
+  btree_map<int, std::string> assigned;
+  assigned[-1] = "x";
+  assigned = m;
+  EXPECT_TRUE(assigned == m);
+
+  btree_map<int, std::string> moved(std::move(copy));
+  EXPECT_TRUE(moved == m);
+  EXPECT_TRUE(copy.empty());  // NOLINT(bugprone-use-after-move)
+  copy[1] = "one";
+  EXPECT_EQ(1u, copy.size());
+
+  btree_map<int, std::string> move_assigned;
+  move_assigned = std::move(moved);
+  EXPECT_TRUE(move_assigned == m);
+
+  swap(move_assigned, copy);
+  EXPECT_EQ(1u, move_assigned.size());
+  EXPECT_TRUE(copy == m);
+  EXPECT_TRUE(move_assigned < copy || copy < move_assigned);
+}
+
+TEST(Btree, MoveOnlyValues) {
+  btree_map<int, std::unique_ptr<int>> m;
+  for (int i = 0; i < 1000; ++i) m.try_emplace(i, new int(i));
+  m.verify();
+  for (int i = 0; i < 1000; i += 2) m.erase(i);
+  m.verify();
+  for (const auto &entry : m) EXPECT_EQ(entry.first, *entry.second);
+
+  btree_multiset<std::unique_ptr<int>> s;
+  s.emplace(new int(1));
+  s.insert(std::unique_ptr<int>(new int(2)));
+  EXPECT_EQ(2u, s.size());
+}
+
+TEST(Btree, NodeHandles) {
+  btree_set<int> s = {1, 2, 3};
+  auto node = s.extract(2);
+  ASSERT_FALSE(node.empty());
+  EXPECT_EQ(2, node.value());
+  EXPECT_THAT(s, ElementsAre(1, 3));
+  auto res = s.insert(std::move(node));
+  EXPECT_TRUE(res.inserted);
+  EXPECT_EQ(2, *res.position);
+  EXPECT_TRUE(s.extract(4).empty());
+
+  btree_map<int, std::string> m = {{1, "a"}, {2, "b"}};
+  auto map_node = m.extract(m.begin());
+  EXPECT_EQ(1, map_node.key());
+  map_node.mapped() = "c";
+  btree_map<int, std::string> other = {{1, "x"}};
+  auto map_res = other.insert(std::move(map_node));
+  EXPECT_FALSE(map_res.inserted);
+  EXPECT_EQ("c", map_res.node.mapped());
+
+  btree_multimap<int, std::string> mm = {{1, "a"}, {2, "b"}};
+  auto multi_node = mm.extract(2);
+  multi_node.mapped() = "c";
+  mm.insert(std::move(multi_node));
+  mm.insert(mm.extract(mm.begin()));
+  EXPECT_THAT(mm, ElementsAre(Pair(1, "a"), Pair(2, "c")));
+}
+
+TEST(Btree, Merge) {
+  btree_set<int> a = {1, 3, 5};
+  btree_set<int> b = {1, 2, 3, 4};
+  a.merge(b);
+  EXPECT_THAT(a, ElementsAre(1, 2, 3, 4, 5));
+  EXPECT_THAT(b, ElementsAre(1, 3));
+
+  btree_multiset<int> c = {1, 1};
+  c.merge(a);
+  EXPECT_THAT(c, ElementsAre(1, 1, 1, 2, 3, 4, 5));
+  EXPECT_TRUE(a.empty());
+}
+
+TEST(Btree, NodeSize) {
+  using Tree = btree<set_params<int32_t, std::less<int32_t>,
+                                std::allocator<int32_t>, 256, false>>;
+  const std::less<int32_t> comp;
+  const std::allocator<int32_t> alloc;
+  Tree tree(comp, alloc);
+  EXPECT_EQ(0u, tree.height());
+  EXPECT_EQ(0.0, tree.fullness());
+  for (int i = 0; i < 100000; ++i) tree.insert_unique(i, i);
+  EXPECT_EQ(3u, tree.height());
+  // Sequential insertions fill the nodes, leaving room for a single value.
+  EXPECT_GT(tree.fullness(), 0.9);
+  // Far from the 40 bytes per value of std::set<int32_t>.
+  EXPECT_LT(static_cast<double>(tree.bytes_used()) / tree.size(), 5.0);
+  EXPECT_EQ(tree.nodes(), tree.leaf_nodes() + tree.internal_nodes());
+
+  // A small tree only allocates what it needs.
+  Tree small(comp, alloc);
+  small.insert_unique(1, 1);
+  EXPECT_LT(small.bytes_used(), sizeof(small) + 32);
+}
+
+TEST(Btree, Comparison) {
+  const btree_set<int> a = {1, 2, 3};
+  const btree_set<int> b = {1, 2, 4};
+  EXPECT_TRUE(a == a);
+  EXPECT_TRUE(a != b);
+  EXPECT_TRUE(a < b);
+  EXPECT_TRUE(b > a);
+  EXPECT_TRUE(a <= b);
+  EXPECT_TRUE(b >= a);
+  std::vector<int> values(a.begin(), a.end());
+  EXPECT_THAT(values, ElementsAreArray({1, 2, 3}));
+}
+
+}  // namespace
+}  // namespace container_internal
+}  // namespace basic
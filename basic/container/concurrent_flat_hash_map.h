@@ -0,0 +1,396 @@
+// Copyright 2019 The Basic Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: concurrent_flat_hash_map.h
+// -----------------------------------------------------------------------------
+//
+// An `basic::concurrent_flat_hash_map<K, V>` is a hash map which can be used
+// from several threads at once, without external locking. It is designed for
+// read-mostly workloads where a single `basic::Mutex` around a
+// `basic::flat_hash_map` becomes the bottleneck.
+//
+// The map is split into `2^NumShardsLog2` shards, each of which is a
+// `flat_hash_map` guarded by its own reader-writer lock. The shard of a key is
+// picked from the high bits of its hash, which the shards don't use to probe.
+// The hash is computed once, before locking the shard, and every operation
+// passes it on to the map of the shard instead of hashing the key again.
+// Lookups take a shared lock on a single shard, so readers never block each
+// other, and a writer only blocks the threads which access the same shard.
+//
+// Reads can't be lock-free, as with a seqlock: a `flat_hash_map` frees its
+// backing array when it grows, so an optimistic reader may dereference freed
+// memory before it notices the concurrent write.
+//
+// Since another thread may modify the map at any time, there are no iterators
+// and no references to the values are handed out. Instead, the values are
+// accessed through callbacks which run under the lock of their shard:
+//
+//   basic::concurrent_flat_hash_map<std::string, int> counts;
+//
+//   // Increments the count of `word`, or inserts it with a count of 1.
+//   counts.try_emplace_l(word, [](auto& entry) { ++entry.second; }, 1);
+//
+//   // Reads the count of `word`.
+//   int count = 0;
+//   counts.if_contains(word, [&](const auto& entry) { count = entry.second; });
+//
+// The callbacks must not access the map, which would deadlock, and should be
+// short, since they block the other threads using the same shard.
+#ifndef ABSL_CONTAINER_CONCURRENT_FLAT_HASH_MAP_H_
+#define ABSL_CONTAINER_CONCURRENT_FLAT_HASH_MAP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <utility>
+
+#include "basic/base/optimization.h"
+#include "basic/base/thread_annotations.h"
+#include "basic/container/flat_hash_map.h"
+#include "basic/container/internal/common.h"
+#include "basic/synchronization/mutex.h"
+
+namespace basic {
+
+template <class K, class V,
+          class Hash = basic::container_internal::hash_default_hash<K>,
+          class Eq = basic::container_internal::hash_default_eq<K>,
+          class Allocator = std::allocator<std::pair<const K, V>>,
+          size_t NumShardsLog2 = 4>
+class concurrent_flat_hash_map {
+  using Map = flat_hash_map<K, V, Hash, Eq, Allocator>;
+
+  using KeyArgImpl = container_internal::KeyArg<
+      container_internal::IsTransparent<Eq>::value &&
+      container_internal::IsTransparent<Hash>::value>;
+
+ public:
+  using key_type = K;
+  using mapped_type = V;
+  using value_type = typename Map::value_type;
+  using size_type = size_t;
+  using hasher = Hash;
+  using key_equal = Eq;
+  using allocator_type = Allocator;
+  // The argument of the callbacks of `lazy_emplace_l()`, which constructs the
+  // inserted value.
+  using constructor = typename Map::constructor;
+
+  static constexpr size_t kNumShards = size_t{1} << NumShardsLog2;
+
+  // Alias used for heterogeneous lookup functions.
+  // `key_arg<K>` evaluates to `K` when the functors are transparent and to
+  // `key_type` otherwise. It permits template argument deduction on `K` for the
+  // transparent case.
+  template <class Key>
+  using key_arg = typename KeyArgImpl::template type<Key, key_type>;
+
+  concurrent_flat_hash_map() : concurrent_flat_hash_map(hasher()) {}
+  explicit concurrent_flat_hash_map(const hasher& hash,
+                                    const key_equal& eq = key_equal(),
+                                    const allocator_type& alloc =
+                                        allocator_type())
+      : hash_(hash),
+        shard_storage_(new char[sizeof(Shard) * kNumShards +
+                                ABSL_CACHELINE_SIZE - 1]) {
+    // `new` ignores the alignment of `Shard` before C++17, so the shards are
+    // aligned by hand.
+    const uintptr_t storage =
+        reinterpret_cast<uintptr_t>(shard_storage_.get());
+    shards_ = reinterpret_cast<Shard*>(
+        (storage + ABSL_CACHELINE_SIZE - 1) &
+        ~static_cast<uintptr_t>(ABSL_CACHELINE_SIZE - 1));
+    for (size_t i = 0; i < kNumShards; ++i) {
+      new (&shards_[i]) Shard(hash, eq, alloc);
+    }
+  }
+
+  ~concurrent_flat_hash_map() {
+    for (size_t i = 0; i < kNumShards; ++i) shards_[i].~Shard();
+  }
+
+  concurrent_flat_hash_map(const concurrent_flat_hash_map&) = delete;
+  concurrent_flat_hash_map& operator=(const concurrent_flat_hash_map&) =
+      delete;
+
+  // Returns the number of elements. This is only a snapshot if other threads
+  // modify the map, and it locks every shard in turn.
+  size_type size() const {
+    size_type size = 0;
+    for (size_t i = 0; i < kNumShards; ++i) {
+      const Shard& shard = shards_[i];
+      ReaderMutexLock lock(&shard.mu);
+      size += shard.map.size();
+    }
+    return size;
+  }
+  bool empty() const { return size() == 0; }
+
+  // Removes all the elements, one shard after the other.
+  void clear() {
+    for (size_t i = 0; i < kNumShards; ++i) {
+      Shard& shard = shards_[i];
+      WriterMutexLock lock(&shard.mu);
+      shard.map.clear();
+    }
+  }
+
+  // Makes room for at least `n` elements overall, assuming that the keys are
+  // evenly spread among the shards.
+  void reserve(size_type n) {
+    for (size_t i = 0; i < kNumShards; ++i) {
+      Shard& shard = shards_[i];
+      WriterMutexLock lock(&shard.mu);
+      shard.map.reserve((n + kNumShards - 1) / kNumShards);
+    }
+  }
+
+  // Lookup routines.
+  template <class Key = key_type>
+  bool contains(const key_arg<Key>& key) const {
+    const size_t hash = hash_(key);
+    const Shard& shard = shard_for(hash);
+    ReaderMutexLock lock(&shard.mu);
+    return shard.map.find(key, hash) != shard.map.end();
+  }
+  template <class Key = key_type>
+  size_type count(const key_arg<Key>& key) const {
+    return contains(key) ? 1 : 0;
+  }
+
+  // Calls `f(const value_type&)` with the element of `key`, under a shared
+  // lock. Returns false if there is no such element.
+  template <class Key = key_type, class F>
+  bool if_contains(const key_arg<Key>& key, F&& f) const {
+    const size_t hash = hash_(key);
+    const Shard& shard = shard_for(hash);
+    ReaderMutexLock lock(&shard.mu);
+    auto it = shard.map.find(key, hash);
+    if (it == shard.map.end()) return false;
+    std::forward<F>(f)(*it);
+    return true;
+  }
+
+  // Calls `f(value_type&)` with the element of `key`, under an exclusive lock,
+  // so that `f` can modify the mapped value. Returns false if there is no such
+  // element.
+  template <class Key = key_type, class F>
+  bool modify_if(const key_arg<Key>& key, F&& f) {
+    const size_t hash = hash_(key);
+    Shard& shard = shard_for(hash);
+    WriterMutexLock lock(&shard.mu);
+    auto it = shard.map.find(key, hash);
+    if (it == shard.map.end()) return false;
+    std::forward<F>(f)(*it);
+    return true;
+  }
+
+  // Insertion routines. They return true if an element was inserted, and
+  // false if there already was an element for the key, which is left as is.
+  bool insert(const value_type& value) {
+    return with_shard_of(value.first, [&](Map& map, size_t hash) {
+      return emplace_with_hash(map, value.first, hash, value).second;
+    });
+  }
+  bool insert(value_type&& value) {
+    return with_shard_of(value.first, [&](Map& map, size_t hash) {
+      return emplace_with_hash(map, value.first, hash, std::move(value))
+          .second;
+    });
+  }
+  template <class... Args>
+  bool try_emplace(const key_type& key, Args&&... args) {
+    return with_shard_of(key, [&](Map& map, size_t hash) {
+      return emplace_with_hash(
+                 map, key, hash, std::piecewise_construct,
+                 std::forward_as_tuple(key),
+                 std::forward_as_tuple(std::forward<Args>(args)...))
+          .second;
+    });
+  }
+  template <class... Args>
+  bool try_emplace(key_type&& key, Args&&... args) {
+    return with_shard_of(key, [&](Map& map, size_t hash) {
+      return emplace_with_hash(
+                 map, key, hash, std::piecewise_construct,
+                 std::forward_as_tuple(std::move(key)),
+                 std::forward_as_tuple(std::forward<Args>(args)...))
+          .second;
+    });
+  }
+
+  // Inserts an element for `key` constructed from `args` or, if there already
+  // is one, calls `f(value_type&)` with it. Both happen under the same
+  // exclusive lock, so this can implement an atomic read-modify-write, like a
+  // counter increment. Returns true if an element was inserted.
+  template <class F, class... Args>
+  bool try_emplace_l(const key_type& key, F&& f, Args&&... args) {
+    return with_shard_of(key, [&](Map& map, size_t hash) {
+      auto res = emplace_with_hash(
+          map, key, hash, std::piecewise_construct, std::forward_as_tuple(key),
+          std::forward_as_tuple(std::forward<Args>(args)...));
+      if (!res.second) std::forward<F>(f)(*res.first);
+      return res.second;
+    });
+  }
+
+  // Like `try_emplace_l()`, but the element is constructed by calling
+  // `f_emplace(const constructor& ctor)`, which must call `ctor` with the
+  // arguments of a `value_type` constructor, as with
+  // `flat_hash_map::lazy_emplace()`. This avoids constructing the key when
+  // it's heterogeneous and already present. Returns true if an element was
+  // inserted.
+  template <class Key = key_type, class FExists, class FEmplace>
+  bool lazy_emplace_l(const key_arg<Key>& key, FExists&& f_exists,
+                      FEmplace&& f_emplace) {
+    return with_shard_of(key, [&](Map& map, size_t hash) {
+      bool inserted = false;
+      auto it = map.lazy_emplace(key, hash, [&](const constructor& ctor) {
+        inserted = true;
+        std::forward<FEmplace>(f_emplace)(ctor);
+      });
+      if (!inserted) std::forward<FExists>(f_exists)(*it);
+      return inserted;
+    });
+  }
+
+  // Inserts `value` for `key`, or assigns it to the existing element. Returns
+  // true if an element was inserted.
+  template <class M>
+  bool insert_or_assign(const key_type& key, M&& value) {
+    return with_shard_of(key, [&](Map& map, size_t hash) {
+      auto res = emplace_with_hash(map, key, hash, std::piecewise_construct,
+                                   std::forward_as_tuple(key),
+                                   std::forward_as_tuple(std::forward<M>(value)));
+      if (!res.second) res.first->second = std::forward<M>(value);
+      return res.second;
+    });
+  }
+
+  // Deletion routines. They return the number of elements erased.
+  template <class Key = key_type>
+  size_type erase(const key_arg<Key>& key) {
+    return with_shard_of(key, [&](Map& map, size_t hash) -> size_type {
+      auto it = map.find(key, hash);
+      if (it == map.end()) return 0;
+      map.erase(it);
+      return 1;
+    });
+  }
+
+  // Erases the element of `key` if `pred(value_type&)` returns true.
+  template <class Key = key_type, class Pred>
+  size_type erase_if(const key_arg<Key>& key, Pred&& pred) {
+    return with_shard_of(key, [&](Map& map, size_t hash) -> size_type {
+      auto it = map.find(key, hash);
+      if (it == map.end() || !std::forward<Pred>(pred)(*it)) return 0;
+      map.erase(it);
+      return 1;
+    });
+  }
+
+  // Calls `f(const value_type&)` with every element, under a shared lock of
+  // one shard at a time. Elements inserted or erased in other shards meanwhile
+  // may or may not be visited.
+  template <class F>
+  void for_each(F&& f) const {
+    for (size_t i = 0; i < kNumShards; ++i) {
+      const Shard& shard = shards_[i];
+      ReaderMutexLock lock(&shard.mu);
+      for (const value_type& value : shard.map) f(value);
+    }
+  }
+
+  // Like `for_each()`, but `f(value_type&)` may modify the mapped values.
+  template <class F>
+  void for_each_m(F&& f) {
+    for (size_t i = 0; i < kNumShards; ++i) {
+      Shard& shard = shards_[i];
+      WriterMutexLock lock(&shard.mu);
+      for (value_type& value : shard.map) f(value);
+    }
+  }
+
+  hasher hash_function() const { return hash_; }
+
+ private:
+  // Aligned so that the locks of neighboring shards, which are written by the
+  // threads using them, are on different cache lines.
+  struct alignas(ABSL_CACHELINE_SIZE) Shard {
+    Shard(const hasher& hash, const key_equal& eq, const allocator_type& alloc)
+        : map(0, hash, eq, alloc) {}
+
+    mutable Mutex mu;
+    Map map GUARDED_BY(mu);
+  };
+
+  static_assert(NumShardsLog2 < std::numeric_limits<size_t>::digits,
+                "too many shards");
+
+  // The maps of the shards probe from the low bits of the hash, past the 7
+  // bits of H2, so the shard index comes from the highest bits.
+  static size_t shard_index(size_t hash) {
+    return NumShardsLog2 == 0
+               ? 0
+               : hash >> (std::numeric_limits<size_t>::digits - NumShardsLog2);
+  }
+  Shard& shard_for(size_t hash) { return shards_[shard_index(hash)]; }
+  const Shard& shard_for(size_t hash) const {
+    return shards_[shard_index(hash)];
+  }
+
+  // Calls `f(Map&, size_t hash)` with the map of the shard of `key` and the
+  // hash of `key`, under the exclusive lock of the shard, and returns its
+  // result.
+  template <class Key, class F>
+  auto with_shard_of(const Key& key, F&& f)
+      -> decltype(f(std::declval<Map&>(), size_t{})) {
+    const size_t hash = hash_(key);
+    Shard& shard = shard_for(hash);
+    WriterMutexLock lock(&shard.mu);
+    return f(shard.map, hash);
+  }
+
+  // Inserts an element constructed from `args` in `map`, unless there already
+  // is one for `key`, whose hash is `hash`. Returns an iterator to the element
+  // for `key` and whether it was inserted.
+  template <class Key, class... Args>
+  static std::pair<typename Map::iterator, bool> emplace_with_hash(
+      Map& map, const Key& key, size_t hash, Args&&... args) {
+    bool inserted = false;
+    auto it = map.lazy_emplace(key, hash, [&](const constructor& ctor) {
+      inserted = true;
+      ctor(std::forward<Args>(args)...);
+    });
+    return {it, inserted};
+  }
+
+  const hasher hash_;
+  // Holds `shards_`, which starts at the first cache line boundary in it.
+  const std::unique_ptr<char[]> shard_storage_;
+  Shard* shards_;
+};
+
+template <class K, class V, class Hash, class Eq, class Allocator,
+          size_t NumShardsLog2>
+constexpr size_t concurrent_flat_hash_map<K, V, Hash, Eq, Allocator,
+                                          NumShardsLog2>::kNumShards;
+
+}  // namespace basic
+
+#endif  // ABSL_CONTAINER_CONCURRENT_FLAT_HASH_MAP_H_
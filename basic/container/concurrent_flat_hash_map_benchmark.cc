@@ -0,0 +1,102 @@
+// Copyright 2019 The Basic Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+
+#include <random>
+#include <utility>
+
+#include "benchmark/benchmark.h"
+#include "basic/base/thread_annotations.h"
+#include "basic/container/concurrent_flat_hash_map.h"
+#include "basic/container/flat_hash_map.h"
+#include "basic/synchronization/mutex.h"
+
+namespace {
+
+constexpr int64_t kNumKeys = 1 << 16;
+
+// The baseline: a single flat_hash_map behind a single reader/writer lock.
+class LockedFlatHashMap {
+ public:
+  bool Find(int64_t key) const {
+    basic::ReaderMutexLock lock(&mu_);
+    return map_.find(key) != map_.end();
+  }
+  void Upsert(int64_t key) {
+    basic::WriterMutexLock lock(&mu_);
+    ++map_[key];
+  }
+
+ private:
+  mutable basic::Mutex mu_;
+  basic::flat_hash_map<int64_t, int64_t> map_ GUARDED_BY(mu_);
+};
+
+class ShardedFlatHashMap {
+ public:
+  bool Find(int64_t key) const {
+    return map_.if_contains(key, [](const std::pair<const int64_t, int64_t>&) {
+    });
+  }
+  void Upsert(int64_t key) {
+    map_.try_emplace_l(
+        key, [](std::pair<const int64_t, int64_t>& v) { ++v.second; }, 1);
+  }
+
+ private:
+  basic::concurrent_flat_hash_map<int64_t, int64_t> map_;
+};
+
+// Runs a mix of lookups and updates on a map shared by all threads, where
+// |state.range(0)| is the percentage of lookups.
+template <typename Map>
+void BM_ReadWrite(benchmark::State& state) {
+  // Threads of the same run share the map; it only ever grows to kNumKeys
+  // entries, so sharing it across runs does not skew the results.
+  static Map* const map = [] {
+    Map* map = new Map;
+    for (int64_t key = 0; key < kNumKeys; key += 2) map->Upsert(key);
+    return map;
+  }();
+  const int64_t read_percent = state.range(0);
+  std::mt19937_64 rng(state.thread_index);
+  std::uniform_int_distribution<int64_t> keys(0, kNumKeys - 1);
+  std::uniform_int_distribution<int64_t> percent(0, 99);
+  int64_t found = 0;
+  for (auto _ : state) {
+    const int64_t key = keys(rng);
+    if (percent(rng) < read_percent) {
+      found += map->Find(key);
+    } else {
+      map->Upsert(key);
+    }
+  }
+  benchmark::DoNotOptimize(found);
+  state.SetItemsProcessed(state.iterations());
+}
+
+#define READ_WRITE_BENCHMARK(type)       \
+  BENCHMARK_TEMPLATE(BM_ReadWrite, type) \
+      ->Arg(100)                         \
+      ->Arg(99)                          \
+      ->Arg(90)                          \
+      ->Arg(50)                          \
+      ->ThreadRange(1, 64)               \
+      ->UseRealTime()
+
+READ_WRITE_BENCHMARK(LockedFlatHashMap);
+READ_WRITE_BENCHMARK(ShardedFlatHashMap);
+
+}  // namespace
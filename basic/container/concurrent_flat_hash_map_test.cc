@@ -0,0 +1,256 @@
+// Copyright 2019 The Basic Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "basic/container/concurrent_flat_hash_map.h"
+
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "basic/strings/str_cat.h"
+#include "basic/strings/string_view.h"
+
+namespace basic {
+namespace {
+
+using ::testing::Pair;
+using ::testing::UnorderedElementsAre;
+
+template <class Map>
+std::vector<typename Map::value_type> Elements(const Map& map) {
+  std::vector<typename Map::value_type> elements;
+  map.for_each([&](const typename Map::value_type& v) {
+    elements.push_back(v);
+  });
+  return elements;
+}
+
+TEST(ConcurrentFlatHashMap, Basic) {
+  concurrent_flat_hash_map<int, std::string> map;
+  EXPECT_TRUE(map.empty());
+  EXPECT_TRUE(map.insert({1, "a"}));
+  EXPECT_FALSE(map.insert({1, "b"}));
+  EXPECT_TRUE(map.try_emplace(2, "b"));
+  EXPECT_FALSE(map.try_emplace(2, "c"));
+  EXPECT_FALSE(map.insert_or_assign(2, "c"));
+  EXPECT_TRUE(map.insert_or_assign(3, "d"));
+  EXPECT_EQ(3u, map.size());
+  EXPECT_TRUE(map.contains(2));
+  EXPECT_EQ(0u, map.count(4));
+  EXPECT_THAT(Elements(map),
+              UnorderedElementsAre(Pair(1, "a"), Pair(2, "c"), Pair(3, "d")));
+
+  std::string value;
+  EXPECT_TRUE(map.if_contains(
+      1, [&](const std::pair<const int, std::string>& v) {
+        value = v.second;
+      }));
+  EXPECT_EQ("a", value);
+  EXPECT_FALSE(map.if_contains(
+      4, [&](const std::pair<const int, std::string>&) { ADD_FAILURE(); }));
+  EXPECT_TRUE(map.modify_if(
+      1, [](std::pair<const int, std::string>& v) { v.second += "!"; }));
+  EXPECT_FALSE(map.modify_if(
+      4, [](std::pair<const int, std::string>&) { ADD_FAILURE(); }));
+  map.for_each_m([](std::pair<const int, std::string>& v) { v.second += "?"; });
+  EXPECT_THAT(Elements(map), UnorderedElementsAre(Pair(1, "a!?"), Pair(2, "c?"),
+                                                  Pair(3, "d?")));
+
+  EXPECT_EQ(1u, map.erase(1));
+  EXPECT_EQ(0u, map.erase(1));
+  EXPECT_EQ(0u, map.erase_if(2, [](std::pair<const int, std::string>& v) {
+              return v.second.empty();
+            }));
+  EXPECT_EQ(1u, map.erase_if(2, [](std::pair<const int, std::string>& v) {
+              return v.second == "c?";
+            }));
+  EXPECT_THAT(Elements(map), UnorderedElementsAre(Pair(3, "d?")));
+
+  map.reserve(1000);
+  map.clear();
+  EXPECT_TRUE(map.empty());
+}
+
+TEST(ConcurrentFlatHashMap, TryEmplaceL) {
+  concurrent_flat_hash_map<std::string, int> counts;
+  auto increment = [](std::pair<const std::string, int>& v) { ++v.second; };
+  EXPECT_TRUE(counts.try_emplace_l("a", increment, 1));
+  EXPECT_FALSE(counts.try_emplace_l("a", increment, 1));
+  EXPECT_TRUE(counts.try_emplace_l("b", increment, 1));
+  EXPECT_THAT(Elements(counts),
+              UnorderedElementsAre(Pair("a", 2), Pair("b", 1)));
+}
+
+TEST(ConcurrentFlatHashMap, LazyEmplaceL) {
+  using Map = concurrent_flat_hash_map<std::string, int>;
+  Map map;
+  int constructed = 0;
+  auto emplace = [&](const Map::constructor& ctor) {
+    ++constructed;
+    ctor("a", 1);
+  };
+  auto exists = [](std::pair<const std::string, int>& v) { v.second = 2; };
+  EXPECT_TRUE(map.lazy_emplace_l("a", exists, emplace));
+  EXPECT_FALSE(map.lazy_emplace_l("a", exists, emplace));
+  EXPECT_EQ(1, constructed);
+  EXPECT_THAT(Elements(map), UnorderedElementsAre(Pair("a", 2)));
+}
+
+TEST(ConcurrentFlatHashMap, HeterogeneousLookup) {
+  concurrent_flat_hash_map<std::string, int> map;
+  map.try_emplace("abc", 1);
+  // The default hash and equality of std::string are transparent.
+  EXPECT_TRUE(map.contains(basic::string_view("abc")));
+  EXPECT_TRUE(map.if_contains("abc", [](const std::pair<const std::string,
+                                                        int>&) {}));
+  EXPECT_EQ(1u, map.erase(basic::string_view("abc")));
+}
+
+// Counts the keys it hashes.
+struct CountingHash {
+  size_t operator()(int key) const {
+    ++*num_calls;
+    return container_internal::hash_default_hash<int>()(key);
+  }
+  int* num_calls;
+};
+
+TEST(ConcurrentFlatHashMap, HashesKeyOnce) {
+  int num_calls = 0;
+  concurrent_flat_hash_map<int, int, CountingHash> map(
+      CountingHash{&num_calls});
+  // Growing the maps of the shards would rehash their elements.
+  map.reserve(1000);
+  auto exists = [](std::pair<const int, int>&) {};
+
+  EXPECT_TRUE(map.insert({1, 1}));
+  EXPECT_EQ(1, num_calls);
+  EXPECT_FALSE(map.insert({1, 1}));
+  EXPECT_EQ(2, num_calls);
+  EXPECT_TRUE(map.try_emplace(2, 2));
+  EXPECT_EQ(3, num_calls);
+  EXPECT_FALSE(map.try_emplace_l(2, exists, 2));
+  EXPECT_EQ(4, num_calls);
+  EXPECT_TRUE(map.lazy_emplace_l(3, exists, [](
+      const decltype(map)::constructor& ctor) { ctor(3, 3); }));
+  EXPECT_EQ(5, num_calls);
+  EXPECT_FALSE(map.insert_or_assign(3, 4));
+  EXPECT_EQ(6, num_calls);
+  EXPECT_TRUE(map.contains(3));
+  EXPECT_EQ(7, num_calls);
+  EXPECT_EQ(1u, map.erase(3));
+  EXPECT_EQ(8, num_calls);
+  EXPECT_EQ(1u, map.erase_if(2, [](std::pair<const int, int>&) {
+    return true;
+  }));
+  EXPECT_EQ(9, num_calls);
+  EXPECT_THAT(Elements(map), UnorderedElementsAre(Pair(1, 1)));
+}
+
+TEST(ConcurrentFlatHashMap, SpreadsKeysAcrossShards) {
+  using Map = concurrent_flat_hash_map<int, int>;
+  Map map;
+  std::vector<int> per_shard(Map::kNumShards);
+  for (int i = 0; i < 10000; ++i) {
+    map.try_emplace(i, i);
+    ++per_shard[map.hash_function()(i) >>
+                (std::numeric_limits<size_t>::digits - 4)];
+  }
+  EXPECT_EQ(10000u, map.size());
+  for (int count : per_shard) EXPECT_GT(count, 10000 / 16 / 2);
+
+  // A single shard is a plain flat_hash_map behind one lock.
+  concurrent_flat_hash_map<int, int, Map::hasher, Map::key_equal,
+                           Map::allocator_type, 0>
+      single;
+  EXPECT_EQ(1u, decltype(single)::kNumShards);
+  single.try_emplace(1, 1);
+  EXPECT_TRUE(single.contains(1));
+}
+
+TEST(ConcurrentFlatHashMap, ConcurrentUpdates) {
+  constexpr int kThreads = 8;
+  constexpr int kKeys = 1000;
+  constexpr int kIncrements = 20000;
+  concurrent_flat_hash_map<int, int> counts;
+  std::atomic<bool> done(false);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&counts, t] {
+      for (int i = 0; i < kIncrements; ++i) {
+        counts.try_emplace_l(
+            (i * 7 + t) % kKeys,
+            [](std::pair<const int, int>& v) { ++v.second; }, 1);
+      }
+    });
+  }
+  // Readers run at the same time, and only ever see positive counts.
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 2; ++t) {
+    readers.emplace_back([&counts, &done] {
+      while (!done.load(std::memory_order_relaxed)) {
+        for (int key = 0; key < kKeys; ++key) {
+          counts.if_contains(key, [](const std::pair<const int, int>& v) {
+            EXPECT_GT(v.second, 0);
+          });
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  done = true;
+  for (std::thread& thread : readers) thread.join();
+
+  EXPECT_EQ(static_cast<size_t>(kKeys), counts.size());
+  int total = 0;
+  counts.for_each([&](const std::pair<const int, int>& v) {
+    total += v.second;
+  });
+  EXPECT_EQ(kThreads * kIncrements, total);
+}
+
+TEST(ConcurrentFlatHashMap, ConcurrentInsertAndErase) {
+  constexpr int kThreads = 4;
+  constexpr int kKeysPerThread = 10000;
+  concurrent_flat_hash_map<std::string, std::unique_ptr<int>> map;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&map, t] {
+      for (int i = 0; i < kKeysPerThread; ++i) {
+        EXPECT_TRUE(map.try_emplace(StrCat(t, "/", i), new int(i)));
+      }
+      // Erase the odd keys of this thread.
+      for (int i = 1; i < kKeysPerThread; i += 2) {
+        EXPECT_EQ(1u, map.erase(StrCat(t, "/", i)));
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+
+  EXPECT_EQ(static_cast<size_t>(kThreads * kKeysPerThread / 2), map.size());
+  map.for_each([](const std::pair<const std::string, std::unique_ptr<int>>& v) {
+    EXPECT_EQ(0, *v.second % 2);
+  });
+}
+
+}  // namespace
+}  // namespace basic
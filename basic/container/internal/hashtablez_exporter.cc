@@ -0,0 +1,174 @@
+// Copyright 2019 The Basic Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "basic/container/internal/hashtablez_exporter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "basic/debugging/symbolize.h"
+#include "basic/flags/flag.h"
+#include "basic/strings/str_cat.h"
+#include "basic/strings/string_view.h"
+
+// The defaults match those of hashtablez_sampler.cc, so that linking this
+// library does not change the behavior of a program until the flags are set.
+ABSL_FLAG(bool, hashtablez_enabled, false,
+          "Enables the sampling of Swiss tables.")
+    .OnUpdate([] {
+      basic::container_internal::SetHashtablezEnabled(
+          basic::GetFlag(FLAGS_hashtablez_enabled));
+    });
+
+ABSL_FLAG(int32_t, hashtablez_sample_rate, 1 << 10,
+          "Samples, on average, one Swiss table in this many.")
+    .OnUpdate([] {
+      basic::container_internal::SetHashtablezSampleParameter(
+          basic::GetFlag(FLAGS_hashtablez_sample_rate));
+    });
+
+ABSL_FLAG(int32_t, hashtablez_max_samples, 1 << 20,
+          "Soft cap on the number of live Swiss table samples.")
+    .OnUpdate([] {
+      basic::container_internal::SetHashtablezMaxSamples(
+          basic::GetFlag(FLAGS_hashtablez_max_samples));
+    });
+
+namespace basic {
+namespace container_internal {
+constexpr int HashtablezCallSite::kProbeLengthBuckets;
+
+namespace {
+
+int ProbeLengthBucket(size_t probe_length) {
+  int bucket = 0;
+  while (probe_length != 0 &&
+         bucket < HashtablezCallSite::kProbeLengthBuckets - 1) {
+    probe_length >>= 1;
+    ++bucket;
+  }
+  return bucket;
+}
+
+void AppendJsonString(basic::string_view s, std::string* out) {
+  out->push_back('"');
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      out->push_back('\\');
+      out->push_back(c);
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      basic::StrAppend(out, "\\u",
+                       basic::Hex(static_cast<unsigned char>(c),
+                                  basic::kZeroPad4));
+    } else {
+      out->push_back(c);
+    }
+  }
+  out->push_back('"');
+}
+
+void AppendJsonFrame(void* pc, std::string* out) {
+  basic::StrAppend(out, "{\"pc\": \"0x",
+                   basic::Hex(reinterpret_cast<uintptr_t>(pc)), "\"");
+  char symbol[1024];
+  if (basic::Symbolize(pc, symbol, sizeof(symbol))) {
+    out->append(", \"function\": ");
+    AppendJsonString(symbol, out);
+  }
+  out->push_back('}');
+}
+
+}  // namespace
+
+HashtablezProfile CollectHashtablezProfile(HashtablezSampler* sampler) {
+  std::map<std::vector<void*>, HashtablezCallSite> call_sites;
+  HashtablezProfile profile;
+  profile.dropped_samples = sampler->Iterate([&](const HashtablezInfo& info) {
+    std::vector<void*> stack(info.stack, info.stack + info.depth);
+    HashtablezCallSite& site = call_sites[stack];
+    if (site.num_tables == 0) site.stack = std::move(stack);
+    const size_t max_probe_length =
+        info.max_probe_length.load(std::memory_order_relaxed);
+    ++site.num_tables;
+    site.capacity += info.capacity.load(std::memory_order_relaxed);
+    site.size += info.size.load(std::memory_order_relaxed);
+    site.num_erases += info.num_erases.load(std::memory_order_relaxed);
+    site.num_rehashes += info.num_rehashes.load(std::memory_order_relaxed);
+    site.total_probe_length +=
+        info.total_probe_length.load(std::memory_order_relaxed);
+    site.max_probe_length = std::max(site.max_probe_length, max_probe_length);
+    site.inline_element_size =
+        std::max(site.inline_element_size, info.inline_element_size);
+    site.hashes_bitwise_and &=
+        info.hashes_bitwise_and.load(std::memory_order_relaxed);
+    site.hashes_bitwise_or |=
+        info.hashes_bitwise_or.load(std::memory_order_relaxed);
+    ++site.probe_length_histogram[ProbeLengthBucket(max_probe_length)];
+  });
+
+  profile.call_sites.reserve(call_sites.size());
+  for (auto& site : call_sites) {
+    profile.call_sites.push_back(std::move(site.second));
+  }
+  std::stable_sort(
+      profile.call_sites.begin(), profile.call_sites.end(),
+      [](const HashtablezCallSite& a, const HashtablezCallSite& b) {
+        return a.capacity * a.inline_element_size >
+               b.capacity * b.inline_element_size;
+      });
+  return profile;
+}
+
+std::string HashtablezProfileToJson(const HashtablezProfile& profile) {
+  std::string out =
+      basic::StrCat("{\"dropped_samples\": ", profile.dropped_samples,
+                    ", \"call_sites\": [");
+  for (size_t i = 0; i != profile.call_sites.size(); ++i) {
+    const HashtablezCallSite& site = profile.call_sites[i];
+    if (i != 0) out.append(", ");
+    basic::StrAppend(
+        &out, "{\"num_tables\": ", site.num_tables,
+        ", \"capacity\": ", site.capacity, ", \"size\": ", site.size,
+        ", \"num_erases\": ", site.num_erases,
+        ", \"num_rehashes\": ", site.num_rehashes,
+        ", \"total_probe_length\": ", site.total_probe_length,
+        ", \"max_probe_length\": ", site.max_probe_length,
+        ", \"inline_element_size\": ", site.inline_element_size);
+    basic::StrAppend(&out, ", \"hashes_bitwise_and\": \"0x",
+                     basic::Hex(site.hashes_bitwise_and),
+                     "\", \"hashes_bitwise_or\": \"0x",
+                     basic::Hex(site.hashes_bitwise_or),
+                     "\", \"probe_length_histogram\": [");
+    for (int b = 0; b != HashtablezCallSite::kProbeLengthBuckets; ++b) {
+      if (b != 0) out.append(", ");
+      basic::StrAppend(&out, site.probe_length_histogram[b]);
+    }
+    out.append("], \"stack\": [");
+    for (size_t f = 0; f != site.stack.size(); ++f) {
+      if (f != 0) out.append(", ");
+      AppendJsonFrame(site.stack[f], &out);
+    }
+    out.append("]}");
+  }
+  out.append("]}");
+  return out;
+}
+
+}  // namespace container_internal
+}  // namespace basic
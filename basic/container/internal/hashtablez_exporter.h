@@ -0,0 +1,107 @@
+// Copyright 2019 The Basic Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// -----------------------------------------------------------------------------
+// File: hashtablez_exporter.h
+// -----------------------------------------------------------------------------
+//
+// This header file defines an exporter for the samples of
+// `HashtablezSampler`: it aggregates the live samples by the call stack that
+// allocated the table, so that the badly-hashed or oversized tables of a
+// program can be found, and renders these aggregates as JSON.
+//
+// It also defines the flags controlling the global sampler:
+//
+//   --hashtablez_enabled       Enables sampling (default: false).
+//   --hashtablez_sample_rate   Samples 1 in this many tables (default: 1024).
+//   --hashtablez_max_samples   Soft cap on live samples (default: 1048576).
+//
+// Example:
+//
+//   basic::container_internal::HashtablezProfile profile =
+//       basic::container_internal::CollectHashtablezProfile(
+//           &basic::container_internal::HashtablezSampler::Global());
+//   WriteFile("/tmp/hashtablez.json",
+//             basic::container_internal::HashtablezProfileToJson(profile));
+//
+// This utility is internal-only. Use at your own risk.
+
+#ifndef ABSL_CONTAINER_INTERNAL_HASHTABLEZ_EXPORTER_H_
+#define ABSL_CONTAINER_INTERNAL_HASHTABLEZ_EXPORTER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "basic/container/internal/hashtablez_sampler.h"
+#include "basic/flags/declare.h"
+
+ABSL_DECLARE_FLAG(bool, hashtablez_enabled);
+ABSL_DECLARE_FLAG(int32_t, hashtablez_sample_rate);
+ABSL_DECLARE_FLAG(int32_t, hashtablez_max_samples);
+
+namespace basic {
+namespace container_internal {
+
+// Aggregated statistics of the sampled tables allocated from one call stack.
+// Unless noted otherwise, fields are sums over the tables.
+struct HashtablezCallSite {
+  // Number of buckets of `probe_length_histogram`.
+  static constexpr int kProbeLengthBuckets = 8;
+
+  // The call stack that allocated the tables, innermost frame first.
+  std::vector<void*> stack;
+  // Number of live sampled tables.
+  size_t num_tables = 0;
+  size_t capacity = 0;
+  size_t size = 0;
+  // Erases since the last rehash: an upper bound on the tombstones.
+  size_t num_erases = 0;
+  size_t num_rehashes = 0;
+  // Sum of the probe lengths of the elements, in groups.
+  size_t total_probe_length = 0;
+  // The longest probe of any table, in groups.
+  size_t max_probe_length = 0;
+  // The size of the slots of the tables.
+  size_t inline_element_size = 0;
+  // Bitwise and/or of the hashes inserted in any of the tables. Bits set in
+  // the former or unset in the latter are constant: the hash is likely bad.
+  size_t hashes_bitwise_and = ~size_t{};
+  size_t hashes_bitwise_or = 0;
+  // Number of tables by their longest probe, in groups: bucket 0 counts the
+  // tables whose longest probe is 0, bucket `i` those in [2^(i-1), 2^i), and
+  // the last bucket is unbounded.
+  size_t probe_length_histogram[kProbeLengthBuckets] = {};
+};
+
+// A snapshot of the samples of a `HashtablezSampler`.
+struct HashtablezProfile {
+  // Samples dropped because of `--hashtablez_max_samples`.
+  int64_t dropped_samples = 0;
+  // Sorted by decreasing memory footprint, `capacity * inline_element_size`.
+  std::vector<HashtablezCallSite> call_sites;
+};
+
+// Aggregates the live samples of `sampler` by call stack.
+HashtablezProfile CollectHashtablezProfile(HashtablezSampler* sampler);
+
+// Renders `profile` as a JSON object. Stack frames are symbolized when
+// possible; see `basic::InitializeSymbolizer()`.
+std::string HashtablezProfileToJson(const HashtablezProfile& profile);
+
+}  // namespace container_internal
+}  // namespace basic
+
+#endif  // ABSL_CONTAINER_INTERNAL_HASHTABLEZ_EXPORTER_H_
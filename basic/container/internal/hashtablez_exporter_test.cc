@@ -0,0 +1,162 @@
+// Copyright 2019 The Basic Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "basic/container/internal/hashtablez_exporter.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "basic/flags/flag.h"
+#include "basic/synchronization/mutex.h"
+
+namespace basic {
+namespace container_internal {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+
+// Registers a sample created by the call site `pc`. The stack is set here
+// rather than captured by `Register()`, which finds no frame in optimized
+// builds without frame pointers.
+HashtablezInfo* Register(HashtablezSampler* s, uintptr_t pc, size_t capacity,
+                         size_t max_probe_length, size_t hash,
+                         size_t inline_element_size) {
+  HashtablezInfo* info = s->Register();
+  EXPECT_NE(info, nullptr);
+  info->capacity.store(capacity);
+  info->size.store(capacity / 2);
+  info->num_erases.store(1);
+  info->num_rehashes.store(2);
+  info->max_probe_length.store(max_probe_length);
+  info->total_probe_length.store(max_probe_length);
+  info->hashes_bitwise_and.store(hash);
+  info->hashes_bitwise_or.store(hash);
+  basic::MutexLock l(&info->init_mu);
+  info->inline_element_size = inline_element_size;
+  info->depth = 1;
+  info->stack[0] = reinterpret_cast<void*>(pc);
+  return info;
+}
+
+// Two distinct call sites.
+HashtablezInfo* RegisterSmall(HashtablezSampler* s, size_t max_probe_length,
+                              size_t hash) {
+  return Register(s, 0x1000, 15, max_probe_length, hash, 8);
+}
+HashtablezInfo* RegisterLarge(HashtablezSampler* s) {
+  return Register(s, 0x2000, 1023, 0, 0x10, 32);
+}
+
+// Restores the sampling flags on destruction.
+class ScopedHashtablezFlags {
+ public:
+  ScopedHashtablezFlags()
+      : enabled_(basic::GetFlag(FLAGS_hashtablez_enabled)),
+        sample_rate_(basic::GetFlag(FLAGS_hashtablez_sample_rate)) {}
+  ~ScopedHashtablezFlags() {
+    basic::SetFlag(&FLAGS_hashtablez_sample_rate, sample_rate_);
+    basic::SetFlag(&FLAGS_hashtablez_enabled, enabled_);
+  }
+
+ private:
+  const bool enabled_;
+  const int32_t sample_rate_;
+};
+
+TEST(HashtablezExporterTest, AggregatesByCallSite) {
+  HashtablezSampler sampler;
+  std::vector<HashtablezInfo*> small;
+  const size_t probe_lengths[] = {0, 2, 3};
+  const size_t hashes[] = {0x13, 0x31, 0x11};
+  for (int i = 0; i < 3; ++i) {
+    small.push_back(RegisterSmall(&sampler, probe_lengths[i], hashes[i]));
+  }
+  HashtablezInfo* large = RegisterLarge(&sampler);
+
+  HashtablezProfile profile = CollectHashtablezProfile(&sampler);
+  EXPECT_EQ(profile.dropped_samples, 0);
+  ASSERT_EQ(profile.call_sites.size(), 2);
+
+  // The largest footprint comes first.
+  const HashtablezCallSite& l = profile.call_sites[0];
+  EXPECT_EQ(l.num_tables, 1);
+  EXPECT_EQ(l.capacity, 1023);
+  EXPECT_EQ(l.inline_element_size, 32);
+  EXPECT_FALSE(l.stack.empty());
+
+  const HashtablezCallSite& s = profile.call_sites[1];
+  EXPECT_EQ(s.num_tables, 3);
+  EXPECT_EQ(s.capacity, 3 * 15);
+  EXPECT_EQ(s.size, 3 * 7);
+  EXPECT_EQ(s.num_erases, 3);
+  EXPECT_EQ(s.num_rehashes, 3 * 2);
+  EXPECT_EQ(s.total_probe_length, 5);
+  EXPECT_EQ(s.max_probe_length, 3);
+  EXPECT_EQ(s.inline_element_size, 8);
+  EXPECT_EQ(s.hashes_bitwise_and, 0x11);
+  EXPECT_EQ(s.hashes_bitwise_or, 0x33);
+  EXPECT_THAT(s.probe_length_histogram, ElementsAre(1, 0, 2, 0, 0, 0, 0, 0));
+  EXPECT_NE(s.stack, l.stack);
+
+  // Unregistered samples are not reported.
+  for (HashtablezInfo* info : small) sampler.Unregister(info);
+  profile = CollectHashtablezProfile(&sampler);
+  ASSERT_EQ(profile.call_sites.size(), 1);
+  EXPECT_EQ(profile.call_sites[0].capacity, 1023);
+  sampler.Unregister(large);
+}
+
+TEST(HashtablezExporterTest, Json) {
+  HashtablezSampler sampler;
+  EXPECT_EQ(HashtablezProfileToJson(CollectHashtablezProfile(&sampler)),
+            "{\"dropped_samples\": 0, \"call_sites\": []}");
+
+  HashtablezInfo* info = RegisterSmall(&sampler, 200, 0xff);
+  const std::string json =
+      HashtablezProfileToJson(CollectHashtablezProfile(&sampler));
+  EXPECT_THAT(json, HasSubstr("\"num_tables\": 1, \"capacity\": 15, "
+                              "\"size\": 7, \"num_erases\": 1, "
+                              "\"num_rehashes\": 2, "
+                              "\"total_probe_length\": 200, "
+                              "\"max_probe_length\": 200, "
+                              "\"inline_element_size\": 8"));
+  EXPECT_THAT(json, HasSubstr("\"hashes_bitwise_and\": \"0xff\", "
+                              "\"hashes_bitwise_or\": \"0xff\""));
+  EXPECT_THAT(json, HasSubstr("\"probe_length_histogram\": "
+                              "[0, 0, 0, 0, 0, 0, 0, 1]"));
+  EXPECT_THAT(json, HasSubstr("\"stack\": [{\"pc\": \"0x1000\""));
+  sampler.Unregister(info);
+}
+
+TEST(HashtablezExporterTest, Flags) {
+  ScopedHashtablezFlags scoped_flags;
+  basic::SetFlag(&FLAGS_hashtablez_sample_rate, 1);
+  basic::SetFlag(&FLAGS_hashtablez_enabled, false);
+  int64_t next_sample = 0;
+  EXPECT_EQ(SampleSlow(&next_sample, 8), nullptr);
+
+  basic::SetFlag(&FLAGS_hashtablez_enabled, true);
+  HashtablezInfo* sample = SampleSlow(&next_sample, 8);
+  EXPECT_NE(sample, nullptr);
+  UnsampleSlow(sample);
+}
+
+}  // namespace
+}  // namespace container_internal
+}  // namespace basic
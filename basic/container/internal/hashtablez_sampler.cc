@@ -132,6 +132,7 @@ void HashtablezInfo::PrepareForSampling() {
   total_probe_length.store(0, std::memory_order_relaxed);
   hashes_bitwise_or.store(0, std::memory_order_relaxed);
   hashes_bitwise_and.store(~size_t{}, std::memory_order_relaxed);
+  num_rehashes.store(0, std::memory_order_relaxed);
 
   create_time = basic::Now();
   // The inliner makes hardcoded skip_count difficult (especially when combined
@@ -139,6 +140,7 @@ void HashtablezInfo::PrepareForSampling() {
   // instead.
   depth = basic::GetStackTrace(stack, HashtablezInfo::kMaxStackDepth,
                               /* skip_count= */ 0);
+  inline_element_size = 0;
   dead = nullptr;
 }
 
@@ -228,10 +230,23 @@ int64_t HashtablezSampler::Iterate(
   return dropped_samples_.load(std::memory_order_relaxed);
 }
 
-HashtablezInfo* SampleSlow(int64_t* next_sample) {
+namespace {
+
+HashtablezInfo* RegisterGlobal(size_t inline_element_size) {
+  HashtablezInfo* info = HashtablezSampler::Global().Register();
+  if (info != nullptr) {
+    basic::MutexLock l(&info->init_mu);
+    info->inline_element_size = inline_element_size;
+  }
+  return info;
+}
+
+}  // namespace
+
+HashtablezInfo* SampleSlow(int64_t* next_sample, size_t inline_element_size) {
   if (kAbslContainerInternalSampleEverything) {
     *next_sample = 1;
-    return HashtablezSampler::Global().Register();
+    return RegisterGlobal(inline_element_size);
   }
 
   bool first = *next_sample < 0;
@@ -247,10 +262,10 @@ HashtablezInfo* SampleSlow(int64_t* next_sample) {
   // that case.
   if (first) {
     if (ABSL_PREDICT_TRUE(--*next_sample > 0)) return nullptr;
-    return SampleSlow(next_sample);
+    return SampleSlow(next_sample, inline_element_size);
   }
 
-  return HashtablezSampler::Global().Register();
+  return RegisterGlobal(inline_element_size);
 }
 
 #if ABSL_PER_THREAD_TLS == 1
@@ -263,10 +278,12 @@ void UnsampleSlow(HashtablezInfo* info) {
 
 void RecordInsertSlow(HashtablezInfo* info, size_t hash,
                       size_t distance_from_desired) {
-  // SwissTables probe in groups of 16, so scale this to count items probes and
-  // not offset from desired.
+  // SwissTables probe in groups of 8, 16 or 32, so scale this to count items
+  // probes and not offset from desired.
   size_t probe_length = distance_from_desired;
-#if SWISSTABLE_HAVE_SSE2
+#if SWISSTABLE_HAVE_AVX2
+  probe_length /= 32;
+#elif SWISSTABLE_HAVE_SSE2
   probe_length /= 16;
 #else
   probe_length /= 8;
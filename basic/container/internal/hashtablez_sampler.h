@@ -25,7 +25,8 @@
 // `Record*` methods store information into samples.
 // `Sample()` and `Unsample()` make use of a single global sampler with
 // properties controlled by the flags hashtablez_enabled,
-// hashtablez_sample_rate, and hashtablez_max_samples.
+// hashtablez_sample_rate, and hashtablez_max_samples, which are defined by
+// hashtablez_exporter.h.
 //
 // WARNING
 //
@@ -76,6 +77,7 @@ struct HashtablezInfo {
   std::atomic<size_t> total_probe_length;
   std::atomic<size_t> hashes_bitwise_or;
   std::atomic<size_t> hashes_bitwise_and;
+  std::atomic<size_t> num_rehashes;
 
   // `HashtablezSampler` maintains intrusive linked lists for all samples.  See
   // comments on `HashtablezSampler::all_` for details on these.  `init_mu`
@@ -94,16 +96,20 @@ struct HashtablezInfo {
   basic::Time create_time;
   int32_t depth;
   void* stack[kMaxStackDepth];
+  size_t inline_element_size;  // sizeof(slot_type) of the sampled table
 };
 
 inline void RecordRehashSlow(HashtablezInfo* info, size_t total_probe_length) {
-#if SWISSTABLE_HAVE_SSE2
+#if SWISSTABLE_HAVE_AVX2
+  total_probe_length /= 32;
+#elif SWISSTABLE_HAVE_SSE2
   total_probe_length /= 16;
 #else
   total_probe_length /= 8;
 #endif
   info->total_probe_length.store(total_probe_length, std::memory_order_relaxed);
   info->num_erases.store(0, std::memory_order_relaxed);
+  info->num_rehashes.fetch_add(1, std::memory_order_relaxed);
 }
 
 inline void RecordStorageChangedSlow(HashtablezInfo* info, size_t size,
@@ -112,7 +118,8 @@ inline void RecordStorageChangedSlow(HashtablezInfo* info, size_t size,
   info->capacity.store(capacity, std::memory_order_relaxed);
   if (size == 0) {
     // This is a clear, reset the total/num_erases too.
-    RecordRehashSlow(info, 0);
+    info->total_probe_length.store(0, std::memory_order_relaxed);
+    info->num_erases.store(0, std::memory_order_relaxed);
   }
 }
 
@@ -124,7 +131,7 @@ inline void RecordEraseSlow(HashtablezInfo* info) {
   info->num_erases.fetch_add(1, std::memory_order_relaxed);
 }
 
-HashtablezInfo* SampleSlow(int64_t* next_sample);
+HashtablezInfo* SampleSlow(int64_t* next_sample, size_t inline_element_size);
 void UnsampleSlow(HashtablezInfo* info);
 
 class HashtablezInfoHandle {
@@ -184,8 +191,9 @@ extern ABSL_PER_THREAD_TLS_KEYWORD int64_t global_next_sample;
 #endif  // ABSL_PER_THREAD_TLS
 
 // Returns an RAII sampling handle that manages registration and unregistation
-// with the global sampler.
-inline HashtablezInfoHandle Sample() {
+// with the global sampler. `inline_element_size` is the size of the slots of
+// the table.
+inline HashtablezInfoHandle Sample(size_t inline_element_size) {
 #if ABSL_PER_THREAD_TLS == 0
   static auto* mu = new basic::Mutex;
   static int64_t global_next_sample = 0;
@@ -195,7 +203,8 @@ inline HashtablezInfoHandle Sample() {
   if (ABSL_PREDICT_TRUE(--global_next_sample > 0)) {
     return HashtablezInfoHandle(nullptr);
   }
-  return HashtablezInfoHandle(SampleSlow(&global_next_sample));
+  return HashtablezInfoHandle(
+      SampleSlow(&global_next_sample, inline_element_size));
 }
 
 // Holds samples and their associated stack traces with a soft limit of
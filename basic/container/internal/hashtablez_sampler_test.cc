@@ -29,7 +29,9 @@
 #include "basic/time/clock.h"
 #include "basic/time/time.h"
 
-#if SWISSTABLE_HAVE_SSE2
+#if SWISSTABLE_HAVE_AVX2
+constexpr int kProbeLength = 32;
+#elif SWISSTABLE_HAVE_SSE2
 constexpr int kProbeLength = 16;
 #else
 constexpr int kProbeLength = 8;
@@ -79,6 +81,8 @@ TEST(HashtablezInfoTest, PrepareForSampling) {
   EXPECT_EQ(info.total_probe_length.load(), 0);
   EXPECT_EQ(info.hashes_bitwise_or.load(), 0);
   EXPECT_EQ(info.hashes_bitwise_and.load(), ~size_t{});
+  EXPECT_EQ(info.num_rehashes.load(), 0);
+  EXPECT_EQ(info.inline_element_size, 0);
   EXPECT_GE(info.create_time, test_start);
 
   info.capacity.store(1, std::memory_order_relaxed);
@@ -88,6 +92,8 @@ TEST(HashtablezInfoTest, PrepareForSampling) {
   info.total_probe_length.store(1, std::memory_order_relaxed);
   info.hashes_bitwise_or.store(1, std::memory_order_relaxed);
   info.hashes_bitwise_and.store(1, std::memory_order_relaxed);
+  info.num_rehashes.store(1, std::memory_order_relaxed);
+  info.inline_element_size = 1;
   info.create_time = test_start - basic::Hours(20);
 
   info.PrepareForSampling();
@@ -98,6 +104,8 @@ TEST(HashtablezInfoTest, PrepareForSampling) {
   EXPECT_EQ(info.total_probe_length.load(), 0);
   EXPECT_EQ(info.hashes_bitwise_or.load(), 0);
   EXPECT_EQ(info.hashes_bitwise_and.load(), ~size_t{});
+  EXPECT_EQ(info.num_rehashes.load(), 0);
+  EXPECT_EQ(info.inline_element_size, 0);
   EXPECT_GE(info.create_time, test_start);
 }
 
@@ -111,6 +119,10 @@ TEST(HashtablezInfoTest, RecordStorageChanged) {
   RecordStorageChangedSlow(&info, 20, 20);
   EXPECT_EQ(info.size.load(), 20);
   EXPECT_EQ(info.capacity.load(), 20);
+  // Clearing the table is not a rehash.
+  RecordStorageChangedSlow(&info, 0, 20);
+  EXPECT_EQ(info.size.load(), 0);
+  EXPECT_EQ(info.num_rehashes.load(), 0);
 }
 
 TEST(HashtablezInfoTest, RecordInsert) {
@@ -166,6 +178,7 @@ TEST(HashtablezInfoTest, RecordRehash) {
   EXPECT_EQ(info.size.load(), 2);
   EXPECT_EQ(info.total_probe_length.load(), 3);
   EXPECT_EQ(info.num_erases.load(), 0);
+  EXPECT_EQ(info.num_rehashes.load(), 1);
 }
 
 TEST(HashtablezSamplerTest, SmallSampleParameter) {
@@ -174,20 +187,34 @@ TEST(HashtablezSamplerTest, SmallSampleParameter) {
 
   for (int i = 0; i < 1000; ++i) {
     int64_t next_sample = 0;
-    HashtablezInfo* sample = SampleSlow(&next_sample);
+    HashtablezInfo* sample = SampleSlow(&next_sample, 8);
     EXPECT_GT(next_sample, 0);
     EXPECT_NE(sample, nullptr);
     UnsampleSlow(sample);
   }
 }
 
+TEST(HashtablezSamplerTest, RecordsInlineElementSize) {
+  SetHashtablezEnabled(true);
+  SetHashtablezSampleParameter(1);
+
+  int64_t next_sample = 0;
+  HashtablezInfo* sample = SampleSlow(&next_sample, 24);
+  ASSERT_NE(sample, nullptr);
+  {
+    basic::MutexLock l(&sample->init_mu);
+    EXPECT_EQ(sample->inline_element_size, 24);
+  }
+  UnsampleSlow(sample);
+}
+
 TEST(HashtablezSamplerTest, LargeSampleParameter) {
   SetHashtablezEnabled(true);
   SetHashtablezSampleParameter(std::numeric_limits<int32_t>::max());
 
   for (int i = 0; i < 1000; ++i) {
     int64_t next_sample = 0;
-    HashtablezInfo* sample = SampleSlow(&next_sample);
+    HashtablezInfo* sample = SampleSlow(&next_sample, 8);
     EXPECT_GT(next_sample, 0);
     EXPECT_NE(sample, nullptr);
     UnsampleSlow(sample);
@@ -201,7 +228,7 @@ TEST(HashtablezSamplerTest, Sample) {
   int64_t total = 0;
   double sample_rate = 0.0;
   for (int i = 0; i < 1000000; ++i) {
-    HashtablezInfoHandle h = Sample();
+    HashtablezInfoHandle h = Sample(8);
     ++total;
     if (HashtablezInfoHandlePeer::IsSampled(h)) {
       ++num_sampled;
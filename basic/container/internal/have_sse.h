@@ -34,10 +34,25 @@
 #endif
 #endif
 
+// AVX2 widens the Swiss table groups from 16 to 32 control bytes. Since this
+// changes the probing of every table, all translation units sharing tables
+// must agree on it; define SWISSTABLE_HAVE_AVX2 to 0 to opt out.
+#ifndef SWISSTABLE_HAVE_AVX2
+#ifdef __AVX2__
+#define SWISSTABLE_HAVE_AVX2 1
+#else
+#define SWISSTABLE_HAVE_AVX2 0
+#endif
+#endif
+
 #if SWISSTABLE_HAVE_SSSE3 && !SWISSTABLE_HAVE_SSE2
 #error "Bad configuration!"
 #endif
 
+#if SWISSTABLE_HAVE_AVX2 && !SWISSTABLE_HAVE_SSSE3
+#error "Bad configuration!"
+#endif
+
 #if SWISSTABLE_HAVE_SSE2
 #include <emmintrin.h>
 #endif
@@ -46,4 +61,8 @@
 #include <tmmintrin.h>
 #endif
 
+#if SWISSTABLE_HAVE_AVX2
+#include <immintrin.h>
+#endif
+
 #endif  // ABSL_CONTAINER_INTERNAL_HAVE_SSE_H_
@@ -115,6 +115,7 @@
 #include "basic/container/internal/layout.h"
 #include "basic/memory/memory.h"
 #include "basic/meta/type_traits.h"
+#include "basic/types/span.h"
 #include "basic/utility/utility.h"
 
 namespace basic {
@@ -278,10 +279,13 @@ static_assert(kDeleted == -2,
               "ConvertSpecialToEmptyAndFullToDeleted efficient");
 
 // A single block of empty control bytes for tables without any slots allocated.
-// This enables removing a branch in the hot path of find().
+// This enables removing a branch in the hot path of find(). It is as wide as
+// the widest group implementation below.
 inline ctrl_t* EmptyGroup() {
-  alignas(16) static constexpr ctrl_t empty_group[] = {
+  alignas(32) static constexpr ctrl_t empty_group[] = {
       kSentinel, kEmpty, kEmpty, kEmpty, kEmpty, kEmpty, kEmpty, kEmpty,
+      kEmpty,    kEmpty, kEmpty, kEmpty, kEmpty, kEmpty, kEmpty, kEmpty,
+      kEmpty,    kEmpty, kEmpty, kEmpty, kEmpty, kEmpty, kEmpty, kEmpty,
       kEmpty,    kEmpty, kEmpty, kEmpty, kEmpty, kEmpty, kEmpty, kEmpty};
   return const_cast<ctrl_t*>(empty_group);
 }
@@ -385,6 +389,73 @@ struct GroupSse2Impl {
 };
 #endif  // SWISSTABLE_HAVE_SSE2
 
+#if SWISSTABLE_HAVE_AVX2
+
+// Same workaround as _mm_cmpgt_epi8_fixed() above.
+inline __m256i _mm256_cmpgt_epi8_fixed(__m256i a, __m256i b) {
+#if defined(__GNUC__) && !defined(__clang__)
+  if (std::is_unsigned<char>::value) {
+    const __m256i mask = _mm256_set1_epi8(static_cast<char>(0x80));
+    const __m256i diff = _mm256_subs_epi8(b, a);
+    return _mm256_cmpeq_epi8(_mm256_and_si256(diff, mask), mask);
+  }
+#endif
+  return _mm256_cmpgt_epi8(a, b);
+}
+
+// Twice as wide as GroupSse2Impl, so that lookups in large tables need fewer
+// probes, and thus fewer cache misses, on average.
+struct GroupAvx2Impl {
+  static constexpr size_t kWidth = 32;  // the number of slots per group
+
+  explicit GroupAvx2Impl(const ctrl_t* pos) {
+    ctrl = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos));
+  }
+
+  // Returns a bitmask representing the positions of slots that match hash.
+  BitMask<uint32_t, kWidth> Match(h2_t hash) const {
+    auto match = _mm256_set1_epi8(hash);
+    return BitMask<uint32_t, kWidth>(static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(match, ctrl))));
+  }
+
+  // Returns a bitmask representing the positions of empty slots.
+  BitMask<uint32_t, kWidth> MatchEmpty() const {
+    // This only works because kEmpty is -128.
+    return BitMask<uint32_t, kWidth>(static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_sign_epi8(ctrl, ctrl))));
+  }
+
+  // Returns a bitmask representing the positions of empty or deleted slots.
+  BitMask<uint32_t, kWidth> MatchEmptyOrDeleted() const {
+    auto special = _mm256_set1_epi8(kSentinel);
+    return BitMask<uint32_t, kWidth>(static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpgt_epi8_fixed(special, ctrl))));
+  }
+
+  // Returns the number of trailing empty or deleted elements in the group.
+  uint32_t CountLeadingEmptyOrDeleted() const {
+    auto special = _mm256_set1_epi8(kSentinel);
+    // Widen before adding one, so that a group of only empty or deleted slots
+    // yields kWidth instead of overflowing to zero.
+    return TrailingZeros(uint64_t{static_cast<uint32_t>(_mm256_movemask_epi8(
+                             _mm256_cmpgt_epi8_fixed(special, ctrl)))} +
+                         1);
+  }
+
+  void ConvertSpecialToEmptyAndFullToDeleted(ctrl_t* dst) const {
+    auto msbs = _mm256_set1_epi8(static_cast<char>(-128));
+    auto x126 = _mm256_set1_epi8(126);
+    // The shuffle works within each 128-bit lane, which is fine since x126
+    // holds the same byte everywhere.
+    auto res = _mm256_or_si256(_mm256_shuffle_epi8(x126, ctrl), msbs);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), res);
+  }
+
+  __m256i ctrl;
+};
+#endif  // SWISSTABLE_HAVE_AVX2
+
 struct GroupPortableImpl {
   static constexpr size_t kWidth = 8;
 
@@ -437,7 +508,9 @@ struct GroupPortableImpl {
   uint64_t ctrl;
 };
 
-#if SWISSTABLE_HAVE_SSE2
+#if SWISSTABLE_HAVE_AVX2
+using Group = GroupAvx2Impl;
+#elif SWISSTABLE_HAVE_SSE2
 using Group = GroupSse2Impl;
 #else
 using Group = GroupPortableImpl;
@@ -1106,7 +1179,14 @@ class raw_hash_set {
 
   template <class K = key_type, class F>
   iterator lazy_emplace(const key_arg<K>& key, F&& f) {
-    auto res = find_or_prepare_insert(key);
+    return lazy_emplace(key, hash_ref()(key), std::forward<F>(f));
+  }
+
+  // Like `lazy_emplace(key, f)`, with the hash passed by the user. It must be
+  // equal to the hash of the key, as with `find(key, hash)`.
+  template <class K = key_type, class F>
+  iterator lazy_emplace(const key_arg<K>& key, size_t hash, F&& f) {
+    auto res = find_or_prepare_insert(key, hash);
     if (res.second) {
       slot_type* slot = slots_ + res.first;
       std::forward<F>(f)(constructor(&alloc_ref(), &slot));
@@ -1257,9 +1337,7 @@ class raw_hash_set {
   void prefetch(const key_arg<K>& key) const {
     (void)key;
 #if defined(__GNUC__)
-    auto seq = probe(hash_ref()(key));
-    __builtin_prefetch(static_cast<const void*>(ctrl_ + seq.offset()));
-    __builtin_prefetch(static_cast<const void*>(slots_ + seq.offset()));
+    prefetch_hash(hash_ref()(key));
 #endif  // __GNUC__
   }
 
@@ -1273,6 +1351,11 @@ class raw_hash_set {
   template <class K = key_type>
   iterator find(const key_arg<K>& key, size_t hash) {
     auto seq = probe(hash);
+#if defined(__GNUC__)
+    // The slots of the first group are needed as soon as one of its control
+    // bytes matches: start loading them while the group is being matched.
+    __builtin_prefetch(static_cast<const void*>(slots_ + seq.offset()));
+#endif  // __GNUC__
     while (true) {
       Group g{ctrl_ + seq.offset()};
       for (int i : g.Match(H2(hash))) {
@@ -1299,6 +1382,45 @@ class raw_hash_set {
     return find(key, hash_ref()(key));
   }
 
+  // Looks up several keys at once, setting `results[i]` to `find(keys[i])`.
+  // `results` must be as large as `keys`.
+  //
+  // The lookups are interleaved in small batches: the hashes of a batch are
+  // computed and its first groups prefetched before any key is probed, which
+  // overlaps the cache misses of lookups into tables much larger than the
+  // cache.
+  //
+  // Like all lookup functions, this supports heterogeneous keys. Their type is
+  // deduced from a `Span` of them, or can be spelled out for any container
+  // convertible to one:
+  //
+  //   flat_hash_map<std::string, int> m;
+  //   std::vector<basic::string_view> keys = ...;
+  //   m.find_many(basic::MakeConstSpan(keys), basic::MakeSpan(results));
+  //   m.find_many<basic::string_view>(keys, basic::MakeSpan(results));
+  //
+  // NOTE: This is a very low level operation and should not be used without
+  // specific benchmarks indicating its importance.
+  void find_many(basic::Span<const key_type> keys,
+                 basic::Span<iterator> results) {
+    find_many<key_type>(keys, results);
+  }
+  void find_many(basic::Span<const key_type> keys,
+                 basic::Span<const_iterator> results) const {
+    find_many<key_type>(keys, results);
+  }
+  template <class K>
+  void find_many(basic::Span<const K> keys, basic::Span<iterator> results) {
+    assert(keys.size() == results.size());
+    find_many_impl<K>(keys, results.begin());
+  }
+  template <class K>
+  void find_many(basic::Span<const K> keys,
+                 basic::Span<const_iterator> results) const {
+    assert(keys.size() == results.size());
+    const_cast<raw_hash_set*>(this)->find_many_impl<K>(keys, results.begin());
+  }
+
   template <class K = key_type>
   bool contains(const key_arg<K>& key) const {
     return find(key) != end();
@@ -1449,7 +1571,7 @@ class raw_hash_set {
     // bound more carefully.
     if (std::is_same<SlotAlloc, std::allocator<slot_type>>::value &&
         slots_ == nullptr) {
-      infoz_ = Sample();
+      infoz_ = Sample(sizeof(slot_type));
     }
 
     auto layout = MakeLayout(capacity_);
@@ -1605,6 +1727,35 @@ class raw_hash_set {
     return false;
   }
 
+  // Issues CPU prefetch instructions for the control bytes and slots of the
+  // first group probed for `hash`.
+  void prefetch_hash(size_t hash) const {
+    (void)hash;
+#if defined(__GNUC__)
+    auto seq = probe(hash);
+    __builtin_prefetch(static_cast<const void*>(ctrl_ + seq.offset()));
+    __builtin_prefetch(static_cast<const void*>(slots_ + seq.offset()));
+#endif  // __GNUC__
+  }
+
+  template <class K, class OutputIt>
+  void find_many_impl(basic::Span<const key_arg<K>> keys, OutputIt out) {
+    // Enough lookups in flight to hide the latency of a cache miss, few
+    // enough for their hashes to stay in registers.
+    constexpr size_t kBatchSize = 8;
+    size_t hashes[kBatchSize];
+    for (size_t begin = 0; begin < keys.size(); begin += kBatchSize) {
+      const size_t n = std::min(kBatchSize, keys.size() - begin);
+      for (size_t i = 0; i != n; ++i) {
+        hashes[i] = hash_ref()(keys[begin + i]);
+        prefetch_hash(hashes[i]);
+      }
+      for (size_t i = 0; i != n; ++i, ++out) {
+        *out = find<K>(keys[begin + i], hashes[i]);
+      }
+    }
+  }
+
   // Probes the raw_hash_set with the probe sequence for hash and returns the
   // pointer to the first empty or deleted slot.
   // NOTE: this function must work with tables having both kEmpty and kDelete
@@ -1655,7 +1806,11 @@ class raw_hash_set {
  protected:
   template <class K>
   std::pair<size_t, bool> find_or_prepare_insert(const K& key) {
-    auto hash = hash_ref()(key);
+    return find_or_prepare_insert(key, hash_ref()(key));
+  }
+
+  template <class K>
+  std::pair<size_t, bool> find_or_prepare_insert(const K& key, size_t hash) {
     auto seq = probe(hash);
     while (true) {
       Group g{ctrl_ + seq.offset()};
@@ -0,0 +1,77 @@
+// Copyright 2019 The Basic Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "basic/container/flat_hash_set.h"
+#include "basic/types/span.h"
+
+namespace {
+
+using Set = basic::flat_hash_set<int64_t>;
+
+// A set of |n| keys, and as many random lookups of which half are present.
+struct Fixture {
+  explicit Fixture(int64_t n) {
+    set.reserve(n);
+    for (int64_t i = 0; i < n; ++i) set.insert(2 * i);
+    std::mt19937_64 rng(n);
+    std::uniform_int_distribution<int64_t> dist(0, 2 * n - 1);
+    for (int64_t i = 0; i < n; ++i) lookups.push_back(dist(rng));
+  }
+
+  Set set;
+  std::vector<int64_t> lookups;
+};
+
+constexpr size_t kLookupsPerIteration = 64;
+
+void BM_Find(benchmark::State& state) {
+  const Fixture fixture(state.range(0));
+  const int64_t* key = fixture.lookups.data();
+  const int64_t* const end = key + fixture.lookups.size();
+  for (auto _ : state) {
+    for (size_t i = 0; i != kLookupsPerIteration; ++i) {
+      benchmark::DoNotOptimize(fixture.set.find(*key));
+      if (++key == end) key = fixture.lookups.data();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kLookupsPerIteration);
+}
+
+void BM_FindMany(benchmark::State& state) {
+  const Fixture fixture(state.range(0));
+  std::vector<Set::const_iterator> results(kLookupsPerIteration);
+  size_t begin = 0;
+  for (auto _ : state) {
+    fixture.set.find_many(
+        basic::MakeConstSpan(fixture.lookups)
+            .subspan(begin, kLookupsPerIteration),
+        basic::MakeSpan(results));
+    benchmark::DoNotOptimize(results.data());
+    begin += kLookupsPerIteration;
+    if (begin + kLookupsPerIteration > fixture.lookups.size()) begin = 0;
+  }
+  state.SetItemsProcessed(state.iterations() * kLookupsPerIteration);
+}
+
+// From tables that fit in L1 to tables far larger than the last level cache.
+BENCHMARK(BM_Find)->RangeMultiplier(16)->Range(1 << 10, 1 << 26);
+BENCHMARK(BM_FindMany)->RangeMultiplier(16)->Range(1 << 10, 1 << 26);
+
+}  // namespace
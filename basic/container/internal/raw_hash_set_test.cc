@@ -22,6 +22,7 @@
 #include <numeric>
 #include <random>
 #include <string>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -33,6 +34,7 @@
 #include "basic/container/internal/hash_policy_testing.h"
 #include "basic/container/internal/hashtable_debug.h"
 #include "basic/strings/string_view.h"
+#include "basic/types/span.h"
 
 namespace basic {
 namespace container_internal {
@@ -167,6 +169,17 @@ TEST(Group, Match) {
     EXPECT_THAT(Group{group}.Match(3), ElementsAre(3, 10));
     EXPECT_THAT(Group{group}.Match(5), ElementsAre(5, 9));
     EXPECT_THAT(Group{group}.Match(7), ElementsAre(7, 8));
+  } else if (Group::kWidth == 32) {
+    ctrl_t group[] = {kEmpty, 1, kDeleted, 3, kEmpty, 5, kSentinel, 7,
+                      7,      5, 3,        1, 1,      1, 1,         1,
+                      kEmpty, 1, kDeleted, 3, kEmpty, 5, kSentinel, 7,
+                      7,      5, 3,        1, 1,      1, 1,         1};
+    EXPECT_THAT(Group{group}.Match(0), ElementsAre());
+    EXPECT_THAT(Group{group}.Match(1), ElementsAre(1, 11, 12, 13, 14, 15, 17,
+                                                   27, 28, 29, 30, 31));
+    EXPECT_THAT(Group{group}.Match(3), ElementsAre(3, 10, 19, 26));
+    EXPECT_THAT(Group{group}.Match(5), ElementsAre(5, 9, 21, 25));
+    EXPECT_THAT(Group{group}.Match(7), ElementsAre(7, 8, 23, 24));
   } else if (Group::kWidth == 8) {
     ctrl_t group[] = {kEmpty, 1, 2, kDeleted, 2, 1, kSentinel, 1};
     EXPECT_THAT(Group{group}.Match(0), ElementsAre());
@@ -182,6 +195,12 @@ TEST(Group, MatchEmpty) {
     ctrl_t group[] = {kEmpty, 1, kDeleted, 3, kEmpty, 5, kSentinel, 7,
                       7,      5, 3,        1, 1,      1, 1,         1};
     EXPECT_THAT(Group{group}.MatchEmpty(), ElementsAre(0, 4));
+  } else if (Group::kWidth == 32) {
+    ctrl_t group[] = {kEmpty, 1, kDeleted, 3, kEmpty, 5, kSentinel, 7,
+                      7,      5, 3,        1, 1,      1, 1,         1,
+                      kEmpty, 1, kDeleted, 3, kEmpty, 5, kSentinel, 7,
+                      7,      5, 3,        1, 1,      1, 1,         1};
+    EXPECT_THAT(Group{group}.MatchEmpty(), ElementsAre(0, 4, 16, 20));
   } else if (Group::kWidth == 8) {
     ctrl_t group[] = {kEmpty, 1, 2, kDeleted, 2, 1, kSentinel, 1};
     EXPECT_THAT(Group{group}.MatchEmpty(), ElementsAre(0));
@@ -195,6 +214,13 @@ TEST(Group, MatchEmptyOrDeleted) {
     ctrl_t group[] = {kEmpty, 1, kDeleted, 3, kEmpty, 5, kSentinel, 7,
                       7,      5, 3,        1, 1,      1, 1,         1};
     EXPECT_THAT(Group{group}.MatchEmptyOrDeleted(), ElementsAre(0, 2, 4));
+  } else if (Group::kWidth == 32) {
+    ctrl_t group[] = {kEmpty, 1, kDeleted, 3, kEmpty, 5, kSentinel, 7,
+                      7,      5, 3,        1, 1,      1, 1,         1,
+                      kEmpty, 1, kDeleted, 3, kEmpty, 5, kSentinel, 7,
+                      7,      5, 3,        1, 1,      1, 1,         1};
+    EXPECT_THAT(Group{group}.MatchEmptyOrDeleted(),
+                ElementsAre(0, 2, 4, 16, 18, 20));
   } else if (Group::kWidth == 8) {
     ctrl_t group[] = {kEmpty, 1, 2, kDeleted, 2, 1, kSentinel, 1};
     EXPECT_THAT(Group{group}.MatchEmptyOrDeleted(), ElementsAre(0, 3));
@@ -464,6 +490,57 @@ TEST(Table, Prefetch) {
 #endif
 }
 
+TEST(Table, FindMany) {
+  IntTable t;
+  // Spans several batches, and ends with a partial one.
+  std::vector<int64_t> keys;
+  for (int64_t i = 0; i < 100; ++i) keys.push_back(i);
+  std::vector<IntTable::iterator> results(keys.size());
+
+  t.find_many(keys, basic::MakeSpan(results));
+  for (const auto& it : results) EXPECT_TRUE(it == t.end());
+
+  for (int64_t i = 0; i < 1000; i += 2) t.emplace(i);
+  t.find_many(keys, basic::MakeSpan(results));
+  for (size_t i = 0; i != keys.size(); ++i) {
+    if (keys[i] % 2 == 0) {
+      ASSERT_TRUE(results[i] != t.end());
+      EXPECT_EQ(keys[i], *results[i]);
+    } else {
+      EXPECT_TRUE(results[i] == t.end());
+    }
+  }
+
+  const IntTable& ct = t;
+  std::vector<IntTable::const_iterator> const_results(3);
+  ct.find_many({4, 5, 6}, basic::MakeSpan(const_results));
+  EXPECT_THAT(*const_results[0], 4);
+  EXPECT_TRUE(const_results[1] == ct.end());
+  EXPECT_THAT(*const_results[2], 6);
+
+  t.find_many({}, basic::Span<IntTable::iterator>());
+}
+
+TEST(Table, FindManyHeterogeneous) {
+  StringTable t;
+  t.emplace("a", "1");
+  t.emplace("c", "3");
+  std::vector<basic::string_view> keys = {"a", "b", "c"};
+  std::vector<StringTable::iterator> results(keys.size());
+  t.find_many<basic::string_view>(keys, basic::MakeSpan(results));
+  EXPECT_THAT(*results[0], Pair("a", "1"));
+  EXPECT_TRUE(results[1] == t.end());
+  EXPECT_THAT(*results[2], Pair("c", "3"));
+
+  // The key type is deduced from a span.
+  std::vector<StringTable::const_iterator> const_results(keys.size());
+  const StringTable& ct = t;
+  ct.find_many(basic::MakeConstSpan(keys), basic::MakeSpan(const_results));
+  EXPECT_THAT(*const_results[0], Pair("a", "1"));
+  EXPECT_TRUE(const_results[1] == ct.end());
+  EXPECT_THAT(*const_results[2], Pair("c", "3"));
+}
+
 TEST(Table, LookupEmpty) {
   IntTable t;
   auto it = t.find(0);
@@ -1103,6 +1180,7 @@ ExpectedStats XorSeedExpectedStats() {
           {{0.95, 0}, {0.99, 2}, {0.999, 4}, {0.9999, 10}}};
       }
     case 16:
+    case 32:
       if (kRandomizesInserts) {
         return {0.1,
                 1.0,
@@ -1197,6 +1275,7 @@ ExpectedStats LinearTransformExpectedStats() {
                 {{0.95, 0}, {0.99, 3}, {0.999, 15}, {0.9999, 25}}};
       }
     case 16:
+    case 32:
       if (kRandomizesInserts) {
         return {0.1,
                 0.4,
@@ -0,0 +1,68 @@
+// Copyright 2019 The Basic Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "basic/hash/hash.h"
+#include "basic/hash/internal/city.h"
+#include "basic/hash/internal/low_level_hash.h"
+#include "basic/strings/string_view.h"
+
+namespace {
+
+using ::basic::hash_internal::kLowLevelHashSalt;
+
+std::string MakeInput(size_t size) {
+  std::string input(size, '\0');
+  for (size_t i = 0; i < size; ++i) input[i] = static_cast<char>(i * 37 + 1);
+  return input;
+}
+
+// Hashes a string of |state.range(0)| bytes with |Fn|. Each hash is fed into
+// the next one's input, so that the latency of the hash is measured, which is
+// what a hash table lookup pays.
+template <uint64_t (*Fn)(const char*, size_t)>
+void BM_Hash(benchmark::State& state) {
+  std::string input = MakeInput(state.range(0));
+  uint64_t h = 0;
+  for (auto _ : state) {
+    input[0] = static_cast<char>(h);
+    h = Fn(input.data(), input.size());
+  }
+  benchmark::DoNotOptimize(h);
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+
+uint64_t BasicHash(const char* data, size_t size) {
+  return basic::Hash<basic::string_view>()(basic::string_view(data, size));
+}
+uint64_t CityHash64(const char* data, size_t size) {
+  return basic::hash_internal::CityHash64(data, size);
+}
+uint64_t LowLevelHash(const char* data, size_t size) {
+  return basic::hash_internal::LowLevelHash(data, size, 0, kLowLevelHashSalt);
+}
+
+#define HASH_BENCHMARK(fn) \
+  BENCHMARK_TEMPLATE(BM_Hash, fn)->RangeMultiplier(2)->Range(1, 4096)
+
+HASH_BENCHMARK(BasicHash);
+HASH_BENCHMARK(CityHash64);
+HASH_BENCHMARK(LowLevelHash);
+
+}  // namespace
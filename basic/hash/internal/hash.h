@@ -48,6 +48,7 @@
 #include "basic/types/variant.h"
 #include "basic/utility/utility.h"
 #include "basic/hash/internal/city.h"
+#include "basic/hash/internal/low_level_hash.h"
 
 namespace basic {
 namespace hash_internal {
@@ -792,11 +793,13 @@ inline uint64_t CityHashState::CombineContiguousImpl(
 inline uint64_t CityHashState::CombineContiguousImpl(
     uint64_t state, const unsigned char* first, size_t len,
     std::integral_constant<int, 8> /* sizeof_size_t */) {
-  // For large values we use CityHash, for small ones we just use a
-  // multiplicative hash.
+  // For large values we use LowLevelHash, for small ones we just use a
+  // multiplicative hash. Up to 16 bytes, two rounds of `Mix()` cost fewer
+  // multiplications than LowLevelHash followed by `Mix()`.
   uint64_t v;
   if (len > 16) {
-    v = basic::hash_internal::CityHash64(reinterpret_cast<const char*>(first), len);
+    v = basic::hash_internal::LowLevelHash(first, len, Seed(),
+                                           kLowLevelHashSalt);
   } else if (len > 8) {
     auto p = Read9To16(first, len);
     state = Mix(state, p.first);
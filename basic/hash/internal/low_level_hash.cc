@@ -0,0 +1,95 @@
+// Copyright 2019 The Basic Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "basic/hash/internal/low_level_hash.h"
+
+#include "basic/base/attributes.h"
+#include "basic/base/internal/endian.h"
+#include "basic/numeric/int128.h"
+
+namespace basic {
+namespace hash_internal {
+
+ABSL_CONST_INIT const uint64_t kLowLevelHashSalt[5] = {
+    uint64_t{0x243F6A8885A308D3}, uint64_t{0x13198A2E03707344},
+    uint64_t{0xA4093822299F31D0}, uint64_t{0x082EFA98EC4E6C89},
+    uint64_t{0x452821E638D01377},
+};
+
+namespace {
+
+// Multiplies `v0` and `v1` into 128 bits, and folds the halves of the product.
+inline uint64_t Mix(uint64_t v0, uint64_t v1) {
+  basic::uint128 p = v0;
+  p *= v1;
+  return basic::Uint128Low64(p) ^ basic::Uint128High64(p);
+}
+
+}  // namespace
+
+uint64_t LowLevelHash(const void* data, size_t len, uint64_t seed,
+                      const uint64_t salt[5]) {
+  const unsigned char* p = static_cast<const unsigned char*>(data);
+  const uint64_t original_len = len;
+  uint64_t state = seed ^ salt[0];
+
+  if (len > 64) {
+    // Two independent lanes consume 64 bytes per iteration, so that the
+    // multiplications of an iteration do not wait on each other.
+    uint64_t other_state = state;
+    do {
+      const uint64_t a = little_endian::Load64(p);
+      const uint64_t b = little_endian::Load64(p + 8);
+      const uint64_t c = little_endian::Load64(p + 16);
+      const uint64_t d = little_endian::Load64(p + 24);
+      const uint64_t e = little_endian::Load64(p + 32);
+      const uint64_t f = little_endian::Load64(p + 40);
+      const uint64_t g = little_endian::Load64(p + 48);
+      const uint64_t h = little_endian::Load64(p + 56);
+      state = Mix(a ^ salt[1], b ^ state) ^ Mix(c ^ salt[2], d ^ state);
+      other_state = Mix(e ^ salt[3], f ^ other_state) ^
+                    Mix(g ^ salt[4], h ^ other_state);
+      p += 64;
+      len -= 64;
+    } while (len > 64);
+    state ^= other_state;
+  }
+
+  while (len > 16) {
+    const uint64_t a = little_endian::Load64(p);
+    const uint64_t b = little_endian::Load64(p + 8);
+    state = Mix(a ^ salt[1], b ^ state);
+    p += 16;
+    len -= 16;
+  }
+
+  // At most 16 bytes are left; read them as two possibly overlapping words.
+  uint64_t a = 0;
+  uint64_t b = 0;
+  if (len > 8) {
+    a = little_endian::Load64(p);
+    b = little_endian::Load64(p + len - 8);
+  } else if (len > 3) {
+    a = little_endian::Load32(p);
+    b = little_endian::Load32(p + len - 4);
+  } else if (len > 0) {
+    a = (uint64_t{p[0]} << 16) | (uint64_t{p[len >> 1]} << 8) | p[len - 1];
+  }
+
+  // The length tells apart the inputs whose overlapping reads are equal.
+  return Mix(Mix(a ^ salt[1], b ^ state), salt[1] ^ original_len);
+}
+
+}  // namespace hash_internal
+}  // namespace basic
@@ -0,0 +1,43 @@
+// Copyright 2019 The Basic Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// This file provides `LowLevelHash()`, a hash function for contiguous byte
+// ranges derived from wyhash (https://github.com/wangyi-fudan/wyhash). Each 16
+// bytes of input cost a single 64x64->128 bit multiplication. `basic::Hash`
+// uses it for ranges longer than 16 bytes on 64-bit platforms.
+//
+// It is not suitable for cryptography, nor meant to resist hash flooding.
+
+#ifndef ABSL_HASH_INTERNAL_LOW_LEVEL_HASH_H_
+#define ABSL_HASH_INTERNAL_LOW_LEVEL_HASH_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+
+namespace basic {
+namespace hash_internal {
+
+// Hashes `len` bytes starting at `data`, with `seed`. `salt` must point to
+// five 64-bit constants with roughly as many set as unset bits, such as
+// `kLowLevelHashSalt`.
+uint64_t LowLevelHash(const void* data, size_t len, uint64_t seed,
+                      const uint64_t salt[5]);
+
+// The digits of pi.
+extern const uint64_t kLowLevelHashSalt[5];
+
+}  // namespace hash_internal
+}  // namespace basic
+
+#endif  // ABSL_HASH_INTERNAL_LOW_LEVEL_HASH_H_
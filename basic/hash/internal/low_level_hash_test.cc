@@ -0,0 +1,107 @@
+// Copyright 2019 The Basic Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "basic/hash/internal/low_level_hash.h"
+
+#include <bitset>
+#include <cstring>
+#include <set>
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace basic {
+namespace hash_internal {
+namespace {
+
+constexpr uint64_t kSeed = 0x0123456789abcdef;
+
+uint64_t Hash(const std::string& s, uint64_t seed = kSeed) {
+  return LowLevelHash(s.data(), s.size(), seed, kLowLevelHashSalt);
+}
+
+std::string PseudoRandomString(size_t size) {
+  std::string s(size, '\0');
+  uint64_t x = 88172645463325252;
+  for (char& c : s) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    c = static_cast<char>(x);
+  }
+  return s;
+}
+
+int BitsSet(uint64_t v) { return static_cast<int>(std::bitset<64>(v).count()); }
+
+// Flips every bit of `s` in turn, and checks that each flip changes about half
+// of the bits of the hash `fn` computes.
+template <typename Fn>
+void ExpectAvalanche(const std::string& s, Fn fn) {
+  const uint64_t h = fn(s);
+  int total = 0;
+  for (size_t bit = 0; bit != s.size() * 8; ++bit) {
+    std::string flipped = s;
+    flipped[bit / 8] ^= static_cast<char>(1 << (bit % 8));
+    const uint64_t diff = fn(flipped) ^ h;
+    EXPECT_NE(diff, 0) << "len=" << s.size() << " bit=" << bit;
+    total += BitsSet(diff);
+  }
+  const double average = static_cast<double>(total) / (s.size() * 8);
+  EXPECT_GT(average, 24) << "len=" << s.size();
+  EXPECT_LT(average, 40) << "len=" << s.size();
+}
+
+TEST(LowLevelHashTest, DependsOnSeed) {
+  const std::string s = PseudoRandomString(100);
+  EXPECT_EQ(Hash(s), Hash(s));
+  EXPECT_NE(Hash(s), Hash(s, kSeed + 1));
+  EXPECT_NE(Hash(""), Hash("", kSeed + 1));
+}
+
+TEST(LowLevelHashTest, DistinctForEveryLength) {
+  const std::string random = PseudoRandomString(256);
+  const std::string zeros(256, '\0');
+  std::set<uint64_t> hashes;
+  for (size_t len = 0; len <= 256; ++len) {
+    EXPECT_TRUE(hashes.insert(Hash(random.substr(0, len))).second) << len;
+    if (len == 0) continue;  // The empty string was inserted above.
+    // Only the length tells these apart.
+    EXPECT_TRUE(hashes.insert(Hash(zeros.substr(0, len))).second) << len;
+  }
+}
+
+TEST(LowLevelHashTest, Avalanche) {
+  for (size_t len : {1, 2, 3, 4, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65,
+                     100, 128, 129, 200}) {
+    ExpectAvalanche(PseudoRandomString(len),
+                    [](const std::string& s) { return Hash(s); });
+  }
+}
+
+TEST(LowLevelHashTest, IgnoresAlignment) {
+  const std::string s = PseudoRandomString(300);
+  char buffer[308];
+  for (size_t offset = 0; offset != 8; ++offset) {
+    memcpy(buffer + offset, s.data(), s.size());
+    for (size_t len : {5, 13, 40, 300}) {
+      EXPECT_EQ(LowLevelHash(buffer + offset, len, kSeed, kLowLevelHashSalt),
+                Hash(s.substr(0, len)));
+    }
+  }
+}
+
+}  // namespace
+}  // namespace hash_internal
+}  // namespace basic
@@ -0,0 +1,460 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/binary_value_serializer.h"
+
+#include <string.h>
+
+#include <cmath>
+#include <utility>
+
+#include "base/files/memory_mapped_file.h"
+#include "base/format_macros.h"
+#include "base/logging.h"
+#include "base/optional.h"
+#include "base/stl_util.h"
+#include "base/strings/string_util.h"
+#include "base/strings/stringprintf.h"
+#include "base/sys_byteorder.h"
+
+// The data is laid out as follows:
+//
+//   header     "BVAL", followed by the format version byte
+//   key table  varint count, then count x (varint length, bytes)
+//   root       value
+//
+// and each value as a type tag byte followed by:
+//
+//   kNone, kFalse, kTrue  nothing
+//   kInt                  the zigzag-encoded value as a varint
+//   kDouble               8 bytes, the little-endian IEEE 754 representation
+//                         of a finite value
+//   kString, kBinary      varint length, bytes
+//   kList                 varint count, count x value
+//   kDictionary           varint count, count x (varint key index, value)
+//
+// Varints are unsigned LEB128: 7 bits per byte, least significant first, with
+// the high bit set on all bytes but the last.
+
+namespace base {
+
+namespace {
+
+const char kMagic[] = {'B', 'V', 'A', 'L'};
+const uint8_t kFormatVersion = 1;
+
+enum Tag : uint8_t {
+  kNone = 0,
+  kFalse,
+  kTrue,
+  kInt,
+  kDouble,
+  kString,
+  kBinary,
+  kList,
+  kDictionary,
+};
+
+// The longest varint encoding of a uint64_t.
+const size_t kMaxVarintLength = 10;
+
+const char* const kErrorMessages[] = {
+    "",
+    "Not a serialized value.",
+    "Unsupported format version.",
+    "Unexpected end of data.",
+    "Invalid type tag.",
+    "Invalid varint.",
+    "Invalid dictionary key index.",
+    "Invalid UTF-8 string.",
+    "Value nested too deeply.",
+    "Unexpected data after the root value.",
+    "Double is NaN or infinite.",
+};
+static_assert(base::size(kErrorMessages) ==
+                  BinaryValueDeserializer::kErrorCodeCount,
+              "Every error code needs a message");
+
+void AppendVarint(uint64_t value, std::string* output) {
+  while (value >= 0x80) {
+    output->push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  output->push_back(static_cast<char>(value));
+}
+
+void AppendBytes(const void* data, size_t size, std::string* output) {
+  AppendVarint(size, output);
+  output->append(static_cast<const char*>(data), size);
+}
+
+uint32_t ZigZagEncode(int value) {
+  return (static_cast<uint32_t>(value) << 1) ^
+         static_cast<uint32_t>(value >> 31);
+}
+
+int ZigZagDecode(uint32_t value) {
+  return static_cast<int>((value >> 1) ^ (0u - (value & 1)));
+}
+
+// Decodes a value from data that is not trusted to be well-formed. Strings
+// are validated and copied straight from the input into the resulting Values;
+// nothing else is copied.
+class Reader {
+ public:
+  explicit Reader(span<const uint8_t> data)
+      : begin_(data.data()),
+        pos_(data.data()),
+        end_(data.data() + data.size()) {}
+
+  Optional<Value> Read() {
+    if (static_cast<size_t>(end_ - pos_) < sizeof(kMagic) + 1 ||
+        memcmp(pos_, kMagic, sizeof(kMagic)) != 0) {
+      return Fail(BinaryValueDeserializer::kBadHeader);
+    }
+    pos_ += sizeof(kMagic);
+    if (*pos_ != kFormatVersion)
+      return Fail(BinaryValueDeserializer::kUnsupportedVersion);
+    ++pos_;
+
+    uint64_t key_count;
+    if (!ReadVarint(&key_count))
+      return nullopt;
+    // Every key takes at least one byte, which bounds the reservation.
+    if (key_count > static_cast<size_t>(end_ - pos_))
+      return Fail(BinaryValueDeserializer::kTruncated);
+    keys_.reserve(key_count);
+    for (uint64_t i = 0; i < key_count; ++i) {
+      StringPiece key;
+      if (!ReadString(&key))
+        return nullopt;
+      keys_.push_back(key);
+    }
+
+    Optional<Value> root = ReadValue(0);
+    if (root && pos_ != end_)
+      return Fail(BinaryValueDeserializer::kTrailingData);
+    return root;
+  }
+
+  BinaryValueDeserializer::ErrorCode error_code() const { return error_code_; }
+  size_t error_offset() const { return error_offset_; }
+
+ private:
+  Optional<Value> ReadValue(int depth) {
+    if (pos_ == end_)
+      return Fail(BinaryValueDeserializer::kTruncated);
+    const uint8_t tag = *pos_++;
+    switch (tag) {
+      case kNone:
+        return Value();
+      case kFalse:
+        return Value(false);
+      case kTrue:
+        return Value(true);
+      case kInt: {
+        uint64_t value;
+        if (!ReadVarint(&value))
+          return nullopt;
+        if (value > UINT32_MAX)
+          return Fail(BinaryValueDeserializer::kBadVarint);
+        return Value(ZigZagDecode(static_cast<uint32_t>(value)));
+      }
+      case kDouble: {
+        if (static_cast<size_t>(end_ - pos_) < sizeof(uint64_t))
+          return Fail(BinaryValueDeserializer::kTruncated);
+        uint64_t bits;
+        memcpy(&bits, pos_, sizeof(bits));
+        bits = ByteSwapToLE64(bits);
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        // Value can't hold NaN or infinities.
+        if (!std::isfinite(value))
+          return Fail(BinaryValueDeserializer::kNonFiniteDouble);
+        pos_ += sizeof(bits);
+        return Value(value);
+      }
+      case kString: {
+        StringPiece value;
+        if (!ReadString(&value))
+          return nullopt;
+        return Value(value);
+      }
+      case kBinary: {
+        StringPiece value;
+        if (!ReadBytes(&value))
+          return nullopt;
+        return Value(as_bytes(make_span(value.data(), value.size())));
+      }
+      case kList:
+      case kDictionary:
+        if (depth >= BinaryValueSerializer::kMaxDepth)
+          return Fail(BinaryValueDeserializer::kTooMuchNesting);
+        return tag == kList ? ReadList(depth + 1) : ReadDictionary(depth + 1);
+      default:
+        --pos_;
+        return Fail(BinaryValueDeserializer::kBadTypeTag);
+    }
+  }
+
+  Optional<Value> ReadList(int depth) {
+    uint64_t count;
+    if (!ReadVarint(&count))
+      return nullopt;
+    // Every item takes at least one byte.
+    if (count > static_cast<size_t>(end_ - pos_))
+      return Fail(BinaryValueDeserializer::kTruncated);
+
+    Value::ListStorage list;
+    list.reserve(count);
+    for (uint64_t i = 0; i < count; ++i) {
+      Optional<Value> item = ReadValue(depth);
+      if (!item)
+        return nullopt;
+      list.push_back(std::move(*item));
+    }
+    return Value(std::move(list));
+  }
+
+  Optional<Value> ReadDictionary(int depth) {
+    uint64_t count;
+    if (!ReadVarint(&count))
+      return nullopt;
+    // Every item takes at least two bytes.
+    if (count > static_cast<size_t>(end_ - pos_) / 2)
+      return Fail(BinaryValueDeserializer::kTruncated);
+
+    std::vector<Value::DictStorage::value_type> dict_storage;
+    dict_storage.reserve(count);
+    for (uint64_t i = 0; i < count; ++i) {
+      const uint8_t* const key_start = pos_;
+      uint64_t key_index;
+      if (!ReadVarint(&key_index))
+        return nullopt;
+      if (key_index >= keys_.size()) {
+        pos_ = key_start;
+        return Fail(BinaryValueDeserializer::kBadKeyIndex);
+      }
+      Optional<Value> value = ReadValue(depth);
+      if (!value)
+        return nullopt;
+      dict_storage.emplace_back(keys_[key_index].as_string(),
+                                std::make_unique<Value>(std::move(*value)));
+    }
+    // Serialized dictionaries are sorted and free of duplicate keys, but the
+    // input is not trusted to be.
+    return Value(
+        Value::DictStorage(std::move(dict_storage), KEEP_LAST_OF_DUPES));
+  }
+
+  bool ReadVarint(uint64_t* value) {
+    uint64_t result = 0;
+    for (size_t i = 0; i < kMaxVarintLength; ++i) {
+      if (pos_ == end_) {
+        Fail(BinaryValueDeserializer::kTruncated);
+        return false;
+      }
+      const uint8_t byte = *pos_++;
+      result |= static_cast<uint64_t>(byte & 0x7F) << (7 * i);
+      if (!(byte & 0x80)) {
+        *value = result;
+        return true;
+      }
+    }
+    Fail(BinaryValueDeserializer::kBadVarint);
+    return false;
+  }
+
+  // Reads a varint length and that many bytes, which |bytes| then refers to.
+  bool ReadBytes(StringPiece* bytes) {
+    uint64_t length;
+    if (!ReadVarint(&length))
+      return false;
+    if (length > static_cast<size_t>(end_ - pos_)) {
+      Fail(BinaryValueDeserializer::kTruncated);
+      return false;
+    }
+    *bytes = StringPiece(reinterpret_cast<const char*>(pos_), length);
+    pos_ += length;
+    return true;
+  }
+
+  // As ReadBytes(), but fails unless the bytes are valid UTF-8.
+  bool ReadString(StringPiece* string) {
+    const uint8_t* const start = pos_;
+    if (!ReadBytes(string))
+      return false;
+    if (!IsStringUTF8(*string)) {
+      pos_ = start;
+      Fail(BinaryValueDeserializer::kInvalidUTF8);
+      return false;
+    }
+    return true;
+  }
+
+  Optional<Value> Fail(BinaryValueDeserializer::ErrorCode error_code) {
+    error_code_ = error_code;
+    error_offset_ = pos_ - begin_;
+    return nullopt;
+  }
+
+  const uint8_t* const begin_;
+  const uint8_t* pos_;
+  const uint8_t* const end_;
+
+  // Refers to the key table in the input.
+  std::vector<StringPiece> keys_;
+
+  BinaryValueDeserializer::ErrorCode error_code_ =
+      BinaryValueDeserializer::kNoError;
+  size_t error_offset_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(Reader);
+};
+
+}  // namespace
+
+constexpr int BinaryValueSerializer::kMaxDepth;
+
+BinaryValueSerializer::BinaryValueSerializer(std::string* output)
+    : output_(output) {
+  DCHECK(output_);
+}
+
+BinaryValueSerializer::~BinaryValueSerializer() = default;
+
+bool BinaryValueSerializer::Serialize(const Value& root) {
+  output_->clear();
+  keys_.clear();
+  key_indices_.clear();
+  if (!CollectKeys(root, 0))
+    return false;
+
+  output_->append(kMagic, sizeof(kMagic));
+  output_->push_back(static_cast<char>(kFormatVersion));
+  AppendVarint(keys_.size(), output_);
+  for (StringPiece key : keys_)
+    AppendBytes(key.data(), key.size(), output_);
+  WriteValue(root);
+
+  keys_.clear();
+  key_indices_.clear();
+  return true;
+}
+
+bool BinaryValueSerializer::CollectKeys(const Value& value, int depth) {
+  if (value.is_list() || value.is_dict()) {
+    if (depth >= kMaxDepth)
+      return false;
+    ++depth;
+  }
+
+  if (value.is_list()) {
+    for (const Value& item : value.GetList()) {
+      if (!CollectKeys(item, depth))
+        return false;
+    }
+  } else if (value.is_dict()) {
+    for (const auto& item : value.DictItems()) {
+      if (key_indices_.emplace(item.first, keys_.size()).second)
+        keys_.push_back(item.first);
+      if (!CollectKeys(item.second, depth))
+        return false;
+    }
+  }
+  return true;
+}
+
+void BinaryValueSerializer::WriteValue(const Value& value) {
+  switch (value.type()) {
+    case Value::Type::NONE:
+      output_->push_back(kNone);
+      break;
+    case Value::Type::BOOLEAN:
+      output_->push_back(value.GetBool() ? kTrue : kFalse);
+      break;
+    case Value::Type::INTEGER:
+      output_->push_back(kInt);
+      AppendVarint(ZigZagEncode(value.GetInt()), output_);
+      break;
+    case Value::Type::DOUBLE: {
+      output_->push_back(kDouble);
+      const double double_value = value.GetDouble();
+      uint64_t bits;
+      memcpy(&bits, &double_value, sizeof(bits));
+      bits = ByteSwapToLE64(bits);
+      output_->append(reinterpret_cast<const char*>(&bits), sizeof(bits));
+      break;
+    }
+    case Value::Type::STRING:
+      output_->push_back(kString);
+      AppendBytes(value.GetString().data(), value.GetString().size(), output_);
+      break;
+    case Value::Type::BINARY:
+      output_->push_back(kBinary);
+      AppendBytes(value.GetBlob().data(), value.GetBlob().size(), output_);
+      break;
+    case Value::Type::LIST:
+      output_->push_back(kList);
+      AppendVarint(value.GetList().size(), output_);
+      for (const Value& item : value.GetList())
+        WriteValue(item);
+      break;
+    case Value::Type::DICTIONARY:
+      output_->push_back(kDictionary);
+      AppendVarint(value.DictSize(), output_);
+      for (const auto& item : value.DictItems()) {
+        AppendVarint(key_indices_.find(item.first)->second, output_);
+        WriteValue(item.second);
+      }
+      break;
+    // TODO(crbug.com/859477): Remove after root cause is found.
+    case Value::Type::DEAD:
+      CHECK(false);
+      break;
+  }
+}
+
+BinaryValueDeserializer::BinaryValueDeserializer(span<const uint8_t> data)
+    : data_(data) {}
+
+BinaryValueDeserializer::BinaryValueDeserializer(StringPiece data)
+    : data_(as_bytes(make_span(data.data(), data.size()))) {}
+
+BinaryValueDeserializer::BinaryValueDeserializer(const MemoryMappedFile& file)
+    : data_(file.data(), file.length()) {
+  DCHECK(file.IsValid());
+}
+
+BinaryValueDeserializer::~BinaryValueDeserializer() = default;
+
+std::unique_ptr<Value> BinaryValueDeserializer::Deserialize(
+    int* error_code,
+    std::string* error_message) {
+  Reader reader(data_);
+  Optional<Value> root = reader.Read();
+  if (error_code)
+    *error_code = reader.error_code();
+  if (!root) {
+    if (error_message) {
+      *error_message =
+          StringPrintf("Offset %" PRIuS ": %s", reader.error_offset(),
+                       GetErrorMessageForCode(reader.error_code()));
+    }
+    return nullptr;
+  }
+  if (error_message)
+    error_message->clear();
+  return Value::ToUniquePtrValue(std::move(*root));
+}
+
+// static
+const char* BinaryValueDeserializer::GetErrorMessageForCode(
+    ErrorCode error_code) {
+  DCHECK_GE(error_code, 0);
+  DCHECK_LT(error_code, kErrorCodeCount);
+  return kErrorMessages[error_code];
+}
+
+}  // namespace base
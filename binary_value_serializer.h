@@ -0,0 +1,123 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// A compact binary encoding of base::Value, for state that is written and
+// read back by the same program, such as on-disk snapshots that would
+// otherwise be re-parsed from JSON on every start:
+//
+//   std::string data;
+//   BinaryValueSerializer(&data).Serialize(state);
+//   ImportantFileWriter::WriteFileAtomically(path, data);
+//   ...
+//   MemoryMappedFile file;
+//   if (!file.Initialize(path))
+//     return nullptr;
+//   return BinaryValueDeserializer(file).Deserialize(nullptr, nullptr);
+//
+// The encoding is not human-readable and, unlike JSON, preserves BINARY
+// values. Every value starts with a one-byte type tag; lengths and integers
+// are varints and each distinct dictionary key is stored once, in a table at
+// the start of the data. The format is versioned, but nothing guarantees that
+// a future version can read data written today, so don't use it for data that
+// is exchanged with other programs.
+
+#ifndef BASE_BINARY_VALUE_SERIALIZER_H_
+#define BASE_BINARY_VALUE_SERIALIZER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/containers/span.h"
+#include "base/macros.h"
+#include "base/strings/string_piece.h"
+#include "base/values.h"
+
+namespace base {
+
+class MemoryMappedFile;
+
+class BASE_EXPORT BinaryValueSerializer : public ValueSerializer {
+ public:
+  // The deepest nesting of lists and dictionaries that can be serialized,
+  // which is also the deepest that BinaryValueDeserializer accepts.
+  static constexpr int kMaxDepth = 200;
+
+  // |output| is overwritten by Serialize() and must outlive the serializer.
+  explicit BinaryValueSerializer(std::string* output);
+  ~BinaryValueSerializer() override;
+
+  // Returns false, leaving |output| empty, if |root| is nested deeper than
+  // kMaxDepth.
+  bool Serialize(const Value& root) override;
+
+ private:
+  // Adds the keys of all dictionaries in |value| to the key table.
+  bool CollectKeys(const Value& value, int depth);
+
+  void WriteValue(const Value& value);
+
+  // Owned by the caller of the constructor.
+  std::string* const output_;
+
+  // The distinct dictionary keys in order of first appearance, and the index
+  // of each. Both refer to the strings of the Value being serialized.
+  std::vector<StringPiece> keys_;
+  std::unordered_map<StringPiece, size_t, StringPieceHash> key_indices_;
+
+  DISALLOW_COPY_AND_ASSIGN(BinaryValueSerializer);
+};
+
+class BASE_EXPORT BinaryValueDeserializer : public ValueDeserializer {
+ public:
+  enum ErrorCode {
+    kNoError = 0,
+    kBadHeader,
+    kUnsupportedVersion,
+    kTruncated,
+    kBadTypeTag,
+    kBadVarint,
+    kBadKeyIndex,
+    kInvalidUTF8,
+    kTooMuchNesting,
+    kTrailingData,
+    kNonFiniteDouble,
+    kErrorCodeCount,
+  };
+
+  // The deserializer reads |data| in place and retains a reference to it, so
+  // it must outlive the deserializer. Malformed data, including strings that
+  // are not valid UTF-8 and doubles that are NaN or infinite, is rejected
+  // without reading outside of |data|.
+  explicit BinaryValueDeserializer(span<const uint8_t> data);
+  explicit BinaryValueDeserializer(StringPiece data);
+
+  // Reads the mapped contents of |file|, which must be valid.
+  explicit BinaryValueDeserializer(const MemoryMappedFile& file);
+
+  ~BinaryValueDeserializer() override;
+
+  // Returns null on failure, in which case |error_code| is set to an
+  // ErrorCode and |error_message| to a description that includes the offset
+  // of the error. Both may be null.
+  std::unique_ptr<Value> Deserialize(int* error_code,
+                                     std::string* error_message) override;
+
+  static const char* GetErrorMessageForCode(ErrorCode error_code);
+
+ private:
+  // Owned by the caller of the constructor.
+  const span<const uint8_t> data_;
+
+  DISALLOW_COPY_AND_ASSIGN(BinaryValueDeserializer);
+};
+
+}  // namespace base
+
+#endif  // BASE_BINARY_VALUE_SERIALIZER_H_
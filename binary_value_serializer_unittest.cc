@@ -0,0 +1,242 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/binary_value_serializer.h"
+
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/files/memory_mapped_file.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/format_macros.h"
+#include "base/json/json_reader.h"
+#include "base/stl_util.h"
+#include "base/strings/stringprintf.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+Value CreateTestValue() {
+  Value root = *JSONReader::Read(R"({
+    "name": "snapshot",
+    "empty_string": "",
+    "count": 42,
+    "negative": -7,
+    "ratio": 0.25,
+    "enabled": true,
+    "disabled": false,
+    "nothing": null,
+    "unicode": "café",
+    "items": [
+      {"name": "a", "count": 1},
+      {"name": "b", "count": 2},
+      [[], {}]
+    ]
+  })");
+  root.SetKey("blob", Value(Value::BlobStorage({0, 1, 0x80, 0xFF})));
+  root.SetKey("min", Value(std::numeric_limits<int>::min()));
+  root.SetKey("max", Value(std::numeric_limits<int>::max()));
+  root.SetKey("huge", Value(1e300));
+  return root;
+}
+
+std::string Serialize(const Value& value) {
+  std::string output;
+  EXPECT_TRUE(BinaryValueSerializer(&output).Serialize(value));
+  return output;
+}
+
+std::unique_ptr<Value> Deserialize(StringPiece data,
+                                   int* error_code = nullptr) {
+  return BinaryValueDeserializer(data).Deserialize(error_code, nullptr);
+}
+
+Value CreateNestedLists(int depth) {
+  Value value(Value::Type::LIST);
+  for (int i = 1; i < depth; ++i) {
+    Value outer(Value::Type::LIST);
+    outer.GetList().push_back(std::move(value));
+    value = std::move(outer);
+  }
+  return value;
+}
+
+}  // namespace
+
+TEST(BinaryValueSerializerTest, RoundTrip) {
+  const Value value = CreateTestValue();
+  std::unique_ptr<Value> result = Deserialize(Serialize(value));
+  ASSERT_TRUE(result);
+  EXPECT_EQ(value, *result);
+
+  const Value kScalars[] = {
+      Value(), Value(true), Value(0), Value(-1), Value(0.5), Value("x"),
+      Value(Value::Type::LIST), Value(Value::Type::DICTIONARY),
+  };
+  for (const Value& scalar : kScalars) {
+    result = Deserialize(Serialize(scalar));
+    ASSERT_TRUE(result);
+    EXPECT_EQ(scalar, *result);
+  }
+}
+
+TEST(BinaryValueSerializerTest, KeysAreStoredOnce) {
+  const std::string kKey = "a_rather_long_dictionary_key";
+  Value list(Value::Type::LIST);
+  for (int i = 0; i < 100; ++i) {
+    Value item(Value::Type::DICTIONARY);
+    item.SetIntKey(kKey, i);
+    list.GetList().push_back(std::move(item));
+  }
+
+  const std::string data = Serialize(list);
+  EXPECT_EQ(data.find(kKey), data.rfind(kKey));
+  EXPECT_LT(data.size(), 100 * 6 + kKey.size() + 16);
+
+  std::unique_ptr<Value> result = Deserialize(data);
+  ASSERT_TRUE(result);
+  EXPECT_EQ(list, *result);
+}
+
+TEST(BinaryValueSerializerTest, SerializeReplacesOutput) {
+  std::string output = "previous contents";
+  BinaryValueSerializer serializer(&output);
+  ASSERT_TRUE(serializer.Serialize(Value(1)));
+  const std::string first = output;
+  ASSERT_TRUE(serializer.Serialize(Value(1)));
+  EXPECT_EQ(first, output);
+}
+
+TEST(BinaryValueSerializerTest, MaxDepth) {
+  std::string output;
+  BinaryValueSerializer serializer(&output);
+  EXPECT_TRUE(serializer.Serialize(
+      CreateNestedLists(BinaryValueSerializer::kMaxDepth)));
+  EXPECT_TRUE(Deserialize(output));
+
+  EXPECT_FALSE(serializer.Serialize(
+      CreateNestedLists(BinaryValueSerializer::kMaxDepth + 1)));
+  EXPECT_TRUE(output.empty());
+
+  // Hand-craft data that is nested too deeply.
+  std::string data = Serialize(Value());
+  data.pop_back();
+  for (int i = 0; i <= BinaryValueSerializer::kMaxDepth; ++i)
+    data.append("\x07\x01");
+  int error_code = 0;
+  EXPECT_FALSE(Deserialize(data, &error_code));
+  EXPECT_EQ(BinaryValueDeserializer::kTooMuchNesting, error_code);
+}
+
+TEST(BinaryValueSerializerTest, Errors) {
+  const std::string valid = Serialize(CreateTestValue());
+  const std::string header = Serialize(Value()).substr(0, 5);
+
+  struct {
+    std::string data;
+    BinaryValueDeserializer::ErrorCode error_code;
+  } kCases[] = {
+      {"", BinaryValueDeserializer::kBadHeader},
+      {"{\"a\": 1}", BinaryValueDeserializer::kBadHeader},
+      {"BVAL", BinaryValueDeserializer::kBadHeader},
+      {std::string("BVAL\x7F\0\0", 7),
+       BinaryValueDeserializer::kUnsupportedVersion},
+      {header + std::string("\0", 1), BinaryValueDeserializer::kTruncated},
+      {header + std::string("\0\x09", 2),
+       BinaryValueDeserializer::kBadTypeTag},
+      {header + std::string("\0\x03\xFF\xFF\xFF\xFF\x7F", 7),
+       BinaryValueDeserializer::kBadVarint},
+      {header + std::string("\0\x03", 2) + std::string(10, '\xFF') + "\x01",
+       BinaryValueDeserializer::kBadVarint},
+      {header + std::string("\0\x05\x05" "abc", 6),
+       BinaryValueDeserializer::kTruncated},
+      {header + std::string("\0\x07\x7F\x00", 4),
+       BinaryValueDeserializer::kTruncated},
+      {header + std::string("\x01\x01" "a\x08\x01\x01\x00", 7),
+       BinaryValueDeserializer::kBadKeyIndex},
+      {header + std::string("\0\x05\x01\xFF", 4),
+       BinaryValueDeserializer::kInvalidUTF8},
+      {header + std::string("\x01\x02\xC3\x28\x08\x00", 6),
+       BinaryValueDeserializer::kInvalidUTF8},
+      {header + std::string("\0\x00\x00", 3),
+       BinaryValueDeserializer::kTrailingData},
+      {valid + '\0', BinaryValueDeserializer::kTrailingData},
+  };
+
+  for (unsigned int i = 0; i < base::size(kCases); ++i) {
+    SCOPED_TRACE(StringPrintf("case %u", i));
+    int error_code = 0;
+    std::string error_message;
+    EXPECT_FALSE(BinaryValueDeserializer(kCases[i].data)
+                     .Deserialize(&error_code, &error_message));
+    EXPECT_EQ(kCases[i].error_code, error_code);
+    EXPECT_FALSE(error_message.empty());
+  }
+
+  // No prefix of valid data can be read.
+  for (size_t length = 0; length < valid.size(); ++length) {
+    SCOPED_TRACE(StringPrintf("length %" PRIuS, length));
+    EXPECT_FALSE(Deserialize(StringPiece(valid.data(), length)));
+  }
+}
+
+TEST(BinaryValueSerializerTest, NonFiniteDoubles) {
+  const std::string header = Serialize(Value()).substr(0, 5);
+  // Little-endian bit patterns of a quiet NaN, a signaling NaN, a NaN with the
+  // sign bit set, and both infinities.
+  const char* const kBits[] = {
+      "\x00\x00\x00\x00\x00\x00\xF8\x7F",
+      "\x01\x00\x00\x00\x00\x00\xF0\x7F",
+      "\x00\x00\x00\x00\x00\x00\xF8\xFF",
+      "\x00\x00\x00\x00\x00\x00\xF0\x7F",
+      "\x00\x00\x00\x00\x00\x00\xF0\xFF",
+  };
+
+  for (unsigned int i = 0; i < base::size(kBits); ++i) {
+    SCOPED_TRACE(StringPrintf("case %u", i));
+    int error_code = 0;
+    EXPECT_FALSE(Deserialize(
+        header + std::string("\0\x04", 2) + std::string(kBits[i], 8),
+        &error_code));
+    EXPECT_EQ(BinaryValueDeserializer::kNonFiniteDouble, error_code);
+  }
+
+  // The largest finite double is accepted.
+  std::unique_ptr<Value> value =
+      Deserialize(header + std::string("\0\x04", 2) +
+                  std::string("\xFF\xFF\xFF\xFF\xFF\xFF\xEF\x7F", 8));
+  ASSERT_TRUE(value);
+  EXPECT_EQ(std::numeric_limits<double>::max(), value->GetDouble());
+}
+
+TEST(BinaryValueSerializerTest, ReadFromMemoryMappedFile) {
+  ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  const FilePath path = temp_dir.GetPath().AppendASCII("state.bin");
+
+  const Value value = CreateTestValue();
+  const std::string data = Serialize(value);
+  ASSERT_EQ(static_cast<int>(data.size()),
+            WriteFile(path, data.data(), data.size()));
+
+  MemoryMappedFile file;
+  ASSERT_TRUE(file.Initialize(path));
+  int error_code = -1;
+  std::string error_message = "unchanged";
+  std::unique_ptr<Value> result =
+      BinaryValueDeserializer(file).Deserialize(&error_code, &error_message);
+  ASSERT_TRUE(result);
+  EXPECT_EQ(value, *result);
+  EXPECT_EQ(BinaryValueDeserializer::kNoError, error_code);
+  EXPECT_TRUE(error_message.empty());
+}
+
+}  // namespace base
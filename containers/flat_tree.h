@@ -450,8 +450,11 @@ class flat_tree {
   void sort_and_unique(iterator first,
                        iterator last,
                        FlatContainerDupes dupes) {
-    // Preserve stability for the unique code below.
-    std::stable_sort(first, last, impl_.get_value_comp());
+    // Preserve stability for the unique code below. Input that is already
+    // sorted, such as a copy of another flat container, is common and much
+    // cheaper to check than to sort.
+    if (!std::is_sorted(first, last, impl_.get_value_comp()))
+      std::stable_sort(first, last, impl_.get_value_comp());
 
     auto comparator = [this](const value_type& lhs, const value_type& rhs) {
       // lhs is already <= rhs due to sort, therefore
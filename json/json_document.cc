@@ -0,0 +1,537 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/json/json_document.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "base/auto_reset.h"
+#include "base/json/json_parser.h"
+#include "base/json/json_structural_index.h"
+#include "base/logging.h"
+#include "base/numerics/safe_conversions.h"
+
+namespace base {
+
+namespace {
+
+// The minimum size of the chunks that decoded strings are copied into.
+constexpr size_t kStringChunkSize = 4096;
+
+constexpr char kUTF8ByteOrderMark[] = "\xEF\xBB\xBF";
+
+}  // namespace
+
+// ValueView ///////////////////////////////////////////////////////////////////
+
+bool ValueView::GetBool() const {
+  CHECK(is_bool());
+  return node_->bool_value;
+}
+
+int ValueView::GetInt() const {
+  CHECK(is_int());
+  return node_->int_value;
+}
+
+double ValueView::GetDouble() const {
+  if (is_double())
+    return node_->double_value;
+  if (is_int())
+    return node_->int_value;
+  CHECK(false);
+  return 0.0;
+}
+
+StringPiece ValueView::GetString() const {
+  CHECK(is_string());
+  return StringPiece(node_->string_value, node_->size);
+}
+
+ValueView::ListView ValueView::GetList() const {
+  CHECK(is_list());
+  return ListView(node_);
+}
+
+ValueView::DictView ValueView::DictItems() const {
+  CHECK(is_dict());
+  return DictView(node_);
+}
+
+Optional<ValueView> ValueView::FindKey(StringPiece key) const {
+  CHECK(is_dict());
+  // Keep going after a match, since the last of any duplicates wins.
+  const Node* found = nullptr;
+  const Node* const end = node_ + node_->subtree_size;
+  for (const Node* child = node_ + 1; child != end;
+       child += child->subtree_size) {
+    if (StringPiece(child->key, child->key_length) == key)
+      found = child;
+  }
+  if (!found)
+    return nullopt;
+  return ValueView(found);
+}
+
+Optional<ValueView> ValueView::FindKeyOfType(StringPiece key,
+                                             Value::Type type) const {
+  Optional<ValueView> result = FindKey(key);
+  if (!result || result->type() != type)
+    return nullopt;
+  return result;
+}
+
+Optional<bool> ValueView::FindBoolKey(StringPiece key) const {
+  Optional<ValueView> result = FindKeyOfType(key, Value::Type::BOOLEAN);
+  return result ? make_optional(result->GetBool()) : nullopt;
+}
+
+Optional<int> ValueView::FindIntKey(StringPiece key) const {
+  Optional<ValueView> result = FindKeyOfType(key, Value::Type::INTEGER);
+  return result ? make_optional(result->GetInt()) : nullopt;
+}
+
+Optional<double> ValueView::FindDoubleKey(StringPiece key) const {
+  Optional<ValueView> result = FindKey(key);
+  if (!result || !(result->is_int() || result->is_double()))
+    return nullopt;
+  return result->GetDouble();
+}
+
+Optional<StringPiece> ValueView::FindStringKey(StringPiece key) const {
+  Optional<ValueView> result = FindKeyOfType(key, Value::Type::STRING);
+  return result ? make_optional(result->GetString()) : nullopt;
+}
+
+Optional<ValueView> ValueView::FindPath(StringPiece path) const {
+  CHECK(is_dict());
+  ValueView current = *this;
+  size_t position = 0;
+  while (position < path.size()) {
+    size_t separator = path.find('.', position);
+    if (separator == StringPiece::npos)
+      separator = path.size();
+    if (!current.is_dict())
+      return nullopt;
+    Optional<ValueView> next =
+        current.FindKey(path.substr(position, separator - position));
+    if (!next)
+      return nullopt;
+    current = *next;
+    position = separator + 1;
+  }
+  return current;
+}
+
+Optional<ValueView> ValueView::FindPath(
+    std::initializer_list<StringPiece> path) const {
+  ValueView current = *this;
+  for (StringPiece component : path) {
+    if (!current.is_dict())
+      return nullopt;
+    Optional<ValueView> next = current.FindKey(component);
+    if (!next)
+      return nullopt;
+    current = *next;
+  }
+  return current;
+}
+
+Optional<ValueView> ValueView::FindPathOfType(StringPiece path,
+                                              Value::Type type) const {
+  Optional<ValueView> result = FindPath(path);
+  if (!result || result->type() != type)
+    return nullopt;
+  return result;
+}
+
+Optional<bool> ValueView::FindBoolPath(StringPiece path) const {
+  Optional<ValueView> result = FindPathOfType(path, Value::Type::BOOLEAN);
+  return result ? make_optional(result->GetBool()) : nullopt;
+}
+
+Optional<int> ValueView::FindIntPath(StringPiece path) const {
+  Optional<ValueView> result = FindPathOfType(path, Value::Type::INTEGER);
+  return result ? make_optional(result->GetInt()) : nullopt;
+}
+
+Optional<double> ValueView::FindDoublePath(StringPiece path) const {
+  Optional<ValueView> result = FindPath(path);
+  if (!result || !(result->is_int() || result->is_double()))
+    return nullopt;
+  return result->GetDouble();
+}
+
+Optional<StringPiece> ValueView::FindStringPath(StringPiece path) const {
+  Optional<ValueView> result = FindPathOfType(path, Value::Type::STRING);
+  return result ? make_optional(result->GetString()) : nullopt;
+}
+
+Value ValueView::ToValue() const {
+  switch (type()) {
+    case Value::Type::NONE:
+      return Value();
+    case Value::Type::BOOLEAN:
+      return Value(GetBool());
+    case Value::Type::INTEGER:
+      return Value(GetInt());
+    case Value::Type::DOUBLE:
+      return Value(GetDouble());
+    case Value::Type::STRING:
+      return Value(GetString());
+    case Value::Type::DICTIONARY: {
+      std::vector<Value::DictStorage::value_type> storage;
+      storage.reserve(node_->size);
+      for (const auto& item : DictItems()) {
+        storage.emplace_back(item.first.as_string(),
+                             std::make_unique<Value>(item.second.ToValue()));
+      }
+      return Value(Value::DictStorage(std::move(storage), KEEP_LAST_OF_DUPES));
+    }
+    case Value::Type::LIST: {
+      Value::ListStorage storage;
+      storage.reserve(node_->size);
+      for (ValueView item : GetList())
+        storage.push_back(item.ToValue());
+      return Value(std::move(storage));
+    }
+    case Value::Type::BINARY:
+      break;
+  }
+  NOTREACHED();
+  return Value();
+}
+
+// JSONDocument::Builder ///////////////////////////////////////////////////////
+
+// Builds the nodes of a document from the structural index of its input, in
+// the same way as the second stage of JSONParser's JSON_USE_STRUCTURAL_INDEX
+// mode. As there, any failure makes the caller fall back to JSONParser, which
+// produces the error information.
+class JSONDocument::Builder {
+ public:
+  Builder(StringPiece input, int options, int max_depth, JSONDocument* document)
+      : input_(input),
+        options_(options),
+        max_depth_(max_depth),
+        string_parser_(options, max_depth),
+        document_(document) {}
+
+  bool Build() {
+    if (!IsValueInRangeForNumericType<int32_t>(input_.size()))
+      return false;
+    if (input_.starts_with(kUTF8ByteOrderMark))
+      input_.remove_prefix(strlen(kUTF8ByteOrderMark));
+    if (!internal::BuildJSONStructuralIndex(input_, &structurals_))
+      return false;
+
+    // Each value takes at least one offset, and each string two.
+    document_->nodes_.reserve(structurals_.size() / 2 + 1);
+    return AppendValue(StringPiece()) &&
+           structural_index_ == structurals_.size();
+  }
+
+ private:
+  char PeekStructural() const {
+    if (structural_index_ == structurals_.size())
+      return '\0';
+    return input_[structurals_[structural_index_]];
+  }
+
+  // Appends a node whose key is |key| and returns its index.
+  size_t AppendNode(Value::Type type, StringPiece key) {
+    internal::JSONDocumentNode node = {};
+    node.type = type;
+    node.subtree_size = 1;
+    node.key = key.data();
+    node.key_length = static_cast<uint32_t>(key.size());
+    document_->nodes_.push_back(node);
+    return document_->nodes_.size() - 1;
+  }
+
+  bool AppendValue(StringPiece key) {
+    switch (PeekStructural()) {
+      case '{':
+        return AppendDictionary(key);
+      case '[':
+        return AppendList(key);
+      case '"': {
+        StringPiece string;
+        if (!ConsumeString(&string))
+          return false;
+        auto& node =
+            document_->nodes_[AppendNode(Value::Type::STRING, key)];
+        node.string_value = string.data();
+        node.size = static_cast<uint32_t>(string.size());
+        return true;
+      }
+      case '\0':
+        return false;
+      default:
+        return AppendScalar(key);
+    }
+  }
+
+  bool AppendDictionary(StringPiece key) {
+    ++structural_index_;  // Opening '{'.
+    AutoReset<int> depth(&depth_, depth_ + 1);
+    if (depth_ >= max_depth_)
+      return false;
+
+    const size_t index = AppendNode(Value::Type::DICTIONARY, key);
+    uint32_t size = 0;
+
+    char c = PeekStructural();
+    while (c != '}') {
+      StringPiece member_key;
+      if (c != '"' || !ConsumeString(&member_key))
+        return false;
+
+      if (PeekStructural() != ':')
+        return false;
+      ++structural_index_;
+
+      if (!AppendValue(member_key))
+        return false;
+      ++size;
+
+      c = PeekStructural();
+      if (c == ',') {
+        ++structural_index_;
+        c = PeekStructural();
+        if (c == '}' && !(options_ & JSON_ALLOW_TRAILING_COMMAS))
+          return false;
+      } else if (c != '}') {
+        return false;
+      }
+    }
+
+    ++structural_index_;  // Closing '}'.
+    FinishContainer(index, size);
+    return true;
+  }
+
+  bool AppendList(StringPiece key) {
+    ++structural_index_;  // Opening '['.
+    AutoReset<int> depth(&depth_, depth_ + 1);
+    if (depth_ >= max_depth_)
+      return false;
+
+    const size_t index = AppendNode(Value::Type::LIST, key);
+    uint32_t size = 0;
+
+    char c = PeekStructural();
+    while (c != ']') {
+      if (!AppendValue(StringPiece()))
+        return false;
+      ++size;
+
+      c = PeekStructural();
+      if (c == ',') {
+        ++structural_index_;
+        c = PeekStructural();
+        if (c == ']' && !(options_ & JSON_ALLOW_TRAILING_COMMAS))
+          return false;
+      } else if (c != ']') {
+        return false;
+      }
+    }
+
+    ++structural_index_;  // Closing ']'.
+    FinishContainer(index, size);
+    return true;
+  }
+
+  void FinishContainer(size_t index, uint32_t size) {
+    auto& node = document_->nodes_[index];
+    node.subtree_size =
+        static_cast<uint32_t>(document_->nodes_.size() - index);
+    node.size = size;
+  }
+
+  bool ConsumeString(StringPiece* out) {
+    const size_t open = structurals_[structural_index_];
+    const size_t close = structurals_[structural_index_ + 1];
+    structural_index_ += 2;
+
+    *out = input_.substr(open + 1, close - open - 1);
+    if (internal::IsVerbatimJSONString(*out))
+      return true;
+
+    // Decode the string token on its own, which fails unless the decoder ends
+    // on the same closing quote as the index.
+    Optional<Value> decoded =
+        string_parser_.Parse(input_.substr(open, close - open + 1));
+    if (!decoded)
+      return false;
+    *out = document_->CopyString(decoded->GetString());
+    return true;
+  }
+
+  bool AppendScalar(StringPiece key) {
+    const size_t start = structurals_[structural_index_++];
+    const size_t end = structural_index_ < structurals_.size()
+                           ? structurals_[structural_index_]
+                           : input_.size();
+    Optional<Value> value = internal::JSONParser::ParseScalarToken(
+        input_.substr(start, end - start));
+    if (!value)
+      return false;
+
+    auto& node = document_->nodes_[AppendNode(value->type(), key)];
+    switch (value->type()) {
+      case Value::Type::BOOLEAN:
+        node.bool_value = value->GetBool();
+        break;
+      case Value::Type::INTEGER:
+        node.int_value = value->GetInt();
+        break;
+      case Value::Type::DOUBLE:
+        node.double_value = value->GetDouble();
+        break;
+      default:
+        break;
+    }
+    return true;
+  }
+
+  StringPiece input_;
+  const int options_;
+  const int max_depth_;
+  int depth_ = 0;
+
+  std::vector<uint32_t> structurals_;
+  size_t structural_index_ = 0;
+
+  // Decodes the strings that cannot be used verbatim.
+  internal::JSONParser string_parser_;
+
+  JSONDocument* const document_;
+
+  DISALLOW_COPY_AND_ASSIGN(Builder);
+};
+
+// JSONDocument ////////////////////////////////////////////////////////////////
+
+JSONDocument::DocumentWithError::DocumentWithError() = default;
+
+JSONDocument::DocumentWithError::DocumentWithError(DocumentWithError&& other) =
+    default;
+
+JSONDocument::DocumentWithError& JSONDocument::DocumentWithError::operator=(
+    DocumentWithError&& other) = default;
+
+JSONDocument::DocumentWithError::~DocumentWithError() = default;
+
+JSONDocument::JSONDocument() = default;
+
+JSONDocument::JSONDocument(JSONDocument&& other) = default;
+
+JSONDocument& JSONDocument::operator=(JSONDocument&& other) = default;
+
+JSONDocument::~JSONDocument() = default;
+
+// static
+Optional<JSONDocument> JSONDocument::Parse(StringPiece json,
+                                           int options,
+                                           int max_depth) {
+  return ParseAndReturnDocumentWithError(json, options, max_depth).document;
+}
+
+// static
+JSONDocument::DocumentWithError JSONDocument::ParseAndReturnDocumentWithError(
+    StringPiece json,
+    int options,
+    int max_depth) {
+  DocumentWithError result;
+  JSONDocument document;
+  if (Builder(json, options, max_depth, &document).Build()) {
+    result.document = std::move(document);
+    return result;
+  }
+
+  // Either |json| is invalid, or it has comments that the structural index
+  // cannot skip. Let JSONParser decide, and copy its result if it succeeds.
+  internal::JSONParser parser(options, max_depth);
+  Optional<Value> value = parser.Parse(json);
+  if (!value) {
+    result.error_code = parser.error_code();
+    result.error_message = parser.GetErrorMessage();
+    result.error_line = parser.error_line();
+    result.error_column = parser.error_column();
+    return result;
+  }
+
+  document.nodes_.clear();
+  document.AppendValue(*value, StringPiece());
+  result.document = std::move(document);
+  return result;
+}
+
+StringPiece JSONDocument::CopyString(StringPiece str) {
+  if (str.size() > chunk_remaining_) {
+    const size_t chunk_size = std::max(kStringChunkSize, str.size());
+    string_chunks_.emplace_back(new char[chunk_size]);
+    chunk_position_ = string_chunks_.back().get();
+    chunk_remaining_ = chunk_size;
+  }
+  char* copy = chunk_position_;
+  memcpy(copy, str.data(), str.size());
+  chunk_position_ += str.size();
+  chunk_remaining_ -= str.size();
+  return StringPiece(copy, str.size());
+}
+
+void JSONDocument::AppendValue(const Value& value, StringPiece key) {
+  const size_t index = nodes_.size();
+  internal::JSONDocumentNode node = {};
+  node.type = value.type();
+  node.subtree_size = 1;
+  const StringPiece key_copy = CopyString(key);
+  node.key = key_copy.data();
+  node.key_length = static_cast<uint32_t>(key_copy.size());
+
+  switch (value.type()) {
+    case Value::Type::NONE:
+      break;
+    case Value::Type::BOOLEAN:
+      node.bool_value = value.GetBool();
+      break;
+    case Value::Type::INTEGER:
+      node.int_value = value.GetInt();
+      break;
+    case Value::Type::DOUBLE:
+      node.double_value = value.GetDouble();
+      break;
+    case Value::Type::STRING: {
+      const StringPiece string = CopyString(value.GetString());
+      node.string_value = string.data();
+      node.size = static_cast<uint32_t>(string.size());
+      break;
+    }
+    case Value::Type::DICTIONARY:
+      node.size = static_cast<uint32_t>(value.DictSize());
+      break;
+    case Value::Type::LIST:
+      node.size = static_cast<uint32_t>(value.GetList().size());
+      break;
+    case Value::Type::BINARY:
+      NOTREACHED();
+      break;
+  }
+  nodes_.push_back(node);
+
+  if (value.is_dict()) {
+    for (const auto& item : value.DictItems())
+      AppendValue(item.second, item.first);
+  } else if (value.is_list()) {
+    for (const Value& item : value.GetList())
+      AppendValue(item, StringPiece());
+  }
+  nodes_[index].subtree_size = static_cast<uint32_t>(nodes_.size() - index);
+}
+
+}  // namespace base
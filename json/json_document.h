@@ -0,0 +1,296 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// JSONDocument is a read-only alternative to JSONReader for callers that only
+// read a few fields out of large inputs. Instead of a tree of heap-allocated
+// Values, the whole document is parsed into a single array of nodes, and
+// strings and dictionary keys are slices of the input buffer. Only strings
+// that contain escape sequences or non-ASCII characters are decoded, into
+// chunks owned by the document.
+//
+// Because of this, a JSONDocument refers to the buffer that it was parsed from
+// and must not outlive it:
+//
+//   Optional<JSONDocument> document = JSONDocument::Parse(payload);
+//   if (!document)
+//     return;
+//   Optional<int> port = document->root().FindIntPath("server.port");
+//   for (ValueView host : document->root().FindKey("hosts")->GetList())
+//     AddHost(host.GetString());
+//
+// Parsing accepts exactly the same inputs as JSONReader with the same options,
+// and reports the same errors.
+
+#ifndef BASE_JSON_JSON_DOCUMENT_H_
+#define BASE_JSON_JSON_DOCUMENT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/json/json_reader.h"
+#include "base/macros.h"
+#include "base/optional.h"
+#include "base/strings/string_piece.h"
+#include "base/values.h"
+
+namespace base {
+
+namespace internal {
+
+// A node of a JSONDocument. Nodes are stored in pre-order, so the children of
+// a list or dictionary immediately follow it, and each child is followed by
+// its own subtree before the next child starts.
+struct JSONDocumentNode {
+  Value::Type type;
+  bool bool_value;
+
+  // The number of nodes in the subtree rooted at this node, including itself.
+  // Adding this to a node's address yields its next sibling.
+  uint32_t subtree_size;
+
+  // The number of children of a list or dictionary, or the length of a
+  // string.
+  uint32_t size;
+
+  // The key of a dictionary member. Unset for other nodes.
+  uint32_t key_length;
+  const char* key;
+
+  union {
+    int int_value;
+    double double_value;
+    const char* string_value;
+  };
+};
+
+}  // namespace internal
+
+// A read-only view of one value in a JSONDocument. Views are cheap to copy and
+// remain valid for as long as the document that they came from. The accessors
+// mirror those of Value.
+class BASE_EXPORT ValueView {
+ public:
+  using Node = internal::JSONDocumentNode;
+
+  // Iterates over the items of a list.
+  class BASE_EXPORT ListView {
+   public:
+    class const_iterator {
+     public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = ValueView;
+      using difference_type = std::ptrdiff_t;
+      using pointer = void;
+      using reference = ValueView;
+
+      explicit const_iterator(const Node* node) : node_(node) {}
+
+      ValueView operator*() const { return ValueView(node_); }
+      const_iterator& operator++() {
+        node_ += node_->subtree_size;
+        return *this;
+      }
+      bool operator==(const const_iterator& other) const {
+        return node_ == other.node_;
+      }
+      bool operator!=(const const_iterator& other) const {
+        return node_ != other.node_;
+      }
+
+     private:
+      const Node* node_;
+    };
+
+    explicit ListView(const Node* list) : list_(list) {}
+
+    const_iterator begin() const { return const_iterator(list_ + 1); }
+    const_iterator end() const {
+      return const_iterator(list_ + list_->subtree_size);
+    }
+    size_t size() const { return list_->size; }
+    bool empty() const { return list_->size == 0; }
+
+   private:
+    const Node* list_;
+  };
+
+  // Iterates over the (key, value) items of a dictionary, in the order in
+  // which they appear in the input, including any duplicate keys. Inputs with
+  // comments are an exception: as with Value, their items are sorted by key
+  // and only the last of any duplicates is kept.
+  class BASE_EXPORT DictView {
+   public:
+    class const_iterator {
+     public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = std::pair<StringPiece, ValueView>;
+      using difference_type = std::ptrdiff_t;
+      using pointer = void;
+      using reference = value_type;
+
+      explicit const_iterator(const Node* node) : node_(node) {}
+
+      value_type operator*() const {
+        return value_type(StringPiece(node_->key, node_->key_length),
+                          ValueView(node_));
+      }
+      const_iterator& operator++() {
+        node_ += node_->subtree_size;
+        return *this;
+      }
+      bool operator==(const const_iterator& other) const {
+        return node_ == other.node_;
+      }
+      bool operator!=(const const_iterator& other) const {
+        return node_ != other.node_;
+      }
+
+     private:
+      const Node* node_;
+    };
+
+    explicit DictView(const Node* dict) : dict_(dict) {}
+
+    const_iterator begin() const { return const_iterator(dict_ + 1); }
+    const_iterator end() const {
+      return const_iterator(dict_ + dict_->subtree_size);
+    }
+    size_t size() const { return dict_->size; }
+    bool empty() const { return dict_->size == 0; }
+
+   private:
+    const Node* dict_;
+  };
+
+  Value::Type type() const { return node_->type; }
+
+  bool is_none() const { return type() == Value::Type::NONE; }
+  bool is_bool() const { return type() == Value::Type::BOOLEAN; }
+  bool is_int() const { return type() == Value::Type::INTEGER; }
+  bool is_double() const { return type() == Value::Type::DOUBLE; }
+  bool is_string() const { return type() == Value::Type::STRING; }
+  bool is_dict() const { return type() == Value::Type::DICTIONARY; }
+  bool is_list() const { return type() == Value::Type::LIST; }
+
+  // These will all CHECK that the type matches.
+  bool GetBool() const;
+  int GetInt() const;
+  double GetDouble() const;  // Implicitly converts from int if necessary.
+  StringPiece GetString() const;
+  ListView GetList() const;
+  DictView DictItems() const;
+
+  // Looks up |key| in this dictionary. If the key appears more than once, the
+  // last occurrence wins, as it does for Value. Lookups are linear in the
+  // number of items of the dictionary.
+  // Note: This CHECKs that type() is Type::DICTIONARY.
+  Optional<ValueView> FindKey(StringPiece key) const;
+  Optional<ValueView> FindKeyOfType(StringPiece key, Value::Type type) const;
+  Optional<bool> FindBoolKey(StringPiece key) const;
+  Optional<int> FindIntKey(StringPiece key) const;
+  // Note FindDoubleKey() will auto-convert INTEGER keys to their double
+  // value, for consistency with GetDouble().
+  Optional<double> FindDoubleKey(StringPiece key) const;
+  Optional<StringPiece> FindStringKey(StringPiece key) const;
+
+  // Searches a hierarchy of dictionaries, as Value::FindPath() does. |path|
+  // uses dots as separators.
+  // Note: This CHECKs that type() is Type::DICTIONARY.
+  Optional<ValueView> FindPath(StringPiece path) const;
+  Optional<ValueView> FindPath(std::initializer_list<StringPiece> path) const;
+  Optional<ValueView> FindPathOfType(StringPiece path, Value::Type type) const;
+  Optional<bool> FindBoolPath(StringPiece path) const;
+  Optional<int> FindIntPath(StringPiece path) const;
+  Optional<double> FindDoublePath(StringPiece path) const;
+  Optional<StringPiece> FindStringPath(StringPiece path) const;
+
+  // Returns a deep copy of this value as a Value.
+  Value ToValue() const;
+
+ private:
+  friend class JSONDocument;
+
+  explicit ValueView(const Node* node) : node_(node) {}
+
+  const Node* node_;
+};
+
+class BASE_EXPORT JSONDocument {
+ public:
+  // Defined below, as it holds a JSONDocument.
+  struct DocumentWithError;
+
+  JSONDocument(JSONDocument&& other);
+  JSONDocument& operator=(JSONDocument&& other);
+  ~JSONDocument();
+
+  // Parses |json| with the given base::JSONParserOptions. Returns nullopt if
+  // |json| is not valid. The returned document refers to |json|, which must
+  // outlive it.
+  static Optional<JSONDocument> Parse(
+      StringPiece json,
+      int options = JSON_PARSE_RFC,
+      int max_depth = JSONReader::kStackMaxDepth);
+
+  // Like Parse(), but also returns the error information if |json| is not
+  // valid.
+  static DocumentWithError ParseAndReturnDocumentWithError(
+      StringPiece json,
+      int options = JSON_PARSE_RFC,
+      int max_depth = JSONReader::kStackMaxDepth);
+
+  // The top-level value of the document.
+  ValueView root() const { return ValueView(nodes_.data()); }
+
+ private:
+  class Builder;
+
+  JSONDocument();
+
+  // Copies |str| into storage owned by the document and returns the copy.
+  StringPiece CopyString(StringPiece str);
+
+  // Appends the nodes for |value|, copying all strings. Used for the inputs
+  // that cannot be parsed directly.
+  void AppendValue(const Value& value, StringPiece key);
+
+  std::vector<internal::JSONDocumentNode> nodes_;
+
+  // Storage for the strings that are not slices of the input.
+  std::vector<std::unique_ptr<char[]>> string_chunks_;
+  char* chunk_position_ = nullptr;
+  size_t chunk_remaining_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(JSONDocument);
+};
+
+struct BASE_EXPORT JSONDocument::DocumentWithError {
+  DocumentWithError();
+  DocumentWithError(DocumentWithError&& other);
+  DocumentWithError& operator=(DocumentWithError&& other);
+  ~DocumentWithError();
+
+  Optional<JSONDocument> document;
+
+  // Contains default values if |document| exists, or the error status if
+  // |document| is base::nullopt.
+  JSONReader::JsonParseError error_code = JSONReader::JSON_NO_ERROR;
+  std::string error_message;
+  int error_line = 0;
+  int error_column = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(DocumentWithError);
+};
+
+}  // namespace base
+
+#endif  // BASE_JSON_JSON_DOCUMENT_H_
@@ -0,0 +1,183 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/json/json_document.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/json/json_reader.h"
+#include "base/stl_util.h"
+#include "base/strings/stringprintf.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+const char kDocument[] = R"({
+  "name": "server",
+  "port": 8080,
+  "ratio": 0.5,
+  "enabled": true,
+  "extra": null,
+  "hosts": ["a.example", "b.example", "caf\u00e9"],
+  "limits": {"cpu": 2, "memory": {"soft": 1024, "hard": 2048}},
+  "escaped": "line\nbreak"
+})";
+
+}  // namespace
+
+TEST(JSONDocumentTest, Accessors) {
+  Optional<JSONDocument> document = JSONDocument::Parse(kDocument);
+  ASSERT_TRUE(document);
+  ValueView root = document->root();
+  ASSERT_TRUE(root.is_dict());
+  EXPECT_EQ(8u, root.DictItems().size());
+
+  EXPECT_EQ("server", root.FindStringKey("name"));
+  EXPECT_EQ(8080, root.FindIntKey("port"));
+  EXPECT_EQ(8080.0, root.FindDoubleKey("port"));
+  EXPECT_EQ(0.5, root.FindDoubleKey("ratio"));
+  EXPECT_EQ(true, root.FindBoolKey("enabled"));
+  EXPECT_TRUE(root.FindKey("extra")->is_none());
+  EXPECT_EQ("line\nbreak", root.FindStringKey("escaped"));
+
+  EXPECT_FALSE(root.FindKey("missing"));
+  EXPECT_FALSE(root.FindIntKey("name"));
+  EXPECT_FALSE(root.FindStringKey("port"));
+  EXPECT_FALSE(root.FindKeyOfType("hosts", Value::Type::DICTIONARY));
+
+  Optional<ValueView> hosts = root.FindKeyOfType("hosts", Value::Type::LIST);
+  ASSERT_TRUE(hosts);
+  std::vector<std::string> host_names;
+  for (ValueView host : hosts->GetList())
+    host_names.push_back(host.GetString().as_string());
+  EXPECT_EQ(std::vector<std::string>({"a.example", "b.example",
+                                      "caf\xC3\xA9"}),
+            host_names);
+}
+
+TEST(JSONDocumentTest, FindPath) {
+  Optional<JSONDocument> document = JSONDocument::Parse(kDocument);
+  ASSERT_TRUE(document);
+  ValueView root = document->root();
+
+  EXPECT_EQ(2, root.FindIntPath("limits.cpu"));
+  EXPECT_EQ(2048, root.FindIntPath("limits.memory.hard"));
+  EXPECT_EQ(1024.0, root.FindDoublePath("limits.memory.soft"));
+  EXPECT_EQ("server", root.FindStringPath("name"));
+  EXPECT_EQ(true, root.FindBoolPath("enabled"));
+  EXPECT_EQ(1024, root.FindPath({"limits", "memory", "soft"})->GetInt());
+  EXPECT_TRUE(root.FindPathOfType("limits.memory", Value::Type::DICTIONARY));
+
+  EXPECT_FALSE(root.FindPath("limits.disk"));
+  EXPECT_FALSE(root.FindPath("port.value"));
+  EXPECT_FALSE(root.FindPath({"hosts", "0"}));
+  EXPECT_FALSE(root.FindIntPath("limits.memory"));
+}
+
+TEST(JSONDocumentTest, StringsReferToInput) {
+  const std::string json = R"({"plain": "abc", "escaped": "a\"c"})";
+  Optional<JSONDocument> document = JSONDocument::Parse(json);
+  ASSERT_TRUE(document);
+
+  StringPiece plain = *document->root().FindStringKey("plain");
+  EXPECT_EQ("abc", plain);
+  EXPECT_GE(plain.data(), json.data());
+  EXPECT_LT(plain.data(), json.data() + json.size());
+
+  StringPiece escaped = *document->root().FindStringKey("escaped");
+  EXPECT_EQ("a\"c", escaped);
+  EXPECT_TRUE(escaped.data() < json.data() ||
+              escaped.data() >= json.data() + json.size());
+}
+
+TEST(JSONDocumentTest, DictItemsInInputOrder) {
+  Optional<JSONDocument> document =
+      JSONDocument::Parse(R"({"b": 1, "a": 2, "b": 3})");
+  ASSERT_TRUE(document);
+
+  std::vector<std::pair<std::string, int>> items;
+  for (const auto& item : document->root().DictItems())
+    items.emplace_back(item.first.as_string(), item.second.GetInt());
+  EXPECT_EQ((std::vector<std::pair<std::string, int>>{
+                {"b", 1}, {"a", 2}, {"b", 3}}),
+            items);
+
+  // As with Value, the last of duplicate keys wins.
+  EXPECT_EQ(3, document->root().FindIntKey("b"));
+}
+
+TEST(JSONDocumentTest, ToValueMatchesJSONReader) {
+  const char* const kCases[] = {
+      kDocument,
+      "[]",
+      "{}",
+      "\"top-level string\"",
+      "-12.5e3",
+      "[1, [2, [3, {\"four\": [5]}]], {}, []]",
+      "\xEF\xBB\xBF{\"bom\": true}",
+      // Comments are handled by falling back to JSONReader.
+      "{\"a\": 1, /* comment */ \"b\": [\"x\", // comment\n \"y\"]}",
+  };
+
+  for (unsigned int i = 0; i < base::size(kCases); ++i) {
+    SCOPED_TRACE(StringPrintf("case %u: \"%s\"", i, kCases[i]));
+    Optional<JSONDocument> document = JSONDocument::Parse(kCases[i]);
+    Optional<Value> value = JSONReader::Read(kCases[i]);
+    ASSERT_TRUE(document);
+    ASSERT_TRUE(value);
+    EXPECT_EQ(*value, document->root().ToValue());
+  }
+}
+
+TEST(JSONDocumentTest, Errors) {
+  const char* const kCases[] = {
+      "", "[1, 2", "{\"a\" 1}", "[1,]", "[\"\\q\"]", "[01]", "{a: 1}",
+      "[1] 2", "[\"\\ud800\"]", "/* unterminated",
+  };
+
+  for (unsigned int i = 0; i < base::size(kCases); ++i) {
+    SCOPED_TRACE(StringPrintf("case %u: \"%s\"", i, kCases[i]));
+    JSONDocument::DocumentWithError document =
+        JSONDocument::ParseAndReturnDocumentWithError(kCases[i]);
+    JSONReader::ValueWithError value =
+        JSONReader::ReadAndReturnValueWithError(kCases[i], JSON_PARSE_RFC);
+    EXPECT_FALSE(document.document);
+    EXPECT_FALSE(value.value);
+    EXPECT_EQ(value.error_code, document.error_code);
+    EXPECT_EQ(value.error_message, document.error_message);
+    EXPECT_EQ(value.error_line, document.error_line);
+    EXPECT_EQ(value.error_column, document.error_column);
+  }
+}
+
+TEST(JSONDocumentTest, Options) {
+  EXPECT_FALSE(JSONDocument::Parse("[1, 2,]"));
+  EXPECT_TRUE(JSONDocument::Parse("[1, 2,]", JSON_ALLOW_TRAILING_COMMAS));
+
+  EXPECT_FALSE(JSONDocument::Parse("[\"\\ufffe\"]"));
+  Optional<JSONDocument> document =
+      JSONDocument::Parse("[\"\\ufffe\"]", JSON_REPLACE_INVALID_CHARACTERS);
+  ASSERT_TRUE(document);
+  EXPECT_EQ("\xEF\xBF\xBD", (*document->root().GetList().begin()).GetString());
+
+  EXPECT_TRUE(JSONDocument::Parse("[[[1]]]"));
+  EXPECT_FALSE(JSONDocument::Parse("[[[1]]]", JSON_PARSE_RFC, 3));
+}
+
+TEST(JSONDocumentTest, ViewsSurviveMove) {
+  Optional<JSONDocument> document = JSONDocument::Parse(kDocument);
+  ASSERT_TRUE(document);
+  ValueView limits = *document->root().FindKey("limits");
+  JSONDocument moved = std::move(*document);
+  document.reset();
+  EXPECT_EQ(2, limits.FindIntKey("cpu"));
+  EXPECT_EQ(2048, moved.root().FindIntPath("limits.memory.hard"));
+}
+
+}  // namespace base
@@ -8,6 +8,7 @@
 #include <utility>
 #include <vector>
 
+#include "base/json/json_structural_index.h"
 #include "base/logging.h"
 #include "base/macros.h"
 #include "base/numerics/safe_conversions.h"
@@ -60,6 +61,7 @@ JSONParser::JSONParser(int options, int max_depth)
       max_depth_(max_depth),
       index_(0),
       stack_depth_(0),
+      structural_index_(0),
       line_number_(0),
       index_last_line_(0),
       error_code_(JSONReader::JSON_NO_ERROR),
@@ -92,6 +94,20 @@ Optional<Value> JSONParser::Parse(StringPiece input) {
   // treating a Unicode BOM as an invalid character and returning NULL.
   ConsumeIfMatch("\xEF\xBB\xBF");
 
+  if (options_ & JSON_USE_STRUCTURAL_INDEX) {
+    const int start_index = index_;
+    Optional<Value> root = ParseWithStructuralIndex();
+    if (root)
+      return root;
+
+    // The indexed parser does not track lines and columns, so let the regular
+    // parser start over to find the error, if there is one.
+    index_ = start_index;
+    error_code_ = JSONReader::JSON_NO_ERROR;
+    error_line_ = 0;
+    error_column_ = 0;
+  }
+
   // Parse the first and any nested tokens.
   Optional<Value> root(ParseNextToken());
   if (!root)
@@ -130,6 +146,9 @@ JSONParser::StringBuilder::StringBuilder() : StringBuilder(nullptr) {}
 JSONParser::StringBuilder::StringBuilder(const char* pos)
     : pos_(pos), length_(0) {}
 
+JSONParser::StringBuilder::StringBuilder(const char* pos, size_t length)
+    : pos_(pos), length_(length) {}
+
 JSONParser::StringBuilder::~StringBuilder() = default;
 
 JSONParser::StringBuilder& JSONParser::StringBuilder::operator=(
@@ -675,19 +694,7 @@ Optional<Value> JSONParser::ConsumeNumber() {
 
   index_ = exit_index;
 
-  StringPiece num_string(num_start, end_index - start_index);
-
-  int num_int;
-  if (StringToInt(num_string, &num_int))
-    return Value(num_int);
-
-  double num_double;
-  if (StringToDouble(num_string.as_string(), &num_double) &&
-      std::isfinite(num_double)) {
-    return Value(num_double);
-  }
-
-  return nullopt;
+  return ConvertNumber(StringPiece(num_start, end_index - start_index));
 }
 
 bool JSONParser::ReadInt(bool allow_leading_zeros) {
@@ -714,6 +721,21 @@ bool JSONParser::ReadInt(bool allow_leading_zeros) {
   return true;
 }
 
+// static
+Optional<Value> JSONParser::ConvertNumber(StringPiece num_string) {
+  int num_int;
+  if (StringToInt(num_string, &num_int))
+    return Value(num_int);
+
+  double num_double;
+  if (StringToDouble(num_string.as_string(), &num_double) &&
+      std::isfinite(num_double)) {
+    return Value(num_double);
+  }
+
+  return nullopt;
+}
+
 Optional<Value> JSONParser::ConsumeLiteral() {
   if (ConsumeIfMatch("true"))
     return Value(true);
@@ -725,6 +747,208 @@ Optional<Value> JSONParser::ConsumeLiteral() {
   return nullopt;
 }
 
+// Structural index ////////////////////////////////////////////////////////////
+
+Optional<Value> JSONParser::ParseWithStructuralIndex() {
+  const StringPiece input = input_.substr(index_);
+  if (!BuildJSONStructuralIndex(input, &structurals_))
+    return nullopt;
+  // The offsets are relative to |input|, which may have skipped a BOM.
+  if (index_ > 0) {
+    for (uint32_t& offset : structurals_)
+      offset += index_;
+  }
+  structural_index_ = 0;
+
+  Optional<Value> root = ParseIndexedToken();
+  if (!root || structural_index_ != structurals_.size())
+    return nullopt;
+  return root;
+}
+
+char JSONParser::PeekStructural() const {
+  if (structural_index_ == structurals_.size())
+    return '\0';
+  return input_[structurals_[structural_index_]];
+}
+
+Optional<Value> JSONParser::ParseIndexedToken() {
+  switch (PeekStructural()) {
+    case '{':
+      return ConsumeIndexedDictionary();
+    case '[':
+      return ConsumeIndexedList();
+    case '"': {
+      StringBuilder string;
+      if (!ConsumeIndexedString(&string))
+        return nullopt;
+      return Value(string.DestructiveAsString());
+    }
+    case '\0':
+      return nullopt;
+    default:
+      return ConsumeIndexedScalar();
+  }
+}
+
+Optional<Value> JSONParser::ConsumeIndexedDictionary() {
+  ++structural_index_;  // Opening '{'.
+
+  StackMarker depth_check(max_depth_, &stack_depth_);
+  if (depth_check.IsTooDeep())
+    return nullopt;
+
+  std::vector<Value::DictStorage::value_type> dict_storage;
+
+  char c = PeekStructural();
+  while (c != '}') {
+    StringBuilder key;
+    if (c != '"' || !ConsumeIndexedString(&key))
+      return nullopt;
+
+    if (PeekStructural() != ':')
+      return nullopt;
+    ++structural_index_;
+
+    Optional<Value> value = ParseIndexedToken();
+    if (!value)
+      return nullopt;
+
+    dict_storage.emplace_back(key.DestructiveAsString(),
+                              std::make_unique<Value>(std::move(*value)));
+
+    c = PeekStructural();
+    if (c == ',') {
+      ++structural_index_;
+      c = PeekStructural();
+      if (c == '}' && !(options_ & JSON_ALLOW_TRAILING_COMMAS))
+        return nullopt;
+    } else if (c != '}') {
+      return nullopt;
+    }
+  }
+
+  ++structural_index_;  // Closing '}'.
+
+  return Value(Value::DictStorage(std::move(dict_storage), KEEP_LAST_OF_DUPES));
+}
+
+Optional<Value> JSONParser::ConsumeIndexedList() {
+  ++structural_index_;  // Opening '['.
+
+  StackMarker depth_check(max_depth_, &stack_depth_);
+  if (depth_check.IsTooDeep())
+    return nullopt;
+
+  Value::ListStorage list_storage;
+
+  char c = PeekStructural();
+  while (c != ']') {
+    Optional<Value> item = ParseIndexedToken();
+    if (!item)
+      return nullopt;
+
+    list_storage.push_back(std::move(*item));
+
+    c = PeekStructural();
+    if (c == ',') {
+      ++structural_index_;
+      c = PeekStructural();
+      if (c == ']' && !(options_ & JSON_ALLOW_TRAILING_COMMAS))
+        return nullopt;
+    } else if (c != ']') {
+      return nullopt;
+    }
+  }
+
+  ++structural_index_;  // Closing ']'.
+
+  return Value(std::move(list_storage));
+}
+
+bool JSONParser::ConsumeIndexedString(StringBuilder* out) {
+  // The index records both quotes of every string, so the closing quote is
+  // always the very next offset.
+  DCHECK_LT(structural_index_ + 1, structurals_.size());
+  const size_t open = structurals_[structural_index_];
+  const size_t close = structurals_[structural_index_ + 1];
+  structural_index_ += 2;
+
+  const char* const start = input_.data() + open + 1;
+  const size_t length = close - open - 1;
+  if (IsVerbatimJSONString(StringPiece(start, length))) {
+    *out = StringBuilder(start, length);
+    return true;
+  }
+
+  // Escapes and multi-byte characters need the full decoder, which must end
+  // on the same closing quote as the index.
+  index_ = static_cast<int>(open);
+  return ConsumeStringRaw(out) && static_cast<size_t>(index_) == close + 1;
+}
+
+Optional<Value> JSONParser::ConsumeIndexedScalar() {
+  const size_t start = structurals_[structural_index_++];
+  const size_t end = structural_index_ < structurals_.size()
+                         ? structurals_[structural_index_]
+                         : input_.length();
+  return ParseScalarToken(StringPiece(input_.data() + start, end - start));
+}
+
+// static
+Optional<Value> JSONParser::ParseScalarToken(StringPiece text) {
+  // The token runs up to the whitespace, if any, before the next structural
+  // character. It cannot contain whitespace itself, as that would have
+  // started another token.
+  size_t end = text.size();
+  while (end > 0 && (text[end - 1] == ' ' || text[end - 1] == '\t' ||
+                     text[end - 1] == '\n' || text[end - 1] == '\r')) {
+    --end;
+  }
+  const StringPiece token = text.substr(0, end);
+
+  if (token == "true")
+    return Value(true);
+  if (token == "false")
+    return Value(false);
+  if (token == "null")
+    return Value(Value::Type::NONE);
+
+  // Match the grammar accepted by ConsumeNumber(): an optional minus sign, an
+  // integer part without leading zeros, and optional fraction and exponent
+  // parts.
+  size_t i = 0;
+  auto read_digits = [&token, &i]() {
+    const size_t digits_start = i;
+    while (i < token.size() && IsAsciiDigit(token[i]))
+      ++i;
+    return i - digits_start;
+  };
+
+  if (i < token.size() && token[i] == '-')
+    ++i;
+  const size_t int_start = i;
+  const size_t int_length = read_digits();
+  if (int_length == 0 || (int_length > 1 && token[int_start] == '0'))
+    return nullopt;
+  if (i < token.size() && token[i] == '.') {
+    ++i;
+    if (read_digits() == 0)
+      return nullopt;
+  }
+  if (i < token.size() && (token[i] == 'e' || token[i] == 'E')) {
+    ++i;
+    if (i < token.size() && (token[i] == '-' || token[i] == '+'))
+      ++i;
+    if (read_digits() == 0)
+      return nullopt;
+  }
+  if (i != token.size())
+    return nullopt;
+
+  return ConvertNumber(token);
+}
+
 bool JSONParser::ConsumeIfMatch(StringPiece match) {
   if (match == PeekChars(match.size())) {
     ConsumeChars(match.size());
@@ -10,6 +10,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "base/base_export.h"
 #include "base/compiler_specific.h"
@@ -66,6 +67,12 @@ class BASE_EXPORT JSONParser {
   // returns 0.
   int error_column() const;
 
+  // Parses |text|, the bytes from the start of a number or literal token up to
+  // the next offset found by BuildJSONStructuralIndex(), into a Value.
+  // Trailing whitespace is ignored. Returns nullopt unless the rest of |text|
+  // is exactly one valid token. Also used by JSONDocument.
+  static Optional<Value> ParseScalarToken(StringPiece text);
+
  private:
   enum Token {
     T_OBJECT_BEGIN,           // {
@@ -96,6 +103,10 @@ class BASE_EXPORT JSONParser {
     // |pos| is the beginning of an input string, excluding the |"|.
     explicit StringBuilder(const char* pos);
 
+    // Creates a builder for the |length| bytes at |pos|, which must not need
+    // any decoding.
+    StringBuilder(const char* pos, size_t length);
+
     ~StringBuilder();
 
     StringBuilder& operator=(StringBuilder&& other);
@@ -191,10 +202,45 @@ class BASE_EXPORT JSONParser {
   // read and false on error.
   bool ReadInt(bool allow_leading_zeros);
 
+  // Converts the text of a valid JSON number to an int Value if it fits, or to
+  // a double Value otherwise. Returns nullopt if the double is not finite.
+  static Optional<Value> ConvertNumber(StringPiece num_string);
+
   // Consumes the literal values of |true|, |false|, and |null|, assuming the
   // parser is wound to the first character of any of those.
   Optional<Value> ConsumeLiteral();
 
+  // The second stage of the JSON_USE_STRUCTURAL_INDEX mode, which walks the
+  // offsets in |structurals_| instead of the input bytes. These functions do
+  // not report errors: any failure returns nullopt (or false) and the input is
+  // then re-parsed by the byte-at-a-time functions above, which produce the
+  // error information. Each function is entered with |structural_index_| on
+  // the structural character that starts its value, and exits past the last
+  // structural character of that value.
+
+  // Builds the structural index and parses the whole input from it.
+  Optional<Value> ParseWithStructuralIndex();
+
+  // Returns the character at the next structural offset, or '\0' if the
+  // index is exhausted.
+  char PeekStructural() const;
+
+  // Parses the value that starts at the next structural offset.
+  Optional<Value> ParseIndexedToken();
+
+  // Indexed counterparts of ConsumeDictionary() and ConsumeList().
+  Optional<Value> ConsumeIndexedDictionary();
+  Optional<Value> ConsumeIndexedList();
+
+  // Parses the string whose opening and closing quotes are the next two
+  // structural offsets. Strings with escapes or non-ASCII characters are
+  // handed to ConsumeStringRaw().
+  bool ConsumeIndexedString(StringBuilder* out);
+
+  // Parses the number or literal that starts at the next structural offset and
+  // extends up to the whitespace before the following one.
+  Optional<Value> ConsumeIndexedScalar();
+
   // Helper function that returns true if the byte squence |match| can be
   // consumed at the current parser position. Returns false if there are fewer
   // than |match|-length bytes or if the sequence does not match, and the
@@ -226,6 +272,11 @@ class BASE_EXPORT JSONParser {
   // The number of times the parser has recursed (current stack depth).
   int stack_depth_;
 
+  // The offsets found by BuildJSONStructuralIndex(), and the position in it to
+  // which the JSON_USE_STRUCTURAL_INDEX parser is wound.
+  std::vector<uint32_t> structurals_;
+  size_t structural_index_;
+
   // The line number that the parser is at currently.
   int line_number_;
 
@@ -441,5 +441,106 @@ TEST_F(JSONParserTest, UnterminatedInputs) {
   }
 }
 
+TEST_F(JSONParserTest, StructuralIndexMatchesRegularParser) {
+  const char* const kCases[] = {
+      // clang-format off
+      // Valid inputs, which are parsed from the index.
+      "{\"a\": [1, -2.5, 3e2, true, false, null], \"b\": {\"c\": \"d\"}}",
+      "  [ \"\\\"quoted\\\"\", \"tab\\there\", \"\\\\\" ] ",
+      "[\"\\u00e9\\ud83d\\ude00\"]",
+      "\"caf\xC3\xA9\"",
+      "\xEF\xBB\xBF{\"bom\": 1}",
+      "{\"dupe\": 1, \"dupe\": 2}",
+      "2147483648",
+      "-0",
+      "[[[[[]]]]]",
+      // Inputs with comments, which fall back to the regular parser.
+      "[1, /* two */ 2]",
+      "// comment\n{\"a\": 1}",
+      "[\"/not a comment/\"]",
+      // Invalid inputs, which must report the same errors.
+      "",
+      "   ",
+      "[1 2]",
+      "[1,]",
+      "{\"a\": 1,}",
+      "{\"a\" 1}",
+      "{a: 1}",
+      "[\"unterminated]",
+      "[\"\\q\"]",
+      "[01]",
+      "[1.]",
+      "[.5]",
+      "[+1]",
+      "[truex]",
+      "[true false]",
+      "[1\"a\"]",
+      "\\\"x\"",
+      "[\"a\"]\n\n  ]",
+      "[1e400]",
+      "{\"a\":\n\t[1,\n\"\\ud800\"]}",
+      "[\"\xFF\"]",
+      // clang-format on
+  };
+
+  for (unsigned int i = 0; i < base::size(kCases); ++i) {
+    SCOPED_TRACE(StringPrintf("case %u: \"%s\"", i, kCases[i]));
+    for (int options : {JSON_PARSE_RFC, JSON_ALLOW_TRAILING_COMMAS,
+                        JSON_REPLACE_INVALID_CHARACTERS}) {
+      std::unique_ptr<char[]> input_owner;
+      StringPiece input = MakeNotNullTerminatedInput(kCases[i], &input_owner);
+
+      JSONReader::ValueWithError expected =
+          JSONReader::ReadAndReturnValueWithError(input, options);
+      JSONReader::ValueWithError actual =
+          JSONReader::ReadAndReturnValueWithError(
+              input, options | JSON_USE_STRUCTURAL_INDEX);
+
+      ASSERT_EQ(expected.value.has_value(), actual.value.has_value());
+      if (expected.value)
+        EXPECT_EQ(*expected.value, *actual.value);
+      EXPECT_EQ(expected.error_code, actual.error_code);
+      EXPECT_EQ(expected.error_message, actual.error_message);
+      EXPECT_EQ(expected.error_line, actual.error_line);
+      EXPECT_EQ(expected.error_column, actual.error_column);
+    }
+  }
+}
+
+TEST_F(JSONParserTest, StructuralIndexBlockBoundaries) {
+  // Moves runs of backslashes and quotes across the 64-byte blocks that the
+  // index is built from.
+  for (size_t padding = 0; padding < 70; ++padding) {
+    for (size_t backslashes = 1; backslashes <= 4; ++backslashes) {
+      std::string json = "[\"" + std::string(padding, 'x') +
+                         std::string(backslashes, '\\') + "\"\", 1]";
+      SCOPED_TRACE(json);
+      JSONReader::ValueWithError expected =
+          JSONReader::ReadAndReturnValueWithError(json, JSON_PARSE_RFC);
+      JSONReader::ValueWithError actual =
+          JSONReader::ReadAndReturnValueWithError(json,
+                                                  JSON_USE_STRUCTURAL_INDEX);
+      ASSERT_EQ(expected.value.has_value(), actual.value.has_value());
+      if (expected.value)
+        EXPECT_EQ(*expected.value, *actual.value);
+      EXPECT_EQ(expected.error_code, actual.error_code);
+      EXPECT_EQ(expected.error_column, actual.error_column);
+    }
+  }
+}
+
+TEST_F(JSONParserTest, StructuralIndexMaxDepth) {
+  std::string nested = std::string(JSONReader::kStackMaxDepth, '[') +
+                       std::string(JSONReader::kStackMaxDepth, ']');
+  EXPECT_FALSE(JSONReader::Read(nested, JSON_USE_STRUCTURAL_INDEX));
+
+  JSONReader::ValueWithError root = JSONReader::ReadAndReturnValueWithError(
+      "[[[1]]]", JSON_USE_STRUCTURAL_INDEX);
+  EXPECT_TRUE(root.value);
+  JSONParser parser(JSON_USE_STRUCTURAL_INDEX, 3);
+  EXPECT_FALSE(parser.Parse("[[[1]]]"));
+  EXPECT_EQ(JSONReader::JSON_TOO_MUCH_NESTING, parser.error_code());
+}
+
 }  // namespace internal
 }  // namespace base
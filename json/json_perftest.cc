@@ -3,6 +3,7 @@
 // found in the LICENSE file.
 
 #include "base/json/json_reader.h"
+#include "base/json/json_streaming_parser.h"
 #include "base/json/json_writer.h"
 #include "base/memory/ptr_util.h"
 #include "base/strings/string_number_conversions.h"
@@ -49,6 +50,27 @@ DictionaryValue GenerateLayeredDict(int breadth, int depth) {
   return root;
 }
 
+// Counts the top-level values reported by a JSONStreamingParser.
+class RecordCounter : public JSONStreamingParser::Delegate {
+ public:
+  void OnDictionaryStart() override {}
+  void OnDictionaryEnd() override {}
+  void OnListStart() override {}
+  void OnListEnd() override {}
+  void OnKey(StringPiece key) override {}
+  void OnNull() override {}
+  void OnBool(bool value) override {}
+  void OnInt(int value) override {}
+  void OnDouble(double value) override {}
+  void OnString(StringPiece value) override {}
+  void OnRootValueEnd() override { ++records_; }
+
+  int records() const { return records_; }
+
+ private:
+  int records_ = 0;
+};
+
 }  // namespace
 
 class JSONPerfTest : public testing::Test {
@@ -73,6 +95,45 @@ class JSONPerfTest : public testing::Test {
                            (end_read - start_read).InMillisecondsF(), "ms",
                            true);
   }
+
+  // Reads |json| with and without JSON_USE_STRUCTURAL_INDEX, reporting the
+  // time taken and the throughput of each.
+  void TestReadModes(const std::string& json, const std::string& description) {
+    const struct {
+      const char* name;
+      int options;
+    } kModes[] = {
+        {"ReadBytewise", JSON_PARSE_RFC},
+        {"ReadStructuralIndex", JSON_USE_STRUCTURAL_INDEX},
+    };
+    for (const auto& mode : kModes) {
+      TimeTicks start_read = TimeTicks::Now();
+      Optional<Value> value = JSONReader::Read(json, mode.options);
+      TimeTicks end_read = TimeTicks::Now();
+      ASSERT_TRUE(value);
+
+      const double ms = (end_read - start_read).InMillisecondsF();
+      perf_test::PrintResult(mode.name, "", description, ms, "ms", true);
+      perf_test::PrintResult(mode.name, "_throughput", description,
+                             json.size() / (ms * 1000.0), "MB/s", true);
+    }
+  }
+
+  // Writes |value| several times, reporting the time taken per write and the
+  // throughput.
+  void TestWrite(const Value& value, const std::string& description) {
+    constexpr int kIterations = 10;
+    std::string json;
+    TimeTicks start_write = TimeTicks::Now();
+    for (int i = 0; i < kIterations; ++i)
+      ASSERT_TRUE(JSONWriter::Write(value, &json));
+    TimeTicks end_write = TimeTicks::Now();
+
+    const double ms = (end_write - start_write).InMillisecondsF() / kIterations;
+    perf_test::PrintResult("Write", "", description, ms, "ms", true);
+    perf_test::PrintResult("Write", "_throughput", description,
+                           json.size() / (ms * 1000.0), "MB/s", true);
+  }
 };
 
 // Times out on Android (crbug.com/906686).
@@ -89,4 +150,75 @@ TEST_F(JSONPerfTest, MAYBE_StressTest) {
   }
 }
 
+TEST_F(JSONPerfTest, StructuralIndexLayeredDict) {
+  std::string json;
+  JSONWriter::WriteWithOptions(GenerateLayeredDict(4, 8),
+                               JSONWriter::OPTIONS_PRETTY_PRINT, &json);
+  TestReadModes(json,
+                "Layered dict, " + NumberToString(json.size()) + " bytes");
+}
+
+TEST_F(JSONPerfTest, StructuralIndexStrings) {
+  // Long strings are where skipping ahead by the index pays off the most.
+  ListValue list;
+  for (int i = 0; i < 20000; ++i) {
+    list.GetList().emplace_back(std::string(100 + i % 200, 'a' + i % 26));
+    list.GetList().emplace_back("escaped \"" + NumberToString(i) + "\"");
+  }
+  std::string json;
+  JSONWriter::Write(list, &json);
+  TestReadModes(json, "Strings, " + NumberToString(json.size()) + " bytes");
+}
+
+TEST_F(JSONPerfTest, WriteDoubles) {
+  ListValue list;
+  for (int i = 0; i < 200000; ++i)
+    list.GetList().emplace_back(i * 1.1 + 1.0 / (i + 3));
+  TestWrite(list, "Doubles");
+}
+
+TEST_F(JSONPerfTest, WriteStrings) {
+  // Mostly strings that need no escaping, as is typical.
+  ListValue list;
+  for (int i = 0; i < 100000; ++i) {
+    list.GetList().emplace_back(std::string(20 + i % 100, 'a' + i % 26));
+    if (i % 10 == 0)
+      list.GetList().emplace_back("line\nbreak <tag> \"quoted\"");
+  }
+  TestWrite(list, "Strings");
+}
+
+TEST_F(JSONPerfTest, WriteLayeredDict) {
+  TestWrite(GenerateLayeredDict(4, 8), "Layered dict");
+}
+
+TEST_F(JSONPerfTest, StreamingNewlineDelimited) {
+  // Newline-delimited records, fed in chunks as if read from a file.
+  constexpr int kRecords = 50000;
+  constexpr size_t kChunkSize = 64 * 1024;
+  std::string json;
+  for (int i = 0; i < kRecords; ++i) {
+    std::string record;
+    JSONWriter::Write(GenerateDict(), &record);
+    json += record + "\n";
+  }
+  const std::string description =
+      "Records, " + NumberToString(json.size()) + " bytes";
+
+  TimeTicks start_read = TimeTicks::Now();
+  RecordCounter counter;
+  JSONStreamingParser parser(&counter, JSON_PARSE_RFC,
+                             JSONStreamingParser::InputMode::kValueSequence);
+  for (size_t offset = 0; offset < json.size(); offset += kChunkSize)
+    ASSERT_TRUE(parser.Feed(StringPiece(json).substr(offset, kChunkSize)));
+  ASSERT_TRUE(parser.Finish());
+  TimeTicks end_read = TimeTicks::Now();
+  EXPECT_EQ(kRecords, counter.records());
+
+  const double ms = (end_read - start_read).InMillisecondsF();
+  perf_test::PrintResult("ReadStreaming", "", description, ms, "ms", true);
+  perf_test::PrintResult("ReadStreaming", "_throughput", description,
+                         json.size() / (ms * 1000.0), "MB/s", true);
+}
+
 }  // namespace base
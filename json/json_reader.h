@@ -54,6 +54,14 @@ enum JSONParserOptions {
   // character (U+FFFD). If not set, invalid characters trigger a hard error and
   // parsing fails.
   JSON_REPLACE_INVALID_CHARACTERS = 1 << 1,
+
+  // Parses in two stages: a vectorized pass first indexes the structural
+  // characters of the whole input, and the Value tree is then built by walking
+  // that index rather than the input bytes. This is considerably faster on
+  // large documents. The result, including any error information, is the same
+  // as without this option; inputs that the index cannot describe (such as
+  // those with comments) and invalid inputs are handed to the regular parser.
+  JSON_USE_STRUCTURAL_INDEX = 1 << 2,
 };
 
 class BASE_EXPORT JSONReader {
@@ -0,0 +1,384 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/json/json_streaming_parser.h"
+
+#include <string.h>
+
+#include "base/json/json_structural_index.h"
+#include "base/logging.h"
+#include "base/strings/stringprintf.h"
+#include "base/values.h"
+
+namespace base {
+
+namespace {
+
+const char kUTF8ByteOrderMark[] = "\xEF\xBB\xBF";
+
+// Returns true if |c| ends a number or literal.
+bool IsDelimiter(char c) {
+  switch (c) {
+    case ' ':
+    case '\t':
+    case '\n':
+    case '\r':
+    case ',':
+    case ':':
+    case '[':
+    case ']':
+    case '{':
+    case '}':
+    case '"':
+    case '/':
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // namespace
+
+JSONStreamingParser::JSONStreamingParser(Delegate* delegate,
+                                         int options,
+                                         InputMode mode,
+                                         int max_depth)
+    : delegate_(delegate),
+      options_(options),
+      mode_(mode),
+      max_depth_(max_depth),
+      string_parser_(options, max_depth) {
+  DCHECK(delegate_);
+  CHECK_LE(max_depth, JSONReader::kStackMaxDepth);
+}
+
+JSONStreamingParser::~JSONStreamingParser() = default;
+
+bool JSONStreamingParser::Feed(StringPiece chunk) {
+  if (error_code_ != JSONReader::JSON_NO_ERROR)
+    return false;
+
+  token_start_ = 0;
+  for (size_t i = 0; i < chunk.size(); ++i) {
+    const char c = chunk[i];
+    ++column_;
+
+    if (at_start_) {
+      if (c == kUTF8ByteOrderMark[byte_order_mark_length_]) {
+        if (++byte_order_mark_length_ == strlen(kUTF8ByteOrderMark))
+          at_start_ = false;
+        continue;
+      }
+      if (byte_order_mark_length_ > 0)
+        return ReportErrorAtCurrentByte(JSONReader::JSON_UNEXPECTED_TOKEN);
+      at_start_ = false;
+    }
+
+    switch (lex_state_) {
+      case LexState::kBetweenTokens:
+        if (!ConsumeByte(c, i))
+          return false;
+        break;
+      case LexState::kString:
+        if (escape_pending_) {
+          escape_pending_ = false;
+        } else if (c == '\\') {
+          escape_pending_ = true;
+        } else if (c == '"') {
+          lex_state_ = LexState::kBetweenTokens;
+          const bool success = ConsumeString(FinishToken(chunk, i + 1));
+          token_.clear();
+          if (!success)
+            return false;
+        }
+        break;
+      case LexState::kScalar: {
+        if (!IsDelimiter(c))
+          break;
+        lex_state_ = LexState::kBetweenTokens;
+        const bool success = ConsumeScalar(FinishToken(chunk, i));
+        token_.clear();
+        if (!success || !ConsumeByte(c, i))
+          return false;
+        break;
+      }
+      case LexState::kSlash:
+        if (c == '/')
+          lex_state_ = LexState::kLineComment;
+        else if (c == '*')
+          lex_state_ = LexState::kBlockComment;
+        else
+          return ReportErrorAtToken(JSONReader::JSON_UNEXPECTED_TOKEN);
+        break;
+      case LexState::kLineComment:
+        if (c == '\n' || c == '\r')
+          lex_state_ = LexState::kBetweenTokens;
+        break;
+      case LexState::kBlockComment:
+        if (c == '*')
+          lex_state_ = LexState::kBlockCommentStar;
+        break;
+      case LexState::kBlockCommentStar:
+        if (c == '/')
+          lex_state_ = LexState::kBetweenTokens;
+        else if (c != '*')
+          lex_state_ = LexState::kBlockComment;
+        break;
+    }
+
+    if (c == '\n' || c == '\r') {
+      // Don't count "\r\n" as two lines.
+      if (c == '\r' || !previous_byte_was_cr_)
+        ++line_;
+      column_ = 0;
+    }
+    previous_byte_was_cr_ = c == '\r';
+  }
+
+  // Keep the start of a token that continues in the next chunk.
+  if (lex_state_ == LexState::kString || lex_state_ == LexState::kScalar)
+    token_.append(chunk.data() + token_start_, chunk.size() - token_start_);
+  return true;
+}
+
+bool JSONStreamingParser::Finish() {
+  if (error_code_ != JSONReader::JSON_NO_ERROR)
+    return false;
+
+  if (at_start_ && byte_order_mark_length_ > 0) {
+    return ReportError(JSONReader::JSON_UNEXPECTED_TOKEN, line_,
+                       column_ + 1);
+  }
+
+  switch (lex_state_) {
+    case LexState::kString:
+      return ReportErrorAtToken(JSONReader::JSON_SYNTAX_ERROR);
+    case LexState::kScalar: {
+      lex_state_ = LexState::kBetweenTokens;
+      const bool success = ConsumeScalar(token_);
+      token_.clear();
+      if (!success)
+        return false;
+      break;
+    }
+    case LexState::kSlash:
+      return ReportErrorAtToken(JSONReader::JSON_UNEXPECTED_TOKEN);
+    default:
+      // As for JSONReader, a comment may run to the end of the input.
+      break;
+  }
+
+  if (expect_ == Expect::kEndOfInput ||
+      (mode_ == InputMode::kValueSequence && stack_.empty())) {
+    return true;
+  }
+  return ReportError(stack_.empty() ? JSONReader::JSON_UNEXPECTED_TOKEN
+                                    : JSONReader::JSON_SYNTAX_ERROR,
+                     line_, column_ + 1);
+}
+
+std::string JSONStreamingParser::GetErrorMessage() const {
+  if (error_code_ == JSONReader::JSON_NO_ERROR)
+    return std::string();
+  return StringPrintf("Line: %i, column: %i, %s", error_line_, error_column_,
+                      JSONReader::ErrorCodeToString(error_code_).c_str());
+}
+
+bool JSONStreamingParser::ConsumeByte(char c, size_t offset) {
+  switch (c) {
+    case ' ':
+    case '\t':
+    case '\n':
+    case '\r':
+      return true;
+    case '/':
+      StartToken(LexState::kSlash, offset);
+      return true;
+    case '{':
+    case '[':
+      if (!IsExpectingValue())
+        return ReportErrorAtCurrentByte(UnexpectedByteError());
+      // Match the depth accounting of JSONParser.
+      if (static_cast<int>(stack_.size()) + 1 >= max_depth_)
+        return ReportErrorAtCurrentByte(JSONReader::JSON_TOO_MUCH_NESTING);
+      if (c == '{') {
+        stack_.push_back(Container::kDictionary);
+        expect_ = Expect::kKeyOrEnd;
+        delegate_->OnDictionaryStart();
+      } else {
+        stack_.push_back(Container::kList);
+        expect_ = Expect::kListItemOrEnd;
+        delegate_->OnListStart();
+      }
+      return true;
+    case '}':
+      return ConsumeContainerEnd(Container::kDictionary);
+    case ']':
+      return ConsumeContainerEnd(Container::kList);
+    case ',':
+      if (expect_ != Expect::kCommaOrEnd)
+        return ReportErrorAtCurrentByte(UnexpectedByteError());
+      expect_ = stack_.back() == Container::kList ? Expect::kListItemAfterComma
+                                                  : Expect::kKeyAfterComma;
+      return true;
+    case ':':
+      if (expect_ != Expect::kColon)
+        return ReportErrorAtCurrentByte(UnexpectedByteError());
+      expect_ = Expect::kValue;
+      return true;
+    case '"':
+      if (IsExpectingKey())
+        token_is_key_ = true;
+      else if (IsExpectingValue())
+        token_is_key_ = false;
+      else
+        return ReportErrorAtCurrentByte(UnexpectedByteError());
+      escape_pending_ = false;
+      StartToken(LexState::kString, offset);
+      return true;
+    default:
+      if (!IsExpectingValue())
+        return ReportErrorAtCurrentByte(UnexpectedByteError());
+      StartToken(LexState::kScalar, offset);
+      return true;
+  }
+}
+
+bool JSONStreamingParser::ConsumeContainerEnd(Container container) {
+  const bool is_list = container == Container::kList;
+  const Expect after_open =
+      is_list ? Expect::kListItemOrEnd : Expect::kKeyOrEnd;
+  const Expect after_comma =
+      is_list ? Expect::kListItemAfterComma : Expect::kKeyAfterComma;
+
+  if (expect_ == after_comma && !(options_ & JSON_ALLOW_TRAILING_COMMAS))
+    return ReportErrorAtCurrentByte(JSONReader::JSON_TRAILING_COMMA);
+  if (expect_ != after_open && expect_ != after_comma &&
+      !(expect_ == Expect::kCommaOrEnd && stack_.back() == container)) {
+    return ReportErrorAtCurrentByte(UnexpectedByteError());
+  }
+
+  stack_.pop_back();
+  if (is_list)
+    delegate_->OnListEnd();
+  else
+    delegate_->OnDictionaryEnd();
+  EndValue();
+  return true;
+}
+
+bool JSONStreamingParser::ConsumeString(StringPiece token) {
+  DCHECK_GE(token.size(), 2u);
+  StringPiece contents = token.substr(1, token.size() - 2);
+
+  // Strings that need decoding go through JSONParser, so that escapes, UTF-16
+  // surrogates and invalid characters are handled exactly as by JSONReader.
+  Optional<Value> decoded;
+  if (!internal::IsVerbatimJSONString(contents)) {
+    decoded = string_parser_.Parse(token);
+    if (!decoded)
+      return ReportErrorAtToken(string_parser_.error_code());
+    contents = decoded->GetString();
+  }
+
+  if (token_is_key_) {
+    delegate_->OnKey(contents);
+    expect_ = Expect::kColon;
+  } else {
+    delegate_->OnString(contents);
+    EndValue();
+  }
+  return true;
+}
+
+bool JSONStreamingParser::ConsumeScalar(StringPiece token) {
+  Optional<Value> value = internal::JSONParser::ParseScalarToken(token);
+  if (!value)
+    return ReportErrorAtToken(JSONReader::JSON_SYNTAX_ERROR);
+
+  switch (value->type()) {
+    case Value::Type::NONE:
+      delegate_->OnNull();
+      break;
+    case Value::Type::BOOLEAN:
+      delegate_->OnBool(value->GetBool());
+      break;
+    case Value::Type::INTEGER:
+      delegate_->OnInt(value->GetInt());
+      break;
+    case Value::Type::DOUBLE:
+      delegate_->OnDouble(value->GetDouble());
+      break;
+    default:
+      NOTREACHED();
+      break;
+  }
+  EndValue();
+  return true;
+}
+
+StringPiece JSONStreamingParser::FinishToken(StringPiece chunk, size_t end) {
+  // Tokens that fit in one chunk are used in place.
+  if (token_.empty())
+    return chunk.substr(token_start_, end - token_start_);
+  token_.append(chunk.data(), end);
+  return token_;
+}
+
+void JSONStreamingParser::EndValue() {
+  if (!stack_.empty()) {
+    expect_ = Expect::kCommaOrEnd;
+    return;
+  }
+  delegate_->OnRootValueEnd();
+  expect_ = mode_ == InputMode::kValueSequence ? Expect::kValue
+                                               : Expect::kEndOfInput;
+}
+
+bool JSONStreamingParser::IsExpectingValue() const {
+  return expect_ == Expect::kValue || expect_ == Expect::kListItemOrEnd ||
+         expect_ == Expect::kListItemAfterComma;
+}
+
+bool JSONStreamingParser::IsExpectingKey() const {
+  return expect_ == Expect::kKeyOrEnd || expect_ == Expect::kKeyAfterComma;
+}
+
+JSONReader::JsonParseError JSONStreamingParser::UnexpectedByteError() const {
+  if (expect_ == Expect::kEndOfInput)
+    return JSONReader::JSON_UNEXPECTED_DATA_AFTER_ROOT;
+  if (IsExpectingKey())
+    return JSONReader::JSON_UNQUOTED_DICTIONARY_KEY;
+  if (IsExpectingValue())
+    return JSONReader::JSON_UNEXPECTED_TOKEN;
+  return JSONReader::JSON_SYNTAX_ERROR;
+}
+
+void JSONStreamingParser::StartToken(LexState state, size_t offset) {
+  DCHECK(token_.empty());
+  lex_state_ = state;
+  token_start_ = offset;
+  token_line_ = line_;
+  token_column_ = column_;
+}
+
+bool JSONStreamingParser::ReportError(JSONReader::JsonParseError code,
+                                      int line,
+                                      int column) {
+  error_code_ = code;
+  error_line_ = line;
+  error_column_ = column;
+  return false;
+}
+
+bool JSONStreamingParser::ReportErrorAtToken(JSONReader::JsonParseError code) {
+  return ReportError(code, token_line_, token_column_);
+}
+
+bool JSONStreamingParser::ReportErrorAtCurrentByte(
+    JSONReader::JsonParseError code) {
+  return ReportError(code, line_, column_);
+}
+
+}  // namespace base
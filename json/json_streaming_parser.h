@@ -0,0 +1,216 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// JSONStreamingParser is a push-based JSON parser for inputs that are too
+// large to hold in memory, such as multi-gigabyte newline-delimited JSON logs.
+// Input is fed in chunks of any size as it arrives, and the parser reports
+// what it finds to a Delegate as a sequence of events rather than building
+// Values:
+//
+//   class RecordCounter : public JSONStreamingParser::Delegate {
+//     ...
+//     void OnRootValueEnd() override { ++records_; }
+//   };
+//
+//   RecordCounter counter;
+//   JSONStreamingParser parser(
+//       &counter, JSON_PARSE_RFC,
+//       JSONStreamingParser::InputMode::kValueSequence);
+//   while (int bytes_read = file.ReadAtCurrentPos(buffer, sizeof(buffer))) {
+//     if (bytes_read < 0 || !parser.Feed(StringPiece(buffer, bytes_read)))
+//       return false;
+//   }
+//   return parser.Finish();
+//
+// Memory use is bounded by the nesting depth and by the length of the longest
+// string or number in the input, not by the size of the input. Strings and
+// numbers are decoded by the same code as JSONReader, and a single value is
+// accepted if and only if JSONReader accepts it with the same options. The
+// reported error codes and positions may differ.
+
+#ifndef BASE_JSON_JSON_STREAMING_PARSER_H_
+#define BASE_JSON_JSON_STREAMING_PARSER_H_
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/json/json_parser.h"
+#include "base/json/json_reader.h"
+#include "base/macros.h"
+#include "base/strings/string_piece.h"
+
+namespace base {
+
+class BASE_EXPORT JSONStreamingParser {
+ public:
+  // Receives the contents of the input, in order. Dictionary members are
+  // reported as OnKey() followed by the events of the value. StringPiece
+  // arguments are only valid for the duration of the call.
+  class Delegate {
+   public:
+    virtual ~Delegate() = default;
+
+    virtual void OnDictionaryStart() = 0;
+    virtual void OnDictionaryEnd() = 0;
+    virtual void OnListStart() = 0;
+    virtual void OnListEnd() = 0;
+    virtual void OnKey(StringPiece key) = 0;
+    virtual void OnNull() = 0;
+    virtual void OnBool(bool value) = 0;
+    virtual void OnInt(int value) = 0;
+    virtual void OnDouble(double value) = 0;
+    virtual void OnString(StringPiece value) = 0;
+
+    // Called after the last event of each top-level value.
+    virtual void OnRootValueEnd() = 0;
+  };
+
+  enum class InputMode {
+    // The input is a single value, as for JSONReader.
+    kSingleValue,
+    // The input is any number of values, optionally separated by whitespace,
+    // such as newline-delimited JSON.
+    kValueSequence,
+  };
+
+  // |delegate| must outlive the parser. |options| are base::JSONParserOptions.
+  JSONStreamingParser(Delegate* delegate,
+                      int options = JSON_PARSE_RFC,
+                      InputMode mode = InputMode::kSingleValue,
+                      int max_depth = JSONReader::kStackMaxDepth);
+  ~JSONStreamingParser();
+
+  // Parses the next |chunk| of the input, which may split tokens anywhere.
+  // Returns false if the input is not valid, after which all calls fail.
+  bool Feed(StringPiece chunk);
+
+  // Signals the end of the input. Returns false if the input is not valid or
+  // ends in the middle of a value.
+  bool Finish();
+
+  // Returns the error code, or JSON_NO_ERROR.
+  JSONReader::JsonParseError error_code() const { return error_code_; }
+
+  // Returns the human-friendly error message, or an empty string.
+  std::string GetErrorMessage() const;
+
+  // Return the line and column of the start of the token at which the error
+  // was detected, or 0 if there is no error.
+  int error_line() const { return error_line_; }
+  int error_column() const { return error_column_; }
+
+ private:
+  // Where the parser is within a token.
+  enum class LexState {
+    kBetweenTokens,
+    kString,
+    kScalar,  // A number or a literal.
+    kSlash,   // A '/' that may start a comment.
+    kLineComment,
+    kBlockComment,
+    kBlockCommentStar,  // A '*' in a block comment.
+  };
+
+  // What the grammar allows next.
+  enum class Expect {
+    kValue,
+    kListItemOrEnd,
+    kListItemAfterComma,
+    kKeyOrEnd,
+    kKeyAfterComma,
+    kColon,
+    kCommaOrEnd,
+    kEndOfInput,
+  };
+
+  enum class Container { kList, kDictionary };
+
+  // Handles |c|, which is outside of any token or comment. |offset| is its
+  // offset in the current chunk.
+  bool ConsumeByte(char c, size_t offset);
+
+  // Handles a '}' or ']'.
+  bool ConsumeContainerEnd(Container container);
+
+  // Handles the complete |token|, the bytes of a string including its quotes
+  // or of a number or literal.
+  bool ConsumeString(StringPiece token);
+  bool ConsumeScalar(StringPiece token);
+
+  // Returns all bytes of the current token, which ends at offset |end| of
+  // |chunk|.
+  StringPiece FinishToken(StringPiece chunk, size_t end);
+
+  // Updates the grammar state after a value was fully reported.
+  void EndValue();
+
+  bool IsExpectingValue() const;
+  bool IsExpectingKey() const;
+
+  // Returns the error for a byte that the grammar does not allow next.
+  JSONReader::JsonParseError UnexpectedByteError() const;
+
+  // Records the start of a token at |offset| of the current chunk.
+  void StartToken(LexState state, size_t offset);
+
+  // Sets the error information to |code| at |line| and |column|, and returns
+  // false.
+  bool ReportError(JSONReader::JsonParseError code, int line, int column);
+  bool ReportErrorAtToken(JSONReader::JsonParseError code);
+  bool ReportErrorAtCurrentByte(JSONReader::JsonParseError code);
+
+  Delegate* const delegate_;
+  const int options_;
+  const InputMode mode_;
+  const int max_depth_;
+
+  LexState lex_state_ = LexState::kBetweenTokens;
+  Expect expect_ = Expect::kValue;
+
+  // The lists and dictionaries that contain the current position.
+  std::vector<Container> stack_;
+
+  // Whether the current string token is a dictionary key.
+  bool token_is_key_ = false;
+
+  // Whether the previous byte of a string started an escape sequence.
+  bool escape_pending_ = false;
+
+  // The offset in the current chunk at which the current token starts, or 0
+  // if it started in an earlier chunk.
+  size_t token_start_ = 0;
+
+  // The bytes of the current token from earlier chunks, if any.
+  std::string token_;
+
+  // The position of the start of the current token.
+  int token_line_ = 0;
+  int token_column_ = 0;
+
+  // The position of the current byte. Both are 1-based.
+  int line_ = 1;
+  int column_ = 0;
+  bool previous_byte_was_cr_ = false;
+
+  // Whether the parser may still be within a UTF-8 byte order mark at the
+  // start of the input, and how many of its bytes were skipped.
+  bool at_start_ = true;
+  size_t byte_order_mark_length_ = 0;
+
+  // Decodes strings that contain escape sequences or non-ASCII characters.
+  internal::JSONParser string_parser_;
+
+  JSONReader::JsonParseError error_code_ = JSONReader::JSON_NO_ERROR;
+  int error_line_ = 0;
+  int error_column_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(JSONStreamingParser);
+};
+
+}  // namespace base
+
+#endif  // BASE_JSON_JSON_STREAMING_PARSER_H_
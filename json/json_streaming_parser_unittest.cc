@@ -0,0 +1,286 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/json/json_streaming_parser.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/json/json_reader.h"
+#include "base/stl_util.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/stringprintf.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+// Records the events as a compact string, e.g. "{ a: 1 b: [ true ] } .".
+class EventRecorder : public JSONStreamingParser::Delegate {
+ public:
+  void OnDictionaryStart() override { Append("{"); }
+  void OnDictionaryEnd() override { Append("}"); }
+  void OnListStart() override { Append("["); }
+  void OnListEnd() override { Append("]"); }
+  void OnKey(StringPiece key) override { Append(key.as_string() + ":"); }
+  void OnNull() override { Append("null"); }
+  void OnBool(bool value) override { Append(value ? "true" : "false"); }
+  void OnInt(int value) override { Append(NumberToString(value)); }
+  void OnDouble(double value) override {
+    Append("d" + NumberToString(value));
+  }
+  void OnString(StringPiece value) override {
+    Append("'" + value.as_string() + "'");
+  }
+  void OnRootValueEnd() override { Append("."); }
+
+  const std::string& events() const { return events_; }
+
+ private:
+  void Append(const std::string& event) {
+    if (!events_.empty())
+      events_ += ' ';
+    events_ += event;
+  }
+
+  std::string events_;
+};
+
+// Rebuilds the values from the events.
+class ValueBuilder : public JSONStreamingParser::Delegate {
+ public:
+  void OnDictionaryStart() override {
+    stack_.emplace_back(TakeKey(), Value(Value::Type::DICTIONARY));
+  }
+  void OnDictionaryEnd() override { EndContainer(); }
+  void OnListStart() override {
+    stack_.emplace_back(TakeKey(), Value(Value::Type::LIST));
+  }
+  void OnListEnd() override { EndContainer(); }
+  void OnKey(StringPiece key) override { key_ = key.as_string(); }
+  void OnNull() override { AddValue(TakeKey(), Value()); }
+  void OnBool(bool value) override { AddValue(TakeKey(), Value(value)); }
+  void OnInt(int value) override { AddValue(TakeKey(), Value(value)); }
+  void OnDouble(double value) override { AddValue(TakeKey(), Value(value)); }
+  void OnString(StringPiece value) override {
+    AddValue(TakeKey(), Value(value));
+  }
+  void OnRootValueEnd() override { EXPECT_TRUE(stack_.empty()); }
+
+  std::vector<Value>& roots() { return roots_; }
+
+ private:
+  std::string TakeKey() { return std::move(key_); }
+
+  void EndContainer() {
+    std::pair<std::string, Value> top = std::move(stack_.back());
+    stack_.pop_back();
+    AddValue(std::move(top.first), std::move(top.second));
+  }
+
+  void AddValue(std::string key, Value value) {
+    if (stack_.empty())
+      roots_.push_back(std::move(value));
+    else if (stack_.back().second.is_list())
+      stack_.back().second.GetList().push_back(std::move(value));
+    else
+      stack_.back().second.SetKey(key, std::move(value));
+  }
+
+  std::string key_;
+  std::vector<std::pair<std::string, Value>> stack_;
+  std::vector<Value> roots_;
+};
+
+}  // namespace
+
+TEST(JSONStreamingParserTest, Events) {
+  EventRecorder recorder;
+  JSONStreamingParser parser(&recorder);
+  EXPECT_TRUE(parser.Feed(
+      R"({"a": 1, "b": [true, false, null, -2.5, "x\ty"], "c": {}})"));
+  EXPECT_TRUE(parser.Finish());
+  EXPECT_EQ("{ a: 1 b: [ true false null d-2.5 'x\ty' ] c: { } } .",
+            recorder.events());
+  EXPECT_EQ(JSONReader::JSON_NO_ERROR, parser.error_code());
+  EXPECT_EQ("", parser.GetErrorMessage());
+}
+
+TEST(JSONStreamingParserTest, TopLevelScalarEndsWithInput) {
+  EventRecorder recorder;
+  JSONStreamingParser parser(&recorder);
+  EXPECT_TRUE(parser.Feed("12"));
+  EXPECT_TRUE(parser.Feed("34"));
+  EXPECT_EQ("", recorder.events());
+  EXPECT_TRUE(parser.Finish());
+  EXPECT_EQ("1234 .", recorder.events());
+}
+
+TEST(JSONStreamingParserTest, AnyChunking) {
+  const std::string json =
+      "\xEF\xBB\xBF{\"key\": [1, 2.5e1, \"str\\\"ing\", \"\\u00e9\\ud83d"
+      "\\ude00\", true, null], /* comment */ \"k\\u0065y2\": {\"x\": \"y\"}"
+      "} // trailing\n";
+  EventRecorder whole_recorder;
+  JSONStreamingParser whole_parser(&whole_recorder);
+  ASSERT_TRUE(whole_parser.Feed(json));
+  ASSERT_TRUE(whole_parser.Finish());
+  EXPECT_EQ(
+      "{ key: [ 1 d25 'str\"ing' '\xC3\xA9\xF0\x9F\x98\x80' true null ] key2: "
+      "{ x: 'y' } } .",
+      whole_recorder.events());
+
+  // Split the input into three chunks in every possible way.
+  for (size_t first = 0; first <= json.size(); ++first) {
+    for (size_t second = first; second <= json.size(); ++second) {
+      SCOPED_TRACE(StringPrintf("chunks end at %zu, %zu", first, second));
+      EventRecorder recorder;
+      JSONStreamingParser parser(&recorder);
+      ASSERT_TRUE(parser.Feed(StringPiece(json).substr(0, first)));
+      ASSERT_TRUE(parser.Feed(StringPiece(json).substr(first, second - first)));
+      ASSERT_TRUE(parser.Feed(StringPiece(json).substr(second)));
+      ASSERT_TRUE(parser.Finish());
+      EXPECT_EQ(whole_recorder.events(), recorder.events());
+    }
+  }
+}
+
+TEST(JSONStreamingParserTest, MatchesJSONReader) {
+  const struct {
+    const char* json;
+    int options;
+  } kCases[] = {
+      {"[]", JSON_PARSE_RFC},
+      {"  {  }  ", JSON_PARSE_RFC},
+      {"\"top-level string\"", JSON_PARSE_RFC},
+      {"-0", JSON_PARSE_RFC},
+      {"2147483648", JSON_PARSE_RFC},
+      {"[1e400]", JSON_PARSE_RFC},
+      {"[1, [2, [3, {\"four\": [5]}]], {}, []]", JSON_PARSE_RFC},
+      {"{\"b\": 1, \"a\": 2, \"b\": 3}", JSON_PARSE_RFC},
+      {"[\"\\x41\\/\\b\\f\\n\\r\\t\\v\"]", JSON_PARSE_RFC},
+      {"[\"\\ud800\"]", JSON_PARSE_RFC},
+      {"[\"\\ufffe\"]", JSON_PARSE_RFC},
+      {"[\"\\ufffe\"]", JSON_REPLACE_INVALID_CHARACTERS},
+      {"[\"\xFF\"]", JSON_PARSE_RFC},
+      {"[\"\xFF\"]", JSON_REPLACE_INVALID_CHARACTERS},
+      {"[\"\\q\"]", JSON_PARSE_RFC},
+      {"[1, 2,]", JSON_PARSE_RFC},
+      {"[1, 2,]", JSON_ALLOW_TRAILING_COMMAS},
+      {"{\"a\": 1,}", JSON_ALLOW_TRAILING_COMMAS},
+      {"[1,,]", JSON_ALLOW_TRAILING_COMMAS},
+      {"[,]", JSON_ALLOW_TRAILING_COMMAS},
+      {"/* a */ [1] // b", JSON_PARSE_RFC},
+      {"[1] /* unterminated", JSON_PARSE_RFC},
+      {"/* unterminated", JSON_PARSE_RFC},
+      {"[1] /", JSON_PARSE_RFC},
+      {"", JSON_PARSE_RFC},
+      {"[1, 2", JSON_PARSE_RFC},
+      {"[\"abc", JSON_PARSE_RFC},
+      {"{\"a\" 1}", JSON_PARSE_RFC},
+      {"{\"a\": 1 \"b\": 2}", JSON_PARSE_RFC},
+      {"{a: 1}", JSON_PARSE_RFC},
+      {"[1}", JSON_PARSE_RFC},
+      {"{\"a\": 1]", JSON_PARSE_RFC},
+      {"[01]", JSON_PARSE_RFC},
+      {"[1.]", JSON_PARSE_RFC},
+      {"[tru]", JSON_PARSE_RFC},
+      {"[truex]", JSON_PARSE_RFC},
+      {"[1] 2", JSON_PARSE_RFC},
+      {"1 2", JSON_PARSE_RFC},
+      {"\xEF\xBB[]", JSON_PARSE_RFC},
+  };
+
+  for (unsigned int i = 0; i < base::size(kCases); ++i) {
+    SCOPED_TRACE(StringPrintf("case %u: \"%s\"", i, kCases[i].json));
+    Optional<Value> expected =
+        JSONReader::Read(kCases[i].json, kCases[i].options);
+
+    ValueBuilder builder;
+    JSONStreamingParser parser(&builder, kCases[i].options);
+    bool success = true;
+    // Feed the input one byte at a time.
+    for (const char* c = kCases[i].json; *c && success; ++c)
+      success = parser.Feed(StringPiece(c, 1));
+    success = success && parser.Finish();
+
+    if (expected) {
+      ASSERT_TRUE(success) << parser.GetErrorMessage();
+      ASSERT_EQ(1u, builder.roots().size());
+      EXPECT_EQ(*expected, builder.roots()[0]);
+    } else {
+      EXPECT_FALSE(success);
+      EXPECT_NE(JSONReader::JSON_NO_ERROR, parser.error_code());
+    }
+  }
+}
+
+TEST(JSONStreamingParserTest, ValueSequence) {
+  EventRecorder recorder;
+  JSONStreamingParser parser(&recorder, JSON_PARSE_RFC,
+                             JSONStreamingParser::InputMode::kValueSequence);
+  EXPECT_TRUE(parser.Finish());
+  EXPECT_TRUE(parser.Feed("{\"id\": 1}\n{\"id\": 2}\r\n"));
+  EXPECT_TRUE(parser.Feed("[3]4 \"five\"{}\n6"));
+  EXPECT_TRUE(parser.Finish());
+  EXPECT_EQ("{ id: 1 } . { id: 2 } . [ 3 ] . 4 . 'five' . { } . 6 .",
+            recorder.events());
+
+  JSONStreamingParser truncated(&recorder, JSON_PARSE_RFC,
+                                JSONStreamingParser::InputMode::kValueSequence);
+  EXPECT_TRUE(truncated.Feed("{\"id\": 1}\n{\"id\""));
+  EXPECT_FALSE(truncated.Finish());
+  EXPECT_EQ(JSONReader::JSON_SYNTAX_ERROR, truncated.error_code());
+}
+
+TEST(JSONStreamingParserTest, Errors) {
+  EventRecorder recorder;
+  JSONStreamingParser parser(&recorder);
+  EXPECT_TRUE(parser.Feed("{\n  \"a\": [1, 2],\r\n"));
+  EXPECT_FALSE(parser.Feed("  \"b\": [1,]\n}"));
+  EXPECT_EQ(JSONReader::JSON_TRAILING_COMMA, parser.error_code());
+  EXPECT_EQ(3, parser.error_line());
+  EXPECT_EQ(11, parser.error_column());
+  EXPECT_EQ("Line: 3, column: 11, Trailing comma not allowed.",
+            parser.GetErrorMessage());
+
+  // The parser stays failed.
+  EXPECT_FALSE(parser.Feed("]}"));
+  EXPECT_FALSE(parser.Finish());
+  EXPECT_EQ(JSONReader::JSON_TRAILING_COMMA, parser.error_code());
+
+  // Errors within strings are reported at the start of the string.
+  JSONStreamingParser escape_parser(&recorder);
+  EXPECT_TRUE(escape_parser.Feed("[\"abc\", \"d\\"));
+  EXPECT_FALSE(escape_parser.Feed("qf\"]"));
+  EXPECT_EQ(JSONReader::JSON_INVALID_ESCAPE, escape_parser.error_code());
+  EXPECT_EQ(1, escape_parser.error_line());
+  EXPECT_EQ(9, escape_parser.error_column());
+
+  JSONStreamingParser after_root_parser(&recorder);
+  EXPECT_FALSE(after_root_parser.Feed("[1]\n[2]"));
+  EXPECT_EQ(JSONReader::JSON_UNEXPECTED_DATA_AFTER_ROOT,
+            after_root_parser.error_code());
+  EXPECT_EQ(2, after_root_parser.error_line());
+  EXPECT_EQ(1, after_root_parser.error_column());
+}
+
+TEST(JSONStreamingParserTest, MaxDepth) {
+  EventRecorder recorder;
+  JSONStreamingParser parser(&recorder, JSON_PARSE_RFC,
+                             JSONStreamingParser::InputMode::kSingleValue, 3);
+  EXPECT_FALSE(parser.Feed("[[[1]]]"));
+  EXPECT_EQ(JSONReader::JSON_TOO_MUCH_NESTING, parser.error_code());
+
+  JSONStreamingParser shallow_parser(
+      &recorder, JSON_PARSE_RFC, JSONStreamingParser::InputMode::kSingleValue,
+      3);
+  EXPECT_TRUE(shallow_parser.Feed("[[1], {\"a\": 2}]"));
+  EXPECT_TRUE(shallow_parser.Finish());
+}
+
+}  // namespace base
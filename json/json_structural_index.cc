@@ -0,0 +1,254 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/json/json_structural_index.h"
+
+#include <string.h>
+
+#include "base/bits.h"
+#include "build/build_config.h"
+
+#if defined(ARCH_CPU_X86_FAMILY)
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#endif
+
+namespace base {
+namespace internal {
+
+namespace {
+
+constexpr size_t kBlockSize = 64;
+
+// Bit i of each mask is set if byte i of the block is one of the listed
+// characters.
+struct BlockMasks {
+  uint64_t quote;       // "
+  uint64_t backslash;   // \ (backslash)
+  uint64_t slash;       // /
+  uint64_t whitespace;  // space, \t, \n, \r
+  uint64_t op;          // { } [ ] : ,
+};
+
+#if defined(ARCH_CPU_X86_FAMILY) && defined(__AVX2__)
+
+inline uint64_t LaneMask(__m256i matches, int lane) {
+  return static_cast<uint64_t>(
+             static_cast<uint32_t>(_mm256_movemask_epi8(matches)))
+         << (32 * lane);
+}
+
+BlockMasks ClassifyBlock(const char* block) {
+  BlockMasks masks = {};
+  for (int lane = 0; lane < 2; ++lane) {
+    const __m256i v = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(block + 32 * lane));
+    auto eq = [&v](char c) {
+      return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c));
+    };
+    // '{' | 0x20 == '[' | 0x20 and '}' | 0x20 == ']' | 0x20, and no other
+    // byte maps onto either, so four brackets take two comparisons.
+    const __m256i folded = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    const __m256i brackets =
+        _mm256_or_si256(_mm256_cmpeq_epi8(folded, _mm256_set1_epi8('{')),
+                        _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('}')));
+    masks.quote |= LaneMask(eq('"'), lane);
+    masks.backslash |= LaneMask(eq('\\'), lane);
+    masks.slash |= LaneMask(eq('/'), lane);
+    masks.whitespace |=
+        LaneMask(_mm256_or_si256(_mm256_or_si256(eq(' '), eq('\t')),
+                                 _mm256_or_si256(eq('\n'), eq('\r'))),
+                 lane);
+    masks.op |= LaneMask(
+        _mm256_or_si256(brackets, _mm256_or_si256(eq(':'), eq(','))), lane);
+  }
+  return masks;
+}
+
+#elif defined(ARCH_CPU_X86_FAMILY)
+
+inline uint64_t LaneMask(__m128i matches, int lane) {
+  return static_cast<uint64_t>(
+             static_cast<uint16_t>(_mm_movemask_epi8(matches)))
+         << (16 * lane);
+}
+
+BlockMasks ClassifyBlock(const char* block) {
+  BlockMasks masks = {};
+  for (int lane = 0; lane < 4; ++lane) {
+    const __m128i v =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * lane));
+    auto eq = [&v](char c) { return _mm_cmpeq_epi8(v, _mm_set1_epi8(c)); };
+    // See the AVX2 version for why this folding is sound.
+    const __m128i folded = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    const __m128i brackets =
+        _mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')),
+                     _mm_cmpeq_epi8(folded, _mm_set1_epi8('}')));
+    masks.quote |= LaneMask(eq('"'), lane);
+    masks.backslash |= LaneMask(eq('\\'), lane);
+    masks.slash |= LaneMask(eq('/'), lane);
+    masks.whitespace |= LaneMask(
+        _mm_or_si128(_mm_or_si128(eq(' '), eq('\t')),
+                     _mm_or_si128(eq('\n'), eq('\r'))),
+        lane);
+    masks.op |=
+        LaneMask(_mm_or_si128(brackets, _mm_or_si128(eq(':'), eq(','))), lane);
+  }
+  return masks;
+}
+
+#else  // !defined(ARCH_CPU_X86_FAMILY)
+
+BlockMasks ClassifyBlock(const char* block) {
+  BlockMasks masks = {};
+  for (size_t i = 0; i < kBlockSize; ++i) {
+    const uint64_t bit = uint64_t{1} << i;
+    switch (block[i]) {
+      case '"':
+        masks.quote |= bit;
+        break;
+      case '\\':
+        masks.backslash |= bit;
+        break;
+      case '/':
+        masks.slash |= bit;
+        break;
+      case ' ':
+      case '\t':
+      case '\n':
+      case '\r':
+        masks.whitespace |= bit;
+        break;
+      case '{':
+      case '}':
+      case '[':
+      case ']':
+      case ':':
+      case ',':
+        masks.op |= bit;
+        break;
+    }
+  }
+  return masks;
+}
+
+#endif  // defined(ARCH_CPU_X86_FAMILY)
+
+// Returns a mask in which bit i is the XOR of bits 0..i of |x|. Applied to the
+// quote mask, this sets every bit from an opening quote up to, but excluding,
+// the matching closing quote.
+inline uint64_t PrefixXor(uint64_t x) {
+  x ^= x << 1;
+  x ^= x << 2;
+  x ^= x << 4;
+  x ^= x << 8;
+  x ^= x << 16;
+  x ^= x << 32;
+  return x;
+}
+
+// Returns the mask of bytes that are escaped, i.e. preceded by an odd-length
+// run of backslashes. |prev_escaped| carries whether the first byte of this
+// block is escaped by a run that ended the previous block, and is updated for
+// the next block.
+inline uint64_t FindEscapedBytes(uint64_t backslash, uint64_t* prev_escaped) {
+  constexpr uint64_t kEvenBits = 0x5555555555555555ULL;
+
+  // An escaped backslash does not start an escape of its own.
+  backslash &= ~*prev_escaped;
+  const uint64_t follows_escape = (backslash << 1) | *prev_escaped;
+
+  // Runs of backslashes that start on an odd bit. Adding them to |backslash|
+  // carries through each run, flipping the parity of its end.
+  const uint64_t odd_sequence_starts = backslash & ~kEvenBits & ~follows_escape;
+  const uint64_t sequences_starting_on_even_bits =
+      odd_sequence_starts + backslash;
+  *prev_escaped = sequences_starting_on_even_bits < backslash ? 1 : 0;
+
+  const uint64_t invert_mask = sequences_starting_on_even_bits << 1;
+  return (kEvenBits ^ invert_mask) & follows_escape;
+}
+
+}  // namespace
+
+bool BuildJSONStructuralIndex(StringPiece input,
+                              std::vector<uint32_t>* offsets) {
+  offsets->clear();
+
+  // State carried from one block to the next.
+  uint64_t prev_escaped = 0;
+  // All ones if the previous block ended inside of a string.
+  uint64_t prev_in_string = 0;
+  // 1 if the last byte of the previous block ended a token. The start of the
+  // input counts as such.
+  uint64_t prev_separator = 1;
+
+  char padded[kBlockSize];
+  for (size_t block_start = 0; block_start < input.size();
+       block_start += kBlockSize) {
+    const char* block = input.data() + block_start;
+    const size_t remaining = input.size() - block_start;
+    if (remaining < kBlockSize) {
+      // Spaces neither start a token nor change the string state.
+      memset(padded, ' ', kBlockSize);
+      memcpy(padded, block, remaining);
+      block = padded;
+    }
+
+    const BlockMasks masks = ClassifyBlock(block);
+
+    const uint64_t escaped = FindEscapedBytes(masks.backslash, &prev_escaped);
+    const uint64_t quote = masks.quote & ~escaped;
+    const uint64_t in_string = PrefixXor(quote) ^ prev_in_string;
+    prev_in_string =
+        static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+
+    // |in_string| includes opening quotes but not closing quotes, so this
+    // leaves only the bytes strictly outside of any string.
+    const uint64_t outside = ~(in_string | quote);
+    if (masks.slash & outside)
+      return false;
+
+    const uint64_t op = masks.op & outside;
+    const uint64_t whitespace = masks.whitespace & outside;
+    const uint64_t scalar = outside & ~(op | whitespace);
+    const uint64_t separator = op | whitespace | quote;
+    const uint64_t scalar_start = scalar & ((separator << 1) | prev_separator);
+    prev_separator = separator >> 63;
+
+    uint64_t structurals = op | quote | scalar_start;
+    while (structurals) {
+      offsets->push_back(static_cast<uint32_t>(
+          block_start + bits::CountTrailingZeroBits(structurals)));
+      structurals &= structurals - 1;
+    }
+  }
+
+  return prev_in_string == 0;
+}
+
+bool IsVerbatimJSONString(StringPiece str) {
+  const char* it = str.data();
+  const char* const end = it + str.size();
+#if defined(ARCH_CPU_X86_FAMILY)
+  const __m128i backslash = _mm_set1_epi8('\\');
+  for (; end - it >= 16; it += 16) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+    // The movemask picks up the high bit of each byte, which is set for both
+    // non-ASCII bytes and the all-ones result of a backslash match.
+    if (_mm_movemask_epi8(_mm_or_si128(v, _mm_cmpeq_epi8(v, backslash))))
+      return false;
+  }
+#endif
+  for (; it != end; ++it) {
+    if (*it == '\\' || static_cast<unsigned char>(*it) >= 0x80)
+      return false;
+  }
+  return true;
+}
+
+}  // namespace internal
+}  // namespace base
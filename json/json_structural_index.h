@@ -0,0 +1,45 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_JSON_JSON_STRUCTURAL_INDEX_H_
+#define BASE_JSON_JSON_STRUCTURAL_INDEX_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/strings/string_piece.h"
+
+namespace base {
+namespace internal {
+
+// The first stage of the JSON_USE_STRUCTURAL_INDEX parse mode. The input is
+// classified 64 bytes at a time (with SSE2 or AVX2 where available) into bit
+// masks of quotes, backslashes, whitespace and structural characters. Escaped
+// quotes and the bytes inside of strings are then masked off with carry-less
+// bit arithmetic, so that no per-byte branching is needed.
+//
+// On success, |offsets| holds, in input order, the offset of:
+//   - every '{', '}', '[', ']', ':' and ',' outside of a string,
+//   - every unescaped '"' (both the opening and closing quote of a string),
+//   - the first byte of every other run of non-whitespace bytes outside of a
+//     string (i.e. the start of a number or literal token).
+//
+// Returns false if the input cannot be indexed: when a string is left
+// unterminated, or when a '/' appears outside of a string, since comments
+// need the byte-at-a-time parser. The index does not validate the input in
+// any other way; that is left to the second stage.
+BASE_EXPORT bool BuildJSONStructuralIndex(StringPiece input,
+                                          std::vector<uint32_t>* offsets);
+
+// Returns true if |str| contains neither a backslash nor any byte outside the
+// 7-bit ASCII range, meaning that the bytes between a pair of quotes can be
+// used verbatim as the string value without any decoding or validation.
+BASE_EXPORT bool IsVerbatimJSONString(StringPiece str);
+
+}  // namespace internal
+}  // namespace base
+
+#endif  // BASE_JSON_JSON_STRUCTURAL_INDEX_H_
@@ -0,0 +1,98 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/json/json_structural_index.h"
+
+#include <string>
+#include <vector>
+
+#include "testing/gmock/include/gmock/gmock.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace internal {
+
+using testing::ElementsAre;
+using testing::IsEmpty;
+
+TEST(JSONStructuralIndexTest, Structurals) {
+  std::vector<uint32_t> offsets;
+  ASSERT_TRUE(BuildJSONStructuralIndex("{\"a\": [1, -2.5], \"b\":null}",
+                                       &offsets));
+  EXPECT_THAT(offsets, ElementsAre(0, 1, 3, 4, 6, 7, 8, 10, 14, 15, 17, 19, 20,
+                                   21, 25));
+}
+
+TEST(JSONStructuralIndexTest, Empty) {
+  std::vector<uint32_t> offsets = {1, 2, 3};
+  EXPECT_TRUE(BuildJSONStructuralIndex("", &offsets));
+  EXPECT_THAT(offsets, IsEmpty());
+  EXPECT_TRUE(BuildJSONStructuralIndex(" \t\r\n ", &offsets));
+  EXPECT_THAT(offsets, IsEmpty());
+}
+
+TEST(JSONStructuralIndexTest, ScalarTokens) {
+  std::vector<uint32_t> offsets;
+  // Every run of non-whitespace bytes outside of strings starts a token, even
+  // if it is not a valid one.
+  ASSERT_TRUE(BuildJSONStructuralIndex("tr ue 12\"x\"3 \\", &offsets));
+  EXPECT_THAT(offsets, ElementsAre(0, 3, 6, 8, 10, 11, 13));
+}
+
+TEST(JSONStructuralIndexTest, StringContentsAreSkipped) {
+  std::vector<uint32_t> offsets;
+  ASSERT_TRUE(BuildJSONStructuralIndex("[\"{a: [1, 2]}/\"]", &offsets));
+  EXPECT_THAT(offsets, ElementsAre(0, 1, 14, 15));
+}
+
+TEST(JSONStructuralIndexTest, EscapedQuotes) {
+  std::vector<uint32_t> offsets;
+  ASSERT_TRUE(BuildJSONStructuralIndex("\"\\\"\"", &offsets));
+  EXPECT_THAT(offsets, ElementsAre(0, 3));
+  ASSERT_TRUE(BuildJSONStructuralIndex("\"\\\\\"", &offsets));
+  EXPECT_THAT(offsets, ElementsAre(0, 3));
+  ASSERT_TRUE(BuildJSONStructuralIndex("\"\\\\\\\"\"", &offsets));
+  EXPECT_THAT(offsets, ElementsAre(0, 5));
+}
+
+TEST(JSONStructuralIndexTest, EscapesAcrossBlocks) {
+  for (size_t backslashes = 1; backslashes <= 5; ++backslashes) {
+    for (size_t padding = 55; padding < 70; ++padding) {
+      std::string json = "\"" + std::string(padding, 'x') +
+                         std::string(backslashes, '\\') + "\"\"";
+      SCOPED_TRACE(json);
+      std::vector<uint32_t> offsets;
+      if (backslashes % 2) {
+        // The first quote after the backslashes is escaped.
+        ASSERT_TRUE(BuildJSONStructuralIndex(json, &offsets));
+        EXPECT_THAT(offsets, ElementsAre(0, json.size() - 1));
+      } else {
+        // The first quote terminates the string and the second one is left
+        // unterminated.
+        EXPECT_FALSE(BuildJSONStructuralIndex(json, &offsets));
+      }
+    }
+  }
+}
+
+TEST(JSONStructuralIndexTest, Unindexable) {
+  std::vector<uint32_t> offsets;
+  EXPECT_FALSE(BuildJSONStructuralIndex("\"unterminated", &offsets));
+  EXPECT_FALSE(BuildJSONStructuralIndex("[1] // comment", &offsets));
+  EXPECT_FALSE(BuildJSONStructuralIndex("[1, /* comment */ 2]", &offsets));
+  EXPECT_TRUE(BuildJSONStructuralIndex("[\"//\", \"/*\"]", &offsets));
+}
+
+TEST(JSONStructuralIndexTest, IsVerbatimJSONString) {
+  EXPECT_TRUE(IsVerbatimJSONString(""));
+  EXPECT_TRUE(IsVerbatimJSONString("plain ASCII, with\ttabs and {}[]:,/"));
+  EXPECT_TRUE(IsVerbatimJSONString(std::string(100, 'x')));
+  EXPECT_FALSE(IsVerbatimJSONString("escaped \\n"));
+  EXPECT_FALSE(IsVerbatimJSONString("caf\xC3\xA9"));
+  EXPECT_FALSE(IsVerbatimJSONString(std::string(40, 'x') + "\\"));
+  EXPECT_FALSE(IsVerbatimJSONString(std::string(17, 'x') + "\xFF"));
+}
+
+}  // namespace internal
+}  // namespace base
@@ -6,11 +6,15 @@
 
 #include <stdint.h>
 
+#include <string.h>
+
 #include <cmath>
 #include <limits>
 
 #include "base/json/string_escape.h"
 #include "base/logging.h"
+#include "base/strings/double_to_string.h"
+#include "base/strings/string_piece.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/strings/utf_string_conversions.h"
 #include "base/values.h"
@@ -24,6 +28,15 @@ const char kPrettyPrintLineEnding[] = "\r\n";
 const char kPrettyPrintLineEnding[] = "\n";
 #endif
 
+namespace {
+
+// The typical length of a double, used to estimate the size of the output.
+// Most doubles in practice are short, and the rare long ones only make the
+// output grow once more.
+constexpr size_t kEstimatedDoubleLength = 8;
+
+}  // namespace
+
 // static
 bool JSONWriter::Write(const Value& node, std::string* json) {
   return WriteWithOptions(node, 0, json);
@@ -34,10 +47,10 @@ bool JSONWriter::WriteWithOptions(const Value& node,
                                   int options,
                                   std::string* json) {
   json->clear();
-  // Is there a better way to estimate the size of the output?
-  json->reserve(1024);
 
   JSONWriter writer(options, json);
+  json->reserve(writer.EstimateSize(node, 0U) +
+                strlen(kPrettyPrintLineEnding));
   bool result = writer.BuildJSONString(node, 0U);
 
   if (options & OPTIONS_PRETTY_PRINT)
@@ -81,22 +94,7 @@ bool JSONWriter::BuildJSONString(const Value& node, size_t depth) {
         json_string_->append(NumberToString(static_cast<int64_t>(value)));
         return true;
       }
-      std::string real = NumberToString(value);
-      // Ensure that the number has a .0 if there's no decimal or 'e'.  This
-      // makes sure that when we read the JSON back, it's interpreted as a
-      // real rather than an int.
-      if (real.find_first_of(".eE") == std::string::npos)
-        real.append(".0");
-
-      // The JSON spec requires that non-integer values in the range (-1,1)
-      // have a zero before the decimal point - ".52" is not valid, "0.52" is.
-      if (real[0] == '.') {
-        real.insert(static_cast<size_t>(0), static_cast<size_t>(1), '0');
-      } else if (real.length() > 1 && real[0] == '-' && real[1] == '.') {
-        // "-.1" bad "-0.1" good
-        real.insert(static_cast<size_t>(1), static_cast<size_t>(1), '0');
-      }
-      json_string_->append(real);
+      AppendDouble(value);
       return true;
     }
 
@@ -191,6 +189,84 @@ bool JSONWriter::BuildJSONString(const Value& node, size_t depth) {
   return false;
 }
 
+size_t JSONWriter::EstimateSize(const Value& node, size_t depth) const {
+  switch (node.type()) {
+    case Value::Type::NONE:
+      return 4;
+
+    case Value::Type::BOOLEAN:
+      return 5;
+
+    case Value::Type::INTEGER:
+      return 11;
+
+    case Value::Type::DOUBLE:
+      return kEstimatedDoubleLength;
+
+    case Value::Type::STRING:
+      return node.GetString().size() + 2;
+
+    case Value::Type::LIST: {
+      // Brackets, and a separator after each item.
+      size_t size = pretty_print_ ? 4 : 2;
+      for (const auto& value : node.GetList()) {
+        if (omit_binary_values_ && value.type() == Value::Type::BINARY)
+          continue;
+        size += EstimateSize(value, depth) + (pretty_print_ ? 2 : 1);
+      }
+      return size;
+    }
+
+    case Value::Type::DICTIONARY: {
+      const size_t line_ending_length = strlen(kPrettyPrintLineEnding);
+      // Braces, and a separator, quotes and a colon for each item.
+      size_t size = 2;
+      size_t item_size = 4;
+      if (pretty_print_) {
+        size += 2 * line_ending_length + depth * 3U;
+        item_size += line_ending_length + (depth + 1U) * 3U + 1;
+      }
+      for (const auto& pair : node.DictItems()) {
+        if (omit_binary_values_ && pair.second.type() == Value::Type::BINARY)
+          continue;
+        size += item_size + pair.first.size() +
+                EstimateSize(pair.second, depth + 1U);
+      }
+      return size;
+    }
+
+    case Value::Type::BINARY:
+    case Value::Type::DEAD:
+      return 0;
+  }
+
+  NOTREACHED();
+  return 0;
+}
+
+void JSONWriter::AppendDouble(double value) {
+  char buffer[kDoubleToShortestStringMaxLength];
+  const size_t length = DoubleToShortestString(value, buffer);
+  StringPiece real(buffer, length);
+
+  // The JSON spec requires that non-integer values in the range (-1,1) have a
+  // zero before the decimal point - ".52" is not valid, "0.52" is.
+  if (real[0] == '.') {
+    json_string_->push_back('0');
+  } else if (real.starts_with("-.")) {
+    // "-.1" bad "-0.1" good
+    json_string_->append("-0");
+    real.remove_prefix(1);
+  }
+  json_string_->append(real.data(), real.size());
+
+  // Ensure that the number has a .0 if there's no decimal or 'e'. This makes
+  // sure that when we read the JSON back, it's interpreted as a real rather
+  // than an int.
+  if (real.find_first_of(".eE") == StringPiece::npos)
+    json_string_->append(".0");
+}
+
 void JSONWriter::IndentLine(size_t depth) {
   json_string_->append(depth * 3U, ' ');
 }
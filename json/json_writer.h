@@ -53,10 +53,18 @@ class BASE_EXPORT JSONWriter {
  private:
   JSONWriter(int options, std::string* json);
 
+  // Returns roughly the number of bytes that BuildJSONString() appends for
+  // |node|, so that the output can be allocated up front. Strings are assumed
+  // to need no escaping.
+  size_t EstimateSize(const Value& node, size_t depth) const;
+
   // Called recursively to build the JSON string. When completed,
   // |json_string_| will contain the JSON.
   bool BuildJSONString(const Value& node, size_t depth);
 
+  // Appends |value| in a form that JSONReader reads back as the same double.
+  void AppendDouble(double value);
+
   // Adds space to json_string_ for the indent level.
   void IndentLine(size_t depth);
 
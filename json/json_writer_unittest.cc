@@ -5,6 +5,7 @@
 #include "base/json/json_writer.h"
 
 #include "base/containers/span.h"
+#include "base/json/json_reader.h"
 #include "base/memory/ptr_util.h"
 #include "base/values.h"
 #include "build/build_config.h"
@@ -154,4 +155,20 @@ TEST(JSONWriterTest, DoublesAsInts) {
   EXPECT_EQ("10000000000", output_js);
 }
 
+TEST(JSONWriterTest, DoublesRoundTrip) {
+  ListValue list;
+  for (double value : {0.1, -0.25, 1.0 / 3, 1e-7, 6.02214076e23,
+                       1.7976931348623157e308, -123456789.125, 100.0}) {
+    list.GetList().emplace_back(value);
+  }
+
+  std::string output_js;
+  EXPECT_TRUE(JSONWriter::Write(list, &output_js));
+  EXPECT_EQ(
+      "[0.1,-0.25,0.3333333333333333,1e-07,6.02214076e+23,"
+      "1.7976931348623157e+308,-123456789.125,100.0]",
+      output_js);
+  EXPECT_EQ(list, *JSONReader::Read(output_js));
+}
+
 }  // namespace base
@@ -10,11 +10,17 @@
 #include <limits>
 #include <string>
 
+#include "base/bits.h"
 #include "base/strings/string_util.h"
 #include "base/strings/stringprintf.h"
 #include "base/strings/utf_string_conversion_utils.h"
 #include "base/strings/utf_string_conversions.h"
 #include "base/third_party/icu/icu_utf.h"
+#include "build/build_config.h"
+
+#if defined(ARCH_CPU_X86_FAMILY)
+#include <emmintrin.h>
+#endif
 
 namespace base {
 
@@ -77,6 +83,52 @@ bool EscapeSpecialCodePoint(uint32_t code_point, std::string* dest) {
   return true;
 }
 
+// Returns true if |c| is a code unit that is copied to the output unchanged:
+// printable ASCII other than the characters escaped above.
+template <typename Char>
+inline bool IsUnescapedCodeUnit(Char c) {
+  return c >= 0x20 && c < 0x80 && c != '"' && c != '\\' && c != '<';
+}
+
+// Returns the number of code units from |begin| that are copied to the output
+// unchanged, stopping at |end|.
+template <typename Char>
+size_t CountUnescapedCodeUnits(const Char* begin, const Char* end) {
+  const Char* it = begin;
+  while (it != end && IsUnescapedCodeUnit(*it))
+    ++it;
+  return it - begin;
+}
+
+#if defined(ARCH_CPU_X86_FAMILY)
+// Most strings need no escaping at all, so check 16 bytes at a time.
+template <>
+size_t CountUnescapedCodeUnits(const char* begin, const char* end) {
+  const __m128i space = _mm_set1_epi8(0x20);
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i less_than = _mm_set1_epi8('<');
+  const char* it = begin;
+  for (; end - it >= 16; it += 16) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+    // As signed bytes, both control characters and non-ASCII bytes are less
+    // than a space.
+    const __m128i special = _mm_or_si128(
+        _mm_or_si128(_mm_cmplt_epi8(v, space), _mm_cmpeq_epi8(v, quote)),
+        _mm_or_si128(_mm_cmpeq_epi8(v, backslash),
+                     _mm_cmpeq_epi8(v, less_than)));
+    const int mask = _mm_movemask_epi8(special);
+    if (mask) {
+      return (it - begin) +
+             bits::CountTrailingZeroBits(static_cast<uint32_t>(mask));
+    }
+  }
+  while (it != end && IsUnescapedCodeUnit(*it))
+    ++it;
+  return it - begin;
+}
+#endif  // defined(ARCH_CPU_X86_FAMILY)
+
 template <typename S>
 bool EscapeJSONStringImpl(const S& str, bool put_in_quotes, std::string* dest) {
   bool did_replacement = false;
@@ -90,6 +142,16 @@ bool EscapeJSONStringImpl(const S& str, bool put_in_quotes, std::string* dest) {
   const int32_t length = static_cast<int32_t>(str.length());
 
   for (int32_t i = 0; i < length; ++i) {
+    // Copy runs of characters that need no escaping in bulk.
+    const int32_t run = static_cast<int32_t>(
+        CountUnescapedCodeUnits(str.data() + i, str.data() + length));
+    if (run) {
+      dest->append(str.data() + i, str.data() + i + run);
+      i += run;
+      if (i == length)
+        break;
+    }
+
     uint32_t code_point;
     if (!ReadUnicodeCharacter(str.data(), length, &i, &code_point) ||
         code_point == static_cast<decltype(code_point)>(CBU_SENTINEL) ||
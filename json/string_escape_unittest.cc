@@ -72,6 +72,33 @@ TEST(JSONStringEscapeTest, EscapeUTF8) {
   EXPECT_TRUE(IsStringUTF8(out));
 }
 
+TEST(JSONStringEscapeTest, EscapeLongUTF8) {
+  // Place each character that needs escaping at every position of a long
+  // string, so that it falls in and between blocks of the fast path.
+  const struct {
+    const char* to_escape;
+    const char* escaped;
+  } kCases[] = {
+      {"\"", "\\\""},
+      {"\\", "\\\\"},
+      {"<", "\\u003C"},
+      {"\n", "\\n"},
+      {"\x1F", "\\u001F"},
+      {"\xC3\xA9", "\xC3\xA9"},
+      {"\xFF", "\xEF\xBF\xBD"},
+  };
+
+  for (const auto& test : kCases) {
+    for (size_t position = 0; position <= 40; ++position) {
+      const std::string prefix(position, 'a');
+      const std::string suffix(40 - position, 'z');
+      std::string out;
+      EscapeJSONString(prefix + test.to_escape + suffix, false, &out);
+      EXPECT_EQ(prefix + test.escaped + suffix, out);
+    }
+  }
+}
+
 TEST(JSONStringEscapeTest, EscapeUTF16) {
   const struct {
     const wchar_t* to_escape;
@@ -0,0 +1,135 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/memory/arena.h"
+
+#include <algorithm>
+
+#include "base/numerics/checked_math.h"
+
+#if BUILDFLAG(USE_PARTITION_ALLOC) && !defined(OS_NACL)
+#include "base/allocator/partition_allocator/partition_alloc.h"
+#endif
+
+namespace base {
+
+struct Arena::Chunk {
+  Chunk* next;
+  // Including this header.
+  size_t size;
+
+  char* begin() {
+    return reinterpret_cast<char*>(this) +
+           bits::Align(sizeof(Chunk), alignof(max_align_t));
+  }
+  char* end() { return reinterpret_cast<char*>(this) + size; }
+};
+
+constexpr size_t Arena::kDefaultInitialChunkSize;
+constexpr size_t Arena::kMaxChunkSize;
+
+Arena::Arena(size_t initial_chunk_size) : next_chunk_size_(initial_chunk_size) {
+  // Allocates the first chunk right away, so that the fast path of Alloc()
+  // always has a chunk to allocate from.
+  first_chunk_ = AllocateChunk(initial_chunk_size);
+  UseChunk(first_chunk_);
+}
+
+#if BUILDFLAG(USE_PARTITION_ALLOC) && !defined(OS_NACL)
+Arena::Arena(PartitionRootGeneric* partition, size_t initial_chunk_size)
+    : partition_(partition), next_chunk_size_(initial_chunk_size) {
+  DCHECK(partition_);
+  first_chunk_ = AllocateChunk(initial_chunk_size);
+  UseChunk(first_chunk_);
+}
+#endif
+
+Arena::~Arena() {
+  RunDestructors();
+  while (first_chunk_) {
+    Chunk* next = first_chunk_->next;
+    FreeChunk(first_chunk_);
+    first_chunk_ = next;
+  }
+}
+
+void Arena::Reset() {
+  RunDestructors();
+  used_bytes_in_previous_chunks_ = 0;
+  UseChunk(first_chunk_);
+}
+
+size_t Arena::GetUsedBytes() const {
+  return used_bytes_in_previous_chunks_ + (ptr_ - current_chunk_->begin());
+}
+
+void* Arena::AllocSlow(size_t size, size_t alignment) {
+  // The space left in the current chunk is lost.
+  used_bytes_in_previous_chunks_ += end_ - current_chunk_->begin();
+
+  // Reuses the chunks kept by Reset() if possible.
+  size_t needed_size = (CheckedNumeric<size_t>(size) + alignment - 1 +
+                        (current_chunk_->begin() -
+                         reinterpret_cast<char*>(current_chunk_)))
+                           .ValueOrDie();
+  while (current_chunk_->next && current_chunk_->next->size < needed_size) {
+    current_chunk_ = current_chunk_->next;
+    used_bytes_in_previous_chunks_ += current_chunk_->end() -
+                                      current_chunk_->begin();
+  }
+
+  Chunk* chunk = current_chunk_->next;
+  if (!chunk) {
+    chunk = AllocateChunk(std::max(needed_size, next_chunk_size_));
+    current_chunk_->next = chunk;
+  }
+  UseChunk(chunk);
+
+  void* result = Alloc(size, alignment);
+  DCHECK(result);
+  return result;
+}
+
+void Arena::UseChunk(Chunk* chunk) {
+  current_chunk_ = chunk;
+  ptr_ = chunk->begin();
+  end_ = chunk->end();
+}
+
+Arena::Chunk* Arena::AllocateChunk(size_t size) {
+  DCHECK_GT(size, sizeof(Chunk));
+  void* memory = nullptr;
+#if BUILDFLAG(USE_PARTITION_ALLOC) && !defined(OS_NACL)
+  if (partition_)
+    memory = partition_->Alloc(size, "Arena");
+#endif
+  if (!memory)
+    memory = ::operator new(size);
+
+  reserved_bytes_ += size;
+  next_chunk_size_ = std::min(next_chunk_size_ * 2, kMaxChunkSize);
+  return new (memory) Chunk{nullptr, size};
+}
+
+void Arena::FreeChunk(Chunk* chunk) {
+  reserved_bytes_ -= chunk->size;
+#if BUILDFLAG(USE_PARTITION_ALLOC) && !defined(OS_NACL)
+  if (partition_) {
+    partition_->Free(chunk);
+    return;
+  }
+#endif
+  ::operator delete(chunk);
+}
+
+void Arena::RunDestructors() {
+  // Destructors may create objects in the arena, which are destroyed as well.
+  while (destructors_) {
+    DestructorNode* node = destructors_;
+    destructors_ = node->next;
+    node->destroy(node->object);
+  }
+}
+
+}  // namespace base
@@ -0,0 +1,198 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_MEMORY_ARENA_H_
+#define BASE_MEMORY_ARENA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "base/base_export.h"
+#include "base/bits.h"
+#include "base/compiler_specific.h"
+#include "base/logging.h"
+#include "base/macros.h"
+#include "base/partition_alloc_buildflags.h"
+#include "build/build_config.h"
+
+namespace base {
+
+#if BUILDFLAG(USE_PARTITION_ALLOC) && !defined(OS_NACL)
+struct PartitionRootGeneric;
+#endif
+
+// A region allocator: allocations are carved from large chunks by bumping a
+// pointer, and are all released at once, when the arena is reset or destroyed.
+// Useful for the many short-lived allocations of a unit of work, such as a
+// request, which can then all be thrown away together.
+//
+// Objects created with New() are destroyed when the arena is reset, in the
+// reverse order of their creation. Memory obtained with Alloc() is not
+// initialized.
+//
+// Reset() keeps the chunks, so that an arena reused for similar units of work
+// stops allocating memory after the first one.
+//
+// This class is not thread-safe.
+//
+// Example:
+//   Arena arena;
+//   Request* request = arena.New<Request>(...);
+//   std::vector<int, ArenaAllocator<int>> ids{ArenaAllocator<int>(&arena)};
+//   ...
+//   arena.Reset();
+class BASE_EXPORT Arena {
+ public:
+  // Size of the first chunk, the following ones are twice as large as the
+  // previous one, up to kMaxChunkSize. Larger allocations get a chunk of their
+  // own.
+  static constexpr size_t kDefaultInitialChunkSize = 4096;
+  static constexpr size_t kMaxChunkSize = 1024 * 1024;
+
+  explicit Arena(size_t initial_chunk_size = kDefaultInitialChunkSize);
+#if BUILDFLAG(USE_PARTITION_ALLOC) && !defined(OS_NACL)
+  // Allocates the chunks from |partition|, which must outlive the arena,
+  // rather than from the heap.
+  explicit Arena(PartitionRootGeneric* partition,
+                 size_t initial_chunk_size = kDefaultInitialChunkSize);
+#endif
+  ~Arena();
+
+  // Returns |size| uninitialized bytes, aligned on |alignment|, which must be a
+  // power of two. Never returns null.
+  ALWAYS_INLINE void* Alloc(size_t size,
+                            size_t alignment = alignof(max_align_t)) {
+    DCHECK(bits::IsPowerOfTwo(alignment));
+    uintptr_t begin = bits::Align(reinterpret_cast<uintptr_t>(ptr_), alignment);
+    if (LIKELY(begin <= reinterpret_cast<uintptr_t>(end_) &&
+               size <= reinterpret_cast<uintptr_t>(end_) - begin)) {
+      ptr_ = reinterpret_cast<char*>(begin + size);
+      return reinterpret_cast<void*>(begin);
+    }
+    return AllocSlow(size, alignment);
+  }
+
+  // Returns memory for |count| objects of type T, which are not constructed.
+  template <typename T>
+  T* AllocArray(size_t count) {
+    CHECK_LE(count, std::numeric_limits<size_t>::max() / sizeof(T));
+    return static_cast<T*>(Alloc(count * sizeof(T), alignof(T)));
+  }
+
+  // Constructs a T from |args| in the arena. Its destructor, if not trivial, is
+  // run by Reset() or by the destructor of the arena.
+  template <typename T, typename... Args>
+  T* New(Args&&... args) {
+    if (std::is_trivially_destructible<T>::value)
+      return new (Alloc(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    DestructorNode* node = AllocArray<DestructorNode>(1);
+    T* object =
+        new (Alloc(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    node->destroy = &Destroy<T>;
+    node->object = object;
+    node->next = destructors_;
+    destructors_ = node;
+    return object;
+  }
+
+  // Destroys the objects created with New(), and makes all the memory of the
+  // arena available again, without releasing it.
+  void Reset();
+
+  // Number of bytes handed out since the last reset, including alignment
+  // padding.
+  size_t GetUsedBytes() const;
+  // Number of bytes allocated for the chunks.
+  size_t GetReservedBytes() const { return reserved_bytes_; }
+
+ private:
+  struct Chunk;
+  struct DestructorNode {
+    void (*destroy)(void*);
+    void* object;
+    DestructorNode* next;
+  };
+
+  template <typename T>
+  static void Destroy(void* object) {
+    static_cast<T*>(object)->~T();
+  }
+
+  NOINLINE void* AllocSlow(size_t size, size_t alignment);
+  void UseChunk(Chunk* chunk);
+  Chunk* AllocateChunk(size_t size);
+  void FreeChunk(Chunk* chunk);
+  void RunDestructors();
+
+#if BUILDFLAG(USE_PARTITION_ALLOC) && !defined(OS_NACL)
+  PartitionRootGeneric* const partition_ = nullptr;
+#endif
+
+  // Allocation range in |current_chunk_|.
+  char* ptr_ = nullptr;
+  char* end_ = nullptr;
+
+  // Chunks, in the order in which they are used.
+  Chunk* first_chunk_ = nullptr;
+  Chunk* current_chunk_ = nullptr;
+  // Bytes used in the chunks before |current_chunk_|.
+  size_t used_bytes_in_previous_chunks_ = 0;
+  size_t next_chunk_size_;
+  size_t reserved_bytes_ = 0;
+
+  // Objects to destroy, most recent first.
+  DestructorNode* destructors_ = nullptr;
+
+  DISALLOW_COPY_AND_ASSIGN(Arena);
+};
+
+// A standard allocator which allocates from an Arena, for use with containers.
+// Deallocation is a no-op, the memory is reclaimed when the arena is reset. As
+// such, containers which grow a lot should be reserved up front.
+//
+// Containers must be destroyed or cleared before the arena is reset.
+template <typename T>
+class ArenaAllocator {
+ public:
+  using value_type = T;
+  // Containers which predate std::allocator_traits, such as
+  // basic::InlinedVector, also need these.
+  using pointer = T*;
+  using const_pointer = const T*;
+  using reference = T&;
+  using const_reference = const T&;
+  using size_type = size_t;
+  using difference_type = ptrdiff_t;
+
+  explicit ArenaAllocator(Arena* arena) : arena_(arena) { DCHECK(arena_); }
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena()) {}
+
+  T* allocate(size_t count) { return arena_->AllocArray<T>(count); }
+  void deallocate(T* ptr, size_t count) {}
+
+  Arena* arena() const { return arena_; }
+
+ private:
+  Arena* arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) {
+  return lhs.arena() == rhs.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) {
+  return !(lhs == rhs);
+}
+
+}  // namespace base
+
+#endif  // BASE_MEMORY_ARENA_H_
@@ -0,0 +1,181 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/memory/arena.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "testing/gtest/include/gtest/gtest.h"
+
+#if BUILDFLAG(USE_PARTITION_ALLOC) && !defined(OS_NACL)
+#include "base/allocator/partition_allocator/partition_alloc.h"
+#endif
+
+namespace base {
+
+namespace {
+
+class DestructionRecorder {
+ public:
+  DestructionRecorder(std::vector<int>* destroyed, int id)
+      : destroyed_(destroyed), id_(id) {}
+  ~DestructionRecorder() { destroyed_->push_back(id_); }
+
+ private:
+  std::vector<int>* const destroyed_;
+  const int id_;
+};
+
+bool IsAligned(const void* ptr, size_t alignment) {
+  return !(reinterpret_cast<uintptr_t>(ptr) & (alignment - 1));
+}
+
+}  // namespace
+
+TEST(ArenaTest, Alloc) {
+  Arena arena;
+  char* first = static_cast<char*>(arena.Alloc(10, 1));
+  char* second = static_cast<char*>(arena.Alloc(10, 1));
+  // Bump allocation.
+  EXPECT_EQ(first + 10, second);
+  EXPECT_EQ(20u, arena.GetUsedBytes());
+  memset(first, 'a', 20);
+
+  EXPECT_TRUE(arena.Alloc(0));
+}
+
+TEST(ArenaTest, Alignment) {
+  Arena arena;
+  for (size_t alignment = 1; alignment <= 4096; alignment *= 2) {
+    arena.Alloc(1, 1);
+    EXPECT_TRUE(IsAligned(arena.Alloc(8, alignment), alignment));
+  }
+  EXPECT_TRUE(IsAligned(arena.AllocArray<double>(3), alignof(double)));
+}
+
+TEST(ArenaTest, GrowsChunks) {
+  Arena arena(256);
+  EXPECT_EQ(256u, arena.GetReservedBytes());
+  // Doesn't fit in the first chunk.
+  arena.Alloc(200);
+  arena.Alloc(200);
+  EXPECT_EQ(256u + 512u, arena.GetReservedBytes());
+
+  // Gets a chunk of its own.
+  char* large = static_cast<char*>(arena.Alloc(Arena::kMaxChunkSize * 2));
+  memset(large, 'a', Arena::kMaxChunkSize * 2);
+  EXPECT_GT(arena.GetReservedBytes(), Arena::kMaxChunkSize * 2);
+}
+
+TEST(ArenaTest, ResetKeepsChunks) {
+  Arena arena(256);
+  for (int i = 0; i < 100; ++i)
+    arena.Alloc(100);
+  size_t reserved_bytes = arena.GetReservedBytes();
+  EXPECT_GT(reserved_bytes, 256u);
+
+  arena.Reset();
+  EXPECT_EQ(0u, arena.GetUsedBytes());
+  EXPECT_EQ(reserved_bytes, arena.GetReservedBytes());
+
+  // The same allocations reuse the chunks.
+  for (int i = 0; i < 100; ++i)
+    arena.Alloc(100);
+  EXPECT_EQ(reserved_bytes, arena.GetReservedBytes());
+}
+
+TEST(ArenaTest, New) {
+  Arena arena;
+  std::vector<int> destroyed;
+  int* value = arena.New<int>(42);
+  EXPECT_EQ(42, *value);
+  arena.New<DestructionRecorder>(&destroyed, 1);
+  arena.New<DestructionRecorder>(&destroyed, 2);
+  EXPECT_TRUE(destroyed.empty());
+
+  // Destroyed in the reverse order of their creation.
+  arena.Reset();
+  EXPECT_EQ((std::vector<int>{2, 1}), destroyed);
+
+  destroyed.clear();
+  arena.New<DestructionRecorder>(&destroyed, 3);
+  arena.Reset();
+  EXPECT_EQ(std::vector<int>{3}, destroyed);
+}
+
+TEST(ArenaTest, DestructorRunsWithArena) {
+  std::vector<int> destroyed;
+  {
+    Arena arena;
+    arena.New<DestructionRecorder>(&destroyed, 1);
+    arena.New<std::string>(100, 'a');
+  }
+  EXPECT_EQ(std::vector<int>{1}, destroyed);
+}
+
+TEST(ArenaTest, ArenaAllocator) {
+  Arena arena;
+  {
+    std::vector<int, ArenaAllocator<int>> vector{ArenaAllocator<int>(&arena)};
+    for (int i = 0; i < 1000; ++i)
+      vector.push_back(i);
+    for (int i = 0; i < 1000; ++i)
+      EXPECT_EQ(i, vector[i]);
+
+    using Map = std::map<int, int, std::less<int>,
+                         ArenaAllocator<std::pair<const int, int>>>;
+    Map map{ArenaAllocator<std::pair<const int, int>>(&arena)};
+    for (int i = 0; i < 100; ++i)
+      map[i] = -i;
+    EXPECT_EQ(100u, map.size());
+    EXPECT_EQ(-42, map[42]);
+
+    using UnorderedMap =
+        std::unordered_map<int, int, std::hash<int>, std::equal_to<int>,
+                           ArenaAllocator<std::pair<const int, int>>>;
+    UnorderedMap unordered_map{
+        0, std::hash<int>(), std::equal_to<int>(),
+        ArenaAllocator<std::pair<const int, int>>(&arena)};
+    for (int i = 0; i < 100; ++i)
+      unordered_map[i] = -i;
+    EXPECT_EQ(-42, unordered_map[42]);
+  }
+  EXPECT_GT(arena.GetUsedBytes(), 1000 * sizeof(int));
+
+  Arena other_arena;
+  EXPECT_EQ(ArenaAllocator<int>(&arena), ArenaAllocator<char>(&arena));
+  EXPECT_NE(ArenaAllocator<int>(&arena), ArenaAllocator<int>(&other_arena));
+}
+
+// Otherwise, PartitionAlloc doesn't allocate any memory.
+#if BUILDFLAG(USE_PARTITION_ALLOC) && !defined(OS_NACL) && \
+    !defined(MEMORY_TOOL_REPLACES_ALLOCATOR)
+TEST(ArenaTest, PartitionAlloc) {
+  PartitionAllocatorGeneric allocator;
+  allocator.init();
+  PartitionRootGeneric* root = allocator.root();
+  size_t committed_before = root->total_size_of_committed_pages;
+  size_t committed_with_arena;
+  {
+    Arena arena(root);
+    std::vector<int> destroyed;
+    arena.New<DestructionRecorder>(&destroyed, 1);
+    memset(arena.Alloc(10000), 'a', 10000);
+    committed_with_arena = root->total_size_of_committed_pages;
+    EXPECT_GT(committed_with_arena, committed_before);
+  }
+  // The chunks were freed to the partition.
+  root->PurgeMemory(PartitionPurgeDecommitEmptyPages);
+  EXPECT_LT(root->total_size_of_committed_pages, committed_with_arena);
+}
+#endif  // BUILDFLAG(USE_PARTITION_ALLOC) && !defined(OS_NACL) &&
+        // !defined(MEMORY_TOOL_REPLACES_ALLOCATOR)
+
+}  // namespace base
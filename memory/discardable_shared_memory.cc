@@ -368,12 +368,22 @@ bool DiscardableSharedMemory::Purge(Time current_time) {
     return false;
   }
 
-// The next section will release as much resource as can be done
-// from the purging process, until the client process notices the
-// purge and releases its own references.
-// Note: this memory will not be accessed again.  The segment will be
-// freed asynchronously at a later time, so just do the best
-// immediately.
+  // Release as much resource as can be done from the purging process, until
+  // the client process notices the purge and releases its own references.
+  // Note: this memory will not be accessed again.  The segment will be freed
+  // asynchronously at a later time, so just do the best immediately.
+  ReleaseMemoryIfPossible(0, AlignToPageSize(mapped_size_));
+
+  last_known_usage_ = Time();
+  return true;
+}
+
+void DiscardableSharedMemory::ReleaseMemoryIfPossible(size_t offset,
+                                                      size_t length) {
+  DCHECK_EQ(AlignToPageSize(offset), offset);
+  DCHECK_EQ(AlignToPageSize(length), length);
+  DCHECK(shared_memory_mapping_.IsValid());
+
 #if defined(OS_POSIX) && !defined(OS_NACL)
 // Linux and Android provide MADV_REMOVE which is preferred as it has a
 // behavior that can be verified in tests. Other POSIX flavors (MacOSX, BSDs),
@@ -391,9 +401,8 @@ bool DiscardableSharedMemory::Purge(Time current_time) {
   // Advise the kernel to remove resources associated with purged pages.
   // Subsequent accesses of memory pages will succeed, but might result in
   // zero-fill-on-demand pages.
-  if (madvise(static_cast<char*>(shared_memory_mapping_.memory()) +
-                  AlignToPageSize(sizeof(SharedState)),
-              AlignToPageSize(mapped_size_), MADV_PURGE_ARGUMENT)) {
+  if (madvise(static_cast<char*>(memory()) + offset, length,
+              MADV_PURGE_ARGUMENT)) {
     DPLOG(ERROR) << "madvise() failed";
   }
 #elif defined(OS_WIN)
@@ -405,9 +414,7 @@ bool DiscardableSharedMemory::Purge(Time current_time) {
       reinterpret_cast<DiscardVirtualMemoryFunction>(GetProcAddress(
           GetModuleHandle(L"Kernel32.dll"), "DiscardVirtualMemory"));
 
-  char* address = static_cast<char*>(shared_memory_mapping_.memory()) +
-                  AlignToPageSize(sizeof(SharedState));
-  size_t length = AlignToPageSize(mapped_size_);
+  char* address = static_cast<char*>(memory()) + offset;
 
   // Use DiscardVirtualMemory when available because it releases faster than
   // MEM_RESET.
@@ -425,13 +432,11 @@ bool DiscardableSharedMemory::Purge(Time current_time) {
 #elif defined(OS_FUCHSIA)
   zx::unowned_vmo vmo = shared_memory_region_.GetPlatformHandle();
   zx_status_t status =
-      vmo->op_range(ZX_VMO_OP_DECOMMIT, AlignToPageSize(sizeof(SharedState)),
-                    AlignToPageSize(mapped_size_), nullptr, 0);
+      vmo->op_range(ZX_VMO_OP_DECOMMIT,
+                    AlignToPageSize(sizeof(SharedState)) + offset, length,
+                    nullptr, 0);
   ZX_DCHECK(status == ZX_OK, status) << "zx_vmo_op_range(ZX_VMO_OP_DECOMMIT)";
 #endif  // defined(OS_FUCHSIA)
-
-  last_known_usage_ = Time();
-  return true;
 }
 
 bool DiscardableSharedMemory::IsMemoryResident() const {
@@ -130,6 +130,13 @@ class BASE_EXPORT DiscardableSharedMemory {
   // each call.
   bool Purge(Time current_time);
 
+  // Releases the resources associated with a range of memory, if the platform
+  // supports it. The content of the range is lost: it may be zero-filled on
+  // demand afterwards. The range must be unlocked, and not accessed by another
+  // process. |offset| and |length| must both be a multiple of the page size as
+  // returned by GetPageSize().
+  void ReleaseMemoryIfPossible(size_t offset, size_t length);
+
   // Returns true if memory is still resident.
   bool IsMemoryResident() const;
 
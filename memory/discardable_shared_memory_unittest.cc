@@ -5,6 +5,9 @@
 #include <fcntl.h>
 #include <stdint.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "base/files/scoped_file.h"
 #include "base/memory/discardable_shared_memory.h"
 #include "base/memory/shared_memory_tracker.h"
@@ -431,6 +434,25 @@ TEST(DiscardableSharedMemoryTest, ZeroFilledPagesAfterPurge) {
   uint8_t expected_data[kDataSize] = {};
   EXPECT_EQ(memcmp(memory2.memory(), expected_data, kDataSize), 0);
 }
+
+TEST(DiscardableSharedMemoryTest, ReleaseMemoryIfPossible) {
+  const size_t kPageSize = GetPageSize();
+
+  TestDiscardableSharedMemory memory;
+  bool rv = memory.CreateAndMap(2 * kPageSize);
+  ASSERT_TRUE(rv);
+  memset(memory.memory(), 0xaa, 2 * kPageSize);
+
+  // Only the released range is zero-filled.
+  memory.SetNow(Time::FromDoubleT(1));
+  memory.Unlock(kPageSize, kPageSize);
+  memory.ReleaseMemoryIfPossible(kPageSize, kPageSize);
+  std::vector<uint8_t> expected_data(kPageSize, 0);
+  uint8_t* data = static_cast<uint8_t*>(memory.memory());
+  EXPECT_EQ(0, memcmp(data + kPageSize, expected_data.data(), kPageSize));
+  std::fill(expected_data.begin(), expected_data.end(), 0xaa);
+  EXPECT_EQ(0, memcmp(data, expected_data.data(), kPageSize));
+}
 #endif
 
 TEST(DiscardableSharedMemoryTest, TracingOwnershipEdges) {
@@ -0,0 +1,461 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/memory/memory_pressure_monitor_linux.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/logging.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/stl_util.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_piece.h"
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
+#include "base/task/post_task.h"
+#include "base/threading/scoped_blocking_call.h"
+#include "base/threading/thread_task_runner_handle.h"
+
+namespace base {
+
+namespace {
+
+constexpr char kPsiFile[] = "/proc/pressure/memory";
+constexpr char kProcSelfCgroupFile[] = "/proc/self/cgroup";
+constexpr char kCgroupRoot[] = "/sys/fs/cgroup";
+
+// Wakes up the monitor when tasks stalled on memory for 150ms within a 2s
+// window. Unprivileged processes can only register windows which are
+// multiples of 2s. This is below the moderate threshold, so that the level is
+// checked as pressure builds up.
+constexpr char kPsiTrigger[] = "some 150000 2000000";
+
+// Reads a small file from procfs or cgroupfs. These are generated by the
+// kernel, and reading them doesn't block on I/O, so this doesn't go through
+// ReadFileToString(), which may not be called on threads which disallow
+// blocking.
+bool ReadKernelFile(const FilePath& path, std::string* contents) {
+  ScopedFD fd(HANDLE_EINTR(open(path.value().c_str(), O_RDONLY | O_CLOEXEC)));
+  if (!fd.is_valid())
+    return false;
+
+  contents->clear();
+  char buffer[4096];
+  while (true) {
+    ssize_t bytes_read = HANDLE_EINTR(read(fd.get(), buffer, sizeof(buffer)));
+    if (bytes_read < 0)
+      return false;
+    if (bytes_read == 0)
+      return true;
+    contents->append(buffer, bytes_read);
+  }
+}
+
+// Reads a memory.max or memory.high file. Returns 0 if there is no limit.
+uint64_t ReadCgroupLimit(const FilePath& path) {
+  std::string contents;
+  uint64_t limit = 0;
+  if (!ReadKernelFile(path, &contents) ||
+      !StringToUint64(TrimWhitespaceASCII(contents, TRIM_ALL), &limit)) {
+    // Either "max", or the file doesn't exist.
+    return 0;
+  }
+  return limit;
+}
+
+// Returns true if |value| engages |level|, given the |current| level.
+bool IsEngaged(double value,
+               const MemoryPressureMonitorLinux::Threshold& threshold,
+               MemoryPressureListener::MemoryPressureLevel level,
+               MemoryPressureListener::MemoryPressureLevel current) {
+  return value >= threshold.raise ||
+         (current >= level && value >= threshold.release);
+}
+
+}  // namespace
+
+// Holds the file descriptors which are polled in the thread pool, so that they
+// outlive the wait, even if the monitor is destroyed during it.
+class MemoryPressureMonitorLinux::PsiTrigger
+    : public RefCountedThreadSafe<PsiTrigger> {
+ public:
+  PsiTrigger(ScopedFD trigger_fd, ScopedFD cancel_fd)
+      : trigger_fd_(std::move(trigger_fd)), cancel_fd_(std::move(cancel_fd)) {}
+
+  // Blocks until the trigger fires, and returns true, or until the write end
+  // of the cancellation pipe is closed, and returns false.
+  bool Wait() {
+    ScopedBlockingCall scoped_blocking_call(FROM_HERE,
+                                            BlockingType::WILL_BLOCK);
+
+    pollfd fds[] = {{trigger_fd_.get(), POLLPRI, 0},
+                    {cancel_fd_.get(), POLLIN, 0}};
+    int res = HANDLE_EINTR(poll(fds, base::size(fds), -1));
+    if (res == -1) {
+      DPLOG(ERROR) << "poll";
+      return false;
+    }
+    if (fds[1].revents)
+      return false;
+    // POLLERR means that the trigger was torn down.
+    return (fds[0].revents & POLLPRI) && !(fds[0].revents & POLLERR);
+  }
+
+ private:
+  friend class RefCountedThreadSafe<PsiTrigger>;
+  ~PsiTrigger() = default;
+
+  const ScopedFD trigger_fd_;
+  const ScopedFD cancel_fd_;
+
+  DISALLOW_COPY_AND_ASSIGN(PsiTrigger);
+};
+
+// These have yet to be tuned with field data. Tasks stalling 10% of the time
+// already cost latency, and all of them stalling as much means that the system
+// is thrashing. The working set of a cgroup can reach its limit, but then the
+// kernel reclaims or kills synchronously, so pressure is signaled ahead of it.
+const MemoryPressureMonitorLinux::Threshold
+    MemoryPressureMonitorLinux::kModeratePsiSomeThreshold = {10.0, 5.0};
+const MemoryPressureMonitorLinux::Threshold
+    MemoryPressureMonitorLinux::kCriticalPsiFullThreshold = {10.0, 5.0};
+const MemoryPressureMonitorLinux::Threshold
+    MemoryPressureMonitorLinux::kModerateCgroupUsageThreshold = {0.85, 0.80};
+const MemoryPressureMonitorLinux::Threshold
+    MemoryPressureMonitorLinux::kCriticalCgroupUsageThreshold = {0.95, 0.90};
+
+const TimeDelta MemoryPressureMonitorLinux::kPollingInterval =
+    TimeDelta::FromSeconds(1);
+const TimeDelta MemoryPressureMonitorLinux::kModeratePressureCooldown =
+    TimeDelta::FromSeconds(10);
+
+MemoryPressureMonitorLinux::MemoryPressureMonitorLinux()
+    : psi_file_(kPsiFile),
+      cgroup_dir_([] {
+        std::string proc_self_cgroup;
+        if (!ReadKernelFile(FilePath(kProcSelfCgroupFile), &proc_self_cgroup))
+          return FilePath();
+        return GetCgroupDir(proc_self_cgroup, FilePath(kCgroupRoot));
+      }()),
+      dispatch_callback_(
+          BindRepeating(&MemoryPressureListener::NotifyMemoryPressure)),
+      weak_ptr_factory_(this) {
+  StartObserving(/* use_psi_trigger= */ true);
+}
+
+MemoryPressureMonitorLinux::MemoryPressureMonitorLinux(
+    const FilePath& psi_file,
+    const FilePath& cgroup_dir,
+    bool start_observing)
+    : psi_file_(psi_file),
+      cgroup_dir_(cgroup_dir),
+      dispatch_callback_(
+          BindRepeating(&MemoryPressureListener::NotifyMemoryPressure)),
+      weak_ptr_factory_(this) {
+  if (start_observing)
+    StartObserving(/* use_psi_trigger= */ false);
+}
+
+MemoryPressureMonitorLinux::~MemoryPressureMonitorLinux() {
+  DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+  // Stops waiting for the PSI trigger, if any.
+  psi_trigger_cancel_fd_.reset();
+}
+
+// static
+bool MemoryPressureMonitorLinux::IsSupported() {
+  std::string contents;
+  double some_avg10;
+  double full_avg10;
+  if (ReadKernelFile(FilePath(kPsiFile), &contents) &&
+      ParsePsi(contents, &some_avg10, &full_avg10)) {
+    return true;
+  }
+
+  if (!ReadKernelFile(FilePath(kProcSelfCgroupFile), &contents))
+    return false;
+  FilePath cgroup_dir = GetCgroupDir(contents, FilePath(kCgroupRoot));
+  return !cgroup_dir.empty() &&
+         ReadKernelFile(cgroup_dir.Append("memory.current"), &contents);
+}
+
+void MemoryPressureMonitorLinux::CheckMemoryPressureSoon() {
+  DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+
+  ThreadTaskRunnerHandle::Get()->PostTask(
+      FROM_HERE, BindOnce(&MemoryPressureMonitorLinux::CheckMemoryPressure,
+                          weak_ptr_factory_.GetWeakPtr()));
+}
+
+MemoryPressureListener::MemoryPressureLevel
+MemoryPressureMonitorLinux::GetCurrentPressureLevel() const {
+  return current_memory_pressure_level_;
+}
+
+void MemoryPressureMonitorLinux::SetDispatchCallback(
+    const DispatchCallback& callback) {
+  dispatch_callback_ = callback;
+}
+
+// static
+bool MemoryPressureMonitorLinux::ParsePsi(const std::string& contents,
+                                          double* some_avg10,
+                                          double* full_avg10) {
+  bool has_some = false;
+  *full_avg10 = 0;
+  for (StringPiece line : SplitStringPiece(contents, "\n", TRIM_WHITESPACE,
+                                           SPLIT_WANT_NONEMPTY)) {
+    // Lines look like "some avg10=1.23 avg60=0.45 avg300=0.06 total=123456".
+    std::vector<StringPiece> fields =
+        SplitStringPiece(line, " ", TRIM_WHITESPACE, SPLIT_WANT_NONEMPTY);
+    if (fields.size() < 2 || !StartsWith(fields[1], "avg10=",
+                                         CompareCase::SENSITIVE)) {
+      return false;
+    }
+    double avg10;
+    if (!StringToDouble(fields[1].substr(strlen("avg10=")).as_string(),
+                        &avg10)) {
+      return false;
+    }
+
+    if (fields[0] == "some") {
+      *some_avg10 = avg10;
+      has_some = true;
+    } else if (fields[0] == "full") {
+      *full_avg10 = avg10;
+    }
+  }
+  return has_some;
+}
+
+// static
+uint64_t MemoryPressureMonitorLinux::GetKeyedValue(const std::string& contents,
+                                                   const std::string& key) {
+  for (StringPiece line : SplitStringPiece(contents, "\n", TRIM_WHITESPACE,
+                                           SPLIT_WANT_NONEMPTY)) {
+    std::vector<StringPiece> fields =
+        SplitStringPiece(line, " ", TRIM_WHITESPACE, SPLIT_WANT_NONEMPTY);
+    uint64_t value;
+    if (fields.size() == 2 && fields[0] == key &&
+        StringToUint64(fields[1], &value)) {
+      return value;
+    }
+  }
+  return 0;
+}
+
+// static
+FilePath MemoryPressureMonitorLinux::GetCgroupDir(
+    const std::string& proc_self_cgroup,
+    const FilePath& cgroup_root) {
+  // The cgroup v2 hierarchy has ID 0, and no controller list, as in
+  // "0::/system.slice/foo.service". The lines of the cgroup v1 hierarchies, if
+  // any, are ignored.
+  constexpr char kUnifiedPrefix[] = "0::/";
+  for (StringPiece line : SplitStringPiece(proc_self_cgroup, "\n",
+                                           TRIM_WHITESPACE,
+                                           SPLIT_WANT_NONEMPTY)) {
+    if (!StartsWith(line, kUnifiedPrefix, CompareCase::SENSITIVE))
+      continue;
+    FilePath relative_path(line.substr(strlen(kUnifiedPrefix)));
+    if (relative_path.empty())
+      return cgroup_root;
+    if (relative_path.IsAbsolute() || relative_path.ReferencesParent())
+      return FilePath();
+    return cgroup_root.Append(relative_path);
+  }
+  return FilePath();
+}
+
+MemoryPressureMonitorLinux::Stats MemoryPressureMonitorLinux::ReadStats()
+    const {
+  Stats stats;
+  std::string contents;
+
+  if (!psi_file_.empty() && ReadKernelFile(psi_file_, &contents)) {
+    stats.has_psi =
+        ParsePsi(contents, &stats.psi_some_avg10, &stats.psi_full_avg10);
+  }
+
+  uint64_t current = 0;
+  if (!cgroup_dir_.empty() &&
+      ReadKernelFile(cgroup_dir_.Append("memory.current"), &contents) &&
+      StringToUint64(TrimWhitespaceASCII(contents, TRIM_ALL), &current)) {
+    stats.has_cgroup = true;
+
+    // The inactive page cache is the first to be reclaimed, rather than a
+    // reason to kill anything, so it isn't counted as in use.
+    uint64_t inactive_file = 0;
+    if (ReadKernelFile(cgroup_dir_.Append("memory.stat"), &contents))
+      inactive_file = GetKeyedValue(contents, "inactive_file");
+    stats.cgroup_working_set = current - std::min(current, inactive_file);
+
+    uint64_t max = ReadCgroupLimit(cgroup_dir_.Append("memory.max"));
+    uint64_t high = ReadCgroupLimit(cgroup_dir_.Append("memory.high"));
+    if (max && high)
+      stats.cgroup_limit = std::min(max, high);
+    else
+      stats.cgroup_limit = std::max(max, high);
+
+    if (ReadKernelFile(cgroup_dir_.Append("memory.events"), &contents)) {
+      // Hitting memory.max only makes the kernel reclaim, like memory.high.
+      // Nothing is killed unless that fails, which the "oom" counters record.
+      stats.cgroup_high_events = GetKeyedValue(contents, "high") +
+                                 GetKeyedValue(contents, "max");
+      stats.cgroup_oom_events = GetKeyedValue(contents, "oom") +
+                                GetKeyedValue(contents, "oom_kill");
+    }
+  }
+
+  return stats;
+}
+
+MemoryPressureListener::MemoryPressureLevel
+MemoryPressureMonitorLinux::CalculatePressureLevel(const Stats& stats) {
+  constexpr MemoryPressureLevel kModerate =
+      MemoryPressureListener::MEMORY_PRESSURE_LEVEL_MODERATE;
+  constexpr MemoryPressureLevel kCritical =
+      MemoryPressureListener::MEMORY_PRESSURE_LEVEL_CRITICAL;
+  const MemoryPressureLevel current = current_memory_pressure_level_;
+
+  bool moderate = false;
+  bool critical = false;
+
+  if (stats.has_psi) {
+    moderate |= IsEngaged(stats.psi_some_avg10, kModeratePsiSomeThreshold,
+                          kModerate, current);
+    critical |= IsEngaged(stats.psi_full_avg10, kCriticalPsiFullThreshold,
+                          kCritical, current);
+  }
+
+  if (stats.has_cgroup) {
+    if (stats.cgroup_limit) {
+      double usage = static_cast<double>(stats.cgroup_working_set) /
+                     static_cast<double>(stats.cgroup_limit);
+      moderate |=
+          IsEngaged(usage, kModerateCgroupUsageThreshold, kModerate, current);
+      critical |=
+          IsEngaged(usage, kCriticalCgroupUsageThreshold, kCritical, current);
+    }
+
+    // The counters only ever grow, unless the cgroup was replaced, in which
+    // case the new counters are the baseline.
+    if (has_cgroup_event_baseline_ &&
+        stats.cgroup_high_events >= last_cgroup_high_events_ &&
+        stats.cgroup_oom_events >= last_cgroup_oom_events_) {
+      moderate |= stats.cgroup_high_events > last_cgroup_high_events_;
+      critical |= stats.cgroup_oom_events > last_cgroup_oom_events_;
+    }
+    has_cgroup_event_baseline_ = true;
+    last_cgroup_high_events_ = stats.cgroup_high_events;
+    last_cgroup_oom_events_ = stats.cgroup_oom_events;
+  }
+
+  if (critical)
+    return kCritical;
+  if (moderate)
+    return kModerate;
+  return MemoryPressureListener::MEMORY_PRESSURE_LEVEL_NONE;
+}
+
+void MemoryPressureMonitorLinux::CheckMemoryPressure() {
+  DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+
+  MemoryPressureLevel previous_level = current_memory_pressure_level_;
+  current_memory_pressure_level_ = CalculatePressureLevel(ReadStats());
+  if (current_memory_pressure_level_ ==
+      MemoryPressureListener::MEMORY_PRESSURE_LEVEL_NONE) {
+    last_moderate_notification_ = TimeTicks();
+    return;
+  }
+
+  // Critical pressure is signaled at every check, until it is released, but
+  // moderate pressure may last for a long time, so it is signaled less often.
+  if (current_memory_pressure_level_ ==
+      MemoryPressureListener::MEMORY_PRESSURE_LEVEL_MODERATE) {
+    TimeTicks now = TimeTicks::Now();
+    if (previous_level == current_memory_pressure_level_ &&
+        now - last_moderate_notification_ < kModeratePressureCooldown) {
+      return;
+    }
+    last_moderate_notification_ = now;
+  }
+
+  dispatch_callback_.Run(current_memory_pressure_level_);
+}
+
+void MemoryPressureMonitorLinux::CheckMemoryPressureAndRecordStatistics() {
+  CheckMemoryPressure();
+
+  if (TimeTicks::Now() - last_pressure_level_report_ >=
+      kUMAMemoryPressureLevelPeriod) {
+    // Record to UMA "Memory.PressureLevel", a tick is 5 seconds.
+    RecordMemoryPressure(current_memory_pressure_level_, 1);
+    last_pressure_level_report_ = TimeTicks::Now();
+  }
+}
+
+void MemoryPressureMonitorLinux::StartObserving(bool use_psi_trigger) {
+  DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+
+  timer_.Start(
+      FROM_HERE, kPollingInterval,
+      BindRepeating(
+          &MemoryPressureMonitorLinux::CheckMemoryPressureAndRecordStatistics,
+          weak_ptr_factory_.GetWeakPtr()));
+
+  if (!use_psi_trigger || psi_file_.empty())
+    return;
+
+  // Registering a trigger requires write access to the PSI file, and older
+  // kernels only allow it to privileged processes. The timer is enough
+  // otherwise.
+  ScopedFD trigger_fd(HANDLE_EINTR(
+      open(psi_file_.value().c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC)));
+  if (!trigger_fd.is_valid() ||
+      HANDLE_EINTR(write(trigger_fd.get(), kPsiTrigger,
+                         sizeof(kPsiTrigger))) < 0) {
+    VPLOG(1) << "Can't register a PSI trigger";
+    return;
+  }
+
+  int pipe_fds[2];
+  if (pipe2(pipe_fds, O_CLOEXEC) != 0) {
+    DPLOG(ERROR) << "pipe2";
+    return;
+  }
+  psi_trigger_ = MakeRefCounted<PsiTrigger>(std::move(trigger_fd),
+                                            ScopedFD(pipe_fds[0]));
+  psi_trigger_cancel_fd_.reset(pipe_fds[1]);
+  ScheduleWaitForPsiTrigger();
+}
+
+void MemoryPressureMonitorLinux::ScheduleWaitForPsiTrigger() {
+  // The wait is cancelled when the monitor is destroyed, but not on shutdown,
+  // which must not wait for it.
+  PostTaskAndReplyWithResult(
+      FROM_HERE,
+      {ThreadPool(), MayBlock(), TaskShutdownBehavior::CONTINUE_ON_SHUTDOWN},
+      BindOnce(&PsiTrigger::Wait, psi_trigger_),
+      BindOnce(&MemoryPressureMonitorLinux::OnPsiTriggerFired,
+               weak_ptr_factory_.GetWeakPtr()));
+}
+
+void MemoryPressureMonitorLinux::OnPsiTriggerFired(bool fired) {
+  // The timer keeps going if the trigger stopped working.
+  if (!fired)
+    return;
+
+  CheckMemoryPressure();
+  ScheduleWaitForPsiTrigger();
+}
+
+}  // namespace base
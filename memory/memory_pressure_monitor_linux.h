@@ -0,0 +1,188 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_MEMORY_MEMORY_PRESSURE_MONITOR_LINUX_H_
+#define BASE_MEMORY_MEMORY_PRESSURE_MONITOR_LINUX_H_
+
+#include <stdint.h>
+
+#include <string>
+
+#include "base/base_export.h"
+#include "base/files/file_path.h"
+#include "base/files/scoped_file.h"
+#include "base/macros.h"
+#include "base/memory/memory_pressure_listener.h"
+#include "base/memory/memory_pressure_monitor.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/weak_ptr.h"
+#include "base/threading/thread_checker.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
+
+namespace base {
+
+////////////////////////////////////////////////////////////////////////////////
+// MemoryPressureMonitorLinux
+//
+// A memory pressure monitor for generic Linux systems, such as servers and
+// containers, where neither the ChromeOS low-memory notifier nor a global free
+// memory figure tell when the process is about to run out of memory. It
+// combines two sources:
+//
+// - Pressure stall information (PSI), from /proc/pressure/memory, which tells
+//   how much time tasks spent waiting for memory over the last 10 seconds. A
+//   PSI trigger is registered, when the kernel allows it, to be woken up as
+//   soon as stalls exceed a threshold, rather than at the next polling
+//   interval.
+// - The cgroup v2 memory controller of the process, whose memory.max and
+//   memory.high limits are what the OOM killer enforces in containers. The
+//   working set (memory.current, minus the inactive page cache) is compared to
+//   the tightest of the limits, and the "high", "max", "oom" and "oom_kill"
+//   counters of memory.events tell when the kernel had to reclaim or kill.
+//   Only the cgroup of the process is considered, not limits set on its
+//   ancestors.
+//
+// Either source may be missing, in which case the other one is used alone. The
+// level is the highest one reported by any source. Each threshold has a lower
+// release value, so that the level doesn't flap when a value hovers around the
+// threshold.
+class BASE_EXPORT MemoryPressureMonitorLinux : public MemoryPressureMonitor {
+ public:
+  // Thresholds of a value which raise the memory pressure level when reached,
+  // and release it when the value drops below |release|.
+  struct Threshold {
+    double raise;
+    double release;
+  };
+
+  // Percentage of time some tasks stalled on memory over the last 10 seconds,
+  // which engages moderate memory pressure.
+  static const Threshold kModeratePsiSomeThreshold;
+  // Percentage of time all the non-idle tasks stalled on memory over the last
+  // 10 seconds, which engages critical memory pressure.
+  static const Threshold kCriticalPsiFullThreshold;
+  // Ratios of the working set of the cgroup to its limit.
+  static const Threshold kModerateCgroupUsageThreshold;
+  static const Threshold kCriticalCgroupUsageThreshold;
+
+  // The interval at which the sources are polled.
+  static const TimeDelta kPollingInterval;
+  // The time which should pass between 2 successive moderate memory pressure
+  // signals.
+  static const TimeDelta kModeratePressureCooldown;
+
+  // Monitors /proc/pressure/memory, and the cgroup v2 of the process.
+  MemoryPressureMonitorLinux();
+  ~MemoryPressureMonitorLinux() override;
+
+  // Returns true if the kernel exposes PSI or a cgroup v2 memory controller for
+  // the process. Otherwise, the monitor would never report memory pressure.
+  static bool IsSupported();
+
+  // Schedules a memory pressure check to run soon. This must be called on the
+  // same thread where the monitor was instantiated.
+  void CheckMemoryPressureSoon();
+
+  // MemoryPressureMonitor:
+  MemoryPressureLevel GetCurrentPressureLevel() const override;
+  void SetDispatchCallback(const DispatchCallback& callback) override;
+
+ protected:
+  // The memory figures read from the sources.
+  struct Stats {
+    bool has_psi = false;
+    double psi_some_avg10 = 0;
+    double psi_full_avg10 = 0;
+
+    bool has_cgroup = false;
+    // Bytes in use by the cgroup, minus inactive page cache.
+    uint64_t cgroup_working_set = 0;
+    // The tightest of memory.max and memory.high, or 0 if there is none.
+    uint64_t cgroup_limit = 0;
+    // Total of the "high" and "max" counters from memory.events.
+    uint64_t cgroup_high_events = 0;
+    // Total of the "oom" and "oom_kill" counters.
+    uint64_t cgroup_oom_events = 0;
+  };
+
+  // For testing. Reads PSI from |psi_file| and the cgroup from |cgroup_dir|,
+  // either of which can be empty to disable the source. The polling timer is
+  // only started if |start_observing| is true, and a PSI trigger is never
+  // registered.
+  MemoryPressureMonitorLinux(const FilePath& psi_file,
+                             const FilePath& cgroup_dir,
+                             bool start_observing);
+
+  // Parses the content of a PSI file. Returns false if it can't be parsed. The
+  // "full" line is missing for the CPU, and older kernels, in which case
+  // |full_avg10| is set to 0.
+  static bool ParsePsi(const std::string& contents,
+                       double* some_avg10,
+                       double* full_avg10);
+  // Returns the value of the "<key> <value>" line of |contents|, as found in
+  // memory.events and memory.stat, or 0 if there is none.
+  static uint64_t GetKeyedValue(const std::string& contents,
+                                const std::string& key);
+  // Returns the directory of the cgroup v2 of the process, under
+  // |cgroup_root|, given the content of /proc/self/cgroup. Returns an empty
+  // path if the process is not in a cgroup v2 hierarchy.
+  static FilePath GetCgroupDir(const std::string& proc_self_cgroup,
+                               const FilePath& cgroup_root);
+
+  // Reads the sources. Can be called on any thread.
+  Stats ReadStats() const;
+
+  // Calculates the memory pressure level from |stats|, given the level which
+  // is currently engaged, for hysteresis. Updates the baseline of the
+  // memory.events counters, so each event is only taken into account once.
+  MemoryPressureLevel CalculatePressureLevel(const Stats& stats);
+
+  // Reads the sources, updates the current level and dispatches it as needed.
+  void CheckMemoryPressure();
+
+ private:
+  class PsiTrigger;
+
+  void CheckMemoryPressureAndRecordStatistics();
+  void StartObserving(bool use_psi_trigger);
+  void ScheduleWaitForPsiTrigger();
+  void OnPsiTriggerFired(bool fired);
+
+  const FilePath psi_file_;
+  const FilePath cgroup_dir_;
+
+  MemoryPressureLevel current_memory_pressure_level_ =
+      MemoryPressureListener::MEMORY_PRESSURE_LEVEL_NONE;
+
+  // Counters of memory.events at the previous check, to detect new events.
+  bool has_cgroup_event_baseline_ = false;
+  uint64_t last_cgroup_high_events_ = 0;
+  uint64_t last_cgroup_oom_events_ = 0;
+
+  // We keep track of how long it has been since we last notified at the
+  // moderate level, and since we reported Memory.PressureLevel.
+  TimeTicks last_moderate_notification_;
+  TimeTicks last_pressure_level_report_;
+
+  DispatchCallback dispatch_callback_;
+
+  // A periodic timer to check for memory pressure changes.
+  RepeatingTimer timer_;
+
+  // The PSI trigger which is waited on in the thread pool, if the kernel
+  // allowed registering it. Closing |psi_trigger_cancel_fd_| stops the wait.
+  scoped_refptr<PsiTrigger> psi_trigger_;
+  ScopedFD psi_trigger_cancel_fd_;
+
+  THREAD_CHECKER(thread_checker_);
+
+  WeakPtrFactory<MemoryPressureMonitorLinux> weak_ptr_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(MemoryPressureMonitorLinux);
+};
+
+}  // namespace base
+
+#endif  // BASE_MEMORY_MEMORY_PRESSURE_MONITOR_LINUX_H_
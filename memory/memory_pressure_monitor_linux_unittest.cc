@@ -0,0 +1,363 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/memory/memory_pressure_monitor_linux.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/macros.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/stringprintf.h"
+#include "base/test/scoped_task_environment.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+constexpr MemoryPressureListener::MemoryPressureLevel kNone =
+    MemoryPressureListener::MEMORY_PRESSURE_LEVEL_NONE;
+constexpr MemoryPressureListener::MemoryPressureLevel kModerate =
+    MemoryPressureListener::MEMORY_PRESSURE_LEVEL_MODERATE;
+constexpr MemoryPressureListener::MemoryPressureLevel kCritical =
+    MemoryPressureListener::MEMORY_PRESSURE_LEVEL_CRITICAL;
+
+bool SetFileContents(const FilePath& path, const std::string& contents) {
+  return WriteFile(path, contents.c_str(), contents.size()) ==
+         static_cast<int>(contents.size());
+}
+
+void OnMemoryPressure(
+    std::vector<MemoryPressureListener::MemoryPressureLevel>* history,
+    MemoryPressureListener::MemoryPressureLevel level) {
+  history->push_back(level);
+}
+
+class TestMemoryPressureMonitor : public MemoryPressureMonitorLinux {
+ public:
+  TestMemoryPressureMonitor(const FilePath& psi_file,
+                            const FilePath& cgroup_dir,
+                            bool start_observing = false)
+      : MemoryPressureMonitorLinux(psi_file, cgroup_dir, start_observing) {}
+
+  using MemoryPressureMonitorLinux::CheckMemoryPressure;
+  using MemoryPressureMonitorLinux::GetCgroupDir;
+  using MemoryPressureMonitorLinux::GetKeyedValue;
+  using MemoryPressureMonitorLinux::ParsePsi;
+  using MemoryPressureMonitorLinux::ReadStats;
+  using MemoryPressureMonitorLinux::Stats;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(TestMemoryPressureMonitor);
+};
+
+class MemoryPressureMonitorLinuxTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    psi_file_ = temp_dir_.GetPath().Append("memory");
+    cgroup_dir_ = temp_dir_.GetPath().Append("cgroup");
+    ASSERT_TRUE(CreateDirectory(cgroup_dir_));
+  }
+
+  void SetPsi(double some_avg10, double full_avg10) {
+    ASSERT_TRUE(SetFileContents(
+        psi_file_,
+        StringPrintf("some avg10=%.2f avg60=0.00 avg300=0.00 total=1\n"
+                     "full avg10=%.2f avg60=0.00 avg300=0.00 total=1\n",
+                     some_avg10, full_avg10)));
+  }
+
+  void SetCgroupFile(const std::string& name, const std::string& contents) {
+    ASSERT_TRUE(SetFileContents(cgroup_dir_.Append(name), contents));
+  }
+
+  void SetCgroupEvents(int high, int max, int oom) {
+    SetCgroupFile("memory.events",
+                  StringPrintf("low 0\nhigh %d\nmax %d\noom %d\noom_kill 0\n",
+                               high, max, oom));
+  }
+
+  // Sets the working set of the cgroup to |percent| of a 1000-byte limit.
+  void SetCgroupUsage(int percent) {
+    SetCgroupFile("memory.current", NumberToString(percent * 10 + 100) + "\n");
+    SetCgroupFile("memory.stat", "anon 0\ninactive_file 100\n");
+  }
+
+  ScopedTempDir temp_dir_;
+  FilePath psi_file_;
+  FilePath cgroup_dir_;
+};
+
+}  // namespace
+
+TEST_F(MemoryPressureMonitorLinuxTest, ParsePsi) {
+  double some_avg10 = -1;
+  double full_avg10 = -1;
+  EXPECT_TRUE(TestMemoryPressureMonitor::ParsePsi(
+      "some avg10=12.50 avg60=3.10 avg300=0.70 total=123456\n"
+      "full avg10=4.25 avg60=1.00 avg300=0.20 total=65432\n",
+      &some_avg10, &full_avg10));
+  EXPECT_EQ(12.5, some_avg10);
+  EXPECT_EQ(4.25, full_avg10);
+
+  // Without a "full" line.
+  EXPECT_TRUE(TestMemoryPressureMonitor::ParsePsi(
+      "some avg10=1.00 avg60=0.00 avg300=0.00 total=1\n", &some_avg10,
+      &full_avg10));
+  EXPECT_EQ(1.0, some_avg10);
+  EXPECT_EQ(0.0, full_avg10);
+
+  EXPECT_FALSE(TestMemoryPressureMonitor::ParsePsi("", &some_avg10,
+                                                   &full_avg10));
+  EXPECT_FALSE(TestMemoryPressureMonitor::ParsePsi(
+      "some avg10=abc avg60=0.00 avg300=0.00 total=1\n", &some_avg10,
+      &full_avg10));
+  EXPECT_FALSE(TestMemoryPressureMonitor::ParsePsi("12 34\n", &some_avg10,
+                                                   &full_avg10));
+}
+
+TEST_F(MemoryPressureMonitorLinuxTest, GetKeyedValue) {
+  const std::string kEvents = "low 0\nhigh 12\nmax 3\noom 1\noom_kill 1\n";
+  EXPECT_EQ(12u, TestMemoryPressureMonitor::GetKeyedValue(kEvents, "high"));
+  EXPECT_EQ(1u, TestMemoryPressureMonitor::GetKeyedValue(kEvents, "oom"));
+  EXPECT_EQ(0u, TestMemoryPressureMonitor::GetKeyedValue(kEvents, "missing"));
+  EXPECT_EQ(0u, TestMemoryPressureMonitor::GetKeyedValue("high x\n", "high"));
+}
+
+TEST_F(MemoryPressureMonitorLinuxTest, GetCgroupDir) {
+  const FilePath kRoot("/sys/fs/cgroup");
+  EXPECT_EQ(FilePath("/sys/fs/cgroup/system.slice/foo.service"),
+            TestMemoryPressureMonitor::GetCgroupDir(
+                "0::/system.slice/foo.service\n", kRoot));
+  // In a cgroup namespace, as in most containers.
+  EXPECT_EQ(kRoot, TestMemoryPressureMonitor::GetCgroupDir("0::/\n", kRoot));
+  // Hybrid hierarchy.
+  EXPECT_EQ(FilePath("/sys/fs/cgroup/user.slice"),
+            TestMemoryPressureMonitor::GetCgroupDir(
+                "12:memory:/user.slice\n1:name=systemd:/user.slice\n"
+                "0::/user.slice\n",
+                kRoot));
+
+  // cgroup v1 only.
+  EXPECT_TRUE(TestMemoryPressureMonitor::GetCgroupDir(
+                  "12:memory:/user.slice\n1:name=systemd:/user.slice\n", kRoot)
+                  .empty());
+  EXPECT_TRUE(
+      TestMemoryPressureMonitor::GetCgroupDir("0::/../../etc\n", kRoot)
+          .empty());
+}
+
+TEST_F(MemoryPressureMonitorLinuxTest, ReadStats) {
+  SetPsi(1.5, 0.5);
+  SetCgroupFile("memory.current", "1000\n");
+  SetCgroupFile("memory.stat", "anon 700\ninactive_file 200\n");
+  SetCgroupFile("memory.max", "2000\n");
+  SetCgroupFile("memory.high", "max\n");
+  SetCgroupFile("memory.events",
+                "low 0\nhigh 2\nmax 3\noom 1\noom_kill 1\n");
+
+  std::unique_ptr<TestMemoryPressureMonitor> monitor =
+      std::make_unique<TestMemoryPressureMonitor>(psi_file_, cgroup_dir_);
+  TestMemoryPressureMonitor::Stats stats = monitor->ReadStats();
+  EXPECT_TRUE(stats.has_psi);
+  EXPECT_EQ(1.5, stats.psi_some_avg10);
+  EXPECT_EQ(0.5, stats.psi_full_avg10);
+  EXPECT_TRUE(stats.has_cgroup);
+  EXPECT_EQ(800u, stats.cgroup_working_set);
+  EXPECT_EQ(2000u, stats.cgroup_limit);
+  EXPECT_EQ(5u, stats.cgroup_high_events);
+  EXPECT_EQ(2u, stats.cgroup_oom_events);
+
+  // memory.high is tighter.
+  SetCgroupFile("memory.high", "1500\n");
+  EXPECT_EQ(1500u, monitor->ReadStats().cgroup_limit);
+
+  // No limit at all.
+  SetCgroupFile("memory.max", "max\n");
+  SetCgroupFile("memory.high", "max\n");
+  EXPECT_EQ(0u, monitor->ReadStats().cgroup_limit);
+
+  // Missing sources.
+  monitor = nullptr;
+  monitor = std::make_unique<TestMemoryPressureMonitor>(
+      FilePath(), temp_dir_.GetPath().Append("none"));
+  stats = monitor->ReadStats();
+  EXPECT_FALSE(stats.has_psi);
+  EXPECT_FALSE(stats.has_cgroup);
+}
+
+TEST_F(MemoryPressureMonitorLinuxTest, PsiLevels) {
+  TestMemoryPressureMonitor monitor(psi_file_, FilePath());
+  std::vector<MemoryPressureListener::MemoryPressureLevel> levels;
+  monitor.SetDispatchCallback(BindRepeating(&OnMemoryPressure, &levels));
+
+  SetPsi(1, 0);
+  monitor.CheckMemoryPressure();
+  EXPECT_EQ(kNone, monitor.GetCurrentPressureLevel());
+
+  SetPsi(20, 1);
+  monitor.CheckMemoryPressure();
+  EXPECT_EQ(kModerate, monitor.GetCurrentPressureLevel());
+
+  // Moderate pressure is released below the lower threshold only.
+  SetPsi(7, 1);
+  monitor.CheckMemoryPressure();
+  EXPECT_EQ(kModerate, monitor.GetCurrentPressureLevel());
+  SetPsi(4, 1);
+  monitor.CheckMemoryPressure();
+  EXPECT_EQ(kNone, monitor.GetCurrentPressureLevel());
+
+  SetPsi(50, 20);
+  monitor.CheckMemoryPressure();
+  EXPECT_EQ(kCritical, monitor.GetCurrentPressureLevel());
+  SetPsi(50, 7);
+  monitor.CheckMemoryPressure();
+  EXPECT_EQ(kCritical, monitor.GetCurrentPressureLevel());
+  SetPsi(50, 1);
+  monitor.CheckMemoryPressure();
+  EXPECT_EQ(kModerate, monitor.GetCurrentPressureLevel());
+
+  // Levels other than none are dispatched, and critical is repeated.
+  EXPECT_EQ(std::vector<MemoryPressureListener::MemoryPressureLevel>(
+                {kModerate, kCritical, kCritical, kModerate}),
+            levels);
+}
+
+TEST_F(MemoryPressureMonitorLinuxTest, CgroupUsageLevels) {
+  SetCgroupFile("memory.max", "1000\n");
+  SetCgroupEvents(0, 0, 0);
+  TestMemoryPressureMonitor monitor(FilePath(), cgroup_dir_);
+  std::vector<MemoryPressureListener::MemoryPressureLevel> levels;
+  monitor.SetDispatchCallback(BindRepeating(&OnMemoryPressure, &levels));
+
+  SetCgroupUsage(50);
+  monitor.CheckMemoryPressure();
+  EXPECT_EQ(kNone, monitor.GetCurrentPressureLevel());
+
+  SetCgroupUsage(90);
+  monitor.CheckMemoryPressure();
+  EXPECT_EQ(kModerate, monitor.GetCurrentPressureLevel());
+
+  SetCgroupUsage(96);
+  monitor.CheckMemoryPressure();
+  EXPECT_EQ(kCritical, monitor.GetCurrentPressureLevel());
+  SetCgroupUsage(92);
+  monitor.CheckMemoryPressure();
+  EXPECT_EQ(kCritical, monitor.GetCurrentPressureLevel());
+  SetCgroupUsage(82);
+  monitor.CheckMemoryPressure();
+  EXPECT_EQ(kModerate, monitor.GetCurrentPressureLevel());
+  SetCgroupUsage(70);
+  monitor.CheckMemoryPressure();
+  EXPECT_EQ(kNone, monitor.GetCurrentPressureLevel());
+
+  // Usage isn't a signal without a limit.
+  SetCgroupFile("memory.max", "max\n");
+  SetCgroupUsage(99);
+  monitor.CheckMemoryPressure();
+  EXPECT_EQ(kNone, monitor.GetCurrentPressureLevel());
+}
+
+TEST_F(MemoryPressureMonitorLinuxTest, CgroupEvents) {
+  SetCgroupUsage(10);
+  SetCgroupEvents(5, 0, 1);
+  TestMemoryPressureMonitor monitor(FilePath(), cgroup_dir_);
+  std::vector<MemoryPressureListener::MemoryPressureLevel> levels;
+  monitor.SetDispatchCallback(BindRepeating(&OnMemoryPressure, &levels));
+
+  // Past events are not taken into account.
+  monitor.CheckMemoryPressure();
+  EXPECT_EQ(kNone, monitor.GetCurrentPressureLevel());
+
+  SetCgroupEvents(6, 0, 1);
+  monitor.CheckMemoryPressure();
+  EXPECT_EQ(kModerate, monitor.GetCurrentPressureLevel());
+  monitor.CheckMemoryPressure();
+  EXPECT_EQ(kNone, monitor.GetCurrentPressureLevel());
+
+  SetCgroupEvents(6, 0, 2);
+  monitor.CheckMemoryPressure();
+  EXPECT_EQ(kCritical, monitor.GetCurrentPressureLevel());
+  monitor.CheckMemoryPressure();
+  EXPECT_EQ(kNone, monitor.GetCurrentPressureLevel());
+
+  // The cgroup was recreated.
+  SetCgroupEvents(0, 0, 0);
+  monitor.CheckMemoryPressure();
+  EXPECT_EQ(kNone, monitor.GetCurrentPressureLevel());
+}
+
+TEST_F(MemoryPressureMonitorLinuxTest, CgroupMaxEventsAreModerate) {
+  SetCgroupUsage(10);
+  SetCgroupEvents(0, 3, 0);
+  TestMemoryPressureMonitor monitor(FilePath(), cgroup_dir_);
+  std::vector<MemoryPressureListener::MemoryPressureLevel> levels;
+  monitor.SetDispatchCallback(BindRepeating(&OnMemoryPressure, &levels));
+
+  monitor.CheckMemoryPressure();
+  EXPECT_EQ(kNone, monitor.GetCurrentPressureLevel());
+
+  // Reclaim at memory.max, while the working set stays small, is not critical.
+  SetCgroupEvents(0, 4, 0);
+  monitor.CheckMemoryPressure();
+  EXPECT_EQ(kModerate, monitor.GetCurrentPressureLevel());
+  SetCgroupEvents(0, 10, 0);
+  monitor.CheckMemoryPressure();
+  EXPECT_EQ(kModerate, monitor.GetCurrentPressureLevel());
+  monitor.CheckMemoryPressure();
+  EXPECT_EQ(kNone, monitor.GetCurrentPressureLevel());
+}
+
+TEST_F(MemoryPressureMonitorLinuxTest, ModerateCooldown) {
+  TestMemoryPressureMonitor monitor(psi_file_, FilePath());
+  std::vector<MemoryPressureListener::MemoryPressureLevel> levels;
+  monitor.SetDispatchCallback(BindRepeating(&OnMemoryPressure, &levels));
+
+  SetPsi(20, 0);
+  monitor.CheckMemoryPressure();
+  monitor.CheckMemoryPressure();
+  EXPECT_EQ(kModerate, monitor.GetCurrentPressureLevel());
+  EXPECT_EQ(1u, levels.size());
+
+  // Back to moderate from critical.
+  SetPsi(20, 20);
+  monitor.CheckMemoryPressure();
+  SetPsi(20, 0);
+  monitor.CheckMemoryPressure();
+  EXPECT_EQ(std::vector<MemoryPressureListener::MemoryPressureLevel>(
+                {kModerate, kCritical, kModerate}),
+            levels);
+}
+
+TEST_F(MemoryPressureMonitorLinuxTest, PollsSources) {
+  test::ScopedTaskEnvironment scoped_task_environment(
+      test::ScopedTaskEnvironment::TimeSource::MOCK_TIME);
+  std::vector<MemoryPressureListener::MemoryPressureLevel> levels;
+  MemoryPressureListener listener(BindRepeating(&OnMemoryPressure, &levels));
+
+  SetPsi(0, 0);
+  TestMemoryPressureMonitor monitor(psi_file_, FilePath(),
+                                    /* start_observing= */ true);
+  scoped_task_environment.FastForwardBy(
+      MemoryPressureMonitorLinux::kPollingInterval);
+  EXPECT_EQ(kNone, monitor.GetCurrentPressureLevel());
+  EXPECT_TRUE(levels.empty());
+
+  // Dispatched to the listeners by default.
+  SetPsi(20, 20);
+  scoped_task_environment.FastForwardBy(
+      MemoryPressureMonitorLinux::kPollingInterval);
+  EXPECT_EQ(kCritical, monitor.GetCurrentPressureLevel());
+  EXPECT_EQ(std::vector<MemoryPressureListener::MemoryPressureLevel>(
+                {kCritical}),
+            levels);
+}
+
+}  // namespace base
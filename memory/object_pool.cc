@@ -0,0 +1,348 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/memory/object_pool.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <set>
+
+#include "base/allocator/partition_allocator/partition_alloc.h"
+#include "base/bits.h"
+#include "base/no_destructor.h"
+#include "base/strings/stringprintf.h"
+#include "base/trace_event/memory_allocator_dump.h"
+#include "base/trace_event/memory_dump_manager.h"
+#include "base/trace_event/memory_dump_provider.h"
+#include "base/trace_event/process_memory_dump.h"
+#include "build/build_config.h"
+
+namespace base {
+namespace internal {
+
+namespace {
+
+// The head of the free list packs the address of the top slot in its low bits
+// and the tag in its high bits. User-space addresses fit in 48 bits on the
+// supported 64-bit platforms.
+#if defined(ARCH_CPU_64_BITS)
+constexpr int kAddressBits = 48;
+#else
+constexpr int kAddressBits = 32;
+#endif
+constexpr uint64_t kAddressMask = (uint64_t{1} << kAddressBits) - 1;
+
+uint64_t PackHead(void* slot, uint64_t tag) {
+  return (tag << kAddressBits) | reinterpret_cast<uintptr_t>(slot);
+}
+
+template <typename SlotType>
+SlotType* SlotFromHead(uint64_t head) {
+  return reinterpret_cast<SlotType*>(
+      static_cast<uintptr_t>(head & kAddressMask));
+}
+
+constexpr uint64_t TagFromHead(uint64_t head) {
+  return head >> kAddressBits;
+}
+
+// Size of the slab allocations in the partition.
+#if DCHECK_IS_ON()
+// Cookies surround each allocation in DCHECK builds.
+constexpr size_t kSlabAllocationSize =
+    ObjectPoolBase::kSlabSize + 2 * kCookieSize;
+#else
+constexpr size_t kSlabAllocationSize = ObjectPoolBase::kSlabSize;
+#endif
+
+// Allocates the slabs of all the pools. PartitionRoot is not thread-safe, hence
+// the lock.
+class SlabAllocator {
+ public:
+  static SlabAllocator* Get() {
+    static NoDestructor<SlabAllocator> instance;
+    return instance.get();
+  }
+
+  SlabAllocator() { allocator_.init(); }
+
+  void* Alloc() {
+    AutoLock lock(lock_);
+    return allocator_.root()->Alloc(ObjectPoolBase::kSlabSize, "ObjectPool");
+  }
+
+  void Free(void* slab) {
+    AutoLock lock(lock_);
+    PartitionFree(slab);
+  }
+
+ private:
+  Lock lock_;
+  SizeSpecificPartitionAllocator<kSlabAllocationSize + kAllocationGranularity>
+      allocator_;
+
+  DISALLOW_COPY_AND_ASSIGN(SlabAllocator);
+};
+
+// Reports the usage of all the pools in memory dumps. A single provider, not
+// bound to a task runner, is registered, since providers without a task runner
+// can't be unregistered safely.
+class ObjectPoolDumpProvider : public trace_event::MemoryDumpProvider {
+ public:
+  static ObjectPoolDumpProvider* Get() {
+    static NoDestructor<ObjectPoolDumpProvider> instance;
+    return instance.get();
+  }
+
+  ObjectPoolDumpProvider() {
+    trace_event::MemoryDumpManager::GetInstance()->RegisterDumpProvider(
+        this, "ObjectPool", nullptr);
+  }
+
+  void AddPool(const ObjectPoolBase* pool) {
+    AutoLock lock(lock_);
+    bool inserted = pools_.insert(pool).second;
+    DCHECK(inserted);
+  }
+
+  void RemovePool(const ObjectPoolBase* pool) {
+    AutoLock lock(lock_);
+    size_t erased_count = pools_.erase(pool);
+    DCHECK_EQ(1u, erased_count);
+  }
+
+  // trace_event::MemoryDumpProvider implementation.
+  bool OnMemoryDump(const trace_event::MemoryDumpArgs& args,
+                    trace_event::ProcessMemoryDump* pmd) override {
+    AutoLock lock(lock_);
+    for (const ObjectPoolBase* pool : pools_)
+      pool->DumpStats(pmd);
+    return true;
+  }
+
+ private:
+  Lock lock_;
+  std::set<const ObjectPoolBase*> pools_ GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(ObjectPoolDumpProvider);
+};
+
+}  // namespace
+
+constexpr size_t ObjectPoolBase::kSlabSize;
+constexpr size_t ObjectPoolBase::kMaxAlignment;
+constexpr size_t ObjectPoolBase::kMagazineCapacity;
+
+struct ObjectPoolBase::Magazine {
+  explicit Magazine(ObjectPoolBase* pool) : pool(pool) {}
+
+  ObjectPoolBase* const pool;
+  size_t count = 0;
+  FreeSlot* slots[kMagazineCapacity];
+};
+
+ObjectPoolBase::ObjectPoolBase(const char* name,
+                               size_t object_size,
+                               size_t object_alignment,
+                               bool use_thread_magazines)
+    : name_(name),
+      slot_size_(bits::Align(std::max(object_size, sizeof(FreeSlot)),
+                             std::max(object_alignment, alignof(FreeSlot)))),
+      first_slot_offset_(bits::Align(sizeof(void*), object_alignment)),
+      slots_per_slab_((kSlabSize - first_slot_offset_) / slot_size_) {
+  DCHECK_LE(object_alignment, kMaxAlignment);
+  CHECK_GE(slots_per_slab_, 1u) << "Objects are too large for " << name_;
+  if (use_thread_magazines) {
+    magazine_slot_ =
+        std::make_unique<ThreadLocalStorage::Slot>(&ReleaseMagazine);
+  }
+  ObjectPoolDumpProvider::Get()->AddPool(this);
+}
+
+ObjectPoolBase::~ObjectPoolBase() {
+  ObjectPoolDumpProvider::Get()->RemovePool(this);
+
+  if (magazine_slot_) {
+    auto* magazine = static_cast<Magazine*>(magazine_slot_->Get());
+    if (magazine) {
+      magazine_slot_->Set(nullptr);
+      delete magazine;
+    }
+  }
+
+  AutoLock lock(lock_);
+  while (slabs_) {
+    void* slab = slabs_;
+    slabs_ = *static_cast<void**>(slab);
+    SlabAllocator::Get()->Free(slab);
+  }
+}
+
+void* ObjectPoolBase::Alloc() {
+#if defined(MEMORY_TOOL_REPLACES_ALLOCATOR)
+  // Lets the tool find the misuses of the objects.
+  return malloc(slot_size_);
+#else
+  if (!magazine_slot_)
+    return PopOrAllocateSlab();
+
+  Magazine* magazine = GetOrCreateMagazine();
+  if (!magazine->count) {
+    // Takes half of the capacity, so that alternating between allocating and
+    // freeing doesn't go to the shared free list every time.
+    magazine->slots[magazine->count++] = PopOrAllocateSlab();
+    while (magazine->count < kMagazineCapacity / 2) {
+      FreeSlot* slot = Pop();
+      if (!slot)
+        break;
+      magazine->slots[magazine->count++] = slot;
+    }
+  }
+  return magazine->slots[--magazine->count];
+#endif  // defined(MEMORY_TOOL_REPLACES_ALLOCATOR)
+}
+
+void ObjectPoolBase::Free(void* slot) {
+#if defined(MEMORY_TOOL_REPLACES_ALLOCATOR)
+  free(slot);
+#else
+  DCHECK(slot);
+  FreeSlot* free_slot = static_cast<FreeSlot*>(slot);
+  if (!magazine_slot_) {
+    free_slot->next = nullptr;
+    Push(free_slot, free_slot, 1);
+    return;
+  }
+
+  Magazine* magazine = GetOrCreateMagazine();
+  if (magazine->count == kMagazineCapacity)
+    FlushMagazine(magazine, kMagazineCapacity / 2);
+  magazine->slots[magazine->count++] = free_slot;
+#endif  // defined(MEMORY_TOOL_REPLACES_ALLOCATOR)
+}
+
+size_t ObjectPoolBase::GetSlabCount() const {
+  AutoLock lock(lock_);
+  return slab_count_;
+}
+
+size_t ObjectPoolBase::GetAllocatedCount() const {
+  size_t slot_count = GetSlabCount() * slots_per_slab_;
+  // Slots can be pushed concurrently with this, so the count of free slots may
+  // include slots of slabs allocated after reading the slab count.
+  return slot_count - std::min(slot_count,
+                               free_count_.load(std::memory_order_relaxed));
+}
+
+void ObjectPoolBase::DumpStats(trace_event::ProcessMemoryDump* pmd) const {
+  trace_event::MemoryAllocatorDump* dump =
+      pmd->CreateAllocatorDump(StringPrintf("object_pool/%s", name_));
+  dump->AddScalar(trace_event::MemoryAllocatorDump::kNameSize,
+                  trace_event::MemoryAllocatorDump::kUnitsBytes,
+                  GetSlabCount() * kSlabSize);
+  dump->AddScalar(trace_event::MemoryAllocatorDump::kNameObjectCount,
+                  trace_event::MemoryAllocatorDump::kUnitsObjects,
+                  GetAllocatedCount());
+  dump->AddScalar("slot_size", trace_event::MemoryAllocatorDump::kUnitsBytes,
+                  slot_size_);
+}
+
+void ObjectPoolBase::Push(FreeSlot* first, FreeSlot* last, size_t count) {
+  // Counted before being pushed, so that GetAllocatedCount() doesn't underflow
+  // when the slots are popped right away.
+  free_count_.fetch_add(count, std::memory_order_relaxed);
+  uint64_t head = free_list_.load(std::memory_order_relaxed);
+  do {
+    last->next = SlotFromHead<FreeSlot>(head);
+  } while (!free_list_.compare_exchange_weak(head,
+                                             PackHead(first, TagFromHead(head)),
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed));
+}
+
+ObjectPoolBase::FreeSlot* ObjectPoolBase::Pop() {
+  uint64_t head = free_list_.load(std::memory_order_acquire);
+  while (true) {
+    FreeSlot* slot = SlotFromHead<FreeSlot>(head);
+    if (!slot)
+      return nullptr;
+    // |slot| may have been popped, and even be in use, by now. This reads
+    // garbage then, but its memory is still mapped as slabs are only released
+    // with the pool, and the tag makes the exchange below fail.
+    uint64_t new_head = PackHead(slot->next, TagFromHead(head) + 1);
+    if (free_list_.compare_exchange_weak(head, new_head,
+                                         std::memory_order_acquire,
+                                         std::memory_order_acquire)) {
+      free_count_.fetch_sub(1, std::memory_order_relaxed);
+      return slot;
+    }
+  }
+}
+
+ObjectPoolBase::FreeSlot* ObjectPoolBase::PopOrAllocateSlab() {
+  FreeSlot* slot = Pop();
+  if (LIKELY(slot))
+    return slot;
+
+  AutoLock lock(lock_);
+  // Another thread may have allocated a slab while this one was waiting.
+  slot = Pop();
+  if (slot)
+    return slot;
+
+  char* slab = static_cast<char*>(SlabAllocator::Get()->Alloc());
+  CHECK_EQ(0u, (uint64_t{reinterpret_cast<uintptr_t>(slab)} + kSlabSize - 1) >>
+                   kAddressBits);
+  *reinterpret_cast<void**>(slab) = slabs_;
+  slabs_ = slab;
+  ++slab_count_;
+
+  // Keeps the first slot, and pushes the others in address order.
+  char* first_slot = slab + first_slot_offset_;
+  if (slots_per_slab_ > 1) {
+    FreeSlot* first = reinterpret_cast<FreeSlot*>(first_slot + slot_size_);
+    FreeSlot* last = first;
+    for (size_t i = 2; i < slots_per_slab_; ++i) {
+      FreeSlot* next = reinterpret_cast<FreeSlot*>(first_slot + i * slot_size_);
+      last->next = next;
+      last = next;
+    }
+    Push(first, last, slots_per_slab_ - 1);
+  }
+  return reinterpret_cast<FreeSlot*>(first_slot);
+}
+
+ObjectPoolBase::Magazine* ObjectPoolBase::GetOrCreateMagazine() {
+  auto* magazine = static_cast<Magazine*>(magazine_slot_->Get());
+  if (UNLIKELY(!magazine)) {
+    magazine = new Magazine(this);
+    magazine_slot_->Set(magazine);
+  }
+  return magazine;
+}
+
+// static
+void ObjectPoolBase::ReleaseMagazine(void* magazine) {
+  auto* typed_magazine = static_cast<Magazine*>(magazine);
+  typed_magazine->pool->FlushMagazine(typed_magazine, typed_magazine->count);
+  delete typed_magazine;
+}
+
+void ObjectPoolBase::FlushMagazine(Magazine* magazine, size_t count) {
+  DCHECK_LE(count, magazine->count);
+  if (!count)
+    return;
+  // Flushes the least recently freed slots, which are the least likely to be
+  // in cache.
+  for (size_t i = 0; i + 1 < count; ++i)
+    magazine->slots[i]->next = magazine->slots[i + 1];
+  Push(magazine->slots[0], magazine->slots[count - 1], count);
+  magazine->count -= count;
+  std::copy(magazine->slots + count, magazine->slots + count + magazine->count,
+            magazine->slots);
+}
+
+}  // namespace internal
+}  // namespace base
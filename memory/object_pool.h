@@ -0,0 +1,165 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_MEMORY_OBJECT_POOL_H_
+#define BASE_MEMORY_OBJECT_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "base/base_export.h"
+#include "base/logging.h"
+#include "base/macros.h"
+#include "base/synchronization/lock.h"
+#include "base/thread_annotations.h"
+#include "base/threading/thread_local_storage.h"
+
+namespace base {
+namespace trace_event {
+class ProcessMemoryDump;
+}
+
+namespace internal {
+
+// Type-independent part of ObjectPool<T>. Hands out fixed-size slots, carved
+// from slabs which are only released with the pool.
+class BASE_EXPORT ObjectPoolBase {
+ public:
+  // Size of the slabs, allocated from a PartitionAlloc partition shared by all
+  // the pools.
+  static constexpr size_t kSlabSize = 4096;
+  // Slabs are aligned on at least this.
+  static constexpr size_t kMaxAlignment = 16;
+  // Maximum number of slots cached by each thread, when magazines are used.
+  static constexpr size_t kMagazineCapacity = 32;
+
+  ObjectPoolBase(const char* name,
+                 size_t object_size,
+                 size_t object_alignment,
+                 bool use_thread_magazines);
+  ~ObjectPoolBase();
+
+  // Returns uninitialized storage for one object. Never returns null.
+  void* Alloc();
+  // Returns |slot|, obtained from Alloc(), to the pool.
+  void Free(void* slot);
+
+  const char* name() const { return name_; }
+  size_t slot_size() const { return slot_size_; }
+  size_t slots_per_slab() const { return slots_per_slab_; }
+  // Number of slabs allocated by the pool so far.
+  size_t GetSlabCount() const;
+  // Number of slots not in the shared free list. This includes the slots cached
+  // in the magazines of the threads.
+  size_t GetAllocatedCount() const;
+
+  // Adds the usage of the pool to |pmd|, under "object_pool/<name>".
+  void DumpStats(trace_event::ProcessMemoryDump* pmd) const;
+
+ private:
+  struct FreeSlot {
+    FreeSlot* next;
+  };
+  struct Magazine;
+
+  // Pushes the linked slots [|first|, |last|] to the shared free list.
+  void Push(FreeSlot* first, FreeSlot* last, size_t count);
+  // Pops a slot from the shared free list, or returns null if it is empty.
+  FreeSlot* Pop();
+  // Pops a slot from the shared free list, allocating a new slab if needed.
+  FreeSlot* PopOrAllocateSlab();
+
+  Magazine* GetOrCreateMagazine();
+  // Called when a thread with a magazine exits.
+  static void ReleaseMagazine(void* magazine);
+  void FlushMagazine(Magazine* magazine, size_t count);
+
+  const char* const name_;
+  const size_t slot_size_;
+  // Offset of the first slot in a slab, after the slab header.
+  const size_t first_slot_offset_;
+  const size_t slots_per_slab_;
+
+  // Treiber stack of the free slots. The address of the top slot is packed with
+  // a tag, incremented by each pop, so that popping fails if the stack went
+  // through pops and pushes bringing the same slot back on top in between (the
+  // ABA problem).
+  std::atomic<uint64_t> free_list_{0};
+  std::atomic<size_t> free_count_{0};
+
+  // Slots are only cached per-thread if this is not null.
+  std::unique_ptr<ThreadLocalStorage::Slot> magazine_slot_;
+
+  // Serializes slab allocations, which also makes sure that concurrent
+  // allocations don't each allocate a slab when the free list runs empty.
+  mutable Lock lock_;
+  // Singly-linked through the header of each slab.
+  void* slabs_ GUARDED_BY(lock_) = nullptr;
+  size_t slab_count_ GUARDED_BY(lock_) = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(ObjectPoolBase);
+};
+
+}  // namespace internal
+
+// A pool of objects of type T, for types which are allocated and freed at a
+// high rate. Allocating and freeing objects is lock-free, and with
+// |use_thread_magazines|, each thread also caches a few free objects, which
+// avoids contention between threads.
+//
+// Objects are carved from 4KiB slabs, allocated from a dedicated PartitionAlloc
+// partition. The memory of the slabs is only released when the pool is
+// destroyed, so pools are meant to be long-lived, typically globals. A pool
+// with thread magazines uses a thread-local storage slot, which are scarce, and
+// leaks the magazines of the other threads if destroyed before them.
+//
+// The usage of the pools is reported in memory dumps, under
+// "object_pool/<name>". |name| must be unique, and must outlive the pool.
+//
+// Example:
+//   ObjectPool<Node> pool("Node");
+//   Node* node = pool.New(arg1, arg2);
+//   ...
+//   pool.Delete(node);
+template <typename T>
+class ObjectPool {
+  static_assert(alignof(T) <= internal::ObjectPoolBase::kMaxAlignment,
+                "Over-aligned types are not supported");
+
+ public:
+  explicit ObjectPool(const char* name, bool use_thread_magazines = false)
+      : base_(name, sizeof(T), alignof(T), use_thread_magazines) {}
+  ~ObjectPool() = default;
+
+  // Constructs a T from |args| in the pool.
+  template <typename... Args>
+  T* New(Args&&... args) {
+    return new (base_.Alloc()) T(std::forward<Args>(args)...);
+  }
+
+  // Destroys |object|, which must come from New() on the same pool.
+  void Delete(T* object) {
+    if (!object)
+      return;
+    object->~T();
+    base_.Free(object);
+  }
+
+  size_t GetSlabCount() const { return base_.GetSlabCount(); }
+  size_t GetAllocatedCount() const { return base_.GetAllocatedCount(); }
+
+ private:
+  internal::ObjectPoolBase base_;
+
+  DISALLOW_COPY_AND_ASSIGN(ObjectPool);
+};
+
+}  // namespace base
+
+#endif  // BASE_MEMORY_OBJECT_POOL_H_
@@ -0,0 +1,204 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/memory/object_pool.h"
+
+#include <stdint.h>
+
+#include <set>
+#include <vector>
+
+#include "base/threading/simple_thread.h"
+#include "base/trace_event/memory_allocator_dump.h"
+#include "base/trace_event/process_memory_dump.h"
+#include "testing/gmock/include/gmock/gmock.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+// Otherwise, objects are allocated with malloc(), and the pools don't use any
+// slab.
+#if !defined(MEMORY_TOOL_REPLACES_ALLOCATOR)
+
+namespace base {
+
+namespace {
+
+struct Node {
+  Node(int value, Node* next) : value(value), next(next) {}
+  ~Node() { ++destroyed_count; }
+
+  static int destroyed_count;
+
+  int value;
+  Node* next;
+};
+
+int Node::destroyed_count = 0;
+
+struct alignas(16) AlignedObject {
+  char data[24];
+};
+
+constexpr int kThreadCount = 4;
+constexpr size_t kIterationsPerThread = 10000;
+
+// Allocates and frees objects from |pool_|, keeping a few alive at a time.
+class PoolUser : public DelegateSimpleThread::Delegate {
+ public:
+  explicit PoolUser(ObjectPool<Node>* pool) : pool_(pool) {}
+
+  void Run() override {
+    Node* list = nullptr;
+    for (size_t i = 0; i < kIterationsPerThread; ++i) {
+      list = pool_->New(static_cast<int>(i), list);
+      if (i % 8 == 7) {
+        while (list) {
+          Node* next = list->next;
+          pool_->Delete(list);
+          list = next;
+        }
+      }
+    }
+    while (list) {
+      Node* next = list->next;
+      pool_->Delete(list);
+      list = next;
+    }
+  }
+
+ private:
+  ObjectPool<Node>* const pool_;
+};
+
+}  // namespace
+
+TEST(ObjectPoolTest, NewAndDelete) {
+  ObjectPool<Node> pool("ObjectPoolTest.NewAndDelete");
+  EXPECT_EQ(0u, pool.GetSlabCount());
+
+  Node* node = pool.New(42, nullptr);
+  EXPECT_EQ(42, node->value);
+  EXPECT_EQ(1u, pool.GetSlabCount());
+  EXPECT_EQ(1u, pool.GetAllocatedCount());
+
+  Node::destroyed_count = 0;
+  pool.Delete(node);
+  EXPECT_EQ(1, Node::destroyed_count);
+  EXPECT_EQ(0u, pool.GetAllocatedCount());
+
+  // The slot is reused.
+  EXPECT_EQ(node, pool.New(43, nullptr));
+  pool.Delete(node);
+
+  pool.Delete(nullptr);
+}
+
+TEST(ObjectPoolTest, ObjectsDontOverlap) {
+  ObjectPool<Node> pool("ObjectPoolTest.ObjectsDontOverlap");
+  std::vector<Node*> nodes;
+  std::set<uintptr_t> addresses;
+  // Spans several slabs.
+  constexpr size_t kCount = 1000;
+  for (size_t i = 0; i < kCount; ++i) {
+    Node* node = pool.New(static_cast<int>(i), nullptr);
+    EXPECT_TRUE(addresses.insert(reinterpret_cast<uintptr_t>(node)).second);
+    nodes.push_back(node);
+  }
+  EXPECT_GT(pool.GetSlabCount(), 1u);
+  EXPECT_EQ(kCount, pool.GetAllocatedCount());
+
+  for (uintptr_t address : addresses) {
+    auto next = addresses.upper_bound(address);
+    if (next != addresses.end()) {
+      EXPECT_GE(*next - address, sizeof(Node));
+    }
+  }
+  for (size_t i = 0; i < kCount; ++i) {
+    EXPECT_EQ(static_cast<int>(i), nodes[i]->value);
+    pool.Delete(nodes[i]);
+  }
+  EXPECT_EQ(0u, pool.GetAllocatedCount());
+}
+
+TEST(ObjectPoolTest, Alignment) {
+  ObjectPool<AlignedObject> pool("ObjectPoolTest.Alignment");
+  std::vector<AlignedObject*> objects;
+  for (size_t i = 0; i < 500; ++i) {
+    AlignedObject* object = pool.New();
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(object) % alignof(AlignedObject));
+    objects.push_back(object);
+  }
+  for (AlignedObject* object : objects)
+    pool.Delete(object);
+}
+
+TEST(ObjectPoolTest, ThreadMagazines) {
+  ObjectPool<Node> pool("ObjectPoolTest.ThreadMagazines",
+                        /* use_thread_magazines= */ true);
+  Node* node = pool.New(1, nullptr);
+  // The magazine was filled from the first slab.
+  EXPECT_EQ(1u, pool.GetSlabCount());
+  EXPECT_EQ(internal::ObjectPoolBase::kMagazineCapacity / 2,
+            pool.GetAllocatedCount());
+
+  // Freeing goes to the magazine, and the slot is reused from there.
+  pool.Delete(node);
+  EXPECT_EQ(node, pool.New(2, nullptr));
+  pool.Delete(node);
+}
+
+TEST(ObjectPoolTest, ThreadMagazinesFlushedOnThreadExit) {
+  ObjectPool<Node> pool("ObjectPoolTest.ThreadMagazinesFlushedOnThreadExit",
+                        /* use_thread_magazines= */ true);
+  PoolUser user(&pool);
+  DelegateSimpleThread thread(&user, "ObjectPoolTest");
+  thread.Start();
+  thread.Join();
+  EXPECT_EQ(0u, pool.GetAllocatedCount());
+}
+
+TEST(ObjectPoolTest, ConcurrentUse) {
+  for (bool use_thread_magazines : {false, true}) {
+    ObjectPool<Node> pool("ObjectPoolTest.ConcurrentUse", use_thread_magazines);
+    PoolUser user(&pool);
+    DelegateSimpleThreadPool threads("ObjectPoolTest", kThreadCount);
+    threads.Start();
+    threads.AddWork(&user, kThreadCount);
+    threads.JoinAll();
+    EXPECT_EQ(0u, pool.GetAllocatedCount());
+    // Each thread has at most 8 objects alive, plus its magazine.
+    EXPECT_LE(pool.GetSlabCount(), static_cast<size_t>(kThreadCount));
+  }
+}
+
+TEST(ObjectPoolTest, DumpStats) {
+  internal::ObjectPoolBase pool("ObjectPoolTest.DumpStats", sizeof(Node),
+                                alignof(Node), false);
+  void* slot = pool.Alloc();
+
+  trace_event::MemoryDumpArgs dump_args = {
+      trace_event::MemoryDumpLevelOfDetail::DETAILED};
+  trace_event::ProcessMemoryDump pmd(dump_args);
+  pool.DumpStats(&pmd);
+
+  const trace_event::MemoryAllocatorDump* dump =
+      pmd.GetAllocatorDump("object_pool/ObjectPoolTest.DumpStats");
+  ASSERT_TRUE(dump);
+  trace_event::MemoryAllocatorDump::Entry expected_size(
+      trace_event::MemoryAllocatorDump::kNameSize,
+      trace_event::MemoryAllocatorDump::kUnitsBytes,
+      internal::ObjectPoolBase::kSlabSize);
+  EXPECT_THAT(dump->entries(),
+              testing::Contains(testing::Eq(testing::ByRef(expected_size))));
+  trace_event::MemoryAllocatorDump::Entry expected_count(
+      trace_event::MemoryAllocatorDump::kNameObjectCount,
+      trace_event::MemoryAllocatorDump::kUnitsObjects, uint64_t{1});
+  EXPECT_THAT(dump->entries(),
+              testing::Contains(testing::Eq(testing::ByRef(expected_count))));
+
+  pool.Free(slot);
+}
+
+}  // namespace base
+
+#endif  // !defined(MEMORY_TOOL_REPLACES_ALLOCATOR)
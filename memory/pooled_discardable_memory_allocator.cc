@@ -0,0 +1,427 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/memory/pooled_discardable_memory_allocator.h"
+
+#include <inttypes.h>
+
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+#include "base/bind.h"
+#include "base/logging.h"
+#include "base/memory/discardable_memory.h"
+#include "base/memory/discardable_shared_memory.h"
+#include "base/numerics/checked_math.h"
+#include "base/process/memory.h"
+#include "base/process/process_metrics.h"
+#include "base/strings/stringprintf.h"
+#include "base/threading/thread_task_runner_handle.h"
+#include "base/trace_event/memory_allocator_dump.h"
+#include "base/trace_event/memory_dump_manager.h"
+#include "base/trace_event/process_memory_dump.h"
+
+namespace base {
+
+class PooledDiscardableMemoryAllocator::Block : public DiscardableMemory,
+                                               public LinkNode<Block> {
+ public:
+  Block(PooledDiscardableMemoryAllocator* allocator,
+        Segment* segment,
+        size_t first_page,
+        size_t page_count,
+        void* data)
+      : allocator_(allocator),
+        segment_(segment),
+        first_page_(first_page),
+        page_count_(page_count),
+        data_(data) {}
+
+  ~Block() override { allocator_->FreeBlock(this); }
+
+  // DiscardableMemory:
+  bool Lock() override { return allocator_->LockBlock(this); }
+  void Unlock() override { allocator_->UnlockBlock(this); }
+  void* data() const override {
+    DCHECK(is_locked_);
+    return data_;
+  }
+  trace_event::MemoryAllocatorDump* CreateMemoryAllocatorDump(
+      const char* name,
+      trace_event::ProcessMemoryDump* pmd) const override {
+    return allocator_->CreateBlockDump(this, name, pmd);
+  }
+
+ private:
+  friend class PooledDiscardableMemoryAllocator;
+
+  PooledDiscardableMemoryAllocator* const allocator_;
+  // Null once the block has been evicted. Guarded by the lock of |allocator_|.
+  Segment* segment_;
+  const size_t first_page_;
+  const size_t page_count_;
+  void* const data_;
+  // Only changed by the owner of the block.
+  bool is_locked_ = true;
+
+  DISALLOW_COPY_AND_ASSIGN(Block);
+};
+
+struct PooledDiscardableMemoryAllocator::Segment {
+  Segment(uint64_t id,
+          std::unique_ptr<DiscardableSharedMemory> shared_memory,
+          size_t page_count)
+      : id(id),
+        shared_memory(std::move(shared_memory)),
+        page_count(page_count) {}
+
+  const uint64_t id;
+  const std::unique_ptr<DiscardableSharedMemory> shared_memory;
+  const size_t page_count;
+  // First page and page count of the runs of free pages. The free pages are
+  // unlocked.
+  std::map<size_t, size_t> free_spans;
+  size_t free_page_count = 0;
+  size_t block_count = 0;
+};
+
+bool PooledDiscardableMemoryAllocator::FreeSpan::operator<(
+    const FreeSpan& other) const {
+  return std::tie(page_count, segment_id, first_page) <
+         std::tie(other.page_count, other.segment_id, other.first_page);
+}
+
+constexpr size_t PooledDiscardableMemoryAllocator::kDefaultSegmentSize;
+
+PooledDiscardableMemoryAllocator::PooledDiscardableMemoryAllocator(
+    size_t budget,
+    size_t segment_size)
+    : page_size_(GetPageSize()),
+      segment_size_(std::max(segment_size, page_size_)),
+      budget_(budget) {
+  // Memory dump providers without a task runner can't be unregistered safely.
+  if (ThreadTaskRunnerHandle::IsSet()) {
+    trace_event::MemoryDumpManager::GetInstance()->RegisterDumpProvider(
+        this, "PooledDiscardableMemoryAllocator",
+        ThreadTaskRunnerHandle::Get());
+    is_dump_provider_registered_ = true;
+  }
+  memory_pressure_listener_ = std::make_unique<MemoryPressureListener>(
+      BindRepeating(&PooledDiscardableMemoryAllocator::OnMemoryPressure,
+                    Unretained(this)));
+}
+
+PooledDiscardableMemoryAllocator::~PooledDiscardableMemoryAllocator() {
+  memory_pressure_listener_ = nullptr;
+  if (is_dump_provider_registered_) {
+    trace_event::MemoryDumpManager::GetInstance()->UnregisterDumpProvider(
+        this);
+  }
+  // Segments are deleted along with their last block.
+  AutoLock lock(lock_);
+  DCHECK(segments_.empty());
+}
+
+std::unique_ptr<DiscardableMemory>
+PooledDiscardableMemoryAllocator::AllocateLockedDiscardableMemory(
+    size_t size) {
+  size_t page_count =
+      ((CheckedNumeric<size_t>(std::max<size_t>(size, 1)) + page_size_ - 1) /
+       page_size_)
+          .ValueOrDie();
+  size_t block_size = page_count * page_size_;
+
+  AutoLock lock(lock_);
+  // Evicts first, so that the block can reuse the pages of the evicted ones.
+  EvictUntil(budget_ > block_size ? budget_ - block_size : 0);
+
+  Segment* segment;
+  size_t first_page;
+  auto best_fit = free_spans_.lower_bound(FreeSpan{page_count, 0, 0, nullptr});
+  if (best_fit != free_spans_.end()) {
+    FreeSpan span = *best_fit;
+    RemoveFreeSpan(span.segment, span.first_page, span.page_count);
+    if (span.page_count > page_count) {
+      AddFreeSpan(span.segment, span.first_page + page_count,
+                  span.page_count - page_count);
+    }
+    segment = span.segment;
+    first_page = span.first_page;
+    // The system may have discarded the free pages, which doesn't matter.
+    DiscardableSharedMemory::LockResult result =
+        segment->shared_memory->Lock(first_page * page_size_, block_size);
+    DCHECK_NE(DiscardableSharedMemory::FAILED, result);
+  } else {
+    size_t segment_page_count =
+        std::max(page_count, segment_size_ / page_size_);
+    auto shared_memory = std::make_unique<DiscardableSharedMemory>();
+    if (!shared_memory->CreateAndMap(segment_page_count * page_size_))
+      TerminateBecauseOutOfMemory(segment_page_count * page_size_);
+    segments_.push_back(std::make_unique<Segment>(
+        next_segment_id_++, std::move(shared_memory), segment_page_count));
+    segment = segments_.back().get();
+    first_page = 0;
+    // New segments are locked entirely.
+    if (segment_page_count > page_count) {
+      segment->shared_memory->Unlock(
+          block_size, (segment_page_count - page_count) * page_size_);
+      AddFreeSpan(segment, page_count, segment_page_count - page_count);
+    }
+  }
+
+  ++segment->block_count;
+  resident_size_ += block_size;
+  locked_size_ += block_size;
+  void* data = static_cast<char*>(segment->shared_memory->memory()) +
+               first_page * page_size_;
+  return std::make_unique<Block>(this, segment, first_page, page_count, data);
+}
+
+void PooledDiscardableMemoryAllocator::SetBudget(size_t budget) {
+  AutoLock lock(lock_);
+  budget_ = budget;
+  EvictUntil(budget_);
+}
+
+void PooledDiscardableMemoryAllocator::ReleaseUnlockedMemory() {
+  AutoLock lock(lock_);
+  EvictUntil(0);
+}
+
+size_t PooledDiscardableMemoryAllocator::GetResidentSize() const {
+  AutoLock lock(lock_);
+  return resident_size_;
+}
+
+size_t PooledDiscardableMemoryAllocator::GetLockedSize() const {
+  AutoLock lock(lock_);
+  return locked_size_;
+}
+
+size_t PooledDiscardableMemoryAllocator::GetSegmentsSize() const {
+  AutoLock lock(lock_);
+  size_t size = 0;
+  for (const auto& segment : segments_)
+    size += segment->page_count * page_size_;
+  return size;
+}
+
+bool PooledDiscardableMemoryAllocator::OnMemoryDump(
+    const trace_event::MemoryDumpArgs& args,
+    trace_event::ProcessMemoryDump* pmd) {
+  using trace_event::MemoryAllocatorDump;
+
+  AutoLock lock(lock_);
+  size_t segments_size = 0;
+  for (const auto& segment : segments_)
+    segments_size += segment->page_count * page_size_;
+  MemoryAllocatorDump* dump = pmd->CreateAllocatorDump("discardable");
+  dump->AddScalar(MemoryAllocatorDump::kNameSize,
+                  MemoryAllocatorDump::kUnitsBytes, resident_size_);
+  dump->AddScalar("locked_size", MemoryAllocatorDump::kUnitsBytes,
+                  locked_size_);
+  dump->AddScalar("virtual_size", MemoryAllocatorDump::kUnitsBytes,
+                  segments_size);
+  if (args.level_of_detail == trace_event::MemoryDumpLevelOfDetail::BACKGROUND)
+    return true;
+
+  for (const auto& segment : segments_) {
+    std::string segment_name = GetSegmentDumpName(segment.get());
+    MemoryAllocatorDump* segment_dump = pmd->CreateAllocatorDump(segment_name);
+    segment_dump->AddScalar("virtual_size", MemoryAllocatorDump::kUnitsBytes,
+                            segment->page_count * page_size_);
+    // Adds the resident size of the segment.
+    segment->shared_memory->CreateSharedMemoryOwnershipEdge(
+        segment_dump, pmd, /* is_owned= */ true);
+
+    MemoryAllocatorDump* blocks_dump =
+        pmd->CreateAllocatorDump(segment_name + "/allocated_objects");
+    blocks_dump->AddScalar(
+        MemoryAllocatorDump::kNameSize, MemoryAllocatorDump::kUnitsBytes,
+        (segment->page_count - segment->free_page_count) * page_size_);
+    blocks_dump->AddScalar(MemoryAllocatorDump::kNameObjectCount,
+                           MemoryAllocatorDump::kUnitsObjects,
+                           segment->block_count);
+  }
+  return true;
+}
+
+void PooledDiscardableMemoryAllocator::OnMemoryPressure(
+    MemoryPressureListener::MemoryPressureLevel level) {
+  AutoLock lock(lock_);
+  switch (level) {
+    case MemoryPressureListener::MEMORY_PRESSURE_LEVEL_NONE:
+      break;
+    case MemoryPressureListener::MEMORY_PRESSURE_LEVEL_MODERATE:
+      EvictUntil(budget_ / 2);
+      break;
+    case MemoryPressureListener::MEMORY_PRESSURE_LEVEL_CRITICAL:
+      EvictUntil(0);
+      break;
+  }
+}
+
+bool PooledDiscardableMemoryAllocator::LockBlock(Block* block) {
+  AutoLock lock(lock_);
+  DCHECK(!block->is_locked_);
+  Segment* segment = block->segment_;
+  if (!segment)
+    return false;
+
+  size_t block_size = block->page_count_ * page_size_;
+  DiscardableSharedMemory::LockResult result = segment->shared_memory->Lock(
+      block->first_page_ * page_size_, block_size);
+  block->RemoveFromList();
+  if (result != DiscardableSharedMemory::SUCCESS) {
+    // Discarded by the system.
+    if (result == DiscardableSharedMemory::PURGED) {
+      segment->shared_memory->Unlock(block->first_page_ * page_size_,
+                                     block_size);
+    }
+    ReleaseBlockPages(block);
+    return false;
+  }
+
+  block->is_locked_ = true;
+  locked_size_ += block_size;
+  return true;
+}
+
+void PooledDiscardableMemoryAllocator::UnlockBlock(Block* block) {
+  AutoLock lock(lock_);
+  DCHECK(block->is_locked_);
+  DCHECK(block->segment_);
+
+  size_t block_size = block->page_count_ * page_size_;
+  block->segment_->shared_memory->Unlock(block->first_page_ * page_size_,
+                                         block_size);
+  block->is_locked_ = false;
+  locked_size_ -= block_size;
+  unlocked_blocks_.Append(block);
+  EvictUntil(budget_);
+}
+
+void PooledDiscardableMemoryAllocator::FreeBlock(Block* block) {
+  AutoLock lock(lock_);
+  if (!block->segment_)
+    return;
+
+  if (block->is_locked_) {
+    size_t block_size = block->page_count_ * page_size_;
+    block->segment_->shared_memory->Unlock(block->first_page_ * page_size_,
+                                           block_size);
+    block->is_locked_ = false;
+    locked_size_ -= block_size;
+  } else {
+    block->RemoveFromList();
+  }
+  ReleaseBlockPages(block);
+}
+
+trace_event::MemoryAllocatorDump*
+PooledDiscardableMemoryAllocator::CreateBlockDump(
+    const Block* block,
+    const char* name,
+    trace_event::ProcessMemoryDump* pmd) {
+  trace_event::MemoryAllocatorDump* dump = pmd->CreateAllocatorDump(name);
+  dump->AddScalar(trace_event::MemoryAllocatorDump::kNameSize,
+                  trace_event::MemoryAllocatorDump::kUnitsBytes,
+                  block->page_count_ * page_size_);
+
+  AutoLock lock(lock_);
+  if (block->segment_) {
+    pmd->AddSuballocation(
+        dump->guid(),
+        GetSegmentDumpName(block->segment_) + "/allocated_objects");
+  }
+  return dump;
+}
+
+void PooledDiscardableMemoryAllocator::EvictUntil(size_t target_size) {
+  while (resident_size_ > target_size && !unlocked_blocks_.empty()) {
+    Block* block = unlocked_blocks_.head()->value();
+    block->RemoveFromList();
+    ReleaseBlockPages(block);
+  }
+}
+
+void PooledDiscardableMemoryAllocator::ReleaseBlockPages(Block* block) {
+  DCHECK(!block->is_locked_);
+  Segment* segment = block->segment_;
+  block->segment_ = nullptr;
+  resident_size_ -= block->page_count_ * page_size_;
+  if (!--segment->block_count) {
+    DeleteSegment(segment);
+    return;
+  }
+
+  size_t first_page = block->first_page_;
+  size_t page_count = block->page_count_;
+  segment->shared_memory->ReleaseMemoryIfPossible(first_page * page_size_,
+                                                  page_count * page_size_);
+
+  // Merges the pages with the neighboring free spans.
+  auto next = segment->free_spans.find(first_page + page_count);
+  if (next != segment->free_spans.end()) {
+    size_t next_page_count = next->second;
+    RemoveFreeSpan(segment, first_page + page_count, next_page_count);
+    page_count += next_page_count;
+  }
+  auto previous = segment->free_spans.lower_bound(first_page);
+  if (previous != segment->free_spans.begin()) {
+    --previous;
+    if (previous->first + previous->second == first_page) {
+      size_t previous_first_page = previous->first;
+      size_t previous_page_count = previous->second;
+      RemoveFreeSpan(segment, previous_first_page, previous_page_count);
+      first_page = previous_first_page;
+      page_count += previous_page_count;
+    }
+  }
+  AddFreeSpan(segment, first_page, page_count);
+}
+
+void PooledDiscardableMemoryAllocator::AddFreeSpan(Segment* segment,
+                                                   size_t first_page,
+                                                   size_t page_count) {
+  bool inserted =
+      segment->free_spans.insert(std::make_pair(first_page, page_count))
+          .second;
+  DCHECK(inserted);
+  segment->free_page_count += page_count;
+  free_spans_.insert(FreeSpan{page_count, segment->id, first_page, segment});
+}
+
+void PooledDiscardableMemoryAllocator::RemoveFreeSpan(Segment* segment,
+                                                      size_t first_page,
+                                                      size_t page_count) {
+  size_t erased_count = segment->free_spans.erase(first_page);
+  DCHECK_EQ(1u, erased_count);
+  segment->free_page_count -= page_count;
+  erased_count =
+      free_spans_.erase(FreeSpan{page_count, segment->id, first_page, segment});
+  DCHECK_EQ(1u, erased_count);
+}
+
+void PooledDiscardableMemoryAllocator::DeleteSegment(Segment* segment) {
+  DCHECK(!segment->block_count);
+  while (!segment->free_spans.empty()) {
+    auto span = segment->free_spans.begin();
+    RemoveFreeSpan(segment, span->first, span->second);
+  }
+  auto it = std::find_if(segments_.begin(), segments_.end(),
+                         [segment](const std::unique_ptr<Segment>& other) {
+                           return other.get() == segment;
+                         });
+  DCHECK(it != segments_.end());
+  segments_.erase(it);
+}
+
+std::string PooledDiscardableMemoryAllocator::GetSegmentDumpName(
+    const Segment* segment) const {
+  return StringPrintf("discardable/segment_%" PRIu64, segment->id);
+}
+
+}  // namespace base
@@ -0,0 +1,139 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_MEMORY_POOLED_DISCARDABLE_MEMORY_ALLOCATOR_H_
+#define BASE_MEMORY_POOLED_DISCARDABLE_MEMORY_ALLOCATOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/containers/linked_list.h"
+#include "base/macros.h"
+#include "base/memory/discardable_memory_allocator.h"
+#include "base/memory/memory_pressure_listener.h"
+#include "base/synchronization/lock.h"
+#include "base/thread_annotations.h"
+#include "base/trace_event/memory_dump_provider.h"
+
+namespace base {
+
+namespace trace_event {
+class MemoryAllocatorDump;
+}
+
+// A DiscardableMemoryAllocator for processes which manage their discardable
+// memory themselves, rather than through another process. Blocks of
+// discardable memory are carved out of larger DiscardableSharedMemory segments,
+// in whole pages.
+//
+// Unlocked blocks are evicted, least recently unlocked first, when the memory
+// of the blocks exceeds a budget, and on memory pressure: their memory is
+// released, and locking them fails afterwards, as if the system had discarded
+// them. Locked blocks are never evicted, and may exceed the budget.
+//
+// Empty segments are released right away, and so is the memory of evicted and
+// freed blocks. Usage is reported in memory dumps, under "discardable".
+//
+// This class is thread-safe. The blocks it allocates can be used from any
+// thread, but must be destroyed before the allocator.
+class BASE_EXPORT PooledDiscardableMemoryAllocator
+    : public DiscardableMemoryAllocator,
+      public trace_event::MemoryDumpProvider {
+ public:
+  // Size of the segments. Larger blocks get a segment of their own.
+  static constexpr size_t kDefaultSegmentSize = 4 * 1024 * 1024;
+
+  // |budget| is the number of bytes which locked and unlocked blocks can
+  // occupy before unlocked blocks are evicted.
+  explicit PooledDiscardableMemoryAllocator(
+      size_t budget,
+      size_t segment_size = kDefaultSegmentSize);
+  ~PooledDiscardableMemoryAllocator() override;
+
+  // DiscardableMemoryAllocator:
+  std::unique_ptr<DiscardableMemory> AllocateLockedDiscardableMemory(
+      size_t size) override;
+
+  // Evicts unlocked blocks if |budget| is exceeded.
+  void SetBudget(size_t budget);
+  // Evicts all the unlocked blocks.
+  void ReleaseUnlockedMemory();
+
+  // Number of bytes occupied by the locked and unlocked blocks.
+  size_t GetResidentSize() const;
+  // Number of bytes occupied by the locked blocks.
+  size_t GetLockedSize() const;
+  // Number of bytes of the segments, including the free pages.
+  size_t GetSegmentsSize() const;
+
+  // trace_event::MemoryDumpProvider:
+  bool OnMemoryDump(const trace_event::MemoryDumpArgs& args,
+                    trace_event::ProcessMemoryDump* pmd) override;
+
+ private:
+  class Block;
+  struct Segment;
+
+  // A run of free pages in a segment.
+  struct FreeSpan {
+    bool operator<(const FreeSpan& other) const;
+
+    size_t page_count;
+    uint64_t segment_id;
+    size_t first_page;
+    Segment* segment;
+  };
+
+  void OnMemoryPressure(MemoryPressureListener::MemoryPressureLevel level);
+
+  bool LockBlock(Block* block);
+  void UnlockBlock(Block* block);
+  void FreeBlock(Block* block);
+  trace_event::MemoryAllocatorDump* CreateBlockDump(
+      const Block* block,
+      const char* name,
+      trace_event::ProcessMemoryDump* pmd);
+
+  // Evicts unlocked blocks until the resident size is at most |target_size|,
+  // or there are none left.
+  void EvictUntil(size_t target_size) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  // Releases the pages of |block|, which must be unlocked.
+  void ReleaseBlockPages(Block* block) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void AddFreeSpan(Segment* segment, size_t first_page, size_t page_count)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void RemoveFreeSpan(Segment* segment, size_t first_page, size_t page_count)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  void DeleteSegment(Segment* segment) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  std::string GetSegmentDumpName(const Segment* segment) const;
+
+  const size_t page_size_;
+  const size_t segment_size_;
+
+  mutable Lock lock_;
+  size_t budget_ GUARDED_BY(lock_);
+  std::vector<std::unique_ptr<Segment>> segments_ GUARDED_BY(lock_);
+  uint64_t next_segment_id_ GUARDED_BY(lock_) = 0;
+  // Free runs of pages of all the segments, smallest first, for best-fit
+  // allocation.
+  std::set<FreeSpan> free_spans_ GUARDED_BY(lock_);
+  // Least recently unlocked first.
+  LinkedList<Block> unlocked_blocks_ GUARDED_BY(lock_);
+  size_t resident_size_ GUARDED_BY(lock_) = 0;
+  size_t locked_size_ GUARDED_BY(lock_) = 0;
+
+  std::unique_ptr<MemoryPressureListener> memory_pressure_listener_;
+  bool is_dump_provider_registered_ = false;
+
+  DISALLOW_COPY_AND_ASSIGN(PooledDiscardableMemoryAllocator);
+};
+
+}  // namespace base
+
+#endif  // BASE_MEMORY_POOLED_DISCARDABLE_MEMORY_ALLOCATOR_H_
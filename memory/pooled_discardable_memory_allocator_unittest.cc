@@ -0,0 +1,204 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/memory/pooled_discardable_memory_allocator.h"
+
+#include <string.h>
+
+#include <memory>
+#include <vector>
+
+#include "base/memory/discardable_memory.h"
+#include "base/memory/memory_pressure_listener.h"
+#include "base/process/process_metrics.h"
+#include "base/run_loop.h"
+#include "base/test/scoped_task_environment.h"
+#include "base/trace_event/memory_allocator_dump.h"
+#include "base/trace_event/process_memory_dump.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+constexpr size_t kSegmentPageCount = 16;
+
+class PooledDiscardableMemoryAllocatorTest : public testing::Test {
+ protected:
+  PooledDiscardableMemoryAllocatorTest()
+      : page_size_(GetPageSize()),
+        allocator_(/* budget= */ 8 * page_size_,
+                   kSegmentPageCount * page_size_) {}
+
+  std::vector<std::unique_ptr<DiscardableMemory>> AllocateUnlocked(
+      size_t count) {
+    std::vector<std::unique_ptr<DiscardableMemory>> blocks;
+    for (size_t i = 0; i < count; ++i) {
+      blocks.push_back(allocator_.AllocateLockedDiscardableMemory(page_size_));
+      blocks.back()->Unlock();
+    }
+    return blocks;
+  }
+
+  test::ScopedTaskEnvironment scoped_task_environment_;
+  const size_t page_size_;
+  PooledDiscardableMemoryAllocator allocator_;
+};
+
+}  // namespace
+
+TEST_F(PooledDiscardableMemoryAllocatorTest, LockAndUnlock) {
+  constexpr size_t kSize = 100;
+  std::unique_ptr<DiscardableMemory> block =
+      allocator_.AllocateLockedDiscardableMemory(kSize);
+  memset(block->data(), 'a', kSize);
+  // Blocks take whole pages.
+  EXPECT_EQ(page_size_, allocator_.GetResidentSize());
+  EXPECT_EQ(page_size_, allocator_.GetLockedSize());
+
+  block->Unlock();
+  EXPECT_EQ(page_size_, allocator_.GetResidentSize());
+  EXPECT_EQ(0u, allocator_.GetLockedSize());
+
+  ASSERT_TRUE(block->Lock());
+  for (size_t i = 0; i < kSize; ++i)
+    EXPECT_EQ('a', block->data_as<char>()[i]);
+  EXPECT_EQ(page_size_, allocator_.GetLockedSize());
+
+  block = nullptr;
+  EXPECT_EQ(0u, allocator_.GetResidentSize());
+  EXPECT_EQ(0u, allocator_.GetLockedSize());
+}
+
+TEST_F(PooledDiscardableMemoryAllocatorTest, BlocksShareSegments) {
+  std::vector<std::unique_ptr<DiscardableMemory>> blocks;
+  for (size_t i = 0; i < kSegmentPageCount; ++i) {
+    blocks.push_back(allocator_.AllocateLockedDiscardableMemory(page_size_));
+    memset(blocks.back()->data(), static_cast<int>(i), page_size_);
+  }
+  EXPECT_EQ(kSegmentPageCount * page_size_, allocator_.GetSegmentsSize());
+  for (size_t i = 0; i < kSegmentPageCount; ++i)
+    EXPECT_EQ(static_cast<char>(i), blocks[i]->data_as<char>()[page_size_ - 1]);
+
+  // The segment is full.
+  blocks.push_back(allocator_.AllocateLockedDiscardableMemory(1));
+  EXPECT_EQ(2 * kSegmentPageCount * page_size_, allocator_.GetSegmentsSize());
+
+  // Larger blocks get a segment of their own.
+  size_t large_size = (kSegmentPageCount + 1) * page_size_;
+  blocks.push_back(allocator_.AllocateLockedDiscardableMemory(large_size));
+  memset(blocks.back()->data(), 'a', large_size);
+  EXPECT_EQ(2 * kSegmentPageCount * page_size_ + large_size,
+            allocator_.GetSegmentsSize());
+
+  // Empty segments are released.
+  blocks.clear();
+  EXPECT_EQ(0u, allocator_.GetSegmentsSize());
+}
+
+TEST_F(PooledDiscardableMemoryAllocatorTest, FreePagesAreReused) {
+  std::vector<std::unique_ptr<DiscardableMemory>> blocks;
+  for (size_t i = 0; i < kSegmentPageCount; ++i)
+    blocks.push_back(allocator_.AllocateLockedDiscardableMemory(page_size_));
+
+  // Two neighboring free pages fit a block of two pages.
+  char* first_page = blocks[4]->data_as<char>();
+  blocks[4] = nullptr;
+  blocks[5] = nullptr;
+  blocks.push_back(allocator_.AllocateLockedDiscardableMemory(2 * page_size_));
+  EXPECT_EQ(first_page, blocks.back()->data());
+  EXPECT_EQ(kSegmentPageCount * page_size_, allocator_.GetSegmentsSize());
+}
+
+TEST_F(PooledDiscardableMemoryAllocatorTest, EvictsLeastRecentlyUnlocked) {
+  std::vector<std::unique_ptr<DiscardableMemory>> blocks = AllocateUnlocked(8);
+  EXPECT_EQ(8 * page_size_, allocator_.GetResidentSize());
+
+  // Using a block makes it the most recently unlocked.
+  ASSERT_TRUE(blocks[0]->Lock());
+  blocks[0]->Unlock();
+
+  // Exceeds the budget.
+  std::unique_ptr<DiscardableMemory> block =
+      allocator_.AllocateLockedDiscardableMemory(2 * page_size_);
+  EXPECT_EQ(8 * page_size_, allocator_.GetResidentSize());
+  EXPECT_FALSE(blocks[1]->Lock());
+  EXPECT_FALSE(blocks[2]->Lock());
+  EXPECT_TRUE(blocks[0]->Lock());
+  EXPECT_TRUE(blocks[3]->Lock());
+}
+
+TEST_F(PooledDiscardableMemoryAllocatorTest, LockedBlocksAreNotEvicted) {
+  std::vector<std::unique_ptr<DiscardableMemory>> blocks;
+  for (size_t i = 0; i < 10; ++i)
+    blocks.push_back(allocator_.AllocateLockedDiscardableMemory(page_size_));
+  EXPECT_EQ(10 * page_size_, allocator_.GetResidentSize());
+
+  // Still over budget.
+  blocks[0]->Unlock();
+  EXPECT_EQ(9 * page_size_, allocator_.GetResidentSize());
+  EXPECT_FALSE(blocks[0]->Lock());
+}
+
+TEST_F(PooledDiscardableMemoryAllocatorTest, SetBudget) {
+  std::vector<std::unique_ptr<DiscardableMemory>> blocks = AllocateUnlocked(8);
+  allocator_.SetBudget(4 * page_size_);
+  EXPECT_EQ(4 * page_size_, allocator_.GetResidentSize());
+
+  allocator_.ReleaseUnlockedMemory();
+  EXPECT_EQ(0u, allocator_.GetResidentSize());
+  for (const auto& block : blocks)
+    EXPECT_FALSE(block->Lock());
+  // The segment was released along with the last block.
+  EXPECT_EQ(0u, allocator_.GetSegmentsSize());
+}
+
+TEST_F(PooledDiscardableMemoryAllocatorTest, MemoryPressure) {
+  std::vector<std::unique_ptr<DiscardableMemory>> blocks = AllocateUnlocked(8);
+  std::unique_ptr<DiscardableMemory> locked_block =
+      allocator_.AllocateLockedDiscardableMemory(page_size_);
+  EXPECT_EQ(8 * page_size_, allocator_.GetResidentSize());
+
+  // Evicts down to half the budget.
+  MemoryPressureListener::SimulatePressureNotification(
+      MemoryPressureListener::MEMORY_PRESSURE_LEVEL_MODERATE);
+  RunLoop().RunUntilIdle();
+  EXPECT_EQ(4 * page_size_, allocator_.GetResidentSize());
+
+  // Evicts all the unlocked blocks.
+  MemoryPressureListener::SimulatePressureNotification(
+      MemoryPressureListener::MEMORY_PRESSURE_LEVEL_CRITICAL);
+  RunLoop().RunUntilIdle();
+  EXPECT_EQ(page_size_, allocator_.GetResidentSize());
+  EXPECT_EQ(page_size_, allocator_.GetLockedSize());
+}
+
+TEST_F(PooledDiscardableMemoryAllocatorTest, MemoryDump) {
+  std::unique_ptr<DiscardableMemory> block =
+      allocator_.AllocateLockedDiscardableMemory(page_size_);
+
+  trace_event::MemoryDumpArgs args = {
+      trace_event::MemoryDumpLevelOfDetail::DETAILED};
+  trace_event::ProcessMemoryDump pmd(args);
+  EXPECT_TRUE(allocator_.OnMemoryDump(args, &pmd));
+
+  const trace_event::MemoryAllocatorDump* dump =
+      pmd.GetAllocatorDump("discardable");
+  ASSERT_TRUE(dump);
+  EXPECT_EQ(page_size_, dump->GetSizeInternal());
+  EXPECT_TRUE(pmd.GetAllocatorDump("discardable/segment_0"));
+  const trace_event::MemoryAllocatorDump* blocks_dump =
+      pmd.GetAllocatorDump("discardable/segment_0/allocated_objects");
+  ASSERT_TRUE(blocks_dump);
+  EXPECT_EQ(page_size_, blocks_dump->GetSizeInternal());
+
+  trace_event::MemoryAllocatorDump* block_dump =
+      block->CreateMemoryAllocatorDump("test/block", &pmd);
+  ASSERT_TRUE(block_dump);
+  EXPECT_EQ(page_size_, block_dump->GetSizeInternal());
+  EXPECT_NE(pmd.allocator_dumps_edges().end(),
+            pmd.allocator_dumps_edges().find(block_dump->guid()));
+}
+
+}  // namespace base
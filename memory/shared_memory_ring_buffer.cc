@@ -0,0 +1,523 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/memory/shared_memory_ring_buffer.h"
+
+#include <limits.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <utility>
+
+#include "base/bits.h"
+#include "base/logging.h"
+#include "base/memory/ptr_util.h"
+#include "base/pickle.h"
+#include "base/threading/platform_thread.h"
+#include "build/build_config.h"
+
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace base {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x52494e47;  // "RING"
+constexpr size_t kMinCapacity = 64;
+constexpr size_t kRecordHeaderSize = 8;
+
+// Types of records. The consumer zeroes the space it releases, so the type of
+// a record which a producer reserved but didn't start writing is kFreeSpace.
+constexpr uint32_t kFreeSpace = 0;
+constexpr uint32_t kDataRecord = 1;
+// Fills the end of the buffer, when the next record doesn't fit there. Also
+// replaces the records dropped by SkipUncommittedRecord().
+constexpr uint32_t kPaddingRecord = 2;
+// A data record which its producer is still writing.
+constexpr uint32_t kReservedRecord = 3;
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) &&
+                  ATOMIC_INT_LOCK_FREE == 2,
+              "Futexes and shared memory require lock-free 32-bit atomics");
+
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+
+// Sleeps until |*word| is woken up, if it still contains |value|, or until
+// |timeout| expires. May return spuriously. The futex is not private, since
+// |word| is in shared memory.
+void FutexWait(std::atomic<uint32_t>* word, uint32_t value, TimeDelta timeout) {
+  struct timespec timespec;
+  if (!timeout.is_max())
+    timespec = timeout.ToTimeSpec();
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, value,
+          timeout.is_max() ? nullptr : &timespec, nullptr, 0);
+}
+
+void FutexWake(std::atomic<uint32_t>* word, int count) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, count,
+          nullptr, nullptr, 0);
+}
+
+#else
+
+// Polls, without a way to wait on an address shared between processes.
+void FutexWait(std::atomic<uint32_t>* word, uint32_t value, TimeDelta timeout) {
+  PlatformThread::Sleep(std::min(timeout, TimeDelta::FromMilliseconds(1)));
+}
+
+void FutexWake(std::atomic<uint32_t>* word, int count) {}
+
+#endif  // defined(OS_LINUX) || defined(OS_ANDROID)
+
+TimeTicks GetDeadline(TimeDelta timeout) {
+  return timeout.is_max() ? TimeTicks::Max() : TimeTicks::Now() + timeout;
+}
+
+TimeDelta GetRemainingTime(TimeTicks deadline) {
+  return deadline.is_max() ? TimeDelta::Max() : deadline - TimeTicks::Now();
+}
+
+}  // namespace
+
+// Positions are offsets in a virtual stream of records, which wrap around at
+// 2^32. They are mapped to the buffer modulo its capacity, a power of two.
+struct SharedMemoryRingBuffer::Header {
+  explicit Header(uint32_t capacity)
+      : magic(kMagic),
+        capacity(capacity),
+        reserve_pos(0),
+        commit_count(0),
+        consumer_waiting(0),
+        read_pos(0),
+        producers_waiting(0) {}
+
+  uint32_t magic;
+  uint32_t capacity;
+
+  // Written by the producers. Space before |reserve_pos| has been reserved.
+  // Each record is committed on its own, by setting its type, and
+  // |commit_count| is then incremented to wake up the consumer.
+  alignas(64) std::atomic<uint32_t> reserve_pos;
+  std::atomic<uint32_t> commit_count;
+  // Whether the consumer waits on |commit_count|.
+  std::atomic<uint32_t> consumer_waiting;
+
+  // Written by the consumer. The space before |read_pos| can be reused.
+  alignas(64) std::atomic<uint32_t> read_pos;
+  // Number of producers waiting on |read_pos|.
+  std::atomic<uint32_t> producers_waiting;
+};
+
+struct SharedMemoryRingBuffer::RecordHeader {
+  // Set last, with release semantics, when the record is committed.
+  std::atomic<uint32_t> type;
+  // Of the payload, which follows the header. Set before |type|.
+  uint32_t size;
+};
+
+namespace {
+
+// Size of a record in the buffer, including its header.
+uint32_t GetRecordSize(size_t payload_size) {
+  return static_cast<uint32_t>(
+      bits::Align(kRecordHeaderSize + payload_size,
+                  SharedMemoryRingBuffer::kRecordAlignment));
+}
+
+}  // namespace
+
+constexpr size_t SharedMemoryRingBuffer::kRecordAlignment;
+constexpr size_t SharedMemoryRingBuffer::kMaxCapacity;
+
+// static
+std::unique_ptr<SharedMemoryRingBuffer> SharedMemoryRingBuffer::Create(
+    WritableSharedMemoryMapping mapping) {
+  if (!mapping.IsValid() || mapping.size() < sizeof(Header) + kMinCapacity)
+    return nullptr;
+  size_t capacity = size_t{1} << bits::Log2Floor(static_cast<uint32_t>(
+                        std::min(mapping.size() - sizeof(Header),
+                                 kMaxCapacity)));
+  new (mapping.memory()) Header(static_cast<uint32_t>(capacity));
+  // Producers rely on reserved space being zeroed, see kFreeSpace.
+  memset(static_cast<uint8_t*>(mapping.memory()) + sizeof(Header), 0,
+         capacity);
+  return WrapUnique(new SharedMemoryRingBuffer(std::move(mapping), capacity));
+}
+
+// static
+std::unique_ptr<SharedMemoryRingBuffer> SharedMemoryRingBuffer::Attach(
+    WritableSharedMemoryMapping mapping) {
+  if (!mapping.IsValid() || mapping.size() < sizeof(Header))
+    return nullptr;
+  const Header* header = static_cast<const Header*>(mapping.memory());
+  uint32_t magic = header->magic;
+  size_t capacity = header->capacity;
+  if (magic != kMagic || !bits::IsPowerOfTwo(capacity) ||
+      capacity < kMinCapacity || capacity > kMaxCapacity ||
+      capacity > mapping.size() - sizeof(Header)) {
+    DLOG(ERROR) << "Invalid ring buffer header";
+    return nullptr;
+  }
+  return WrapUnique(new SharedMemoryRingBuffer(std::move(mapping), capacity));
+}
+
+SharedMemoryRingBuffer::SharedMemoryRingBuffer(
+    WritableSharedMemoryMapping mapping,
+    size_t capacity)
+    : mapping_(std::move(mapping)),
+      header_(static_cast<Header*>(mapping_.memory())),
+      capacity_(capacity),
+      read_pos_(header_->read_pos.load(std::memory_order_relaxed)) {}
+
+SharedMemoryRingBuffer::~SharedMemoryRingBuffer() {
+  DCHECK(!pending_read_size_);
+}
+
+size_t SharedMemoryRingBuffer::GetMaxRecordSize() const {
+  static_assert(sizeof(RecordHeader) == kRecordHeaderSize,
+                "Records must remain aligned");
+  // So that a record and the padding before it always fit in an empty buffer.
+  return capacity_ / 2 - sizeof(RecordHeader);
+}
+
+bool SharedMemoryRingBuffer::TryWrite(span<const uint8_t> data) {
+  return TryWriteImpl(data.data(), data.size());
+}
+
+bool SharedMemoryRingBuffer::TryWrite(const Pickle& pickle) {
+  return TryWriteImpl(pickle.data(), pickle.size());
+}
+
+bool SharedMemoryRingBuffer::Write(span<const uint8_t> data,
+                                   TimeDelta timeout) {
+  return WriteImpl(data.data(), data.size(), timeout);
+}
+
+bool SharedMemoryRingBuffer::Write(const Pickle& pickle, TimeDelta timeout) {
+  return WriteImpl(pickle.data(), pickle.size(), timeout);
+}
+
+bool SharedMemoryRingBuffer::BeginRead(span<const uint8_t>* record) {
+  DCHECK(!pending_read_size_);
+  uint32_t size_in_buffer;
+  if (!FindRecord(record, &size_in_buffer))
+    return false;
+  pending_read_size_ = size_in_buffer;
+  return true;
+}
+
+void SharedMemoryRingBuffer::EndRead() {
+  DCHECK(pending_read_size_);
+  Release(pending_read_size_);
+  pending_read_size_ = 0;
+}
+
+bool SharedMemoryRingBuffer::TryRead(std::vector<uint8_t>* record) {
+  span<const uint8_t> data;
+  if (!BeginRead(&data))
+    return false;
+  record->assign(data.begin(), data.end());
+  EndRead();
+  return true;
+}
+
+bool SharedMemoryRingBuffer::TryRead(Pickle* pickle) {
+  // The record is copied before being parsed, since its header, which gives
+  // its size, could be modified by another process in the meantime.
+  std::vector<uint8_t> record;
+  if (!TryRead(&record))
+    return false;
+  Pickle view(reinterpret_cast<const char*>(record.data()), record.size());
+  if (!view.data())
+    return false;
+  *pickle = view;
+  return true;
+}
+
+bool SharedMemoryRingBuffer::WaitForRecord(TimeDelta timeout) {
+  TimeTicks deadline = GetDeadline(timeout);
+  while (true) {
+    // Read before looking for a record, so that a record committed after that
+    // changes it.
+    uint32_t commit_count =
+        header_->commit_count.load(std::memory_order_acquire);
+    span<const uint8_t> record;
+    uint32_t size_in_buffer;
+    if (FindRecord(&record, &size_in_buffer))
+      return true;
+    if (corrupted_)
+      return false;
+    TimeDelta remaining = GetRemainingTime(deadline);
+    if (remaining <= TimeDelta())
+      return false;
+
+    header_->consumer_waiting.store(1, std::memory_order_seq_cst);
+    if (header_->commit_count.load(std::memory_order_seq_cst) == commit_count)
+      FutexWait(&header_->commit_count, commit_count, remaining);
+    header_->consumer_waiting.store(0, std::memory_order_relaxed);
+  }
+}
+
+bool SharedMemoryRingBuffer::SkipUncommittedRecord() {
+  DCHECK(!pending_read_size_);
+  while (true) {
+    uint32_t available;
+    if (!GetAvailableSize(&available))
+      return false;
+
+    const uint32_t position = read_pos_;
+    const uint32_t size_to_end =
+        static_cast<uint32_t>(capacity_ - (position & (capacity_ - 1)));
+    const uint32_t limit = std::min(size_to_end, available);
+    RecordHeader* record_header = GetRecordHeader(position);
+    uint32_t type = record_header->type.load(std::memory_order_acquire);
+    uint32_t size = record_header->size;
+    switch (type) {
+      case kPaddingRecord:
+        // Reserved along with the next record, which may be the uncommitted
+        // one.
+        if (size != size_to_end - sizeof(RecordHeader) ||
+            size_to_end >= available) {
+          SetCorrupted();
+          return false;
+        }
+        Release(size_to_end);
+        continue;
+
+      case kReservedRecord:
+        if (size > GetMaxRecordSize() || GetRecordSize(size) > limit) {
+          SetCorrupted();
+          return false;
+        }
+        // The producer commits the record with a compare-and-swap as well:
+        // either it finds that the record was dropped, or the record can be
+        // read.
+        if (!record_header->type.compare_exchange_strong(
+                type, kPaddingRecord, std::memory_order_relaxed)) {
+          return false;
+        }
+        Release(GetRecordSize(size));
+        return true;
+
+      case kFreeSpace: {
+        // The producer didn't even write the header. The space it reserved is
+        // still zeroed, up to the header of the next record, or the end of the
+        // buffer if it reserved padding as well.
+        uint32_t skipped_size = kRecordAlignment;
+        while (skipped_size < limit &&
+               GetRecordHeader(position + skipped_size)
+                       ->type.load(std::memory_order_acquire) == kFreeSpace) {
+          skipped_size += kRecordAlignment;
+        }
+        Release(skipped_size);
+        return true;
+      }
+
+      default:
+        // Committed, or corrupted, which reading will find.
+        return false;
+    }
+  }
+}
+
+bool SharedMemoryRingBuffer::GetAvailableSize(uint32_t* available) {
+  if (corrupted_)
+    return false;
+  *available =
+      header_->reserve_pos.load(std::memory_order_acquire) - read_pos_;
+  if (!*available)
+    return false;
+  if (*available > capacity_ || *available % kRecordAlignment) {
+    SetCorrupted();
+    return false;
+  }
+  return true;
+}
+
+bool SharedMemoryRingBuffer::FindRecord(span<const uint8_t>* record,
+                                        uint32_t* size_in_buffer) {
+  uint32_t available;
+  if (!GetAvailableSize(&available))
+    return false;
+
+  // Skips the padding at the end of the buffer, if any.
+  uint32_t position = read_pos_;
+  uint32_t skipped_size = 0;
+  while (true) {
+    RecordHeader* record_header = GetRecordHeader(position);
+    // Acquire, so that the record is complete. The size is read once, since
+    // another process may modify it.
+    uint32_t type = record_header->type.load(std::memory_order_acquire);
+    if (type == kFreeSpace || type == kReservedRecord)
+      return false;
+    uint32_t size = record_header->size;
+    uint32_t size_to_end =
+        static_cast<uint32_t>(capacity_ - (position & (capacity_ - 1)));
+
+    if (type == kPaddingRecord && !skipped_size &&
+        size == size_to_end - sizeof(RecordHeader) &&
+        size_to_end < available) {
+      skipped_size = size_to_end;
+      position += size_to_end;
+      available -= size_to_end;
+      continue;
+    }
+    if (type != kDataRecord || size > GetMaxRecordSize() ||
+        GetRecordSize(size) > std::min(size_to_end, available)) {
+      SetCorrupted();
+      return false;
+    }
+
+    *record =
+        span<const uint8_t>(GetData(position) + sizeof(RecordHeader), size);
+    *size_in_buffer = skipped_size + GetRecordSize(size);
+    return true;
+  }
+}
+
+void SharedMemoryRingBuffer::Release(uint32_t size) {
+  // Producers expect the space they reserve to be zeroed. Up to two parts,
+  // when padding at the end of the buffer is released with a record.
+  while (size) {
+    uint32_t size_to_end =
+        static_cast<uint32_t>(capacity_ - (read_pos_ & (capacity_ - 1)));
+    uint32_t part_size = std::min(size, size_to_end);
+    memset(GetData(read_pos_), 0, part_size);
+    read_pos_ += part_size;
+    size -= part_size;
+  }
+  // Sequentially consistent, along with the load of |producers_waiting|, so
+  // that a producer either sees the space made here, or is woken up. Also
+  // publishes the zeroed space.
+  header_->read_pos.store(read_pos_, std::memory_order_seq_cst);
+  if (header_->producers_waiting.load(std::memory_order_seq_cst))
+    FutexWake(&header_->read_pos, INT_MAX);
+}
+
+bool SharedMemoryRingBuffer::TryWriteImpl(const void* data, size_t size) {
+  uint32_t position;
+  if (!Reserve(size, &position))
+    return false;
+  RecordHeader* record_header = GetRecordHeader(position);
+  record_header->size = static_cast<uint32_t>(size);
+  record_header->type.store(kReservedRecord, std::memory_order_release);
+  // The payload isn't written before the header, so that the consumer finds
+  // the reservation zeroed if this producer dies before writing the header.
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(GetData(position) + sizeof(RecordHeader), data, size);
+
+  // Records are committed independently of each other, so a producer which
+  // crashes or stalls while writing doesn't block the other ones. Release, so
+  // that the consumer sees the payload. Fails if the consumer dropped the
+  // record in the meantime.
+  uint32_t type = kReservedRecord;
+  if (!record_header->type.compare_exchange_strong(
+          type, kDataRecord, std::memory_order_release,
+          std::memory_order_relaxed)) {
+    return false;
+  }
+  header_->commit_count.fetch_add(1, std::memory_order_seq_cst);
+  if (header_->consumer_waiting.load(std::memory_order_seq_cst))
+    FutexWake(&header_->commit_count, 1);
+  return true;
+}
+
+bool SharedMemoryRingBuffer::ReserveForTesting(size_t size,
+                                               bool write_header) {
+  uint32_t position;
+  if (!Reserve(size, &position))
+    return false;
+  if (write_header) {
+    RecordHeader* record_header = GetRecordHeader(position);
+    record_header->size = static_cast<uint32_t>(size);
+    record_header->type.store(kReservedRecord, std::memory_order_release);
+  }
+  return true;
+}
+
+bool SharedMemoryRingBuffer::Reserve(size_t size, uint32_t* position) {
+  if (size > GetMaxRecordSize())
+    return false;
+  const uint32_t record_size = GetRecordSize(size);
+
+  // Reserves space for the record, and the padding before it, if the record
+  // doesn't fit before the end of the buffer.
+  uint32_t begin = header_->reserve_pos.load(std::memory_order_relaxed);
+  uint32_t padding_size;
+  uint32_t end;
+  do {
+    // Acquire, so that the consumer is done with the space before |read_pos|,
+    // and has zeroed it, before it is overwritten.
+    uint32_t used =
+        begin - header_->read_pos.load(std::memory_order_acquire);
+    uint32_t size_to_end =
+        static_cast<uint32_t>(capacity_ - (begin & (capacity_ - 1)));
+    padding_size = record_size > size_to_end ? size_to_end : 0;
+    if (used > capacity_ || capacity_ - used < padding_size + record_size)
+      return false;
+    end = begin + padding_size + record_size;
+  } while (!header_->reserve_pos.compare_exchange_weak(
+      begin, end, std::memory_order_relaxed));
+
+  *position = begin;
+  if (padding_size) {
+    // Padding is committed right away.
+    RecordHeader* padding = GetRecordHeader(*position);
+    padding->size = padding_size - static_cast<uint32_t>(kRecordHeaderSize);
+    padding->type.store(kPaddingRecord, std::memory_order_release);
+    *position += padding_size;
+  }
+  return true;
+}
+
+bool SharedMemoryRingBuffer::WriteImpl(const void* data,
+                                       size_t size,
+                                       TimeDelta timeout) {
+  if (size > GetMaxRecordSize())
+    return false;
+
+  TimeTicks deadline = GetDeadline(timeout);
+  while (true) {
+    if (TryWriteImpl(data, size))
+      return true;
+    TimeDelta remaining = GetRemainingTime(deadline);
+    if (remaining <= TimeDelta())
+      return false;
+
+    // The consumer wakes up waiting producers when it makes space, after
+    // updating |read_pos|. Checks again after registering as a waiter, in case
+    // it did in the meantime.
+    header_->producers_waiting.fetch_add(1, std::memory_order_seq_cst);
+    uint32_t read_pos = header_->read_pos.load(std::memory_order_seq_cst);
+    bool written = TryWriteImpl(data, size);
+    if (!written)
+      FutexWait(&header_->read_pos, read_pos, remaining);
+    header_->producers_waiting.fetch_sub(1, std::memory_order_relaxed);
+    if (written)
+      return true;
+  }
+}
+
+uint8_t* SharedMemoryRingBuffer::GetData(uint32_t position) const {
+  return static_cast<uint8_t*>(mapping_.memory()) + sizeof(Header) +
+         (position & (capacity_ - 1));
+}
+
+SharedMemoryRingBuffer::RecordHeader* SharedMemoryRingBuffer::GetRecordHeader(
+    uint32_t position) const {
+  return reinterpret_cast<RecordHeader*>(GetData(position));
+}
+
+void SharedMemoryRingBuffer::SetCorrupted() {
+  DLOG(ERROR) << "Corrupted ring buffer";
+  corrupted_ = true;
+}
+
+}  // namespace base
@@ -0,0 +1,172 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_MEMORY_SHARED_MEMORY_RING_BUFFER_H_
+#define BASE_MEMORY_SHARED_MEMORY_RING_BUFFER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/containers/span.h"
+#include "base/macros.h"
+#include "base/memory/shared_memory_mapping.h"
+#include "base/time/time.h"
+
+namespace base {
+
+class Pickle;
+
+// A ring buffer of variable-length records, laid out in shared memory, to
+// stream data between processes without going through a socket. Records are
+// written by any number of producers and read by a single consumer, each of
+// which may live in a different process, and maps the same region.
+//
+// Reserving space for a record is lock-free. Each record is then committed on
+// its own, so producers never wait for each other, and the consumer reads the
+// records in the order in which their space was reserved. A producer which
+// crashes or stalls before committing its record holds up the consumer, not
+// the other producers, and the consumer can drop the record with
+// SkipUncommittedRecord(). Readers and writers only make a system call to wake
+// up the other side when it is waiting, using futexes on Linux and Android.
+// Other platforms poll.
+//
+// The consumer must not trust the content of the buffer, which may have been
+// corrupted by another process: records are validated before being handed
+// out, and the buffer stops being usable once corruption has been detected.
+//
+// Example:
+//   // In the consumer.
+//   UnsafeSharedMemoryRegion region = UnsafeSharedMemoryRegion::Create(size);
+//   auto consumer = SharedMemoryRingBuffer::Create(region.Map());
+//   ... send |region| to the producer process ...
+//   while (consumer->WaitForRecord(TimeDelta::Max())) {
+//     Pickle pickle;
+//     if (consumer->TryRead(&pickle))
+//       Handle(pickle);
+//   }
+//
+//   // In the producer.
+//   auto producer = SharedMemoryRingBuffer::Attach(region.Map());
+//   Pickle pickle;
+//   pickle.WriteString(...);
+//   producer->Write(pickle, TimeDelta::Max());
+class BASE_EXPORT SharedMemoryRingBuffer {
+ public:
+  // Records are aligned on this, within the buffer.
+  static constexpr size_t kRecordAlignment = 8;
+  // The largest capacity, such that positions fit in 32 bits, which is the size
+  // of a futex.
+  static constexpr size_t kMaxCapacity = size_t{1} << 31;
+
+  // Lays out an empty ring buffer in |mapping|, which must not be used by
+  // another process yet. The capacity of the buffer is the largest power of two
+  // which fits in the mapping, after a small header. Returns null if |mapping|
+  // is invalid or too small.
+  static std::unique_ptr<SharedMemoryRingBuffer> Create(
+      WritableSharedMemoryMapping mapping);
+  // Uses the ring buffer laid out by Create() in another mapping of the same
+  // region. Returns null if the header of the buffer is invalid.
+  static std::unique_ptr<SharedMemoryRingBuffer> Attach(
+      WritableSharedMemoryMapping mapping);
+
+  ~SharedMemoryRingBuffer();
+
+  // Size of the data area of the buffer. Records take their size, plus a header
+  // of 8 bytes, rounded up to kRecordAlignment.
+  size_t capacity() const { return capacity_; }
+  // The largest record which can be written.
+  size_t GetMaxRecordSize() const;
+  // Whether the consumer found the buffer to be corrupted, after which it can't
+  // read from it anymore.
+  bool IsCorrupted() const { return corrupted_; }
+
+  // Producer side. Writes |data| as a single record, and returns true, if the
+  // buffer has room for it and the consumer didn't drop the record while it
+  // was written (see SkipUncommittedRecord()). Can be called from any thread,
+  // of any process.
+  bool TryWrite(span<const uint8_t> data);
+  // Writes the data of |pickle|, which can be read back as a Pickle.
+  bool TryWrite(const Pickle& pickle);
+  // Same as TryWrite(), but waits up to |timeout| for the consumer to make
+  // room. Returns false right away if |data| is larger than
+  // GetMaxRecordSize().
+  bool Write(span<const uint8_t> data, TimeDelta timeout);
+  bool Write(const Pickle& pickle, TimeDelta timeout);
+
+  // Consumer side. These must all be called from the same thread, and only
+  // from one process.
+  //
+  // If a record is available, points |record| to it, in the shared memory, and
+  // returns true. The record must then be released with EndRead(), before
+  // reading the next one. The content of |record| may be modified by another
+  // process: it must be read once, or copied, to be validated.
+  bool BeginRead(span<const uint8_t>* record);
+  void EndRead();
+  // Copies the next record, if any, to |record|, and returns true.
+  bool TryRead(std::vector<uint8_t>* record);
+  // Reads the next record, if any, as a pickle. Returns false if there is no
+  // record, or if the record is not a valid pickle, in which case it is
+  // consumed nonetheless.
+  bool TryRead(Pickle* pickle);
+  // Waits up to |timeout| for a record to be available. Returns true if there
+  // is one.
+  bool WaitForRecord(TimeDelta timeout);
+  // Drops the next record if its producer reserved space for it but didn't
+  // commit it, as when the producer crashed. Returns true if space was
+  // released, in which case records reserved after it may be read, or the
+  // next one may be dropped as well. Only call this once the producer is
+  // presumed dead, typically when WaitForRecord() timed out: if the producer
+  // later writes the record, it overwrites space reused by other records,
+  // which the consumer may then find corrupted.
+  bool SkipUncommittedRecord();
+
+  // Reserves space for a record of |size| bytes without committing it, as a
+  // producer which crashes while writing the record would. Writes the header
+  // of the record only if |write_header|.
+  bool ReserveForTesting(size_t size, bool write_header);
+
+ private:
+  struct Header;
+  struct RecordHeader;
+
+  SharedMemoryRingBuffer(WritableSharedMemoryMapping mapping, size_t capacity);
+
+  bool TryWriteImpl(const void* data, size_t size);
+  bool WriteImpl(const void* data, size_t size, TimeDelta timeout);
+  // Reserves space for a record with a payload of |size| bytes, and sets
+  // |position| to the record.
+  bool Reserve(size_t size, uint32_t* position);
+  // Sets |available| to the size of the space reserved after |read_pos_|.
+  // Returns false if there is none, or if the buffer is corrupted.
+  bool GetAvailableSize(uint32_t* available);
+  // Finds the next committed record, without consuming it. |size_in_buffer| is
+  // set to the space to release once it is read.
+  bool FindRecord(span<const uint8_t>* record, uint32_t* size_in_buffer);
+  // Zeroes the |size| bytes after |read_pos_| and hands them to the producers.
+  void Release(uint32_t size);
+  uint8_t* GetData(uint32_t position) const;
+  RecordHeader* GetRecordHeader(uint32_t position) const;
+  void SetCorrupted();
+
+  WritableSharedMemoryMapping mapping_;
+  Header* const header_;
+  // Copied from |header_|, which another process could modify.
+  const size_t capacity_;
+
+  // Position of the next record to read, which isn't trusted from |header_|.
+  uint32_t read_pos_;
+  // Size, in the buffer, of the record handed out by BeginRead(), if any.
+  uint32_t pending_read_size_ = 0;
+  bool corrupted_ = false;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedMemoryRingBuffer);
+};
+
+}  // namespace base
+
+#endif  // BASE_MEMORY_SHARED_MEMORY_RING_BUFFER_H_
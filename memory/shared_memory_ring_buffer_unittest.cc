@@ -0,0 +1,314 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/memory/shared_memory_ring_buffer.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/memory/unsafe_shared_memory_region.h"
+#include "base/pickle.h"
+#include "base/threading/simple_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+constexpr size_t kRegionSize = 4096;
+
+span<const uint8_t> AsBytes(const std::string& string) {
+  return as_bytes(make_span(string));
+}
+
+std::string AsString(const std::vector<uint8_t>& record) {
+  return std::string(record.begin(), record.end());
+}
+
+struct Message {
+  uint32_t producer;
+  uint32_t sequence;
+};
+
+// Writes |count| messages, with a sequence number.
+class Producer : public DelegateSimpleThread::Delegate {
+ public:
+  Producer(const UnsafeSharedMemoryRegion& region,
+           uint32_t id,
+           uint32_t count)
+      : ring_buffer_(SharedMemoryRingBuffer::Attach(region.Map())),
+        id_(id),
+        count_(count) {}
+
+  void Run() override {
+    for (uint32_t i = 0; i < count_; ++i) {
+      Message message = {id_, i};
+      // Varying sizes, to wrap around at different positions.
+      std::vector<uint8_t> record(sizeof(message) + i % 100, 'a');
+      memcpy(record.data(), &message, sizeof(message));
+      ASSERT_TRUE(ring_buffer_->Write(record, TimeDelta::Max()));
+    }
+  }
+
+ private:
+  std::unique_ptr<SharedMemoryRingBuffer> ring_buffer_;
+  const uint32_t id_;
+  const uint32_t count_;
+};
+
+class SharedMemoryRingBufferTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    region_ = UnsafeSharedMemoryRegion::Create(kRegionSize);
+    ASSERT_TRUE(region_.IsValid());
+    consumer_ = SharedMemoryRingBuffer::Create(region_.Map());
+    ASSERT_TRUE(consumer_);
+    // As in another process.
+    producer_ = SharedMemoryRingBuffer::Attach(region_.Map());
+    ASSERT_TRUE(producer_);
+  }
+
+  UnsafeSharedMemoryRegion region_;
+  std::unique_ptr<SharedMemoryRingBuffer> consumer_;
+  std::unique_ptr<SharedMemoryRingBuffer> producer_;
+};
+
+}  // namespace
+
+TEST_F(SharedMemoryRingBufferTest, WriteAndRead) {
+  EXPECT_EQ(2048u, consumer_->capacity());
+  EXPECT_EQ(consumer_->capacity(), producer_->capacity());
+
+  std::vector<uint8_t> record;
+  EXPECT_FALSE(consumer_->TryRead(&record));
+  EXPECT_FALSE(consumer_->WaitForRecord(TimeDelta()));
+
+  EXPECT_TRUE(producer_->TryWrite(AsBytes("first")));
+  EXPECT_TRUE(producer_->TryWrite(AsBytes("")));
+  EXPECT_TRUE(producer_->TryWrite(AsBytes("third")));
+  EXPECT_TRUE(consumer_->WaitForRecord(TimeDelta()));
+
+  ASSERT_TRUE(consumer_->TryRead(&record));
+  EXPECT_EQ("first", AsString(record));
+  ASSERT_TRUE(consumer_->TryRead(&record));
+  EXPECT_EQ("", AsString(record));
+
+  // Without copying.
+  span<const uint8_t> data;
+  ASSERT_TRUE(consumer_->BeginRead(&data));
+  EXPECT_EQ("third", std::string(data.begin(), data.end()));
+  consumer_->EndRead();
+
+  EXPECT_FALSE(consumer_->TryRead(&record));
+}
+
+TEST_F(SharedMemoryRingBufferTest, Pickle) {
+  Pickle written;
+  written.WriteInt(42);
+  written.WriteString("pickle");
+  EXPECT_TRUE(producer_->TryWrite(written));
+
+  Pickle read;
+  ASSERT_TRUE(consumer_->TryRead(&read));
+  PickleIterator iterator(read);
+  int value;
+  std::string string;
+  EXPECT_TRUE(iterator.ReadInt(&value));
+  EXPECT_EQ(42, value);
+  EXPECT_TRUE(iterator.ReadString(&string));
+  EXPECT_EQ("pickle", string);
+
+  // Not a pickle.
+  EXPECT_TRUE(producer_->TryWrite(AsBytes("ab")));
+  EXPECT_FALSE(consumer_->TryRead(&read));
+  EXPECT_FALSE(consumer_->IsCorrupted());
+}
+
+TEST_F(SharedMemoryRingBufferTest, Full) {
+  std::vector<uint8_t> record(100, 'a');
+  size_t count = 0;
+  while (producer_->TryWrite(record))
+    ++count;
+  // Records take 8 more bytes, rounded up to the alignment.
+  EXPECT_EQ(consumer_->capacity() / 112, count);
+  EXPECT_FALSE(producer_->Write(record, TimeDelta::FromMilliseconds(1)));
+
+  // Reading a record makes room for another one.
+  std::vector<uint8_t> read;
+  ASSERT_TRUE(consumer_->TryRead(&read));
+  EXPECT_EQ(record, read);
+  EXPECT_TRUE(producer_->Write(record, TimeDelta::FromMilliseconds(1)));
+}
+
+TEST_F(SharedMemoryRingBufferTest, RecordTooLarge) {
+  std::vector<uint8_t> record(producer_->GetMaxRecordSize() + 1, 'a');
+  EXPECT_FALSE(producer_->TryWrite(record));
+  EXPECT_FALSE(producer_->Write(record, TimeDelta::Max()));
+
+  record.pop_back();
+  EXPECT_TRUE(producer_->TryWrite(record));
+  std::vector<uint8_t> read;
+  ASSERT_TRUE(consumer_->TryRead(&read));
+  EXPECT_EQ(record, read);
+}
+
+TEST_F(SharedMemoryRingBufferTest, WrapAround) {
+  // Records of varying sizes end up at every position, and padding is needed at
+  // the end of the buffer.
+  for (size_t i = 0; i < 1000; ++i) {
+    std::string written(i % 997, static_cast<char>('a' + i % 26));
+    ASSERT_TRUE(producer_->TryWrite(AsBytes(written)));
+    if (i % 2) {
+      ASSERT_TRUE(producer_->TryWrite(AsBytes(std::to_string(i))));
+    }
+
+    std::vector<uint8_t> read;
+    ASSERT_TRUE(consumer_->TryRead(&read));
+    EXPECT_EQ(written, AsString(read));
+    if (i % 2) {
+      ASSERT_TRUE(consumer_->TryRead(&read));
+      EXPECT_EQ(std::to_string(i), AsString(read));
+    }
+    EXPECT_FALSE(consumer_->TryRead(&read));
+  }
+}
+
+TEST_F(SharedMemoryRingBufferTest, InvalidRegion) {
+  EXPECT_FALSE(SharedMemoryRingBuffer::Create(WritableSharedMemoryMapping()));
+  UnsafeSharedMemoryRegion small_region = UnsafeSharedMemoryRegion::Create(64);
+  EXPECT_FALSE(SharedMemoryRingBuffer::Create(small_region.Map()));
+
+  // Not laid out by Create().
+  UnsafeSharedMemoryRegion region = UnsafeSharedMemoryRegion::Create(4096);
+  EXPECT_FALSE(SharedMemoryRingBuffer::Attach(region.Map()));
+}
+
+TEST_F(SharedMemoryRingBufferTest, CorruptedRecord) {
+  const std::string kPayload = "payload to corrupt";
+  ASSERT_TRUE(producer_->TryWrite(AsBytes(kPayload)));
+
+  // Makes the size of the record larger than the buffer.
+  WritableSharedMemoryMapping mapping = region_.Map();
+  uint8_t* memory = mapping.GetMemoryAs<uint8_t>();
+  uint8_t* payload = std::search(memory, memory + mapping.size(),
+                                 kPayload.begin(), kPayload.end());
+  ASSERT_NE(memory + mapping.size(), payload);
+  uint32_t size = 1 << 20;
+  memcpy(payload - sizeof(size), &size, sizeof(size));
+
+  std::vector<uint8_t> record;
+  EXPECT_FALSE(consumer_->TryRead(&record));
+  EXPECT_TRUE(consumer_->IsCorrupted());
+  EXPECT_FALSE(consumer_->WaitForRecord(TimeDelta::Max()));
+}
+
+TEST_F(SharedMemoryRingBufferTest, UncommittedRecord) {
+  // As a producer which crashed while writing its record.
+  ASSERT_TRUE(producer_->ReserveForTesting(16, true));
+
+  // Doesn't block the other producers.
+  auto other_producer = SharedMemoryRingBuffer::Attach(region_.Map());
+  ASSERT_TRUE(other_producer);
+  EXPECT_TRUE(other_producer->TryWrite(AsBytes("after")));
+  std::vector<uint8_t> record(100, 'a');
+  while (other_producer->TryWrite(record)) {
+  }
+  EXPECT_FALSE(other_producer->Write(record, TimeDelta::FromMilliseconds(1)));
+
+  // Holds up the consumer until it drops the record.
+  std::vector<uint8_t> read;
+  EXPECT_FALSE(consumer_->TryRead(&read));
+  EXPECT_FALSE(consumer_->WaitForRecord(TimeDelta::FromMilliseconds(1)));
+  EXPECT_TRUE(consumer_->SkipUncommittedRecord());
+  ASSERT_TRUE(consumer_->TryRead(&read));
+  EXPECT_EQ("after", AsString(read));
+  EXPECT_FALSE(consumer_->SkipUncommittedRecord());
+  ASSERT_TRUE(consumer_->TryRead(&read));
+  EXPECT_EQ(record, read);
+  EXPECT_FALSE(consumer_->IsCorrupted());
+}
+
+TEST_F(SharedMemoryRingBufferTest, UncommittedRecordWithoutHeader) {
+  std::vector<uint8_t> read;
+
+  // The producer crashed before writing anything: the consumer drops the space
+  // up to the next record.
+  ASSERT_TRUE(producer_->ReserveForTesting(100, false));
+  EXPECT_TRUE(producer_->TryWrite(AsBytes("first")));
+  EXPECT_FALSE(consumer_->TryRead(&read));
+  EXPECT_TRUE(consumer_->SkipUncommittedRecord());
+  ASSERT_TRUE(consumer_->TryRead(&read));
+  EXPECT_EQ("first", AsString(read));
+
+  // Same, with padding at the end of the buffer before the record.
+  std::vector<uint8_t> record(900, 'a');
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_TRUE(producer_->TryWrite(record));
+    ASSERT_TRUE(consumer_->TryRead(&read));
+  }
+  ASSERT_TRUE(producer_->ReserveForTesting(400, false));
+  EXPECT_TRUE(producer_->TryWrite(AsBytes("second")));
+  EXPECT_FALSE(consumer_->TryRead(&read));
+  EXPECT_TRUE(consumer_->SkipUncommittedRecord());
+  ASSERT_TRUE(consumer_->TryRead(&read));
+  EXPECT_EQ("second", AsString(read));
+  EXPECT_FALSE(consumer_->IsCorrupted());
+}
+
+TEST_F(SharedMemoryRingBufferTest, ProducerThread) {
+  constexpr uint32_t kCount = 10000;
+  Producer producer(region_, 0, kCount);
+  DelegateSimpleThread thread(&producer, "SharedMemoryRingBufferTest");
+  thread.Start();
+
+  // The buffer only holds a few records at a time, so that both sides wait.
+  for (uint32_t i = 0; i < kCount; ++i) {
+    ASSERT_TRUE(consumer_->WaitForRecord(TimeDelta::Max()));
+    std::vector<uint8_t> record;
+    ASSERT_TRUE(consumer_->TryRead(&record));
+    ASSERT_EQ(sizeof(Message) + i % 100, record.size());
+    Message message;
+    memcpy(&message, record.data(), sizeof(message));
+    EXPECT_EQ(i, message.sequence);
+  }
+  thread.Join();
+  EXPECT_FALSE(consumer_->WaitForRecord(TimeDelta()));
+}
+
+TEST_F(SharedMemoryRingBufferTest, MultipleProducers) {
+  constexpr uint32_t kProducerCount = 3;
+  constexpr uint32_t kCountPerProducer = 5000;
+  std::vector<std::unique_ptr<Producer>> producers;
+  std::vector<std::unique_ptr<DelegateSimpleThread>> threads;
+  for (uint32_t i = 0; i < kProducerCount; ++i) {
+    producers.push_back(
+        std::make_unique<Producer>(region_, i, kCountPerProducer));
+    threads.push_back(std::make_unique<DelegateSimpleThread>(
+        producers.back().get(), "SharedMemoryRingBufferTest"));
+    threads.back()->Start();
+  }
+
+  // The records of each producer are read in order.
+  std::vector<uint32_t> next_sequences(kProducerCount, 0);
+  for (uint32_t i = 0; i < kProducerCount * kCountPerProducer; ++i) {
+    ASSERT_TRUE(consumer_->WaitForRecord(TimeDelta::Max()));
+    std::vector<uint8_t> record;
+    ASSERT_TRUE(consumer_->TryRead(&record));
+    Message message;
+    ASSERT_GE(record.size(), sizeof(message));
+    memcpy(&message, record.data(), sizeof(message));
+    ASSERT_LT(message.producer, kProducerCount);
+    EXPECT_EQ(next_sequences[message.producer]++, message.sequence);
+  }
+  for (auto& thread : threads)
+    thread->Join();
+  EXPECT_FALSE(consumer_->WaitForRecord(TimeDelta()));
+}
+
+}  // namespace base
@@ -0,0 +1,30 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_STRINGS_DOUBLE_TO_STRING_H_
+#define BASE_STRINGS_DOUBLE_TO_STRING_H_
+
+#include <stddef.h>
+
+#include "base/base_export.h"
+
+namespace base {
+
+// The longest output of DoubleToShortestString(), e.g.
+// "-2.2250738585072014e-308".
+constexpr size_t kDoubleToShortestStringMaxLength = 24;
+
+// Formats |value| exactly as NumberToString(double) does: as the shortest
+// decimal string that converts back to |value|, switching to exponential
+// notation for very large and very small magnitudes. Unlike NumberToString(),
+// this uses the Ryu algorithm, which is several times faster, and does not
+// allocate.
+//
+// Writes at most kDoubleToShortestStringMaxLength bytes to |buffer|, with no
+// terminating NUL, and returns the number of bytes written.
+BASE_EXPORT size_t DoubleToShortestString(double value, char* buffer);
+
+}  // namespace base
+
+#endif  // BASE_STRINGS_DOUBLE_TO_STRING_H_
@@ -0,0 +1,100 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/strings/double_to_string.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <cmath>
+#include <limits>
+#include <string>
+
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/stringprintf.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+std::string ToString(double value) {
+  char buffer[kDoubleToShortestStringMaxLength];
+  return std::string(buffer, DoubleToShortestString(value, buffer));
+}
+
+double FromBits(uint64_t bits) {
+  double value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+}  // namespace
+
+TEST(DoubleToStringTest, Format) {
+  const struct {
+    double input;
+    const char* expected;
+  } kCases[] = {
+      {0.0, "0"},
+      {-0.0, "-0"},
+      {1.0, "1"},
+      {-1.5, "-1.5"},
+      {0.1, ".1"},
+      {0.3, ".3"},
+      {1.0 / 3, ".3333333333333333"},
+      {0.001, ".001"},
+      {0.0001, ".0001"},
+      {0.00001, "1e-05"},
+      {123456.0, "123456"},
+      {1e6, "1e+06"},
+      {1234567e5, "123456700000"},
+      {1e21, "1e+21"},
+      {1.33518e+012, "1.33518e+12"},
+      {1.33545e+009, "1335450000"},
+      {5e-324, "5e-324"},
+      {std::numeric_limits<double>::max(), "1.7976931348623157e+308"},
+      {-std::numeric_limits<double>::min(), "-2.2250738585072014e-308"},
+      {9007199254740993.0, "9007199254740992"},
+      {std::numeric_limits<double>::infinity(), "Infinity"},
+      {-std::numeric_limits<double>::infinity(), "-Infinity"},
+      {std::numeric_limits<double>::quiet_NaN(), "NaN"},
+  };
+
+  for (const auto& test : kCases) {
+    EXPECT_EQ(test.expected, ToString(test.input));
+    EXPECT_EQ(NumberToString(test.input), ToString(test.input));
+  }
+}
+
+TEST(DoubleToStringTest, MatchesNumberToString) {
+  // Powers of two and ten, and their neighbors, are where the bounds of the
+  // shortest representation are the most irregular.
+  for (int exponent = -1074; exponent <= 1023; ++exponent) {
+    const double power = std::ldexp(1.0, exponent);
+    for (double value : {power, std::nextafter(power, 0.0),
+                         std::nextafter(power, HUGE_VAL)}) {
+      SCOPED_TRACE(StringPrintf("%a", value));
+      EXPECT_EQ(NumberToString(value), ToString(value));
+    }
+  }
+  for (int exponent = -323; exponent <= 308; ++exponent) {
+    const double power = std::pow(10.0, exponent);
+    SCOPED_TRACE(StringPrintf("%a", power));
+    EXPECT_EQ(NumberToString(power), ToString(power));
+  }
+
+  // A deterministic sample of bit patterns, including subnormals.
+  uint64_t bits = 0x123456789ABCDEF;
+  for (int i = 0; i < 100000; ++i) {
+    bits = bits * 6364136223846793005ULL + 1442695040888963407ULL;
+    for (uint64_t sample : {bits, bits >> 12, bits & 0x800FFFFFFFFFFFFF}) {
+      const double value = FromBits(sample);
+      SCOPED_TRACE(StringPrintf("%a", value));
+      EXPECT_EQ(NumberToString(value), ToString(value));
+    }
+  }
+}
+
+}  // namespace base
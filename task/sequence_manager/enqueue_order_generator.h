@@ -6,6 +6,7 @@
 #ifndef BASE_TASK_SEQUENCE_MANAGER_ENQUEUE_ORDER_GENERATOR_H_
 #define BASE_TASK_SEQUENCE_MANAGER_ENQUEUE_ORDER_GENERATOR_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include <atomic>
@@ -31,6 +32,19 @@ class BASE_EXPORT EnqueueOrderGenerator {
         &counter_, uint64_t(1), std::memory_order_relaxed));
   }
 
+  // Reserves |count| consecutive enqueue orders and returns the first one.
+  // Can be called from any thread.
+  EnqueueOrder GenerateNext(size_t count) {
+    return EnqueueOrder(std::atomic_fetch_add_explicit(
+        &counter_, uint64_t(count), std::memory_order_relaxed));
+  }
+
+  // Returns the enqueue order reserved |n| places after |enqueue_order| by
+  // GenerateNext(count), where |n| < count.
+  static EnqueueOrder Advance(EnqueueOrder enqueue_order, size_t n) {
+    return EnqueueOrder(enqueue_order + n);
+  }
+
  private:
   std::atomic<uint64_t> counter_;
   DISALLOW_COPY_AND_ASSIGN(EnqueueOrderGenerator);
@@ -0,0 +1,90 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/task/sequence_manager/immediate_incoming_queue.h"
+
+namespace base {
+namespace sequence_manager {
+namespace internal {
+
+ImmediateIncomingQueue::ImmediateIncomingQueue()
+    : head_(&stub_), retired_(&stub_), grace_end_(&stub_), tail_(&stub_) {}
+
+ImmediateIncomingQueue::~ImmediateIncomingQueue() {
+  Link* link = retired_;
+  while (link) {
+    Link* next = link->next.load(std::memory_order_acquire);
+    if (link != &stub_)
+      delete static_cast<Node*>(link);
+    link = next;
+  }
+}
+
+void ImmediateIncomingQueue::TakeTasks(TaskDeque* tasks) {
+  size_t num_taken = 0;
+  for (;;) {
+    Link* next = head_->next.load(std::memory_order_acquire);
+    if (!next)
+      break;
+    tasks->push_back(std::move(static_cast<Node*>(next)->task));
+    head_ = next;
+    ++num_taken;
+  }
+  if (num_taken)
+    size_.fetch_sub(num_taken, std::memory_order_relaxed);
+  DeleteRetiredNodes();
+}
+
+void ImmediateIncomingQueue::DeleteRetiredNodes() {
+  // No producer can link to a retired node: its successor is linked. But a
+  // producer which read |tail_| before the successor was appended might still
+  // compare |tail_| to its address. The successor was appended before it was
+  // linked, hence before |epoch_| was flipped: such a producer registered
+  // before the flip, in the previous epoch, and a producer which registers in
+  // the previous epoch after the flip sees the flip and retries. So the nodes
+  // retired before the flip can be deleted once the previous epoch is empty.
+  const int epoch = epoch_.load(std::memory_order_relaxed);
+  if (retired_ != grace_end_) {
+    if (num_pushing_[1 - epoch].load(std::memory_order_seq_cst) != 0)
+      return;
+    DeleteNodesUntil(grace_end_);
+  }
+  if (grace_end_ == head_)
+    return;
+
+  // The previous epoch is empty and stays so, since producers check |epoch_|
+  // after registering. Reuse it for the producers which start from now on.
+  grace_end_ = head_;
+  epoch_.store(1 - epoch, std::memory_order_seq_cst);
+  if (num_pushing_[epoch].load(std::memory_order_seq_cst) == 0)
+    DeleteNodesUntil(grace_end_);
+}
+
+void ImmediateIncomingQueue::DeleteNodesUntil(Link* end) {
+  while (retired_ != end) {
+    Link* next = retired_->next.load(std::memory_order_relaxed);
+    if (retired_ != &stub_)
+      delete static_cast<Node*>(retired_);
+    retired_ = next;
+  }
+}
+
+bool ImmediateIncomingQueue::Arm() {
+  armed_.store(true, std::memory_order_seq_cst);
+  if (!head_->next.load(std::memory_order_seq_cst))
+    return true;
+  // A task was pushed before the queue was armed, or concurrently. If it was
+  // the latter, the producer might still see that the queue is armed and
+  // report it, which is harmless.
+  armed_.store(false, std::memory_order_relaxed);
+  return false;
+}
+
+void ImmediateIncomingQueue::Disarm() {
+  armed_.store(false, std::memory_order_relaxed);
+}
+
+}  // namespace internal
+}  // namespace sequence_manager
+}  // namespace base
@@ -0,0 +1,311 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_TASK_SEQUENCE_MANAGER_IMMEDIATE_INCOMING_QUEUE_H_
+#define BASE_TASK_SEQUENCE_MANAGER_IMMEDIATE_INCOMING_QUEUE_H_
+
+#include <stddef.h>
+
+#include <atomic>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/logging.h"
+#include "base/macros.h"
+#include "base/task/sequence_manager/enqueue_order.h"
+#include "base/task/sequence_manager/enqueue_order_generator.h"
+#include "base/task/sequence_manager/lazily_deallocated_deque.h"
+#include "base/task/sequence_manager/tasks.h"
+#include "base/time/time_override.h"
+
+namespace base {
+namespace sequence_manager {
+namespace internal {
+
+// A lock-free, multi-producer single-consumer queue of immediate tasks, used
+// as the |immediate_incoming_queue| of a TaskQueueImpl. Any thread can Push()
+// tasks; the main thread (the consumer) takes all of them at once with
+// TakeTasks().
+//
+// Tasks are held in an intrusive singly-linked list. A producer appends a node
+// by swinging |tail_| to it with a compare-and-swap and then linking it from
+// the previous tail. Enqueue orders are generated between reading |tail_| and
+// the compare-and-swap, so they increase along the list: the EnqueueOrder of a
+// task is never smaller than that of a task ahead of it in the queue, as
+// WorkQueue requires. A task becomes visible to the consumer once it is linked.
+//
+// That argument only holds if the node a producer read from |tail_| is still
+// the tail when its compare-and-swap succeeds, not a new node that reuses the
+// address of a deleted one (ABA). So the consumer doesn't delete the nodes it
+// takes right away: it retires them, and deletes them once every Push() that
+// was in progress when they were retired has returned. Producers register in
+// one of two counters, picked by |epoch_|, and the consumer flips |epoch_|
+// when it retires nodes, so Push()es that start later don't delay the
+// deletion: under any load, retired nodes are deleted by the first TakeTasks()
+// after the Push()es that were in progress when they were retired.
+//
+// The consumer doesn't poll the queue. Instead, when it runs out of tasks it
+// calls Arm(), and the first Push() after that returns true to tell the
+// producer to wake the consumer up.
+class BASE_EXPORT ImmediateIncomingQueue {
+ private:
+  struct Link {
+    std::atomic<Link*> next{nullptr};
+  };
+
+  struct Node : public Link {
+    explicit Node(Task task) : task(std::move(task)) {}
+
+    Task task;
+  };
+
+ public:
+  // LazilyDeallocatedDeque use TimeTicks to figure out when to resize. We
+  // should use real time here always.
+  using TaskDeque =
+      LazilyDeallocatedDeque<Task, subtle::TimeTicksNowIgnoringOverride>;
+
+  // Iterates over the tasks that are visible to the consumer, from oldest to
+  // newest.
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = const Task;
+    using difference_type = ptrdiff_t;
+    using pointer = const Task*;
+    using reference = const Task&;
+
+    explicit const_iterator(const Link* link) : link_(link) {}
+
+    const Task& operator*() const {
+      return static_cast<const Node*>(link_)->task;
+    }
+    const Task* operator->() const { return &**this; }
+
+    const_iterator& operator++() {
+      link_ = link_->next.load(std::memory_order_acquire);
+      return *this;
+    }
+
+    bool operator==(const const_iterator& other) const {
+      return link_ == other.link_;
+    }
+    bool operator!=(const const_iterator& other) const {
+      return link_ != other.link_;
+    }
+
+   private:
+    const Link* link_;
+  };
+
+  ImmediateIncomingQueue();
+
+  // Must not be called while a Push() is in progress.
+  ~ImmediateIncomingQueue();
+
+  // Appends |task|. Its enqueue order is obtained from |next_enqueue_order|, a
+  // callable returning strictly increasing EnqueueOrders, which may be called
+  // more than once. If |task| already has an enqueue order, as in tests,
+  // |next_enqueue_order| must return it. |will_push| is called on the task once
+  // its enqueue order is set and before the consumer can see it. Returns true
+  // if the consumer is armed (see Arm()), in which case the caller must wake it
+  // up. Can be called from any thread.
+  template <typename NextEnqueueOrder, typename WillPush>
+  bool Push(Task task,
+            NextEnqueueOrder next_enqueue_order,
+            WillPush will_push);
+
+  // Appends |tasks|, in order, like as many calls to Push() but with a single
+  // compare-and-swap of |tail_|, and a single check of whether the consumer is
+  // armed. |next_enqueue_orders| is a callable which reserves as many
+  // consecutive EnqueueOrders as it is passed and returns the first one; it
+  // may be called more than once. |tasks| must not be empty and must not have
+  // enqueue orders. Can be called from any thread.
+  template <typename NextEnqueueOrders, typename WillPush>
+  bool PushBatch(std::vector<Task> tasks,
+                 NextEnqueueOrders next_enqueue_orders,
+                 WillPush will_push);
+
+  // Moves all the tasks that are visible to the consumer to the back of
+  // |tasks|, and deletes the retired nodes that no Push() can refer to.
+  // Consumer only.
+  void TakeTasks(TaskDeque* tasks);
+
+  // Asks for the next Push() to return true. Returns false without arming the
+  // queue if tasks were pushed since the last TakeTasks(), in which case the
+  // caller should take them instead of waiting. Consumer only.
+  bool Arm();
+
+  // Cancels a previous Arm(). A concurrent Push() may still return true.
+  // Consumer only.
+  void Disarm();
+
+  // Consumer only.
+  bool empty() const {
+    return !head_->next.load(std::memory_order_acquire);
+  }
+  // The number of tasks pushed and not taken yet. Unlike iterating, this may
+  // count tasks whose Push() is still in progress.
+  size_t size() const { return size_.load(std::memory_order_relaxed); }
+  const Task& front() const {
+    DCHECK(!empty());
+    return *begin();
+  }
+  const_iterator begin() const {
+    return const_iterator(head_->next.load(std::memory_order_acquire));
+  }
+  const_iterator end() const { return const_iterator(nullptr); }
+
+ private:
+  // Publishes the |count| nodes linked from |first| to |last|.
+  template <typename NextEnqueueOrders, typename WillPush>
+  bool PushNodes(Node* first,
+                 Node* last,
+                 size_t count,
+                 NextEnqueueOrders next_enqueue_orders,
+                 WillPush will_push);
+
+  // Deletes the retired nodes that no Push() can refer to, and starts a new
+  // grace period for the nodes retired since the last one.
+  void DeleteRetiredNodes();
+
+  // Deletes the nodes from |retired_| up to |end|, excluded.
+  void DeleteNodesUntil(Link* end);
+
+  // The last node whose task was taken, or |stub_| before the first
+  // TakeTasks(). The tasks in the queue are those of the nodes after it.
+  // Consumer only.
+  Link* head_;
+
+  // The oldest node which wasn't deleted yet. The nodes from it up to |head_|,
+  // excluded, are retired: their tasks were taken, but a producer might still
+  // compare |tail_| to their address. Consumer only.
+  Link* retired_;
+
+  // The nodes from |retired_| up to |grace_end_|, excluded, were retired
+  // before the last change of |epoch_|. They are deleted once no producer is
+  // registered in the previous epoch. Consumer only.
+  Link* grace_end_;
+
+  // The last node in the list, which might not be linked to the previous one
+  // yet.
+  std::atomic<Link*> tail_;
+
+  // The number of tasks pushed and not taken yet.
+  std::atomic<size_t> size_{0};
+
+  // Selects the counter of |num_pushing_| that producers register in. Written
+  // by the consumer only.
+  std::atomic<int> epoch_{0};
+
+  // The number of producers between their first read of |tail_| and their
+  // successful compare-and-swap, by the epoch they registered in.
+  std::atomic<int> num_pushing_[2]{{0}, {0}};
+
+  // Whether the consumer is waiting for a Push().
+  std::atomic<bool> armed_{true};
+
+  Link stub_;
+
+  DISALLOW_COPY_AND_ASSIGN(ImmediateIncomingQueue);
+};
+
+template <typename NextEnqueueOrder, typename WillPush>
+bool ImmediateIncomingQueue::Push(Task task,
+                                  NextEnqueueOrder next_enqueue_order,
+                                  WillPush will_push) {
+  Node* const node = new Node(std::move(task));
+  return PushNodes(
+      node, node, 1, [&next_enqueue_order](size_t count) {
+        return next_enqueue_order();
+      },
+      will_push);
+}
+
+template <typename NextEnqueueOrders, typename WillPush>
+bool ImmediateIncomingQueue::PushBatch(std::vector<Task> tasks,
+                                       NextEnqueueOrders next_enqueue_orders,
+                                       WillPush will_push) {
+  DCHECK(!tasks.empty());
+  DCHECK(!tasks.front().enqueue_order_set());
+  // The nodes are linked to each other before they are published, so the
+  // consumer sees all of them at once.
+  Node* const first = new Node(std::move(tasks.front()));
+  Node* last = first;
+  for (size_t i = 1; i < tasks.size(); ++i) {
+    DCHECK(!tasks[i].enqueue_order_set());
+    Node* const node = new Node(std::move(tasks[i]));
+    last->next.store(node, std::memory_order_relaxed);
+    last = node;
+  }
+  return PushNodes(first, last, tasks.size(), next_enqueue_orders, will_push);
+}
+
+template <typename NextEnqueueOrders, typename WillPush>
+bool ImmediateIncomingQueue::PushNodes(Node* first,
+                                       Node* last,
+                                       size_t count,
+                                       NextEnqueueOrders next_enqueue_orders,
+                                       WillPush will_push) {
+  // Generating the enqueue orders after reading |tail_| guarantees that they
+  // are greater than that of |prev|, which was generated before |prev| became
+  // the tail. Retry with new enqueue orders if another producer got in first.
+  // Registering in |num_pushing_| before reading |tail_| keeps the consumer
+  // from deleting |prev| until the compare-and-swap is done (see
+  // DeleteRetiredNodes()), so the compare-and-swap can't succeed on a new node
+  // which reuses the address of |prev|. Checking |epoch_| again after
+  // registering guarantees that the consumer waits for this producer if it
+  // retires nodes this producer may read.
+  int epoch;
+  for (;;) {
+    epoch = epoch_.load(std::memory_order_seq_cst);
+    num_pushing_[epoch].fetch_add(1, std::memory_order_seq_cst);
+    if (epoch_.load(std::memory_order_seq_cst) == epoch)
+      break;
+    num_pushing_[epoch].fetch_sub(1, std::memory_order_release);
+  }
+  Link* prev = tail_.load(std::memory_order_seq_cst);
+  EnqueueOrder first_enqueue_order;
+  do {
+    first_enqueue_order = next_enqueue_orders(count);
+  } while (!tail_.compare_exchange_weak(prev, last, std::memory_order_seq_cst,
+                                        std::memory_order_seq_cst));
+  // From now on, |prev| can't be deleted before it's linked to |first|.
+  num_pushing_[epoch].fetch_sub(1, std::memory_order_release);
+
+  Node* node = first;
+  for (size_t i = 0; i < count; ++i) {
+    const EnqueueOrder enqueue_order =
+        EnqueueOrderGenerator::Advance(first_enqueue_order, i);
+    if (node->task.enqueue_order_set())
+      DCHECK_EQ(node->task.enqueue_order(), enqueue_order);
+    else
+      node->task.set_enqueue_order(enqueue_order);
+    will_push(&node->task);
+    // |last->next| belongs to the next producer as soon as |tail_| is swung,
+    // so don't read it.
+    if (node != last)
+      node = static_cast<Node*>(node->next.load(std::memory_order_relaxed));
+  }
+
+  // Counting the tasks before linking them keeps TakeTasks() from
+  // decrementing |size_| below zero.
+  size_.fetch_add(count, std::memory_order_relaxed);
+
+  // Linking |first| makes the nodes visible to the consumer. This store and
+  // the load of |armed_| below are sequentially consistent, and so are the
+  // corresponding operations in Arm(): either Arm() sees |first|, or this sees
+  // that the consumer is armed.
+  prev->next.store(first, std::memory_order_seq_cst);
+  return armed_.load(std::memory_order_seq_cst) &&
+         armed_.exchange(false, std::memory_order_seq_cst);
+}
+
+}  // namespace internal
+}  // namespace sequence_manager
+}  // namespace base
+
+#endif  // BASE_TASK_SEQUENCE_MANAGER_IMMEDIATE_INCOMING_QUEUE_H_
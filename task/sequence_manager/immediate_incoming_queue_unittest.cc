@@ -0,0 +1,323 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/task/sequence_manager/immediate_incoming_queue.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/bind_helpers.h"
+#include "base/callback_helpers.h"
+#include "base/task/sequence_manager/enqueue_order_generator.h"
+#include "base/threading/simple_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace sequence_manager {
+namespace internal {
+
+namespace {
+
+Task CreateTask() {
+  return Task(PostedTask(DoNothing(), FROM_HERE), TimeTicks(), EnqueueOrder());
+}
+
+std::vector<EnqueueOrder> GetEnqueueOrders(
+    const ImmediateIncomingQueue::TaskDeque& tasks) {
+  std::vector<EnqueueOrder> enqueue_orders;
+  for (const Task& task : tasks)
+    enqueue_orders.push_back(task.enqueue_order());
+  return enqueue_orders;
+}
+
+class ImmediateIncomingQueueTest : public testing::Test {
+ protected:
+  // Pushes a task and returns whether the queue was armed.
+  bool Push() {
+    return queue_.Push(
+        CreateTask(),
+        [this]() { return enqueue_order_generator_.GenerateNext(); },
+        [](Task* task) {});
+  }
+
+  EnqueueOrderGenerator enqueue_order_generator_;
+  ImmediateIncomingQueue queue_;
+};
+
+// Pushes |num_tasks| tasks, in batches of |batch_size| if it's greater than 1.
+class PostingThread : public SimpleThread {
+ public:
+  PostingThread(ImmediateIncomingQueue* queue,
+                EnqueueOrderGenerator* enqueue_order_generator,
+                size_t num_tasks,
+                size_t batch_size,
+                std::atomic<int>* num_armed_pushes)
+      : SimpleThread("PostingThread"),
+        queue_(queue),
+        enqueue_order_generator_(enqueue_order_generator),
+        num_tasks_(num_tasks),
+        batch_size_(batch_size),
+        num_armed_pushes_(num_armed_pushes) {}
+
+  void Run() override {
+    for (size_t i = 0; i < num_tasks_; i += batch_size_) {
+      if (Push())
+        num_armed_pushes_->fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+ private:
+  bool Push() {
+    if (batch_size_ == 1) {
+      return queue_->Push(
+          CreateTask(),
+          [this]() { return enqueue_order_generator_->GenerateNext(); },
+          [](Task* task) {});
+    }
+    std::vector<Task> tasks;
+    for (size_t i = 0; i < batch_size_; ++i)
+      tasks.push_back(CreateTask());
+    return queue_->PushBatch(
+        std::move(tasks),
+        [this](size_t count) {
+          return enqueue_order_generator_->GenerateNext(count);
+        },
+        [](Task* task) {});
+  }
+
+  ImmediateIncomingQueue* const queue_;
+  EnqueueOrderGenerator* const enqueue_order_generator_;
+  const size_t num_tasks_;
+  const size_t batch_size_;
+  std::atomic<int>* const num_armed_pushes_;
+};
+
+}  // namespace
+
+TEST_F(ImmediateIncomingQueueTest, PushAndTake) {
+  EXPECT_TRUE(queue_.empty());
+  EXPECT_EQ(0u, queue_.size());
+
+  Push();
+  Push();
+  Push();
+  EXPECT_FALSE(queue_.empty());
+  EXPECT_EQ(3u, queue_.size());
+  const EnqueueOrder front_enqueue_order = queue_.front().enqueue_order();
+
+  ImmediateIncomingQueue::TaskDeque tasks;
+  queue_.TakeTasks(&tasks);
+  EXPECT_TRUE(queue_.empty());
+  std::vector<EnqueueOrder> enqueue_orders = GetEnqueueOrders(tasks);
+  ASSERT_EQ(3u, enqueue_orders.size());
+  EXPECT_EQ(front_enqueue_order, enqueue_orders[0]);
+  EXPECT_LT(enqueue_orders[0], enqueue_orders[1]);
+  EXPECT_LT(enqueue_orders[1], enqueue_orders[2]);
+
+  // The queue can be reused once drained.
+  Push();
+  EXPECT_EQ(1u, queue_.size());
+  queue_.TakeTasks(&tasks);
+  enqueue_orders = GetEnqueueOrders(tasks);
+  ASSERT_EQ(4u, enqueue_orders.size());
+  EXPECT_LT(enqueue_orders[2], enqueue_orders[3]);
+}
+
+TEST_F(ImmediateIncomingQueueTest, PushBatch) {
+  Push();
+  std::vector<Task> batch;
+  batch.push_back(CreateTask());
+  batch.push_back(CreateTask());
+  batch.push_back(CreateTask());
+  size_t num_will_push_calls = 0;
+  queue_.PushBatch(
+      std::move(batch),
+      [this](size_t count) {
+        return enqueue_order_generator_.GenerateNext(count);
+      },
+      [&](Task* task) {
+        EXPECT_TRUE(task->enqueue_order_set());
+        ++num_will_push_calls;
+      });
+  EXPECT_EQ(3u, num_will_push_calls);
+  Push();
+  EXPECT_EQ(5u, queue_.size());
+
+  ImmediateIncomingQueue::TaskDeque tasks;
+  queue_.TakeTasks(&tasks);
+  std::vector<EnqueueOrder> enqueue_orders = GetEnqueueOrders(tasks);
+  ASSERT_EQ(5u, enqueue_orders.size());
+  for (size_t i = 1; i < enqueue_orders.size(); ++i)
+    EXPECT_LT(enqueue_orders[i - 1], enqueue_orders[i]);
+}
+
+TEST_F(ImmediateIncomingQueueTest, PushBatchArm) {
+  ImmediateIncomingQueue::TaskDeque tasks;
+  EXPECT_TRUE(Push());
+  queue_.TakeTasks(&tasks);
+  EXPECT_TRUE(queue_.Arm());
+
+  // A batch is reported once.
+  std::vector<Task> batch;
+  batch.push_back(CreateTask());
+  batch.push_back(CreateTask());
+  EXPECT_TRUE(queue_.PushBatch(
+      std::move(batch),
+      [this](size_t count) {
+        return enqueue_order_generator_.GenerateNext(count);
+      },
+      [](Task* task) {}));
+  EXPECT_FALSE(Push());
+}
+
+TEST_F(ImmediateIncomingQueueTest, WillPushSeesEnqueueOrder) {
+  EnqueueOrder enqueue_order;
+  queue_.Push(CreateTask(),
+              [this]() { return enqueue_order_generator_.GenerateNext(); },
+              [&](Task* task) { enqueue_order = task->enqueue_order(); });
+  EXPECT_EQ(enqueue_order, queue_.front().enqueue_order());
+}
+
+TEST_F(ImmediateIncomingQueueTest, Iterate) {
+  Push();
+  Push();
+  std::vector<EnqueueOrder> enqueue_orders;
+  for (const Task& task : queue_)
+    enqueue_orders.push_back(task.enqueue_order());
+  ASSERT_EQ(2u, enqueue_orders.size());
+  EXPECT_EQ(queue_.front().enqueue_order(), enqueue_orders[0]);
+  EXPECT_LT(enqueue_orders[0], enqueue_orders[1]);
+}
+
+TEST_F(ImmediateIncomingQueueTest, Arm) {
+  // The queue starts armed, and only the first push reports it.
+  EXPECT_TRUE(Push());
+  EXPECT_FALSE(Push());
+
+  // Can't arm while there are tasks to take.
+  EXPECT_FALSE(queue_.Arm());
+  EXPECT_FALSE(Push());
+
+  ImmediateIncomingQueue::TaskDeque tasks;
+  queue_.TakeTasks(&tasks);
+  EXPECT_TRUE(queue_.Arm());
+  EXPECT_TRUE(Push());
+  EXPECT_FALSE(Push());
+
+  queue_.TakeTasks(&tasks);
+  EXPECT_TRUE(queue_.Arm());
+  queue_.Disarm();
+  EXPECT_FALSE(Push());
+}
+
+TEST_F(ImmediateIncomingQueueTest, TasksAreDeletedWithQueue) {
+  bool deleted = false;
+  {
+    ImmediateIncomingQueue queue;
+    ScopedClosureRunner runner(
+        BindOnce([](bool* deleted) { *deleted = true; }, &deleted));
+    Task task(
+        PostedTask(BindOnce([](ScopedClosureRunner) {}, std::move(runner)),
+                   FROM_HERE),
+        TimeTicks(), EnqueueOrder());
+    queue.Push(std::move(task),
+               [this]() { return enqueue_order_generator_.GenerateNext(); },
+               [](Task* task) {});
+    EXPECT_FALSE(deleted);
+  }
+  EXPECT_TRUE(deleted);
+}
+
+class ImmediateIncomingQueueConcurrencyTest
+    : public ImmediateIncomingQueueTest,
+      public testing::WithParamInterface<size_t> {};
+
+// Takes tasks while several threads push, and checks that no task is lost,
+// that enqueue orders never decrease, and that every time the consumer armed
+// the queue, a push woke it up.
+TEST_P(ImmediateIncomingQueueConcurrencyTest, ConcurrentPushes) {
+  constexpr size_t kNumThreads = 4;
+  constexpr size_t kNumTasksPerThread = 20000;
+  std::atomic<int> num_armed_pushes(0);
+
+  std::vector<std::unique_ptr<PostingThread>> threads;
+  for (size_t i = 0; i < kNumThreads; ++i) {
+    threads.push_back(std::make_unique<PostingThread>(
+        &queue_, &enqueue_order_generator_, kNumTasksPerThread, GetParam(),
+        &num_armed_pushes));
+  }
+  // The queue starts armed.
+  int num_arms = 1;
+  for (auto& thread : threads)
+    thread->Start();
+
+  size_t num_tasks = 0;
+  EnqueueOrder last_enqueue_order;
+  while (num_tasks < kNumThreads * kNumTasksPerThread) {
+    ImmediateIncomingQueue::TaskDeque tasks;
+    queue_.TakeTasks(&tasks);
+    if (tasks.empty() && queue_.Arm()) {
+      ++num_arms;
+      // Wait for the push that disarms the queue.
+      while (num_armed_pushes.load(std::memory_order_relaxed) < num_arms)
+        PlatformThread::YieldCurrentThread();
+      continue;
+    }
+    for (const Task& task : tasks) {
+      EXPECT_LE(last_enqueue_order, task.enqueue_order());
+      last_enqueue_order = task.enqueue_order();
+    }
+    num_tasks += tasks.size();
+  }
+
+  for (auto& thread : threads)
+    thread->Join();
+  EXPECT_TRUE(queue_.empty());
+  EXPECT_EQ(0u, queue_.size());
+  EXPECT_EQ(kNumThreads * kNumTasksPerThread, num_tasks);
+}
+
+// Takes tasks as fast as possible while many threads push, so that the
+// addresses of deleted nodes are reused while producers race on the tail, and
+// checks that enqueue orders strictly increase.
+TEST_P(ImmediateIncomingQueueConcurrencyTest, EnqueueOrdersIncrease) {
+  constexpr size_t kNumThreads = 8;
+  constexpr size_t kNumTasksPerThread = 10000;
+  std::atomic<int> num_armed_pushes(0);
+
+  std::vector<std::unique_ptr<PostingThread>> threads;
+  for (size_t i = 0; i < kNumThreads; ++i) {
+    threads.push_back(std::make_unique<PostingThread>(
+        &queue_, &enqueue_order_generator_, kNumTasksPerThread, GetParam(),
+        &num_armed_pushes));
+  }
+  for (auto& thread : threads)
+    thread->Start();
+
+  size_t num_tasks = 0;
+  EnqueueOrder last_enqueue_order;
+  while (num_tasks < kNumThreads * kNumTasksPerThread) {
+    ImmediateIncomingQueue::TaskDeque tasks;
+    queue_.TakeTasks(&tasks);
+    for (const Task& task : tasks) {
+      ASSERT_LT(last_enqueue_order, task.enqueue_order());
+      last_enqueue_order = task.enqueue_order();
+    }
+    num_tasks += tasks.size();
+  }
+
+  for (auto& thread : threads)
+    thread->Join();
+  EXPECT_EQ(kNumThreads * kNumTasksPerThread, num_tasks);
+}
+
+INSTANTIATE_TEST_SUITE_P(,
+                         ImmediateIncomingQueueConcurrencyTest,
+                         testing::Values(1, 4));
+
+}  // namespace internal
+}  // namespace sequence_manager
+}  // namespace base
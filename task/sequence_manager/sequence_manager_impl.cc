@@ -882,6 +882,10 @@ EnqueueOrder SequenceManagerImpl::GetNextSequenceNumber() {
   return enqueue_order_generator_.GenerateNext();
 }
 
+EnqueueOrder SequenceManagerImpl::GetNextSequenceNumbers(size_t count) {
+  return enqueue_order_generator_.GenerateNext(count);
+}
+
 std::unique_ptr<trace_event::ConvertableToTraceFormat>
 SequenceManagerImpl::AsValueWithSelectorResult(
     internal::WorkQueue* selected_work_queue,
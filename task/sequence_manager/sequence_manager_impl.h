@@ -338,6 +338,9 @@ class BASE_EXPORT SequenceManagerImpl
 
   EnqueueOrder GetNextSequenceNumber();
 
+  // Reserves |count| consecutive sequence numbers and returns the first one.
+  EnqueueOrder GetNextSequenceNumbers(size_t count);
+
   bool GetAddQueueTimeToTasks();
 
   std::unique_ptr<trace_event::ConvertableToTraceFormat>
@@ -655,6 +655,32 @@ TEST_P(SequenceManagerTest, SingleQueuePosting) {
   EXPECT_THAT(run_order, ElementsAre(1u, 2u, 3u));
 }
 
+TEST_P(SequenceManagerTest, PostTasks) {
+  auto queue = CreateTaskQueue();
+
+  std::vector<EnqueueOrder> run_order;
+  queue->task_runner()->PostTask(FROM_HERE, BindOnce(&TestTask, 1, &run_order));
+  std::vector<OnceClosure> tasks;
+  tasks.push_back(BindOnce(&TestTask, 2, &run_order));
+  tasks.push_back(BindOnce(&TestTask, 3, &run_order));
+  tasks.push_back(BindOnce(&TestTask, 4, &run_order));
+  EXPECT_TRUE(queue->task_runner()->PostTasks(FROM_HERE, std::move(tasks)));
+  queue->task_runner()->PostTask(FROM_HERE, BindOnce(&TestTask, 5, &run_order));
+
+  RunLoop().RunUntilIdle();
+  EXPECT_THAT(run_order, ElementsAre(1u, 2u, 3u, 4u, 5u));
+}
+
+TEST_P(SequenceManagerTest, PostTasksToShutdownQueue) {
+  auto queue = CreateTaskQueue();
+  scoped_refptr<SingleThreadTaskRunner> task_runner = queue->task_runner();
+  queue->ShutdownTaskQueue();
+
+  std::vector<OnceClosure> tasks;
+  tasks.push_back(BindOnce(&NopTask));
+  EXPECT_FALSE(task_runner->PostTasks(FROM_HERE, std::move(tasks)));
+}
+
 TEST_P(SequenceManagerTest, MultiQueuePosting) {
   auto queues = CreateTaskQueues(3u);
 
@@ -993,6 +1019,31 @@ TEST(SequenceManagerTestWithMockTaskRunner,
   EXPECT_EQ(1u, fixture.test_task_runner()->GetPendingTaskCount());
 }
 
+TEST(SequenceManagerTestWithMockTaskRunner,
+     CrossThreadPostTasksSchedulesWorkOnce) {
+  FixtureWithMockTaskRunner fixture;
+  auto queue =
+      fixture.sequence_manager()->CreateTaskQueue(TaskQueue::Spec("test"));
+
+  std::vector<int> run_order;
+  Thread thread("TestThread");
+  thread.Start();
+  thread.task_runner()->PostTask(FROM_HERE, BindLambdaForTesting([&]() {
+                                   std::vector<OnceClosure> tasks;
+                                   for (int i = 0; i < 3; ++i) {
+                                     tasks.push_back(BindLambdaForTesting(
+                                         [&, i]() { run_order.push_back(i); }));
+                                   }
+                                   queue->task_runner()->PostTasks(
+                                       FROM_HERE, std::move(tasks));
+                                 }));
+  thread.Stop();
+
+  EXPECT_EQ(1u, fixture.test_task_runner()->GetPendingTaskCount());
+  fixture.test_task_runner()->RunUntilIdle();
+  EXPECT_THAT(run_order, ElementsAre(0, 1, 2));
+}
+
 class TestObject {
  public:
   ~TestObject() { destructor_count__++; }
@@ -8,6 +8,7 @@
 #include <memory>
 
 #include "base/bind.h"
+#include "base/format_macros.h"
 #include "base/message_loop/message_loop.h"
 #include "base/message_loop/message_pump_default.h"
 #include "base/run_loop.h"
@@ -584,6 +585,74 @@ class TwoThreadTestCase : public TestCase {
   int done_count_ = 0;
 };
 
+// Posts immediate tasks from |num_threads| threads at once, which contend for
+// the immediate incoming queues of the task queues.
+class MultiThreadTestCase : public TestCase {
+ public:
+  MultiThreadTestCase(PerfTestDelegate* delegate,
+                      std::vector<scoped_refptr<TaskRunner>> task_runners,
+                      size_t num_threads)
+      : TestCase(delegate), task_runners_(std::move(task_runners)) {
+    for (size_t i = 0; i < num_threads; i++) {
+      posting_threads_.push_back(std::make_unique<Thread>(
+          StringPrintf("posting thread %" PRIuS, i)));
+      posting_threads_.back()->Start();
+    }
+  }
+
+  ~MultiThreadTestCase() override {
+    for (auto& thread : posting_threads_)
+      thread->Stop();
+  }
+
+  void Start() override {
+    done_count_ = 0;
+    task_sources_.clear();
+    for (size_t i = 0; i < posting_threads_.size(); i++) {
+      task_sources_.push_back(std::make_unique<CrossThreadImmediateTaskSource>(
+          this, task_runners_, kNumTasks / posting_threads_.size()));
+    }
+    for (size_t i = 0; i < posting_threads_.size(); i++) {
+      posting_threads_[i]->task_runner()->PostTask(
+          FROM_HERE, BindOnce(&CrossThreadImmediateTaskSource::Start,
+                              Unretained(task_sources_[i].get())));
+    }
+  }
+
+ private:
+  class CrossThreadImmediateTaskSource : public CrossThreadTaskSource {
+   public:
+    CrossThreadImmediateTaskSource(
+        MultiThreadTestCase* multi_thread_test_case,
+        std::vector<scoped_refptr<TaskRunner>> task_runners,
+        size_t num_tasks)
+        : CrossThreadTaskSource(std::move(task_runners), num_tasks),
+          multi_thread_test_case_(multi_thread_test_case) {}
+
+    ~CrossThreadImmediateTaskSource() override = default;
+
+    void PostTask(unsigned int queue) override {
+      task_runners_[queue]->PostTask(FROM_HERE, task_closure_);
+    }
+
+    // Will be called on the main thread.
+    void SignalDone() override { multi_thread_test_case_->SignalDone(); }
+
+    MultiThreadTestCase* multi_thread_test_case_;  // NOT OWNED.
+  };
+
+  // Will be called on the main thread.
+  void SignalDone() {
+    if (++done_count_ == task_sources_.size())
+      delegate_->SignalDone();
+  }
+
+  const std::vector<scoped_refptr<TaskRunner>> task_runners_;
+  std::vector<std::unique_ptr<Thread>> posting_threads_;
+  std::vector<std::unique_ptr<CrossThreadImmediateTaskSource>> task_sources_;
+  size_t done_count_ = 0;
+};
+
 class SequenceManagerPerfTest : public testing::TestWithParam<PerfTestType> {
  public:
   SequenceManagerPerfTest() = default;
@@ -821,6 +890,34 @@ TEST_P(SequenceManagerPerfTest,
             &task_source);
 }
 
+TEST_P(SequenceManagerPerfTest, PostImmediateTasksFromFourThreads_OneQueue) {
+  MultiThreadTestCase task_source(delegate_.get(), CreateTaskRunners(1), 4);
+  Benchmark("post immediate tasks with one queue from four threads",
+            &task_source);
+}
+
+TEST_P(SequenceManagerPerfTest, PostImmediateTasksFromEightThreads_OneQueue) {
+  if (!ShouldMeasureQueueScaling()) {
+    LOG(INFO) << "Unsupported";
+    return;
+  }
+
+  MultiThreadTestCase task_source(delegate_.get(), CreateTaskRunners(1), 8);
+  Benchmark("post immediate tasks with one queue from eight threads",
+            &task_source);
+}
+
+TEST_P(SequenceManagerPerfTest, PostImmediateTasksFromEightThreads_FourQueues) {
+  if (!ShouldMeasureQueueScaling()) {
+    LOG(INFO) << "Unsupported";
+    return;
+  }
+
+  MultiThreadTestCase task_source(delegate_.get(), CreateTaskRunners(4), 8);
+  Benchmark("post immediate tasks with four queues from eight threads",
+            &task_source);
+}
+
 // TODO(alexclarke): Add additional tests with different mixes of non-delayed vs
 // delayed tasks.
 
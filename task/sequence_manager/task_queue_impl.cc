@@ -64,6 +64,18 @@ bool TaskQueueImpl::GuardedTaskPoster::PostTask(PostedTask task) {
   return true;
 }
 
+bool TaskQueueImpl::GuardedTaskPoster::PostTasks(
+    std::vector<PostedTask> tasks) {
+  ScopedDeferTaskPosting disallow_task_posting;
+
+  auto token = operations_controller_.TryBeginOperation();
+  if (!token)
+    return false;
+
+  outer_->PostTasks(std::move(tasks));
+  return true;
+}
+
 TaskQueueImpl::TaskRunner::TaskRunner(
     scoped_refptr<GuardedTaskPoster> task_poster,
     scoped_refptr<AssociatedThreadId> associated_thread,
@@ -89,6 +101,17 @@ bool TaskQueueImpl::TaskRunner::PostNonNestableDelayedTask(
                                            Nestable::kNonNestable, task_type_));
 }
 
+bool TaskQueueImpl::TaskRunner::PostTasks(const Location& location,
+                                          std::vector<OnceClosure> callbacks) {
+  std::vector<PostedTask> tasks;
+  tasks.reserve(callbacks.size());
+  for (OnceClosure& callback : callbacks) {
+    tasks.emplace_back(std::move(callback), location, TimeDelta(),
+                       Nestable::kNestable, task_type_);
+  }
+  return task_poster_->PostTasks(std::move(tasks));
+}
+
 bool TaskQueueImpl::TaskRunner::RunsTasksInCurrentSequence() const {
   return associated_thread_->IsBoundToCurrentThread();
 }
@@ -164,14 +187,16 @@ void TaskQueueImpl::UnregisterTaskQueue() {
     task_poster_->ShutdownAndWaitForZeroOperations();
   }
 
+  // There are no task runners left to push onto |immediate_incoming_queue_|.
   TaskDeque immediate_incoming_queue;
+  immediate_incoming_queue_.TakeTasks(&immediate_incoming_queue);
 
   {
     base::internal::CheckedAutoLock lock(any_thread_lock_);
     any_thread_.unregistered = true;
     any_thread_.time_domain = nullptr;
-    immediate_incoming_queue.swap(any_thread_.immediate_incoming_queue);
     any_thread_.task_queue_observer = nullptr;
+    post_immediate_task_needs_lock_.store(false, std::memory_order_relaxed);
   }
 
   if (main_thread_only().time_domain)
@@ -224,6 +249,30 @@ void TaskQueueImpl::PostTask(PostedTask task) {
   }
 }
 
+void TaskQueueImpl::PostTasks(std::vector<PostedTask> tasks) {
+  CurrentThread current_thread =
+      associated_thread_->IsBoundToCurrentThread()
+          ? TaskQueueImpl::CurrentThread::kMainThread
+          : TaskQueueImpl::CurrentThread::kNotMainThread;
+
+#if DCHECK_IS_ON()
+  // Tasks delayed by MaybeAdjustTaskDelay() are posted on their own.
+  std::vector<PostedTask> immediate_tasks;
+  immediate_tasks.reserve(tasks.size());
+  for (PostedTask& task : tasks) {
+    MaybeLogPostTask(&task);
+    MaybeAdjustTaskDelay(&task, current_thread);
+    if (task.delay.is_zero())
+      immediate_tasks.push_back(std::move(task));
+    else
+      PostDelayedTaskImpl(std::move(task), current_thread);
+  }
+  tasks = std::move(immediate_tasks);
+#endif  // DCHECK_IS_ON()
+
+  PostImmediateTasksImpl(std::move(tasks), current_thread);
+}
+
 void TaskQueueImpl::MaybeLogPostTask(PostedTask* task) {
 #if DCHECK_IS_ON()
   if (!sequence_manager_->settings().log_post_task)
@@ -252,6 +301,94 @@ void TaskQueueImpl::MaybeAdjustTaskDelay(PostedTask* task,
 #endif  // DCHECK_IS_ON()
 }
 
+template <typename WillPush>
+bool TaskQueueImpl::PushOntoImmediateIncomingQueue(Task task,
+                                                   WillPush will_push) {
+  const bool reload_requested = immediate_incoming_queue_.Push(
+      std::move(task),
+      [this]() { return sequence_manager_->GetNextSequenceNumber(); },
+      [&will_push](Task* task) {
+        // As for other immediate tasks, the sequence number is the enqueue
+        // order, which was only just assigned.
+        task->sequence_num = static_cast<int>(task->enqueue_order());
+        will_push(task);
+      });
+  return reload_requested && RequestImmediateWorkQueueReload();
+}
+
+template <typename WillPush>
+bool TaskQueueImpl::PushOntoImmediateIncomingQueue(std::vector<Task> tasks,
+                                                   WillPush will_push) {
+  const bool reload_requested = immediate_incoming_queue_.PushBatch(
+      std::move(tasks),
+      [this](size_t count) {
+        return sequence_manager_->GetNextSequenceNumbers(count);
+      },
+      [&will_push](Task* task) {
+        task->sequence_num = static_cast<int>(task->enqueue_order());
+        will_push(task);
+      });
+  return reload_requested && RequestImmediateWorkQueueReload();
+}
+
+bool TaskQueueImpl::RequestImmediateWorkQueueReload() {
+  // The immediate work queue ran out of tasks, so the SequenceManager needs to
+  // be informed so it can reload it and add us to the TaskQueueSelector which
+  // can only be done from the main thread. In addition it may need to schedule
+  // a DoWork if this queue isn't blocked.
+  empty_queues_to_reload_handle_.SetActive(true);
+  return post_immediate_task_should_schedule_work_.load(
+      std::memory_order_relaxed);
+}
+
+bool TaskQueueImpl::PostImmediateTaskNeedsLock() const {
+  return post_immediate_task_needs_lock_.load(std::memory_order_relaxed) ||
+         delayed_fence_allowed_ || sequence_manager_->GetAddQueueTimeToTasks();
+}
+
+Task TaskQueueImpl::MakeImmediateTaskLocked(PostedTask task,
+                                            LazyNow* lazy_now) {
+  if (any_thread_.task_queue_observer)
+    any_thread_.task_queue_observer->OnPostTask(task.location, TimeDelta());
+  if (sequence_manager_->GetAddQueueTimeToTasks())
+    task.queue_time = lazy_now->Now();
+
+  base::TimeTicks desired_run_time;
+  // The desired run time is only required when delayed fence is allowed.
+  // Avoid evaluating it when not required.
+  if (delayed_fence_allowed_)
+    desired_run_time = lazy_now->Now();
+
+  // The enqueue order is assigned by PushOntoImmediateIncomingQueue().
+  return Task(std::move(task), desired_run_time, EnqueueOrder());
+}
+
+void TaskQueueImpl::WillPushImmediateTaskLocked(Task* pending_task,
+                                                LazyNow* lazy_now,
+                                                CurrentThread current_thread) {
+  if (any_thread_.on_task_ready_handler)
+    any_thread_.on_task_ready_handler.Run(*pending_task, lazy_now);
+
+#if DCHECK_IS_ON()
+  pending_task->cross_thread_ =
+      (current_thread == TaskQueueImpl::CurrentThread::kNotMainThread);
+#endif
+
+  sequence_manager_->WillQueueTask(pending_task, name_);
+  MaybeReportIpcTaskQueuedFromAnyThreadLocked(pending_task, name_);
+}
+
+void TaskQueueImpl::WillPushImmediateTask(Task* pending_task,
+                                          CurrentThread current_thread) {
+#if DCHECK_IS_ON()
+  pending_task->cross_thread_ =
+      (current_thread == TaskQueueImpl::CurrentThread::kNotMainThread);
+#endif
+
+  sequence_manager_->WillQueueTask(pending_task, name_);
+  MaybeReportIpcTaskQueuedFromAnyThreadUnlocked(pending_task, name_);
+}
+
 void TaskQueueImpl::PostImmediateTaskImpl(PostedTask task,
                                           CurrentThread current_thread) {
   // Use CHECK instead of DCHECK to crash earlier. See http://crbug.com/711167
@@ -259,57 +396,21 @@ void TaskQueueImpl::PostImmediateTaskImpl(PostedTask task,
   CHECK(task.callback);
 
   bool should_schedule_work = false;
-  {
-    // TODO(alexclarke): Maybe add a main thread only immediate_incoming_queue
-    // See https://crbug.com/901800
+  if (PostImmediateTaskNeedsLock()) {
     base::internal::CheckedAutoLock lock(any_thread_lock_);
     LazyNow lazy_now = any_thread_.time_domain->CreateLazyNow();
-    if (any_thread_.task_queue_observer)
-      any_thread_.task_queue_observer->OnPostTask(task.location, TimeDelta());
-    bool add_queue_time_to_tasks = sequence_manager_->GetAddQueueTimeToTasks();
-    if (add_queue_time_to_tasks)
-      task.queue_time = lazy_now.Now();
-
-    // The sequence number must be incremented atomically with pushing onto the
-    // incoming queue. Otherwise if there are several threads posting task we
-    // risk breaking the assumption that sequence numbers increase monotonically
-    // within a queue.
-    EnqueueOrder sequence_number = sequence_manager_->GetNextSequenceNumber();
-    bool was_immediate_incoming_queue_empty =
-        any_thread_.immediate_incoming_queue.empty();
-    base::TimeTicks desired_run_time;
-    // The desired run time is only required when delayed fence is allowed.
-    // Avoid evaluating it when not required.
-    if (delayed_fence_allowed_)
-      desired_run_time = lazy_now.Now();
-    any_thread_.immediate_incoming_queue.push_back(Task(
-        std::move(task), desired_run_time, sequence_number, sequence_number));
-
-    if (any_thread_.on_task_ready_handler) {
-      any_thread_.on_task_ready_handler.Run(
-          any_thread_.immediate_incoming_queue.back(), &lazy_now);
-    }
-
-#if DCHECK_IS_ON()
-    any_thread_.immediate_incoming_queue.back().cross_thread_ =
-        (current_thread == TaskQueueImpl::CurrentThread::kNotMainThread);
-#endif
-
-    sequence_manager_->WillQueueTask(
-        &any_thread_.immediate_incoming_queue.back(), name_);
-    MaybeReportIpcTaskQueuedFromAnyThreadLocked(
-        &any_thread_.immediate_incoming_queue.back(), name_);
-
-    // If this queue was completely empty, then the SequenceManager needs to be
-    // informed so it can reload the work queue and add us to the
-    // TaskQueueSelector which can only be done from the main thread. In
-    // addition it may need to schedule a DoWork if this queue isn't blocked.
-    if (was_immediate_incoming_queue_empty &&
-        any_thread_.immediate_work_queue_empty) {
-      empty_queues_to_reload_handle_.SetActive(true);
-      should_schedule_work =
-          any_thread_.post_immediate_task_should_schedule_work;
-    }
+    should_schedule_work = PushOntoImmediateIncomingQueue(
+        MakeImmediateTaskLocked(std::move(task), &lazy_now),
+        [&](Task* pending_task) {
+          WillPushImmediateTaskLocked(pending_task, &lazy_now, current_thread);
+        });
+  } else {
+    // Common case: the task is pushed without taking |any_thread_lock_|.
+    should_schedule_work = PushOntoImmediateIncomingQueue(
+        Task(std::move(task), TimeTicks(), EnqueueOrder()),
+        [&](Task* pending_task) {
+          WillPushImmediateTask(pending_task, current_thread);
+        });
   }
 
   // On windows it's important to call this outside of a lock because calling a
@@ -317,9 +418,9 @@ void TaskQueueImpl::PostImmediateTaskImpl(PostedTask task,
   // http://shortn/_ntnKNqjDQT for a discussion.
   //
   // Calling ScheduleWork outside the lock should be safe, only the main thread
-  // can mutate |any_thread_.post_immediate_task_should_schedule_work|. If it
-  // transitions to false we call ScheduleWork redundantly that's harmless. If
-  // it transitions to true, the side effect of
+  // can mutate |post_immediate_task_should_schedule_work_|. If it transitions
+  // to false we call ScheduleWork redundantly that's harmless. If it
+  // transitions to true, the side effect of
   // |empty_queues_to_reload_handle_SetActive(true)| is guaranteed to be picked
   // up by the ThreadController's call to SequenceManagerImpl::DelayTillNextTask
   // when it computes what continuation (if any) is needed.
@@ -329,6 +430,45 @@ void TaskQueueImpl::PostImmediateTaskImpl(PostedTask task,
   TraceQueueSize();
 }
 
+void TaskQueueImpl::PostImmediateTasksImpl(std::vector<PostedTask> tasks,
+                                           CurrentThread current_thread) {
+  if (tasks.empty())
+    return;
+
+  std::vector<Task> pending_tasks;
+  pending_tasks.reserve(tasks.size());
+  bool should_schedule_work = false;
+  if (PostImmediateTaskNeedsLock()) {
+    base::internal::CheckedAutoLock lock(any_thread_lock_);
+    LazyNow lazy_now = any_thread_.time_domain->CreateLazyNow();
+    for (PostedTask& task : tasks) {
+      CHECK(task.callback);
+      pending_tasks.push_back(
+          MakeImmediateTaskLocked(std::move(task), &lazy_now));
+    }
+    should_schedule_work = PushOntoImmediateIncomingQueue(
+        std::move(pending_tasks), [&](Task* pending_task) {
+          WillPushImmediateTaskLocked(pending_task, &lazy_now, current_thread);
+        });
+  } else {
+    for (PostedTask& task : tasks) {
+      CHECK(task.callback);
+      pending_tasks.emplace_back(std::move(task), TimeTicks(), EnqueueOrder());
+    }
+    should_schedule_work = PushOntoImmediateIncomingQueue(
+        std::move(pending_tasks), [&](Task* pending_task) {
+          WillPushImmediateTask(pending_task, current_thread);
+        });
+  }
+
+  // See PostImmediateTaskImpl(). The whole batch was published at once, so
+  // it causes at most one DoWork to be scheduled.
+  if (should_schedule_work)
+    sequence_manager_->ScheduleWork();
+
+  TraceQueueSize();
+}
+
 void TaskQueueImpl::PostDelayedTaskImpl(PostedTask task,
                                         CurrentThread current_thread) {
   // Use CHECK instead of DCHECK to crash earlier. See http://crbug.com/711167
@@ -448,7 +588,11 @@ void TaskQueueImpl::ScheduleDelayedWorkTask(Task pending_task) {
 }
 
 void TaskQueueImpl::ReloadEmptyImmediateWorkQueue() {
-  DCHECK(main_thread_only().immediate_work_queue->Empty());
+  // A cross thread PostTask can request a reload just after
+  // RequeueDeferredNonNestableTask pushed a task onto the immediate work queue.
+  // The immediate incoming queue will be taken when it becomes empty again.
+  if (!main_thread_only().immediate_work_queue->Empty())
+    return;
   main_thread_only().immediate_work_queue->TakeImmediateIncomingQueueTasks();
 
   if (main_thread_only().task_queue_observer && IsQueueEnabled()) {
@@ -458,13 +602,12 @@ void TaskQueueImpl::ReloadEmptyImmediateWorkQueue() {
 }
 
 void TaskQueueImpl::TakeImmediateIncomingQueueTasks(TaskDeque* queue) {
-  base::internal::CheckedAutoLock lock(any_thread_lock_);
   DCHECK(queue->empty());
-  queue->swap(any_thread_.immediate_incoming_queue);
-
-  // Since |immediate_incoming_queue| is empty, now is a good time to consider
-  // reducing it's capacity if we're wasting memory.
-  any_thread_.immediate_incoming_queue.MaybeShrinkQueue();
+  immediate_incoming_queue_.TakeTasks(queue);
+  // If there are no tasks, the next PostTask has to request a reload. Tasks
+  // that were posted in the meantime can be taken right away.
+  if (queue->empty() && !immediate_incoming_queue_.Arm())
+    immediate_incoming_queue_.TakeTasks(queue);
 
   // Activate delayed fence if necessary. This is ideologically similar to
   // ActivateDelayedFenceIfNeeded, but due to immediate tasks being posted
@@ -483,12 +626,13 @@ void TaskQueueImpl::TakeImmediateIncomingQueueTasks(TaskDeque* queue) {
             main_thread_only().current_fence);
         main_thread_only().delayed_work_queue->InsertFenceSilently(
             main_thread_only().current_fence);
+
+        base::internal::CheckedAutoLock lock(any_thread_lock_);
+        UpdateCrossThreadQueueStateLocked();
         break;
       }
     }
   }
-
-  UpdateCrossThreadQueueStateLocked();
 }
 
 bool TaskQueueImpl::IsEmpty() const {
@@ -498,8 +642,7 @@ bool TaskQueueImpl::IsEmpty() const {
     return false;
   }
 
-  base::internal::CheckedAutoLock lock(any_thread_lock_);
-  return any_thread_.immediate_incoming_queue.empty();
+  return immediate_incoming_queue_.empty();
 }
 
 size_t TaskQueueImpl::GetNumberOfPendingTasks() const {
@@ -507,9 +650,7 @@ size_t TaskQueueImpl::GetNumberOfPendingTasks() const {
   task_count += main_thread_only().delayed_work_queue->Size();
   task_count += main_thread_only().delayed_incoming_queue.size();
   task_count += main_thread_only().immediate_work_queue->Size();
-
-  base::internal::CheckedAutoLock lock(any_thread_lock_);
-  task_count += any_thread_.immediate_incoming_queue.size();
+  task_count += immediate_incoming_queue_.size();
   return task_count;
 }
 
@@ -529,8 +670,7 @@ bool TaskQueueImpl::HasTaskToRunImmediately() const {
   }
 
   // Finally tasks on |immediate_incoming_queue| count as immediate work.
-  base::internal::CheckedAutoLock lock(any_thread_lock_);
-  return !any_thread_.immediate_incoming_queue.empty();
+  return !immediate_incoming_queue_.empty();
 }
 
 Optional<DelayedWakeUp> TaskQueueImpl::GetNextScheduledWakeUpImpl() {
@@ -594,14 +734,10 @@ void TaskQueueImpl::TraceQueueSize() const {
   if (!associated_thread_->IsBoundToCurrentThread())
     return;
 
-  size_t total_task_count;
-  {
-    base::internal::CheckedAutoLock lock(any_thread_lock_);
-    total_task_count = any_thread_.immediate_incoming_queue.size() +
-                       main_thread_only().immediate_work_queue->Size() +
-                       main_thread_only().delayed_work_queue->Size() +
-                       main_thread_only().delayed_incoming_queue.size();
-  }
+  size_t total_task_count = immediate_incoming_queue_.size() +
+                            main_thread_only().immediate_work_queue->Size() +
+                            main_thread_only().delayed_work_queue->Size() +
+                            main_thread_only().delayed_incoming_queue.size();
   TRACE_COUNTER1(TRACE_DISABLED_BY_DEFAULT("sequence_manager"), GetName(),
                  total_task_count);
 }
@@ -611,6 +747,10 @@ void TaskQueueImpl::SetQueuePriority(TaskQueue::QueuePriority priority) {
     return;
   sequence_manager_->main_thread_only().selector.SetQueuePriority(this,
                                                                   priority);
+#if DCHECK_IS_ON()
+  base::internal::CheckedAutoLock lock(any_thread_lock_);
+  UpdateCrossThreadQueueStateLocked();
+#endif
 }
 
 TaskQueue::QueuePriority TaskQueueImpl::GetQueuePriority() const {
@@ -642,7 +782,7 @@ void TaskQueueImpl::AsValueInto(TimeTicks now,
   state->SetString("time_domain_name",
                    main_thread_only().time_domain->GetName());
   state->SetInteger("any_thread_.immediate_incoming_queuesize",
-                    any_thread_.immediate_incoming_queue.size());
+                    immediate_incoming_queue_.size());
   state->SetInteger("delayed_incoming_queue_size",
                     main_thread_only().delayed_incoming_queue.size());
   state->SetInteger("immediate_work_queue_size",
@@ -650,8 +790,6 @@ void TaskQueueImpl::AsValueInto(TimeTicks now,
   state->SetInteger("delayed_work_queue_size",
                     main_thread_only().delayed_work_queue->Size());
 
-  state->SetInteger("any_thread_.immediate_incoming_queuecapacity",
-                    any_thread_.immediate_incoming_queue.capacity());
   state->SetInteger("immediate_work_queue_capacity",
                     immediate_work_queue()->Capacity());
   state->SetInteger("delayed_work_queue_capacity",
@@ -679,7 +817,7 @@ void TaskQueueImpl::AsValueInto(TimeTicks now,
 
   if (verbose || force_verbose) {
     state->BeginArray("immediate_incoming_queue");
-    QueueAsValueInto(any_thread_.immediate_incoming_queue, now, state);
+    QueueAsValueInto(immediate_incoming_queue_, now, state);
     state->EndArray();
     state->BeginArray("delayed_work_queue");
     main_thread_only().delayed_work_queue->AsValueInto(now, state);
@@ -773,19 +911,17 @@ void TaskQueueImpl::InsertFence(TaskQueue::InsertFencePosition position) {
   front_task_unblocked |=
       main_thread_only().delayed_work_queue->InsertFence(current_fence);
 
-  {
-    base::internal::CheckedAutoLock lock(any_thread_lock_);
-    if (!front_task_unblocked && previous_fence &&
-        previous_fence < current_fence) {
-      if (!any_thread_.immediate_incoming_queue.empty() &&
-          any_thread_.immediate_incoming_queue.front().enqueue_order() >
-              previous_fence &&
-          any_thread_.immediate_incoming_queue.front().enqueue_order() <
-              current_fence) {
-        front_task_unblocked = true;
-      }
+  if (!front_task_unblocked && previous_fence &&
+      previous_fence < current_fence) {
+    if (!immediate_incoming_queue_.empty() &&
+        immediate_incoming_queue_.front().enqueue_order() > previous_fence &&
+        immediate_incoming_queue_.front().enqueue_order() < current_fence) {
+      front_task_unblocked = true;
     }
+  }
 
+  {
+    base::internal::CheckedAutoLock lock(any_thread_lock_);
     UpdateCrossThreadQueueStateLocked();
   }
 
@@ -815,16 +951,15 @@ void TaskQueueImpl::RemoveFence() {
       main_thread_only().immediate_work_queue->RemoveFence();
   front_task_unblocked |= main_thread_only().delayed_work_queue->RemoveFence();
 
-  {
-    base::internal::CheckedAutoLock lock(any_thread_lock_);
-    if (!front_task_unblocked && previous_fence) {
-      if (!any_thread_.immediate_incoming_queue.empty() &&
-          any_thread_.immediate_incoming_queue.front().enqueue_order() >
-              previous_fence) {
-        front_task_unblocked = true;
-      }
+  if (!front_task_unblocked && previous_fence) {
+    if (!immediate_incoming_queue_.empty() &&
+        immediate_incoming_queue_.front().enqueue_order() > previous_fence) {
+      front_task_unblocked = true;
     }
+  }
 
+  {
+    base::internal::CheckedAutoLock lock(any_thread_lock_);
     UpdateCrossThreadQueueStateLocked();
   }
 
@@ -844,11 +979,10 @@ bool TaskQueueImpl::BlockedByFence() const {
     return false;
   }
 
-  base::internal::CheckedAutoLock lock(any_thread_lock_);
-  if (any_thread_.immediate_incoming_queue.empty())
+  if (immediate_incoming_queue_.empty())
     return true;
 
-  return any_thread_.immediate_incoming_queue.front().enqueue_order() >
+  return immediate_incoming_queue_.front().enqueue_order() >
          main_thread_only().current_fence;
 }
 
@@ -876,7 +1010,7 @@ bool TaskQueueImpl::CouldTaskRun(EnqueueOrder enqueue_order) const {
 }
 
 // static
-void TaskQueueImpl::QueueAsValueInto(const TaskDeque& queue,
+void TaskQueueImpl::QueueAsValueInto(const ImmediateIncomingQueue& queue,
                                      TimeTicks now,
                                      trace_event::TracedValue* state) {
   for (const Task& task : queue) {
@@ -991,19 +1125,18 @@ void TaskQueueImpl::SetShouldReportPostedTasksWhenDisabled(bool should_report) {
 }
 
 void TaskQueueImpl::UpdateCrossThreadQueueStateLocked() {
-  any_thread_.immediate_work_queue_empty =
-      main_thread_only().immediate_work_queue->Empty();
-
   if (main_thread_only().task_queue_observer) {
     // If there's an observer we need a DoWork for the callback to be issued by
     // ReloadEmptyImmediateWorkQueue. The callback isn't sent for disabled
     // queues.
-    any_thread_.post_immediate_task_should_schedule_work = IsQueueEnabled();
+    post_immediate_task_should_schedule_work_.store(IsQueueEnabled(),
+                                                     std::memory_order_relaxed);
   } else {
     // Otherwise we need PostImmediateTaskImpl to ScheduleWork unless the queue
     // is blocked or disabled.
-    any_thread_.post_immediate_task_should_schedule_work =
-        IsQueueEnabled() && !main_thread_only().current_fence;
+    post_immediate_task_should_schedule_work_.store(
+        IsQueueEnabled() && !main_thread_only().current_fence,
+        std::memory_order_relaxed);
   }
 
 #if DCHECK_IS_ON()
@@ -1012,6 +1145,12 @@ void TaskQueueImpl::UpdateCrossThreadQueueStateLocked() {
 #endif
 }
 
+void TaskQueueImpl::UpdatePostImmediateTaskNeedsLockLocked() {
+  post_immediate_task_needs_lock_.store(
+      any_thread_.task_queue_observer || !!any_thread_.on_task_ready_handler,
+      std::memory_order_relaxed);
+}
+
 void TaskQueueImpl::ReclaimMemory(TimeTicks now) {
   if (main_thread_only().delayed_incoming_queue.empty())
     return;
@@ -1021,18 +1160,15 @@ void TaskQueueImpl::ReclaimMemory(TimeTicks now) {
   main_thread_only().delayed_work_queue->MaybeShrinkQueue();
   main_thread_only().immediate_work_queue->MaybeShrinkQueue();
 
-  {
-    base::internal::CheckedAutoLock lock(any_thread_lock_);
-    any_thread_.immediate_incoming_queue.MaybeShrinkQueue();
-  }
-
   LazyNow lazy_now(now);
   UpdateDelayedWakeUp(&lazy_now);
 }
 
 void TaskQueueImpl::PushImmediateIncomingTaskForTest(Task&& task) {
-  base::internal::CheckedAutoLock lock(any_thread_lock_);
-  any_thread_.immediate_incoming_queue.push_back(std::move(task));
+  const EnqueueOrder enqueue_order = task.enqueue_order();
+  immediate_incoming_queue_.Push(
+      std::move(task), [enqueue_order]() { return enqueue_order; },
+      [](Task* task) {});
 }
 
 void TaskQueueImpl::RequeueDeferredNonNestableTask(
@@ -1048,14 +1184,12 @@ void TaskQueueImpl::RequeueDeferredNonNestableTask(
   } else {
     // We're about to push |task| onto an empty |immediate_work_queue|
     // (bypassing |immediate_incoming_queue_|). As such, we no longer need to
-    // reload if we were planning to. The flag must be cleared while holding
-    // the lock to avoid a cross-thread post task setting it again before
-    // we actually make |immediate_work_queue| non-empty.
+    // reload if we were planning to. A cross-thread post task may still set
+    // the flag again, which ReloadEmptyImmediateWorkQueue ignores.
     if (main_thread_only().immediate_work_queue->Empty()) {
-      base::internal::CheckedAutoLock lock(any_thread_lock_);
+      immediate_incoming_queue_.Disarm();
       empty_queues_to_reload_handle_.SetActive(false);
 
-      any_thread_.immediate_work_queue_empty = false;
       main_thread_only().immediate_work_queue->PushNonNestableTaskToFront(
           std::move(task.task));
 
@@ -1077,6 +1211,7 @@ void TaskQueueImpl::SetObserver(TaskQueue::Observer* observer) {
 
   base::internal::CheckedAutoLock lock(any_thread_lock_);
   any_thread_.task_queue_observer = observer;
+  UpdatePostImmediateTaskNeedsLockLocked();
 }
 
 void TaskQueueImpl::UpdateDelayedWakeUp(LazyNow* lazy_now) {
@@ -1116,14 +1251,13 @@ bool TaskQueueImpl::HasPendingImmediateWork() {
   }
 
   // Finally tasks on |immediate_incoming_queue| count as immediate work.
-  base::internal::CheckedAutoLock lock(any_thread_lock_);
-  return !any_thread_.immediate_incoming_queue.empty();
+  return !immediate_incoming_queue_.empty();
 }
 
 bool TaskQueueImpl::HasPendingImmediateWorkLocked() {
   return !main_thread_only().delayed_work_queue->Empty() ||
          !main_thread_only().immediate_work_queue->Empty() ||
-         !any_thread_.immediate_incoming_queue.empty();
+         !immediate_incoming_queue_.empty();
 }
 
 void TaskQueueImpl::SetOnTaskReadyHandler(
@@ -1134,6 +1268,7 @@ void TaskQueueImpl::SetOnTaskReadyHandler(
   base::internal::CheckedAutoLock lock(any_thread_lock_);
   DCHECK_NE(!!any_thread_.on_task_ready_handler, !!handler);
   any_thread_.on_task_ready_handler = std::move(handler);
+  UpdatePostImmediateTaskNeedsLockLocked();
 }
 
 void TaskQueueImpl::SetOnTaskStartedHandler(
@@ -1193,15 +1328,15 @@ void TaskQueueImpl::DeletePendingTasks() {
   DelayedIncomingQueue queue_to_delete;
   main_thread_only().delayed_incoming_queue.swap(&queue_to_delete);
 
+  // Tasks posted while this runs are deleted too, until the immediate incoming
+  // queue can be armed to request a reload when the next task is posted. The
+  // reload flag must be cleared first, so that it isn't lost if such a task
+  // sets it.
+  empty_queues_to_reload_handle_.SetActive(false);
   TaskDeque deque;
-  {
-    // Limit the scope of the lock to ensure that the deque is destroyed
-    // outside of the lock to allow it to post tasks.
-    base::internal::CheckedAutoLock lock(any_thread_lock_);
-    deque.swap(any_thread_.immediate_incoming_queue);
-    any_thread_.immediate_work_queue_empty = true;
-    empty_queues_to_reload_handle_.SetActive(false);
-  }
+  do {
+    immediate_incoming_queue_.TakeTasks(&deque);
+  } while (!immediate_incoming_queue_.Arm());
 
   LazyNow lazy_now = main_thread_only().time_domain->CreateLazyNow();
   UpdateDelayedWakeUp(&lazy_now);
@@ -1215,11 +1350,7 @@ bool TaskQueueImpl::HasTasks() const {
   if (!main_thread_only().delayed_incoming_queue.empty())
     return true;
 
-  base::internal::CheckedAutoLock lock(any_thread_lock_);
-  if (!any_thread_.immediate_incoming_queue.empty())
-    return true;
-
-  return false;
+  return !immediate_incoming_queue_.empty();
 }
 
 void TaskQueueImpl::MaybeReportIpcTaskQueuedFromMainThread(
@@ -7,9 +7,11 @@
 
 #include <stddef.h>
 
+#include <atomic>
 #include <memory>
 #include <queue>
 #include <set>
+#include <vector>
 
 #include "base/callback.h"
 #include "base/macros.h"
@@ -21,6 +23,7 @@
 #include "base/task/sequence_manager/associated_thread_id.h"
 #include "base/task/sequence_manager/atomic_flag_set.h"
 #include "base/task/sequence_manager/enqueue_order.h"
+#include "base/task/sequence_manager/immediate_incoming_queue.h"
 #include "base/task/sequence_manager/lazily_deallocated_deque.h"
 #include "base/task/sequence_manager/sequenced_task_source.h"
 #include "base/task/sequence_manager/task_queue.h"
@@ -51,9 +54,9 @@ class WorkQueueSets;
 //    |delayed_work_queue| - SequenceManager takes delayed tasks here.
 //
 // The |immediate_incoming_queue| can be accessed from any thread, the other
-// queues are main-thread only. To reduce the overhead of locking,
-// |immediate_work_queue| is swapped with |immediate_incoming_queue| when
-// |immediate_work_queue| becomes empty.
+// queues are main-thread only. It is a lock-free ImmediateIncomingQueue, which
+// is drained into |immediate_work_queue| in one go when |immediate_work_queue|
+// becomes empty.
 //
 // Delayed tasks are initially posted to |delayed_incoming_queue| and a wake-up
 // is scheduled with the TimeDomain.  When the delay has elapsed, the TimeDomain
@@ -254,6 +257,7 @@ class BASE_EXPORT TaskQueueImpl {
     explicit GuardedTaskPoster(TaskQueueImpl* outer);
 
     bool PostTask(PostedTask task);
+    bool PostTasks(std::vector<PostedTask> tasks);
 
     void StartAcceptingOperations() {
       operations_controller_.StartAcceptingOperations();
@@ -285,6 +289,8 @@ class BASE_EXPORT TaskQueueImpl {
     bool PostNonNestableDelayedTask(const Location& location,
                                     OnceClosure callback,
                                     TimeDelta delay) final;
+    bool PostTasks(const Location& location,
+                   std::vector<OnceClosure> callbacks) final;
     bool RunsTasksInCurrentSequence() const final;
 
    private:
@@ -370,8 +376,11 @@ class BASE_EXPORT TaskQueueImpl {
   };
 
   void PostTask(PostedTask task);
+  void PostTasks(std::vector<PostedTask> tasks);
 
   void PostImmediateTaskImpl(PostedTask task, CurrentThread current_thread);
+  void PostImmediateTasksImpl(std::vector<PostedTask> tasks,
+                              CurrentThread current_thread);
   void PostDelayedTaskImpl(PostedTask task, CurrentThread current_thread);
 
   // Push the task onto the |delayed_incoming_queue|. Lock-free main thread
@@ -389,18 +398,15 @@ class BASE_EXPORT TaskQueueImpl {
   void MoveReadyImmediateTasksToImmediateWorkQueueLocked()
       EXCLUSIVE_LOCKS_REQUIRED(any_thread_lock_);
 
-  // LazilyDeallocatedDeque use TimeTicks to figure out when to resize.  We
-  // should use real time here always.
-  using TaskDeque =
-      LazilyDeallocatedDeque<Task, subtle::TimeTicksNowIgnoringOverride>;
+  using TaskDeque = ImmediateIncomingQueue::TaskDeque;
 
-  // Extracts all the tasks from the immediate incoming queue and swaps it with
-  // |queue| which must be empty.
-  // Can be called from any thread.
+  // Moves all the tasks from the immediate incoming queue to |queue| which must
+  // be empty. If there are none, the next task posted to the immediate
+  // incoming queue will request a reload of this queue.
   void TakeImmediateIncomingQueueTasks(TaskDeque* queue);
 
   void TraceQueueSize() const;
-  static void QueueAsValueInto(const TaskDeque& queue,
+  static void QueueAsValueInto(const ImmediateIncomingQueue& queue,
                                TimeTicks now,
                                trace_event::TracedValue* state);
   static void QueueAsValueInto(const std::priority_queue<Task>& queue,
@@ -418,10 +424,50 @@ class BASE_EXPORT TaskQueueImpl {
   // Activate a delayed fence if a time has come.
   void ActivateDelayedFenceIfNeeded(TimeTicks now);
 
+  // Pushes |task| onto the immediate incoming queue, assigning its enqueue
+  // order, and requests a reload of this queue if the immediate work queue ran
+  // out of tasks. |will_push| is called on the task before the main thread can
+  // see it. Returns true if a DoWork needs to be scheduled. Can be called from
+  // any thread.
+  template <typename WillPush>
+  bool PushOntoImmediateIncomingQueue(Task task, WillPush will_push);
+
+  // Same as above for several tasks, which become visible to the main thread
+  // at once.
+  template <typename WillPush>
+  bool PushOntoImmediateIncomingQueue(std::vector<Task> tasks,
+                                      WillPush will_push);
+
+  // Called when pushing onto the immediate incoming queue requested a reload.
+  // Returns true if a DoWork needs to be scheduled.
+  bool RequestImmediateWorkQueueReload();
+
+  // Whether posting an immediate task has to take |any_thread_lock_|, either
+  // to call hooks it protects or to read the time domain.
+  bool PostImmediateTaskNeedsLock() const;
+
+  // Calls the hooks to be called before an immediate task is enqueued, and
+  // converts |task| to a Task without an enqueue order.
+  Task MakeImmediateTaskLocked(PostedTask task, LazyNow* lazy_now)
+      EXCLUSIVE_LOCKS_REQUIRED(any_thread_lock_);
+
+  // Calls the hooks to be called on an immediate task once its enqueue order
+  // is assigned, before it is visible to the main thread.
+  void WillPushImmediateTaskLocked(Task* pending_task,
+                                   LazyNow* lazy_now,
+                                   CurrentThread current_thread)
+      EXCLUSIVE_LOCKS_REQUIRED(any_thread_lock_);
+  void WillPushImmediateTask(Task* pending_task, CurrentThread current_thread);
+
   // Updates state protected by any_thread_lock_.
   void UpdateCrossThreadQueueStateLocked()
       EXCLUSIVE_LOCKS_REQUIRED(any_thread_lock_);
 
+  // Updates |post_immediate_task_needs_lock_| after the hooks it tracks
+  // changed.
+  void UpdatePostImmediateTaskNeedsLockLocked()
+      EXCLUSIVE_LOCKS_REQUIRED(any_thread_lock_);
+
   void MaybeLogPostTask(PostedTask* task);
   void MaybeAdjustTaskDelay(PostedTask* task, CurrentThread current_thread);
 
@@ -472,13 +518,6 @@ class BASE_EXPORT TaskQueueImpl {
 
     TaskQueue::Observer* task_queue_observer = nullptr;
 
-    TaskDeque immediate_incoming_queue;
-
-    // True if main_thread_only().immediate_work_queue is empty.
-    bool immediate_work_queue_empty = true;
-
-    bool post_immediate_task_should_schedule_work = true;
-
     bool unregistered = false;
 
     OnTaskReadyHandler on_task_ready_handler;
@@ -496,6 +535,19 @@ class BASE_EXPORT TaskQueueImpl {
 
   AnyThread any_thread_ GUARDED_BY(any_thread_lock_);
 
+  // Can be pushed to from any thread without holding |any_thread_lock_|.
+  ImmediateIncomingQueue immediate_incoming_queue_;
+
+  // Whether PostImmediateTaskImpl has to call hooks which are protected by
+  // |any_thread_lock_| (the Observer and the OnTaskReadyHandler). Set on the
+  // main thread while holding the lock.
+  std::atomic<bool> post_immediate_task_needs_lock_{false};
+
+  // Whether PostImmediateTaskImpl needs to ScheduleWork when the immediate
+  // incoming queue requests a reload. Only the main thread sets it, while
+  // holding |any_thread_lock_|.
+  std::atomic<bool> post_immediate_task_should_schedule_work_{true};
+
   MainThreadOnly main_thread_only_;
   MainThreadOnly& main_thread_only() {
     DCHECK_CALLED_ON_VALID_THREAD(associated_thread_->thread_checker);
@@ -508,9 +560,9 @@ class BASE_EXPORT TaskQueueImpl {
 
   // Handle to our entry within the SequenceManagers |empty_queues_to_reload_|
   // atomic flag set. Used to signal that this queue needs to be reloaded.
-  // If you call SetActive(false) you should do so inside |any_thread_lock_|
-  // because there is a danger a cross thread PostTask might reset it before we
-  // make |immediate_work_queue| non-empty.
+  // A cross thread PostTask might set it concurrently with SetActive(false),
+  // so ReloadEmptyImmediateWorkQueue() tolerates a non-empty
+  // |immediate_work_queue|.
   AtomicFlagSet::AtomicFlag empty_queues_to_reload_handle_;
 
   const bool should_monitor_quiescence_;
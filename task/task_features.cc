@@ -23,6 +23,9 @@ const Feature kNoDetachBelowInitialCapacity = {
 const Feature kMayBlockWithoutDelay = {"MayBlockWithoutDelay",
                                        base::FEATURE_DISABLED_BY_DEFAULT};
 
+const Feature kThreadGroupWorkStealing = {"ThreadGroupWorkStealing",
+                                          base::FEATURE_DISABLED_BY_DEFAULT};
+
 #if defined(OS_WIN) || defined(OS_MACOSX)
 const Feature kUseNativeThreadPool = {"UseNativeThreadPool",
                                       base::FEATURE_DISABLED_BY_DEFAULT};
@@ -24,6 +24,11 @@ extern const BASE_EXPORT Feature kNoDetachBelowInitialCapacity;
 // instead of waiting for a threshold.
 extern const BASE_EXPORT Feature kMayBlockWithoutDelay;
 
+// Under this feature, each worker in ThreadGroupImpl has a local queue of task
+// sources, filled with the task sources it re-enqueues and those posted from
+// its tasks, from which idle workers steal.
+extern const BASE_EXPORT Feature kThreadGroupWorkStealing;
+
 #if defined(OS_WIN) || defined(OS_MACOSX)
 #define HAS_NATIVE_THREAD_POOL() 1
 #else
@@ -0,0 +1,146 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/task/thread_pool/cpu_topology.h"
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+
+#include "base/files/file_util.h"
+#include "base/no_destructor.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
+#include "build/build_config.h"
+
+#if defined(OS_LINUX)
+#include <sched.h>
+#endif
+
+namespace base {
+namespace internal {
+
+namespace {
+
+// Reads the list of ids in the file at |path| into |*ids|.
+bool ReadSysfsIdList(const FilePath& path, std::vector<int>* ids) {
+  std::string contents;
+  return ReadFileToString(path, &contents) &&
+         ParseSysfsIdList(TrimWhitespaceASCII(contents, TRIM_ALL), ids);
+}
+
+}  // namespace
+
+CpuTopology::CpuTopology() : nodes(1) {}
+
+CpuTopology::CpuTopology(const CpuTopology& other) = default;
+
+CpuTopology::CpuTopology(CpuTopology&& other) = default;
+
+CpuTopology::~CpuTopology() = default;
+
+CpuTopology& CpuTopology::operator=(const CpuTopology& other) = default;
+
+CpuTopology& CpuTopology::operator=(CpuTopology&& other) = default;
+
+// static
+const CpuTopology& CpuTopology::Get() {
+#if defined(OS_LINUX)
+  static const NoDestructor<CpuTopology> topology(
+      ReadFromSysfs(FilePath(FILE_PATH_LITERAL("/sys/devices/system"))));
+#else
+  static const NoDestructor<CpuTopology> topology;
+#endif
+  return *topology;
+}
+
+// static
+CpuTopology CpuTopology::ReadFromSysfs(const FilePath& sysfs_root) {
+  CpuTopology topology;
+
+  std::vector<int> online_cpus;
+  if (!ReadSysfsIdList(sysfs_root.Append(FILE_PATH_LITERAL("cpu"))
+                           .Append(FILE_PATH_LITERAL("online")),
+                       &online_cpus)) {
+    return topology;
+  }
+
+  // Machines without NUMA support have no "node" directory. All their CPUs
+  // are in a single node.
+  const FilePath node_dir = sysfs_root.Append(FILE_PATH_LITERAL("node"));
+  std::vector<int> online_nodes;
+  if (!ReadSysfsIdList(node_dir.Append(FILE_PATH_LITERAL("online")),
+                       &online_nodes)) {
+    topology.nodes[0] = std::move(online_cpus);
+    return topology;
+  }
+
+  std::vector<std::vector<int>> nodes;
+  for (int node : online_nodes) {
+    std::vector<int> node_cpus;
+    if (!ReadSysfsIdList(
+            node_dir.AppendASCII("node" + NumberToString(node))
+                .Append(FILE_PATH_LITERAL("cpulist")),
+            &node_cpus)) {
+      continue;
+    }
+    std::vector<int> node_online_cpus;
+    std::set_intersection(node_cpus.begin(), node_cpus.end(),
+                          online_cpus.begin(), online_cpus.end(),
+                          std::back_inserter(node_online_cpus));
+    if (!node_online_cpus.empty())
+      nodes.push_back(std::move(node_online_cpus));
+  }
+
+  if (nodes.empty())
+    topology.nodes[0] = std::move(online_cpus);
+  else
+    topology.nodes = std::move(nodes);
+  return topology;
+}
+
+size_t CpuTopology::GetNodeForCpu(int cpu) const {
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    if (std::binary_search(nodes[i].begin(), nodes[i].end(), cpu))
+      return i;
+  }
+  return 0;
+}
+
+size_t CpuTopology::GetNodeForCurrentThread() const {
+  if (nodes.size() == 1)
+    return 0;
+#if defined(OS_LINUX)
+  const int cpu = sched_getcpu();
+  if (cpu >= 0)
+    return GetNodeForCpu(cpu);
+#endif
+  return 0;
+}
+
+bool ParseSysfsIdList(StringPiece list, std::vector<int>* ids) {
+  std::vector<int> result;
+  for (StringPiece range :
+       SplitStringPiece(list, ",", TRIM_WHITESPACE, SPLIT_WANT_ALL)) {
+    const std::vector<StringPiece> bounds =
+        SplitStringPiece(range, "-", KEEP_WHITESPACE, SPLIT_WANT_ALL);
+    int first = 0;
+    int last = 0;
+    if (bounds.empty() || bounds.size() > 2 ||
+        !StringToInt(bounds.front(), &first) ||
+        !StringToInt(bounds.back(), &last) || first < 0 || last < first) {
+      return false;
+    }
+    for (int id = first; id <= last; ++id)
+      result.push_back(id);
+  }
+  std::sort(result.begin(), result.end());
+  result.erase(std::unique(result.begin(), result.end()), result.end());
+  *ids = std::move(result);
+  return true;
+}
+
+}  // namespace internal
+}  // namespace base
@@ -0,0 +1,60 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_TASK_THREAD_POOL_CPU_TOPOLOGY_H_
+#define BASE_TASK_THREAD_POOL_CPU_TOPOLOGY_H_
+
+#include <stddef.h>
+
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/files/file_path.h"
+#include "base/strings/string_piece.h"
+
+namespace base {
+namespace internal {
+
+// The online CPUs of the machine, grouped by NUMA node. Used by ThreadPoolImpl
+// to create a thread group per node whose workers only run on the CPUs of
+// that node.
+struct BASE_EXPORT CpuTopology {
+  CpuTopology();
+  CpuTopology(const CpuTopology& other);
+  CpuTopology(CpuTopology&& other);
+  ~CpuTopology();
+
+  CpuTopology& operator=(const CpuTopology& other);
+  CpuTopology& operator=(CpuTopology&& other);
+
+  // Returns the topology of this machine, which is read once. On platforms
+  // other than Linux, or if sysfs can't be read, it has a single node whose
+  // list of CPUs is empty.
+  static const CpuTopology& Get();
+
+  // Reads the topology from |sysfs_root|, normally "/sys/devices/system".
+  // Nodes without online CPUs are omitted.
+  static CpuTopology ReadFromSysfs(const FilePath& sysfs_root);
+
+  // Returns the index in |nodes| of the node that contains |cpu|, or 0 if no
+  // node does.
+  size_t GetNodeForCpu(int cpu) const;
+
+  // Returns the index in |nodes| of the node that contains the CPU on which
+  // the current thread is running, or 0 if that can't be determined.
+  size_t GetNodeForCurrentThread() const;
+
+  // The online CPUs of each node, sorted, in increasing order of node id.
+  // Never empty.
+  std::vector<std::vector<int>> nodes;
+};
+
+// Parses a list of CPUs or nodes in the format of sysfs, such as "0-3,8,10-11",
+// into |*ids|. Returns false if |list| is malformed.
+BASE_EXPORT bool ParseSysfsIdList(StringPiece list, std::vector<int>* ids);
+
+}  // namespace internal
+}  // namespace base
+
+#endif  // BASE_TASK_THREAD_POOL_CPU_TOPOLOGY_H_
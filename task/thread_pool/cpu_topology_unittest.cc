@@ -0,0 +1,121 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/task/thread_pool/cpu_topology.h"
+
+#include <string>
+
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/macros.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace internal {
+
+namespace {
+
+class ThreadPoolCpuTopologyTest : public testing::Test {
+ protected:
+  ThreadPoolCpuTopologyTest() = default;
+
+  void SetUp() override { ASSERT_TRUE(sysfs_dir_.CreateUniqueTempDir()); }
+
+  // Writes |contents| to |relative_path| under the fake sysfs directory.
+  void WriteSysfsFile(const std::string& relative_path,
+                      const std::string& contents) {
+    const FilePath path = sysfs_dir_.GetPath().AppendASCII(relative_path);
+    ASSERT_TRUE(CreateDirectory(path.DirName()));
+    ASSERT_EQ(static_cast<int>(contents.size()),
+              WriteFile(path, contents.data(), contents.size()));
+  }
+
+  CpuTopology Read() const {
+    return CpuTopology::ReadFromSysfs(sysfs_dir_.GetPath());
+  }
+
+ private:
+  ScopedTempDir sysfs_dir_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadPoolCpuTopologyTest);
+};
+
+}  // namespace
+
+TEST(ThreadPoolCpuTopologyParseTest, ParseSysfsIdList) {
+  std::vector<int> ids;
+  EXPECT_TRUE(ParseSysfsIdList("", &ids));
+  EXPECT_TRUE(ids.empty());
+  EXPECT_TRUE(ParseSysfsIdList("3", &ids));
+  EXPECT_EQ(std::vector<int>({3}), ids);
+  EXPECT_TRUE(ParseSysfsIdList("0-3,8,10-11", &ids));
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 3, 8, 10, 11}), ids);
+  EXPECT_TRUE(ParseSysfsIdList("4-5,0-1,1", &ids));
+  EXPECT_EQ(std::vector<int>({0, 1, 4, 5}), ids);
+
+  ids = {42};
+  EXPECT_FALSE(ParseSysfsIdList("a", &ids));
+  EXPECT_FALSE(ParseSysfsIdList("1-", &ids));
+  EXPECT_FALSE(ParseSysfsIdList("3-1", &ids));
+  EXPECT_FALSE(ParseSysfsIdList("1-2-3", &ids));
+  EXPECT_FALSE(ParseSysfsIdList("1,,2", &ids));
+  EXPECT_FALSE(ParseSysfsIdList("-1", &ids));
+  EXPECT_EQ(std::vector<int>({42}), ids);
+}
+
+TEST_F(ThreadPoolCpuTopologyTest, TwoNodes) {
+  WriteSysfsFile("cpu/online", "0-7\n");
+  WriteSysfsFile("node/online", "0-1\n");
+  WriteSysfsFile("node/node0/cpulist", "0-3\n");
+  WriteSysfsFile("node/node1/cpulist", "4-7\n");
+
+  const CpuTopology topology = Read();
+  ASSERT_EQ(2U, topology.nodes.size());
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 3}), topology.nodes[0]);
+  EXPECT_EQ(std::vector<int>({4, 5, 6, 7}), topology.nodes[1]);
+  EXPECT_EQ(0U, topology.GetNodeForCpu(2));
+  EXPECT_EQ(1U, topology.GetNodeForCpu(5));
+  EXPECT_EQ(0U, topology.GetNodeForCpu(100));
+}
+
+// Offline CPUs are left out, as are nodes without online CPUs.
+TEST_F(ThreadPoolCpuTopologyTest, OfflineCpus) {
+  WriteSysfsFile("cpu/online", "0-1,6-7\n");
+  WriteSysfsFile("node/online", "0,2-3\n");
+  WriteSysfsFile("node/node0/cpulist", "0-3\n");
+  WriteSysfsFile("node/node2/cpulist", "\n");
+  WriteSysfsFile("node/node3/cpulist", "4-7\n");
+
+  const CpuTopology topology = Read();
+  ASSERT_EQ(2U, topology.nodes.size());
+  EXPECT_EQ(std::vector<int>({0, 1}), topology.nodes[0]);
+  EXPECT_EQ(std::vector<int>({6, 7}), topology.nodes[1]);
+  EXPECT_EQ(1U, topology.GetNodeForCpu(7));
+}
+
+TEST_F(ThreadPoolCpuTopologyTest, NoNumaSupport) {
+  WriteSysfsFile("cpu/online", "0-3\n");
+
+  const CpuTopology topology = Read();
+  ASSERT_EQ(1U, topology.nodes.size());
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 3}), topology.nodes[0]);
+  EXPECT_EQ(0U, topology.GetNodeForCurrentThread());
+}
+
+TEST_F(ThreadPoolCpuTopologyTest, Unreadable) {
+  const CpuTopology topology = Read();
+  ASSERT_EQ(1U, topology.nodes.size());
+  EXPECT_TRUE(topology.nodes[0].empty());
+}
+
+TEST(ThreadPoolCpuTopologyGetTest, Get) {
+  const CpuTopology& topology = CpuTopology::Get();
+  EXPECT_EQ(&topology, &CpuTopology::Get());
+  ASSERT_FALSE(topology.nodes.empty());
+  EXPECT_LT(topology.GetNodeForCurrentThread(), topology.nodes.size());
+}
+
+}  // namespace internal
+}  // namespace base
@@ -12,9 +12,11 @@ namespace internal {
 
 PooledParallelTaskRunner::PooledParallelTaskRunner(
     const TaskTraits& traits,
-    PooledTaskRunnerDelegate* pooled_task_runner_delegate)
+    PooledTaskRunnerDelegate* pooled_task_runner_delegate,
+    size_t numa_node)
     : traits_(traits),
-      pooled_task_runner_delegate_(pooled_task_runner_delegate) {}
+      pooled_task_runner_delegate_(pooled_task_runner_delegate),
+      numa_node_(numa_node) {}
 
 PooledParallelTaskRunner::~PooledParallelTaskRunner() = default;
 
@@ -26,7 +28,7 @@ bool PooledParallelTaskRunner::PostDelayedTask(const Location& from_here,
 
   // Post the task as part of a one-off single-task Sequence.
   scoped_refptr<Sequence> sequence = MakeRefCounted<Sequence>(
-      traits_, this, TaskSourceExecutionMode::kParallel);
+      traits_, this, TaskSourceExecutionMode::kParallel, numa_node_);
 
   {
     CheckedAutoLock auto_lock(lock_);
@@ -37,6 +39,35 @@ bool PooledParallelTaskRunner::PostDelayedTask(const Location& from_here,
       Task(from_here, std::move(closure), delay), std::move(sequence));
 }
 
+bool PooledParallelTaskRunner::PostTasks(const Location& from_here,
+                                         std::vector<OnceClosure> closures) {
+  if (!PooledTaskRunnerDelegate::Exists())
+    return false;
+
+  // Post each task as part of a one-off single-task Sequence, but register
+  // all the Sequences under a single acquisition of |lock_|.
+  std::vector<Task> tasks;
+  std::vector<scoped_refptr<Sequence>> sequences;
+  std::vector<Sequence*> raw_sequences;
+  tasks.reserve(closures.size());
+  sequences.reserve(closures.size());
+  raw_sequences.reserve(closures.size());
+  for (OnceClosure& closure : closures) {
+    tasks.emplace_back(from_here, std::move(closure), TimeDelta());
+    sequences.push_back(MakeRefCounted<Sequence>(
+        traits_, this, TaskSourceExecutionMode::kParallel, numa_node_));
+    raw_sequences.push_back(sequences.back().get());
+  }
+
+  {
+    CheckedAutoLock auto_lock(lock_);
+    sequences_.insert(raw_sequences.begin(), raw_sequences.end());
+  }
+
+  return pooled_task_runner_delegate_->PostTasksWithSequences(
+      std::move(tasks), std::move(sequences));
+}
+
 bool PooledParallelTaskRunner::RunsTasksInCurrentSequence() const {
   return pooled_task_runner_delegate_->IsRunningPoolWithTraits(traits_);
 }
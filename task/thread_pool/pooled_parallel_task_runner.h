@@ -5,6 +5,10 @@
 #ifndef BASE_TASK_THREAD_POOL_POOLED_PARALLEL_TASK_RUNNER_H_
 #define BASE_TASK_THREAD_POOL_POOLED_PARALLEL_TASK_RUNNER_H_
 
+#include <stddef.h>
+
+#include <vector>
+
 #include "base/base_export.h"
 #include "base/callback_forward.h"
 #include "base/containers/flat_set.h"
@@ -25,15 +29,21 @@ class PooledTaskRunnerDelegate;
 class BASE_EXPORT PooledParallelTaskRunner : public TaskRunner {
  public:
   // Constructs a PooledParallelTaskRunner which can be used to post tasks.
+  // Its tasks run in the thread group of NUMA node |numa_node|, if the thread
+  // pool has one per node.
   PooledParallelTaskRunner(
       const TaskTraits& traits,
-      PooledTaskRunnerDelegate* pooled_task_runner_delegate);
+      PooledTaskRunnerDelegate* pooled_task_runner_delegate,
+      size_t numa_node = 0);
 
   // TaskRunner:
   bool PostDelayedTask(const Location& from_here,
                        OnceClosure closure,
                        TimeDelta delay) override;
 
+  bool PostTasks(const Location& from_here,
+                 std::vector<OnceClosure> closures) override;
+
   bool RunsTasksInCurrentSequence() const override;
 
   // Removes |sequence| from |sequences_|.
@@ -44,6 +54,7 @@ class BASE_EXPORT PooledParallelTaskRunner : public TaskRunner {
 
   const TaskTraits traits_;
   PooledTaskRunnerDelegate* const pooled_task_runner_delegate_;
+  const size_t numa_node_;
 
   CheckedLock lock_;
 
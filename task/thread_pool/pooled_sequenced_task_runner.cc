@@ -11,12 +11,13 @@ namespace internal {
 
 PooledSequencedTaskRunner::PooledSequencedTaskRunner(
     const TaskTraits& traits,
-    PooledTaskRunnerDelegate* pooled_task_runner_delegate)
+    PooledTaskRunnerDelegate* pooled_task_runner_delegate,
+    size_t numa_node)
     : pooled_task_runner_delegate_(pooled_task_runner_delegate),
       sequence_(MakeRefCounted<Sequence>(traits,
                                          this,
-                                         TaskSourceExecutionMode::kSequenced)) {
-}
+                                         TaskSourceExecutionMode::kSequenced,
+                                         numa_node)) {}
 
 PooledSequencedTaskRunner::~PooledSequencedTaskRunner() = default;
 
@@ -33,6 +34,21 @@ bool PooledSequencedTaskRunner::PostDelayedTask(const Location& from_here,
                                                             sequence_);
 }
 
+bool PooledSequencedTaskRunner::PostTasks(const Location& from_here,
+                                          std::vector<OnceClosure> closures) {
+  if (!PooledTaskRunnerDelegate::Exists())
+    return false;
+
+  std::vector<Task> tasks;
+  tasks.reserve(closures.size());
+  for (OnceClosure& closure : closures)
+    tasks.emplace_back(from_here, std::move(closure), TimeDelta());
+
+  // Post the tasks as part of |sequence_|.
+  return pooled_task_runner_delegate_->PostTasksWithSequence(std::move(tasks),
+                                                             sequence_);
+}
+
 bool PooledSequencedTaskRunner::PostNonNestableDelayedTask(
     const Location& from_here,
     OnceClosure closure,
@@ -5,6 +5,10 @@
 #ifndef BASE_TASK_THREAD_POOL_POOLED_SEQUENCED_TASK_RUNNER_H_
 #define BASE_TASK_THREAD_POOL_POOLED_SEQUENCED_TASK_RUNNER_H_
 
+#include <stddef.h>
+
+#include <vector>
+
 #include "base/base_export.h"
 #include "base/callback_forward.h"
 #include "base/location.h"
@@ -22,15 +26,21 @@ class BASE_EXPORT PooledSequencedTaskRunner
     : public UpdateableSequencedTaskRunner {
  public:
   // Constructs a PooledSequencedTaskRunner which can be used to post tasks.
+  // Its tasks run in the thread group of NUMA node |numa_node|, if the thread
+  // pool has one per node.
   PooledSequencedTaskRunner(
       const TaskTraits& traits,
-      PooledTaskRunnerDelegate* pooled_task_runner_delegate);
+      PooledTaskRunnerDelegate* pooled_task_runner_delegate,
+      size_t numa_node = 0);
 
   // UpdateableSequencedTaskRunner:
   bool PostDelayedTask(const Location& from_here,
                        OnceClosure closure,
                        TimeDelta delay) override;
 
+  bool PostTasks(const Location& from_here,
+                 std::vector<OnceClosure> closures) override;
+
   bool PostNonNestableDelayedTask(const Location& from_here,
                                   OnceClosure closure,
                                   TimeDelta delay) override;
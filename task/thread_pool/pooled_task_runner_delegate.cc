@@ -4,6 +4,8 @@
 
 #include "base/task/thread_pool/pooled_task_runner_delegate.h"
 
+#include <utility>
+
 namespace base {
 namespace internal {
 
@@ -36,5 +38,26 @@ bool PooledTaskRunnerDelegate::Exists() {
   return g_exists;
 }
 
+bool PooledTaskRunnerDelegate::PostTasksWithSequence(
+    std::vector<Task> tasks,
+    scoped_refptr<Sequence> sequence) {
+  bool all_posted = true;
+  for (Task& task : tasks)
+    all_posted &= PostTaskWithSequence(std::move(task), sequence);
+  return all_posted;
+}
+
+bool PooledTaskRunnerDelegate::PostTasksWithSequences(
+    std::vector<Task> tasks,
+    std::vector<scoped_refptr<Sequence>> sequences) {
+  DCHECK_EQ(tasks.size(), sequences.size());
+  bool all_posted = true;
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    all_posted &=
+        PostTaskWithSequence(std::move(tasks[i]), std::move(sequences[i]));
+  }
+  return all_posted;
+}
+
 }  // namespace internal
 }  // namespace base
@@ -5,6 +5,8 @@
 #ifndef BASE_TASK_THREAD_POOL_POOLED_TASK_RUNNER_DELEGATE_H_
 #define BASE_TASK_THREAD_POOL_POOLED_TASK_RUNNER_DELEGATE_H_
 
+#include <vector>
+
 #include "base/base_export.h"
 #include "base/task/task_traits.h"
 #include "base/task/thread_pool/job_task_source.h"
@@ -34,6 +36,23 @@ class BASE_EXPORT PooledTaskRunnerDelegate {
   virtual bool PostTaskWithSequence(Task task,
                                     scoped_refptr<Sequence> sequence) = 0;
 
+  // Invoked when undelayed |tasks| are posted together to a
+  // PooledSequencedTaskRunner. Like PostTaskWithSequence() for each task, but
+  // implementations can enqueue the whole batch at once. Returns true if all
+  // the tasks were successfully posted. The default implementation calls
+  // PostTaskWithSequence() for each task.
+  virtual bool PostTasksWithSequence(std::vector<Task> tasks,
+                                     scoped_refptr<Sequence> sequence);
+
+  // Invoked when undelayed |tasks| are posted together to a
+  // PooledParallelTaskRunner. Each task is posted as part of the one-off
+  // Sequence at the same index in |sequences|, all of which have the same
+  // traits. Returns true if all the tasks were successfully posted. The
+  // default implementation calls PostTaskWithSequence() for each task.
+  virtual bool PostTasksWithSequences(
+      std::vector<Task> tasks,
+      std::vector<scoped_refptr<Sequence>> sequences);
+
   // Invoked when a task is posted as a Job. The implementation must add
   // |task_source| to the appropriate priority queue, depending on |task_source|
   // traits. Returns true if task source was successfully enqueued.
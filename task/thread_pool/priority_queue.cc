@@ -91,9 +91,13 @@ PriorityQueue& PriorityQueue::operator=(PriorityQueue&& other) = default;
 void PriorityQueue::Push(
     TransactionWithRegisteredTaskSource transaction_with_task_source) {
   auto sequence_sort_key = transaction_with_task_source.GetSortKey();
-  container_.insert(TaskSourceAndSortKey(
-      transaction_with_task_source.take_task_source(), sequence_sort_key));
-  IncrementNumTaskSourcesForPriority(sequence_sort_key.priority());
+  Push(transaction_with_task_source.take_task_source(), sequence_sort_key);
+}
+
+void PriorityQueue::Push(RegisteredTaskSource task_source,
+                         const SequenceSortKey& sort_key) {
+  container_.insert(TaskSourceAndSortKey(std::move(task_source), sort_key));
+  IncrementNumTaskSourcesForPriority(sort_key.priority());
 }
 
 const SequenceSortKey& PriorityQueue::PeekSortKey() const {
@@ -30,6 +30,10 @@ class BASE_EXPORT PriorityQueue {
   // Inserts |task_source| in the PriorityQueue with |sequence_sort_key|.
   void Push(TransactionWithRegisteredTaskSource transaction_with_task_source);
 
+  // Inserts |task_source| in the PriorityQueue with |sort_key|, which must be
+  // its current sort key.
+  void Push(RegisteredTaskSource task_source, const SequenceSortKey& sort_key);
+
   // Returns a reference to the SequenceSortKey representing the priority of
   // the highest pending task in this PriorityQueue. The reference becomes
   // invalid the next time that this PriorityQueue is modified.
@@ -128,8 +128,9 @@ void Sequence::ReleaseTaskRunner() {
 
 Sequence::Sequence(const TaskTraits& traits,
                    TaskRunner* task_runner,
-                   TaskSourceExecutionMode execution_mode)
-    : TaskSource(traits, task_runner, execution_mode) {}
+                   TaskSourceExecutionMode execution_mode,
+                   size_t numa_node)
+    : TaskSource(traits, task_runner, execution_mode, numa_node) {}
 
 Sequence::~Sequence() = default;
 
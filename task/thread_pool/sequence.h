@@ -74,10 +74,12 @@ class BASE_EXPORT Sequence : public TaskSource {
   // |task_runner| is a reference to the TaskRunner feeding this TaskSource.
   // |task_runner| can be nullptr only for tasks with no TaskRunner, in which
   // case |execution_mode| must be kParallel. Otherwise, |execution_mode| is the
-  // execution mode of |task_runner|.
+  // execution mode of |task_runner|. |numa_node| is the index of the NUMA node
+  // whose thread group should run the Sequence's tasks.
   Sequence(const TaskTraits& traits,
            TaskRunner* task_runner,
-           TaskSourceExecutionMode execution_mode);
+           TaskSourceExecutionMode execution_mode,
+           size_t numa_node = 0);
 
   // Begins a Transaction. This method cannot be called on a thread which has an
   // active Sequence::Transaction.
@@ -84,6 +84,7 @@ void TaskSource::Transaction::UpdatePriority(TaskPriority priority) {
   if (FeatureList::IsEnabled(kAllTasksUserBlocking))
     return;
   task_source_->traits_.UpdatePriority(priority);
+  task_source_->priority_racy_.store(priority, std::memory_order_relaxed);
 }
 
 TaskSource::RunIntent TaskSource::MakeRunIntent(Saturated is_saturated) const {
@@ -100,10 +101,13 @@ void TaskSource::ClearHeapHandle() {
 
 TaskSource::TaskSource(const TaskTraits& traits,
                        TaskRunner* task_runner,
-                       TaskSourceExecutionMode execution_mode)
+                       TaskSourceExecutionMode execution_mode,
+                       size_t numa_node)
     : traits_(traits),
+      priority_racy_(traits.priority()),
       task_runner_(task_runner),
-      execution_mode_(execution_mode) {
+      execution_mode_(execution_mode),
+      numa_node_(numa_node) {
   DCHECK(task_runner_ ||
          execution_mode_ == TaskSourceExecutionMode::kParallel ||
          execution_mode_ == TaskSourceExecutionMode::kJob);
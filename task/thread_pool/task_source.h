@@ -7,6 +7,8 @@
 
 #include <stddef.h>
 
+#include <atomic>
+
 #include "base/base_export.h"
 #include "base/compiler_specific.h"
 #include "base/macros.h"
@@ -181,10 +183,13 @@ class BASE_EXPORT TaskSource : public RefCountedThreadSafe<TaskSource> {
   // |task_runner| is a reference to the TaskRunner feeding this TaskSource.
   // |task_runner| can be nullptr only for tasks with no TaskRunner, in which
   // case |execution_mode| must be kParallel. Otherwise, |execution_mode| is the
-  // execution mode of |task_runner|.
+  // execution mode of |task_runner|. |numa_node| is the index of the NUMA node
+  // whose thread group should run the TaskSource's tasks (see
+  // ThreadPoolInstance::InitParams::numa_aware_thread_groups).
   TaskSource(const TaskTraits& traits,
              TaskRunner* task_runner,
-             TaskSourceExecutionMode execution_mode);
+             TaskSourceExecutionMode execution_mode,
+             size_t numa_node = 0);
 
   // Begins a Transaction. This method cannot be called on a thread which has an
   // active TaskSource::Transaction.
@@ -215,6 +220,12 @@ class BASE_EXPORT TaskSource : public RefCountedThreadSafe<TaskSource> {
     return traits_.shutdown_behavior();
   }
 
+  // Returns the priority of all Tasks in the TaskSource. Can be accessed
+  // without a Transaction, but the returned value may immediately be obsolete.
+  TaskPriority priority_racy() const {
+    return priority_racy_.load(std::memory_order_relaxed);
+  }
+
   // A reference to TaskRunner is only retained between PushTask() and when
   // DidProcessTask() returns false, guaranteeing it is safe to dereference this
   // pointer. Otherwise, the caller should guarantee such TaskRunner still
@@ -223,6 +234,11 @@ class BASE_EXPORT TaskSource : public RefCountedThreadSafe<TaskSource> {
 
   TaskSourceExecutionMode execution_mode() const { return execution_mode_; }
 
+  // Returns the index of the NUMA node whose thread group should run the tasks
+  // of this TaskSource. Can be accessed without a Transaction because it is
+  // never mutated.
+  size_t numa_node() const { return numa_node_; }
+
  protected:
   virtual ~TaskSource();
 
@@ -257,6 +273,9 @@ class BASE_EXPORT TaskSource : public RefCountedThreadSafe<TaskSource> {
   // by the PriorityQueue's lock.
   HeapHandle heap_handle_;
 
+  // A copy of |traits_.priority()| that can be read without a Transaction.
+  std::atomic<TaskPriority> priority_racy_;
+
   // A pointer to the TaskRunner that posts to this TaskSource, if any. The
   // derived class is responsible for calling AddRef() when a TaskSource from
   // which no Task is executing becomes non-empty and Release() when
@@ -265,6 +284,8 @@ class BASE_EXPORT TaskSource : public RefCountedThreadSafe<TaskSource> {
 
   TaskSourceExecutionMode execution_mode_;
 
+  const size_t numa_node_;
+
   DISALLOW_COPY_AND_ASSIGN(TaskSource);
 };
 
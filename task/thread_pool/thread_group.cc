@@ -148,7 +148,7 @@ void ThreadGroup::ReEnqueueTaskSourceLockRequired(
     TransactionWithRegisteredTaskSource transaction_with_task_source) {
   // Decide in which thread group the TaskSource should be reenqueued.
   ThreadGroup* destination_thread_group =
-      delegate_->GetThreadGroupForTraits(transaction_with_task_source.traits());
+      delegate_->GetThreadGroupForTaskSource(transaction_with_task_source);
 
   if (destination_thread_group == this) {
     // Another worker that was running a task from this task source may have
@@ -214,9 +214,8 @@ void ThreadGroup::PushTaskSourceAndWakeUpWorkersImpl(
     TransactionWithRegisteredTaskSource transaction_with_task_source) {
   CheckedAutoLock auto_lock(lock_);
   DCHECK(!replacement_thread_group_);
-  DCHECK_EQ(
-      delegate_->GetThreadGroupForTraits(transaction_with_task_source.traits()),
-      this);
+  DCHECK_EQ(delegate_->GetThreadGroupForTaskSource(transaction_with_task_source),
+            this);
   if (transaction_with_task_source.task_source()->heap_handle().IsValid()) {
     // If the task source changed group, it is possible that multiple concurrent
     // workers try to enqueue it. Only the first enqueue should succeed.
@@ -228,6 +227,29 @@ void ThreadGroup::PushTaskSourceAndWakeUpWorkersImpl(
   EnsureEnoughWorkersLockRequired(executor);
 }
 
+void ThreadGroup::PushTaskSourcesAndWakeUpWorkersImpl(
+    BaseScopedWorkersExecutor* executor,
+    std::vector<RegisteredTaskSource> task_sources) {
+  // A TaskSource's lock can't be acquired while holding another lock, so the
+  // sort keys are read before acquiring |lock_|. They can't change in between
+  // since the task sources aren't shared yet.
+  std::vector<SequenceSortKey> sort_keys;
+  sort_keys.reserve(task_sources.size());
+  for (const RegisteredTaskSource& task_source : task_sources) {
+    auto transaction = task_source->BeginTransaction();
+    DCHECK_EQ(delegate_->GetThreadGroupForTaskSource(transaction), this);
+    sort_keys.push_back(transaction.GetSortKey());
+  }
+
+  CheckedAutoLock auto_lock(lock_);
+  DCHECK(!replacement_thread_group_);
+  for (size_t i = 0; i < task_sources.size(); ++i) {
+    DCHECK(!task_sources[i]->heap_handle().IsValid());
+    priority_queue_.Push(std::move(task_sources[i]), sort_keys[i]);
+  }
+  EnsureEnoughWorkersLockRequired(executor);
+}
+
 void ThreadGroup::InvalidateAndHandoffAllTaskSourcesToOtherThreadGroup(
     ThreadGroup* destination_thread_group) {
   CheckedAutoLock current_thread_group_lock(lock_);
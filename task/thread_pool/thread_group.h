@@ -5,6 +5,8 @@
 #ifndef BASE_TASK_THREAD_POOL_THREAD_GROUP_H_
 #define BASE_TASK_THREAD_POOL_THREAD_GROUP_H_
 
+#include <vector>
+
 #include "base/base_export.h"
 #include "base/memory/ref_counted.h"
 #include "base/task/common/checked_lock.h"
@@ -24,8 +26,9 @@ namespace internal {
 class TaskTracker;
 
 // Interface and base implementation for a thread group. A thread group is a
-// subset of the threads in the thread pool (see GetThreadGroupForTraits() for
-// thread group selection logic when posting tasks and creating task runners).
+// subset of the threads in the thread pool (see GetThreadGroupForTaskSource()
+// for thread group selection logic when posting tasks and creating task
+// runners).
 class BASE_EXPORT ThreadGroup {
  public:
   // Delegate interface for ThreadGroup.
@@ -33,10 +36,11 @@ class BASE_EXPORT ThreadGroup {
    public:
     virtual ~Delegate() = default;
 
-    // Invoked when a TaskSource with |traits| is non-empty after the
+    // Invoked when the TaskSource of |transaction| is non-empty after the
     // ThreadGroup has run a task from it. The implementation must return the
     // thread group in which the TaskSource should be reenqueued.
-    virtual ThreadGroup* GetThreadGroupForTraits(const TaskTraits& traits) = 0;
+    virtual ThreadGroup* GetThreadGroupForTaskSource(
+        const TaskSource::Transaction& transaction) = 0;
   };
 
   enum class WorkerEnvironment {
@@ -65,7 +69,8 @@ class BASE_EXPORT ThreadGroup {
   // RegisteredTaskSource that evaluats to true if successful, or false if
   // |task_source| is not currently in |priority_queue_|, such as when a worker
   // is running a task from it.
-  RegisteredTaskSource RemoveTaskSource(scoped_refptr<TaskSource> task_source);
+  virtual RegisteredTaskSource RemoveTaskSource(
+      scoped_refptr<TaskSource> task_source);
 
   // Updates the position of the TaskSource in |transaction_with_task_source| in
   // this ThreadGroup's PriorityQueue based on the TaskSource's current traits.
@@ -83,6 +88,17 @@ class BASE_EXPORT ThreadGroup {
   virtual void PushTaskSourceAndWakeUpWorkers(
       TransactionWithRegisteredTaskSource transaction_with_task_source) = 0;
 
+  // Pushes |task_sources| into this ThreadGroup's PriorityQueue under a single
+  // acquisition of |lock_|, and wakes up workers as appropriate once they are
+  // all queued. The task sources must be new, i.e. neither queued nor running,
+  // and only referenced by the caller, e.g. the one-off Sequences of a
+  // PooledParallelTaskRunner.
+  //
+  // Implementations should instantiate a concrete ScopedWorkersExecutor and
+  // invoke PushTaskSourcesAndWakeUpWorkersImpl().
+  virtual void PushTaskSourcesAndWakeUpWorkers(
+      std::vector<RegisteredTaskSource> task_sources) = 0;
+
   // Removes all task sources from this ThreadGroup's PriorityQueue and enqueues
   // them in another |destination_thread_group|. After this method is called,
   // any task sources posted to this ThreadGroup will be forwarded to
@@ -219,6 +235,9 @@ class BASE_EXPORT ThreadGroup {
   void PushTaskSourceAndWakeUpWorkersImpl(
       BaseScopedWorkersExecutor* executor,
       TransactionWithRegisteredTaskSource transaction_with_task_source);
+  void PushTaskSourcesAndWakeUpWorkersImpl(
+      BaseScopedWorkersExecutor* executor,
+      std::vector<RegisteredTaskSource> task_sources);
 
   // Synchronizes accesses to all members of this class which are neither const,
   // atomic, nor immutable after start. Since this lock is a bottleneck to post
@@ -16,6 +16,7 @@
 #include "base/bind_helpers.h"
 #include "base/compiler_specific.h"
 #include "base/feature_list.h"
+#include "base/lazy_instance.h"
 #include "base/location.h"
 #include "base/memory/ptr_util.h"
 #include "base/metrics/histogram.h"
@@ -26,10 +27,13 @@
 #include "base/strings/stringprintf.h"
 #include "base/task/task_features.h"
 #include "base/task/task_traits.h"
+#include "base/task/thread_pool/sequence_sort_key.h"
 #include "base/task/thread_pool/task_tracker.h"
+#include "base/task/thread_pool/work_stealing_queue.h"
 #include "base/threading/platform_thread.h"
 #include "base/threading/scoped_blocking_call.h"
 #include "base/threading/thread_checker.h"
+#include "base/threading/thread_local.h"
 #include "base/threading/thread_restrictions.h"
 #include "base/time/time_override.h"
 #include "build/build_config.h"
@@ -56,6 +60,18 @@ constexpr char kNumActiveWorkersHistogramPrefix[] =
     "ThreadPool.NumActiveWorkers.";
 constexpr size_t kMaxNumberOfWorkers = 256;
 
+// Capacity of the queue of task sources of each priority of a worker, under
+// the ThreadGroupWorkStealing feature. Task sources that don't fit are queued
+// in the PriorityQueue of the thread group.
+constexpr size_t kWorkerQueueCapacity = 256;
+constexpr size_t kNumPriorities =
+    static_cast<size_t>(TaskPriority::HIGHEST) + 1;
+
+// The delegate of the ThreadGroupImpl worker running on the current thread,
+// when the ThreadGroupWorkStealing feature is enabled.
+LazyInstance<ThreadLocalPointer<WorkerThread::Delegate>>::Leaky
+    tls_worker_delegate = LAZY_INSTANCE_INITIALIZER;
+
 // In a background thread group:
 // - Blocking calls take more time than in a foreground thread group.
 // - We want to minimize impact on foreground work, not maximize execution
@@ -95,6 +111,23 @@ bool ContainsWorker(const std::vector<scoped_refptr<WorkerThread>>& workers,
 
 }  // namespace
 
+// A task source in the queue of a worker, with its sort key at the time it was
+// queued.
+struct ThreadGroupImpl::WorkerQueueItem {
+  WorkerQueueItem(RegisteredTaskSource task_source_in,
+                  SequenceSortKey sort_key_in)
+      : task_source(std::move(task_source_in)), sort_key(sort_key_in) {}
+
+  // Returns true if the priority of |task_source| was updated since it was
+  // queued, in which case it must be reenqueued with its current sort key.
+  bool HasStaleSortKey() const {
+    return task_source->priority_racy() != sort_key.priority();
+  }
+
+  RegisteredTaskSource task_source;
+  const SequenceSortKey sort_key;
+};
+
 // Upon destruction, executes actions that control the number of active workers.
 // Useful to satisfy locking requirements of these actions.
 class ThreadGroupImpl::ScopedWorkersExecutor
@@ -220,9 +253,27 @@ class ThreadGroupImpl::WorkerThreadDelegateImpl : public WorkerThread::Delegate,
 
   // Returns true iff the worker can get work. Cleans up the worker or puts it
   // on the idle stack if it can't get work.
-  bool CanGetWorkLockRequired(WorkerThread* worker)
+  bool CanGetWorkLockRequired(ScopedWorkersExecutor* executor,
+                              WorkerThread* worker)
       EXCLUSIVE_LOCKS_REQUIRED(outer_->lock_);
 
+  // Appends |*item| to the queue of this worker for its priority and returns
+  // true, or returns false and leaves |*item| untouched if that queue is full.
+  // Must be called from the worker thread.
+  bool PushToQueue(std::unique_ptr<WorkerQueueItem>* item);
+
+  // Removes and returns the oldest task source from the queue of this worker
+  // for |priority|, or nullptr if it's empty. Thread-safe.
+  std::unique_ptr<WorkerQueueItem> TakeFromQueue(TaskPriority priority);
+
+  // Queues the task source of |transaction_with_task_source|, which a task
+  // running on this worker just made non-empty, in the queue of this worker
+  // and returns true. Returns false and leaves |transaction_with_task_source|
+  // untouched if it must be queued in |outer_->priority_queue_| instead. Must
+  // be called from the worker thread.
+  bool QueueTaskSourcePostedFromTask(
+      TransactionWithRegisteredTaskSource* transaction_with_task_source);
+
   // Returns true iff this worker has been within a MAY_BLOCK ScopedBlockingCall
   // for more than |may_block_threshold|. The max tasks must be
   // incremented if this returns true.
@@ -253,9 +304,36 @@ class ThreadGroupImpl::WorkerThreadDelegateImpl : public WorkerThread::Delegate,
       EXCLUSIVE_LOCKS_REQUIRED(outer_->lock_);
 
   // Called in GetWork() when a worker becomes idle.
-  void OnWorkerBecomesIdleLockRequired(WorkerThread* worker)
+  void OnWorkerBecomesIdleLockRequired(ScopedWorkersExecutor* executor,
+                                       WorkerThread* worker)
       EXCLUSIVE_LOCKS_REQUIRED(outer_->lock_);
 
+  // Called in DidProcessTask() under the ThreadGroupWorkStealing feature.
+  // Returns true if the worker may look for its next task source without
+  // acquiring |outer_->lock_|, in which case it keeps |*task_source| as
+  // |worker_only().next_task_source| and remains counted as running a task.
+  bool CanContinueWithoutLock(RegisteredTaskSource* task_source);
+
+  // Called in GetWork() when the worker is still counted as running a task.
+  // Returns the next task source to run from |worker_only().next_task_source|
+  // or the queue of this worker, if one has the priority of the last task and
+  // nothing more important is waiting in the thread group. Returns nullptr
+  // otherwise, without acquiring |outer_->lock_|.
+  RunIntentWithRegisteredTaskSource GetWorkWithoutLock();
+
+  // Returns true if no task source is queued by this worker.
+  bool AreQueuesEmpty() const;
+
+  // Moves the task sources queued by this worker to |outer_->priority_queue_|
+  // when it exits.
+  void MoveQueuedTaskSourcesToPriorityQueue();
+
+  using WorkerQueue = WorkStealingQueue<WorkerQueueItem, kWorkerQueueCapacity>;
+
+  // Task sources queued by this worker, by priority. Filled only from the
+  // worker thread, and drained by any worker.
+  std::array<WorkerQueue, kNumPriorities> queues_;
+
   // Accessed only from the worker thread.
   struct WorkerOnly {
     // Number of tasks executed since the last time the
@@ -271,6 +349,15 @@ class ThreadGroupImpl::WorkerThreadDelegateImpl : public WorkerThread::Delegate,
     // yet).
     bool is_running_task = false;
 
+    // Whether the worker is still counted in |outer_->num_running_tasks_|
+    // after DidProcessTask() (i.e. it decided to look for its next task source
+    // without acquiring |outer_->lock_|).
+    bool is_counted_as_running = false;
+
+    // The task source that the last task ran from, if it wasn't reenqueued
+    // yet.
+    std::unique_ptr<WorkerQueueItem> next_task_source;
+
 #if defined(OS_WIN)
     std::unique_ptr<win::ScopedWindowsThreadEnvironment> win_thread_environment;
 #endif  // defined(OS_WIN)
@@ -395,6 +482,7 @@ void ThreadGroupImpl::Start(
 
   in_start().may_block_without_delay =
       FeatureList::IsEnabled(kMayBlockWithoutDelay);
+  in_start().work_stealing = FeatureList::IsEnabled(kThreadGroupWorkStealing);
   in_start().may_block_threshold =
       may_block_threshold ? may_block_threshold.value()
                           : (priority_hint_ == ThreadPriority::NORMAL
@@ -421,6 +509,12 @@ void ThreadGroupImpl::Start(
   EnsureEnoughWorkersLockRequired(&executor);
 }
 
+void ThreadGroupImpl::SetWorkerCpuAffinity(std::vector<int> cpus) {
+  CheckedAutoLock auto_lock(lock_);
+  DCHECK(workers_.empty());
+  in_start().worker_cpu_affinity = std::move(cpus);
+}
+
 ThreadGroupImpl::~ThreadGroupImpl() {
   // ThreadGroup should only ever be deleted:
   //  1) In tests, after JoinForTesting().
@@ -429,19 +523,63 @@ ThreadGroupImpl::~ThreadGroupImpl() {
   DCHECK(workers_.empty());
 }
 
+RegisteredTaskSource ThreadGroupImpl::RemoveTaskSource(
+    scoped_refptr<TaskSource> task_source) {
+  CheckedAutoLock auto_lock(lock_);
+  MoveWorkerQueuesToPriorityQueueLockRequired(task_source.get());
+  return priority_queue_.RemoveTaskSource(std::move(task_source));
+}
+
 void ThreadGroupImpl::UpdateSortKey(
     TransactionWithOwnedTaskSource transaction_with_task_source) {
   ScopedWorkersExecutor executor(this);
-  UpdateSortKeyImpl(&executor, std::move(transaction_with_task_source));
+  CheckedAutoLock auto_lock(lock_);
+  MoveWorkerQueuesToPriorityQueueLockRequired(
+      transaction_with_task_source.task_source());
+  priority_queue_.UpdateSortKey(std::move(transaction_with_task_source));
+  EnsureEnoughWorkersLockRequired(&executor);
 }
 
 void ThreadGroupImpl::PushTaskSourceAndWakeUpWorkers(
     TransactionWithRegisteredTaskSource transaction_with_task_source) {
+  // Under the ThreadGroupWorkStealing feature, a task source made non-empty by
+  // a task running in this thread group is queued by the worker running it,
+  // without acquiring |lock_|. |lock_| is only needed to wake up a worker, and
+  // only if one is idle: otherwise, every worker is busy and will look for
+  // work in the queues of others when it's done.
+  if (IsBoundToCurrentThread()) {
+    WorkerThread::Delegate* const worker_delegate =
+        tls_worker_delegate.Get().Get();
+    if (worker_delegate &&
+        static_cast<WorkerThreadDelegateImpl*>(worker_delegate)
+            ->QueueTaskSourcePostedFromTask(&transaction_with_task_source)) {
+      // Sequentially consistent, like the update of |num_idle_workers_| in
+      // WorkerThreadDelegateImpl::OnWorkerBecomesIdleLockRequired(), so that
+      // either this sees the worker that becomes idle, or that worker sees the
+      // task source that was just queued.
+      if (num_idle_workers_.load() == 0)
+        return;
+      ScopedWorkersExecutor executor(this);
+      CheckedAutoLock auto_lock(lock_);
+      EnsureEnoughWorkersLockRequired(&executor);
+      return;
+    }
+  }
+
   ScopedWorkersExecutor executor(this);
   PushTaskSourceAndWakeUpWorkersImpl(&executor,
                                      std::move(transaction_with_task_source));
 }
 
+void ThreadGroupImpl::PushTaskSourcesAndWakeUpWorkers(
+    std::vector<RegisteredTaskSource> task_sources) {
+  // Unlike in PushTaskSourceAndWakeUpWorkers(), the task sources are queued
+  // in |priority_queue_| even when posted from a worker of this thread group,
+  // so that idle workers can pick them up in parallel.
+  ScopedWorkersExecutor executor(this);
+  PushTaskSourcesAndWakeUpWorkersImpl(&executor, std::move(task_sources));
+}
+
 size_t ThreadGroupImpl::GetMaxConcurrentNonBlockedTasksDeprecated() const {
 #if DCHECK_IS_ON()
   CheckedAutoLock auto_lock(lock_);
@@ -574,8 +712,17 @@ void ThreadGroupImpl::WorkerThreadDelegateImpl::OnMainEntry(
   PlatformThread::SetName(
       StringPrintf("ThreadPool%sWorker", outer_->thread_group_label_.c_str()));
 
+#if defined(OS_LINUX)
+  if (!outer_->after_start().worker_cpu_affinity.empty()) {
+    PlatformThread::SetCurrentThreadAffinity(
+        outer_->after_start().worker_cpu_affinity);
+  }
+#endif  // defined(OS_LINUX)
+
   outer_->BindToCurrentThread();
   SetBlockingObserverForCurrentThread(this);
+  if (outer_->after_start().work_stealing)
+    tls_worker_delegate.Get().Set(this);
 }
 
 RunIntentWithRegisteredTaskSource
@@ -583,23 +730,73 @@ ThreadGroupImpl::WorkerThreadDelegateImpl::GetWork(WorkerThread* worker) {
   DCHECK_CALLED_ON_VALID_THREAD(worker_thread_checker_);
   DCHECK(!worker_only().is_running_task);
 
+  if (worker_only().is_counted_as_running) {
+    RunIntentWithRegisteredTaskSource task_source = GetWorkWithoutLock();
+    if (task_source) {
+      worker_only().is_running_task = true;
+      worker_only().is_counted_as_running = false;
+      return task_source;
+    }
+  }
+
+  // The task source that the last task ran from is queued before acquiring
+  // |outer_->lock_|. If the queue is full or its priority was updated, a
+  // transaction is created to reenqueue it with its current sort key; see
+  // DidProcessTask() for why it must be created here.
+  Optional<TransactionWithRegisteredTaskSource> transaction_with_task_source;
+  if (worker_only().next_task_source &&
+      (worker_only().next_task_source->HasStaleSortKey() ||
+       !PushToQueue(&worker_only().next_task_source))) {
+    transaction_with_task_source.emplace(
+        TransactionWithRegisteredTaskSource::FromTaskSource(
+            std::move(worker_only().next_task_source->task_source)));
+    worker_only().next_task_source.reset();
+  }
+
   ScopedWorkersExecutor executor(outer_.get());
+  ScopedReenqueueExecutor reenqueue_executor;
   CheckedAutoLock auto_lock(outer_->lock_);
 
   DCHECK(ContainsWorker(outer_->workers_, worker));
 
+  if (worker_only().is_counted_as_running) {
+    outer_->DecrementTasksRunningLockRequired(
+        *read_worker().current_task_priority);
+    worker_only().is_counted_as_running = false;
+  }
+
+  if (transaction_with_task_source) {
+    outer_->ReEnqueueTaskSourceLockRequired(
+        &executor, &reenqueue_executor,
+        std::move(transaction_with_task_source.value()));
+  }
+
   // Use this opportunity, before assigning work to this worker, to create/wake
   // additional workers if needed (doing this here allows us to reduce
   // potentially expensive create/wake directly on PostTask()).
   outer_->EnsureEnoughWorkersLockRequired(&executor);
   executor.FlushWorkerCreation(&outer_->lock_);
 
-  if (!CanGetWorkLockRequired(worker))
+  if (!CanGetWorkLockRequired(&executor, worker))
     return nullptr;
 
   RunIntentWithRegisteredTaskSource task_source;
   TaskPriority priority;
-  while (!task_source && !outer_->priority_queue_.IsEmpty()) {
+  while (!task_source) {
+    if (outer_->after_start().work_stealing) {
+      std::unique_ptr<WorkerQueueItem> item =
+          outer_->StealTaskSourceLockRequired(this);
+      if (item) {
+        priority = item->sort_key.priority();
+        auto run_intent = item->task_source->WillRunTask();
+        DCHECK(run_intent.IsSaturated());
+        task_source = {std::move(item->task_source), std::move(run_intent)};
+        break;
+      }
+    }
+    if (outer_->priority_queue_.IsEmpty())
+      break;
+
     // Enforce the CanRunPolicy and that no more than |max_best_effort_tasks_|
     // BEST_EFFORT tasks run concurrently.
     priority = outer_->priority_queue_.PeekSortKey().priority();
@@ -613,7 +810,7 @@ ThreadGroupImpl::WorkerThreadDelegateImpl::GetWork(WorkerThread* worker) {
     task_source = outer_->TakeRunIntentWithRegisteredTaskSource(&executor);
   }
   if (!task_source) {
-    OnWorkerBecomesIdleLockRequired(worker);
+    OnWorkerBecomesIdleLockRequired(&executor, worker);
     return nullptr;
   }
 
@@ -635,6 +832,11 @@ void ThreadGroupImpl::WorkerThreadDelegateImpl::DidProcessTask(
   ++worker_only().num_tasks_since_last_wait;
   ++worker_only().num_tasks_since_last_detach;
 
+  if (outer_->after_start().work_stealing &&
+      CanContinueWithoutLock(&task_source)) {
+    return;
+  }
+
   // A transaction to the TaskSource to reenqueue, if any. Instantiated here as
   // |TaskSource::lock_| is a UniversalPredecessor and must always be acquired
   // prior to acquiring a second lock
@@ -697,6 +899,173 @@ TimeDelta ThreadGroupImpl::WorkerThreadDelegateImpl::GetSleepTimeout() {
   return outer_->after_start().suggested_reclaim_time * 1.1;
 }
 
+bool ThreadGroupImpl::WorkerThreadDelegateImpl::PushToQueue(
+    std::unique_ptr<WorkerQueueItem>* item) {
+  DCHECK_CALLED_ON_VALID_THREAD(worker_thread_checker_);
+
+  const size_t priority_index =
+      static_cast<size_t>((*item)->sort_key.priority());
+  if (!queues_[priority_index].Push(item))
+    return false;
+  // Sequentially consistent, see PushTaskSourceAndWakeUpWorkers().
+  ++outer_->num_task_sources_in_worker_queues_[priority_index];
+  return true;
+}
+
+std::unique_ptr<ThreadGroupImpl::WorkerQueueItem>
+ThreadGroupImpl::WorkerThreadDelegateImpl::TakeFromQueue(
+    TaskPriority priority) {
+  const size_t priority_index = static_cast<size_t>(priority);
+  std::unique_ptr<WorkerQueueItem> item = queues_[priority_index].Take();
+  if (item)
+    --outer_->num_task_sources_in_worker_queues_[priority_index];
+  return item;
+}
+
+bool ThreadGroupImpl::WorkerThreadDelegateImpl::QueueTaskSourcePostedFromTask(
+    TransactionWithRegisteredTaskSource* transaction_with_task_source) {
+  DCHECK_CALLED_ON_VALID_THREAD(worker_thread_checker_);
+
+  // Jobs are only queued in |outer_->priority_queue_|, which supports running
+  // a task source on several workers. Posting from outside of a task, e.g.
+  // from a task's destructor, goes through |outer_->lock_| as usual.
+  if (!worker_only().is_running_task ||
+      transaction_with_task_source->task_source()->execution_mode() ==
+          TaskSourceExecutionMode::kJob) {
+    return false;
+  }
+  DCHECK(!transaction_with_task_source->task_source()
+              ->heap_handle()
+              .IsValid());
+
+  const SequenceSortKey sort_key = transaction_with_task_source->GetSortKey();
+  if (queues_[static_cast<size_t>(sort_key.priority())].IsFull())
+    return false;
+
+  // The transaction ends before the task source is visible to other workers.
+  std::unique_ptr<WorkerQueueItem> item;
+  {
+    TransactionWithRegisteredTaskSource transaction(
+        std::move(*transaction_with_task_source));
+    item = std::make_unique<WorkerQueueItem>(transaction.take_task_source(),
+                                             sort_key);
+  }
+  const bool pushed = PushToQueue(&item);
+  DCHECK(pushed);
+  ALLOW_UNUSED_LOCAL(pushed);
+  return true;
+}
+
+bool ThreadGroupImpl::WorkerThreadDelegateImpl::CanContinueWithoutLock(
+    RegisteredTaskSource* task_source) {
+  DCHECK(!worker_only().next_task_source);
+
+  if (*task_source) {
+    if ((*task_source)->execution_mode() == TaskSourceExecutionMode::kJob)
+      return false;
+    auto transaction = (*task_source)->BeginTransaction();
+    if (outer_->delegate_->GetThreadGroupForTaskSource(transaction) !=
+        outer_.get()) {
+      return false;
+    }
+    worker_only().next_task_source = std::make_unique<WorkerQueueItem>(
+        std::move(*task_source), transaction.GetSortKey());
+  } else if (queues_[static_cast<size_t>(*read_worker().current_task_priority)]
+                 .IsEmpty()) {
+    return false;
+  }
+
+  worker_only().is_running_task = false;
+  worker_only().is_counted_as_running = true;
+  return true;
+}
+
+RunIntentWithRegisteredTaskSource
+ThreadGroupImpl::WorkerThreadDelegateImpl::GetWorkWithoutLock() {
+  DCHECK(worker_only().is_counted_as_running);
+
+  // The worker keeps the slot of the last task, which must still be allowed to
+  // run a task of the same priority.
+  const TaskPriority priority = *read_worker().current_task_priority;
+  if (!outer_->can_run_worker_queues_without_lock_.load(
+          std::memory_order_relaxed) ||
+      !outer_->task_tracker_->CanRunPriority(priority)) {
+    return nullptr;
+  }
+  for (size_t i = static_cast<size_t>(priority) + 1; i < kNumPriorities; ++i) {
+    if (outer_->num_task_sources_in_worker_queues_[i].load(
+            std::memory_order_relaxed) > 0) {
+      return nullptr;
+    }
+  }
+
+  std::unique_ptr<WorkerQueueItem>& next_task_source =
+      worker_only().next_task_source;
+  if (next_task_source && (next_task_source->sort_key.priority() != priority ||
+                           next_task_source->HasStaleSortKey())) {
+    return nullptr;
+  }
+
+  // Task sources in the queue were queued before the one the last task ran
+  // from, which goes to the back of the queue. Since a slot was just freed,
+  // pushing it can't fail.
+  std::unique_ptr<WorkerQueueItem> item = TakeFromQueue(priority);
+  if (!item) {
+    item = std::move(next_task_source);
+  } else if (next_task_source) {
+    const bool pushed = PushToQueue(&next_task_source);
+    DCHECK(pushed);
+    ALLOW_UNUSED_LOCAL(pushed);
+  }
+  if (!item)
+    return nullptr;
+
+  // A task source whose priority was updated is reenqueued by GetWork().
+  if (item->HasStaleSortKey()) {
+    DCHECK(!next_task_source);
+    next_task_source = std::move(item);
+    return nullptr;
+  }
+
+  auto run_intent = item->task_source->WillRunTask();
+  DCHECK(run_intent.IsSaturated());
+  return {std::move(item->task_source), std::move(run_intent)};
+}
+
+bool ThreadGroupImpl::WorkerThreadDelegateImpl::AreQueuesEmpty() const {
+  return std::all_of(queues_.begin(), queues_.end(),
+                     [](const WorkerQueue& queue) { return queue.IsEmpty(); });
+}
+
+void ThreadGroupImpl::WorkerThreadDelegateImpl::
+    MoveQueuedTaskSourcesToPriorityQueue() {
+  std::vector<std::unique_ptr<WorkerQueueItem>> items;
+  if (worker_only().next_task_source)
+    items.push_back(std::move(worker_only().next_task_source));
+  for (size_t i = 0; i < kNumPriorities; ++i) {
+    while (std::unique_ptr<WorkerQueueItem> item =
+               TakeFromQueue(static_cast<TaskPriority>(i))) {
+      items.push_back(std::move(item));
+    }
+  }
+
+  for (auto& item : items) {
+    auto transaction_with_task_source =
+        TransactionWithRegisteredTaskSource::FromTaskSource(
+            std::move(item->task_source));
+    CheckedAutoLock auto_lock(outer_->lock_);
+    outer_->priority_queue_.Push(std::move(transaction_with_task_source));
+  }
+
+  CheckedAutoLock auto_lock(outer_->lock_);
+  if (worker_only().is_counted_as_running) {
+    outer_->DecrementTasksRunningLockRequired(
+        *read_worker().current_task_priority);
+    worker_only().is_counted_as_running = false;
+  }
+  outer_->UpdateMinAllowedPriorityLockRequired();
+}
+
 bool ThreadGroupImpl::WorkerThreadDelegateImpl::CanCleanupLockRequired(
     const WorkerThread* worker) const {
   DCHECK_CALLED_ON_VALID_THREAD(worker_thread_checker_);
@@ -705,6 +1074,7 @@ bool ThreadGroupImpl::WorkerThreadDelegateImpl::CanCleanupLockRequired(
   return !last_used_time.is_null() &&
          subtle::TimeTicksNowIgnoringOverride() - last_used_time >=
              outer_->after_start().suggested_reclaim_time &&
+         AreQueuesEmpty() &&
          (outer_->workers_.size() > outer_->after_start().initial_max_tasks ||
           !FeatureList::IsEnabled(kNoDetachBelowInitialCapacity)) &&
          LIKELY(!outer_->worker_cleanup_disallowed_for_testing_);
@@ -719,6 +1089,7 @@ void ThreadGroupImpl::WorkerThreadDelegateImpl::CleanupLockRequired(
   outer_->cleanup_timestamps_.push(subtle::TimeTicksNowIgnoringOverride());
   worker->Cleanup();
   outer_->idle_workers_stack_.Remove(worker);
+  outer_->num_idle_workers_.store(outer_->idle_workers_stack_.Size());
 
   // Remove the worker from |workers_|.
   auto worker_iter =
@@ -735,6 +1106,7 @@ void ThreadGroupImpl::WorkerThreadDelegateImpl::CleanupLockRequired(
 }
 
 void ThreadGroupImpl::WorkerThreadDelegateImpl::OnWorkerBecomesIdleLockRequired(
+    ScopedWorkersExecutor* executor,
     WorkerThread* worker) {
   DCHECK_CALLED_ON_VALID_THREAD(worker_thread_checker_);
 
@@ -751,6 +1123,17 @@ void ThreadGroupImpl::WorkerThreadDelegateImpl::OnWorkerBecomesIdleLockRequired(
   outer_->idle_workers_stack_.Push(worker);
   DCHECK_LE(outer_->idle_workers_stack_.Size(), outer_->workers_.size());
   outer_->idle_workers_stack_cv_for_testing_->Broadcast();
+
+  // A busy worker that queued a task source without |lock_| only wakes up a
+  // worker if it sees one as idle. Both sides are sequentially consistent, so
+  // either that worker sees this one as idle, or this sees its task source and
+  // wakes up a worker to run it.
+  outer_->num_idle_workers_.store(outer_->idle_workers_stack_.Size());
+  if (outer_->GetNumBestEffortTaskSourcesInWorkerQueues() +
+          outer_->GetNumForegroundTaskSourcesInWorkerQueues() >
+      0) {
+    outer_->EnsureEnoughWorkersLockRequired(executor);
+  }
 }
 
 void ThreadGroupImpl::WorkerThreadDelegateImpl::OnMainExit(
@@ -773,6 +1156,11 @@ void ThreadGroupImpl::WorkerThreadDelegateImpl::OnMainExit(
   }
 #endif
 
+  if (outer_->after_start().work_stealing) {
+    MoveQueuedTaskSourcesToPriorityQueue();
+    tls_worker_delegate.Get().Set(nullptr);
+  }
+
 #if defined(OS_WIN)
   worker_only().win_thread_environment.reset();
 #endif  // defined(OS_WIN)
@@ -877,6 +1265,7 @@ void ThreadGroupImpl::WorkerThreadDelegateImpl::WillBlockEntered() {
 }
 
 bool ThreadGroupImpl::WorkerThreadDelegateImpl::CanGetWorkLockRequired(
+    ScopedWorkersExecutor* executor,
     WorkerThread* worker) {
   // To avoid searching through the idle stack : use GetLastUsedTime() not being
   // null (or being directly on top of the idle stack) as a proxy for being on
@@ -899,7 +1288,7 @@ bool ThreadGroupImpl::WorkerThreadDelegateImpl::CanGetWorkLockRequired(
   // up.
   if (outer_->GetNumAwakeWorkersLockRequired() >
       outer_->GetDesiredNumAwakeWorkersLockRequired()) {
-    OnWorkerBecomesIdleLockRequired(worker);
+    OnWorkerBecomesIdleLockRequired(executor, worker);
     return false;
   }
 
@@ -992,7 +1381,8 @@ size_t ThreadGroupImpl::GetDesiredNumAwakeWorkersLockRequired() const {
   // to run by the CanRunPolicy.
   const size_t num_running_or_queued_can_run_best_effort_task_sources =
       num_running_best_effort_tasks_ +
-      GetNumAdditionalWorkersForBestEffortTaskSourcesLockRequired();
+      GetNumAdditionalWorkersForBestEffortTaskSourcesLockRequired() +
+      GetNumBestEffortTaskSourcesInWorkerQueues();
 
   const size_t workers_for_best_effort_task_sources =
       std::max(std::min(num_running_or_queued_can_run_best_effort_task_sources,
@@ -1002,7 +1392,8 @@ size_t ThreadGroupImpl::GetDesiredNumAwakeWorkersLockRequired() const {
   // Number of USER_{VISIBLE|BLOCKING} task sources that are running or queued.
   const size_t num_running_or_queued_foreground_task_sources =
       (num_running_tasks_ - num_running_best_effort_tasks_) +
-      GetNumAdditionalWorkersForForegroundTaskSourcesLockRequired();
+      GetNumAdditionalWorkersForForegroundTaskSourcesLockRequired() +
+      GetNumForegroundTaskSourcesInWorkerQueues();
 
   const size_t workers_for_foreground_task_sources =
       num_running_or_queued_foreground_task_sources;
@@ -1012,6 +1403,106 @@ size_t ThreadGroupImpl::GetDesiredNumAwakeWorkersLockRequired() const {
                    max_tasks_, kMaxNumberOfWorkers});
 }
 
+size_t ThreadGroupImpl::GetNumBestEffortTaskSourcesInWorkerQueues() const {
+  if (!task_tracker_->CanRunPriority(TaskPriority::BEST_EFFORT))
+    return 0U;
+  const int num_task_sources = num_task_sources_in_worker_queues_[
+      static_cast<size_t>(TaskPriority::BEST_EFFORT)].load();
+  return std::max(num_task_sources, 0);
+}
+
+size_t ThreadGroupImpl::GetNumForegroundTaskSourcesInWorkerQueues() const {
+  if (!task_tracker_->CanRunPriority(TaskPriority::HIGHEST))
+    return 0U;
+  size_t num_task_sources = 0;
+  for (size_t i = static_cast<size_t>(TaskPriority::USER_VISIBLE);
+       i < kNumPriorities; ++i) {
+    num_task_sources +=
+        std::max(num_task_sources_in_worker_queues_[i].load(), 0);
+  }
+  return num_task_sources;
+}
+
+std::unique_ptr<ThreadGroupImpl::WorkerQueueItem>
+ThreadGroupImpl::StealTaskSourceLockRequired(WorkerThreadDelegateImpl* thief) {
+  for (size_t i = kNumPriorities; i-- > 0;) {
+    const TaskPriority priority = static_cast<TaskPriority>(i);
+    if (!priority_queue_.IsEmpty() &&
+        priority < priority_queue_.PeekSortKey().priority()) {
+      return nullptr;
+    }
+
+    // Enforce the CanRunPolicy and that no more than |max_best_effort_tasks_|
+    // BEST_EFFORT tasks run concurrently.
+    if (num_task_sources_in_worker_queues_[i].load() <= 0 ||
+        !task_tracker_->CanRunPriority(priority) ||
+        (priority == TaskPriority::BEST_EFFORT &&
+         num_running_best_effort_tasks_ >= max_best_effort_tasks_)) {
+      continue;
+    }
+
+    // A task source is counted only after it's pushed, so if none is found, it
+    // was taken by another worker.
+    std::unique_ptr<WorkerQueueItem> item = thief->TakeFromQueue(priority);
+    for (size_t j = 0; !item && j < workers_.size(); ++j) {
+      item = static_cast<WorkerThreadDelegateImpl*>(workers_[j]->delegate())
+                 ->TakeFromQueue(priority);
+    }
+    if (!item)
+      continue;
+
+    // A task source whose priority was updated while no worker queue held it
+    // (e.g. while it was the next task source of a worker) is moved to
+    // |priority_queue_|. A transaction can't be created under |lock_|, but only
+    // the priority of its sort key can have changed since it was queued.
+    if (item->HasStaleSortKey()) {
+      const SequenceSortKey sort_key(item->task_source->priority_racy(),
+                                     item->sort_key.next_task_sequenced_time());
+      priority_queue_.Push(std::move(item->task_source), sort_key);
+      UpdateMinAllowedPriorityLockRequired();
+      return nullptr;
+    }
+
+    // Among task sources of the same priority, the one whose next task was
+    // posted first runs first.
+    if (!priority_queue_.IsEmpty() &&
+        priority_queue_.PeekSortKey() <= item->sort_key &&
+        thief->PushToQueue(&item)) {
+      return nullptr;
+    }
+    return item;
+  }
+  return nullptr;
+}
+
+void ThreadGroupImpl::MoveWorkerQueuesToPriorityQueueLockRequired(
+    const TaskSource* task_source) {
+  // There is no worker before Start().
+  if (workers_.empty() || !after_start().work_stealing ||
+      task_source->heap_handle().IsValid()) {
+    return;
+  }
+
+  bool moved = false;
+  for (const scoped_refptr<WorkerThread>& worker : workers_) {
+    auto* delegate = static_cast<WorkerThreadDelegateImpl*>(worker->delegate());
+    for (size_t i = 0; i < kNumPriorities; ++i) {
+      while (std::unique_ptr<WorkerQueueItem> item =
+                 delegate->TakeFromQueue(static_cast<TaskPriority>(i))) {
+        const SequenceSortKey sort_key(
+            item->task_source->priority_racy(),
+            item->sort_key.next_task_sequenced_time());
+        priority_queue_.Push(std::move(item->task_source), sort_key);
+        moved = true;
+      }
+    }
+  }
+  // Workers can't run task sources from their queues without |lock_| while
+  // |priority_queue_| isn't empty.
+  if (moved)
+    UpdateMinAllowedPriorityLockRequired();
+}
+
 void ThreadGroupImpl::DidUpdateCanRunPolicy() {
   ScopedWorkersExecutor executor(this);
   CheckedAutoLock auto_lock(lock_);
@@ -1050,6 +1541,8 @@ void ThreadGroupImpl::EnsureEnoughWorkersLockRequired(
   if (desired_num_awake_workers == num_awake_workers)
     MaintainAtLeastOneIdleWorkerLockRequired(executor);
 
+  num_idle_workers_.store(idle_workers_stack_.Size());
+
   // This function is called every time a task source is (re-)enqueued,
   // hence the minimum priority needs to be updated.
   UpdateMinAllowedPriorityLockRequired();
@@ -1119,7 +1612,8 @@ bool ThreadGroupImpl::ShouldPeriodicallyAdjustMaxTasksLockRequired() {
 
   const size_t num_running_or_queued_best_effort_task_sources =
       num_running_best_effort_tasks_ +
-      GetNumAdditionalWorkersForBestEffortTaskSourcesLockRequired();
+      GetNumAdditionalWorkersForBestEffortTaskSourcesLockRequired() +
+      GetNumBestEffortTaskSourcesInWorkerQueues();
   if (num_running_or_queued_best_effort_task_sources > max_best_effort_tasks_ &&
       num_unresolved_best_effort_may_block_ > 0) {
     return true;
@@ -1128,7 +1622,9 @@ bool ThreadGroupImpl::ShouldPeriodicallyAdjustMaxTasksLockRequired() {
   const size_t num_running_or_queued_task_sources =
       num_running_tasks_ +
       GetNumAdditionalWorkersForBestEffortTaskSourcesLockRequired() +
-      GetNumAdditionalWorkersForForegroundTaskSourcesLockRequired();
+      GetNumAdditionalWorkersForForegroundTaskSourcesLockRequired() +
+      GetNumBestEffortTaskSourcesInWorkerQueues() +
+      GetNumForegroundTaskSourcesInWorkerQueues();
   constexpr size_t kIdleWorker = 1;
   return num_running_or_queued_task_sources + kIdleWorker > max_tasks_ &&
          num_unresolved_may_block_ > 0;
@@ -1142,6 +1638,15 @@ void ThreadGroupImpl::UpdateMinAllowedPriorityLockRequired() {
     min_allowed_priority_.store(priority_queue_.PeekSortKey().priority(),
                                 std::memory_order_relaxed);
   }
+
+  // Workers that keep the slot of their last task (see
+  // WorkerThreadDelegateImpl::CanContinueWithoutLock()) must give it up when
+  // a task source is waiting in |priority_queue_| or when there are more
+  // running tasks than allowed.
+  can_run_worker_queues_without_lock_.store(
+      priority_queue_.IsEmpty() && num_running_tasks_ <= max_tasks_ &&
+          num_running_best_effort_tasks_ <= max_best_effort_tasks_,
+      std::memory_order_relaxed);
 }
 
 void ThreadGroupImpl::DecrementTasksRunningLockRequired(TaskPriority priority) {
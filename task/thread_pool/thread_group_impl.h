@@ -7,6 +7,8 @@
 
 #include <stddef.h>
 
+#include <array>
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
@@ -23,6 +25,7 @@
 #include "base/synchronization/atomic_flag.h"
 #include "base/synchronization/condition_variable.h"
 #include "base/synchronization/waitable_event.h"
+#include "base/task/task_traits.h"
 #include "base/task/thread_pool/task.h"
 #include "base/task/thread_pool/task_source.h"
 #include "base/task/thread_pool/thread_group.h"
@@ -46,6 +49,16 @@ class TaskTracker;
 // The thread group doesn't create threads until Start() is called. Tasks can be
 // posted at any time but will not run until after Start() is called.
 //
+// Under the ThreadGroupWorkStealing feature, each worker also has a lock-free
+// queue of task sources per priority. A worker queues the sequence it just ran
+// a task from, and those made non-empty by the tasks it runs, in its own queue
+// rather than in |priority_queue_|, and runs the next task from its queue
+// without acquiring |lock_| while no task source of higher priority is waiting
+// anywhere. Workers that run out of work steal from the queues of others.
+// Task sources of a job are always queued in |priority_queue_|, and so are all
+// queued task sources when one of them is removed from the thread group or has
+// its priority updated.
+//
 // This class is thread-safe.
 class BASE_EXPORT ThreadGroupImpl : public ThreadGroup {
  public:
@@ -83,6 +96,11 @@ class BASE_EXPORT ThreadGroupImpl : public ThreadGroup {
              WorkerEnvironment worker_environment,
              Optional<TimeDelta> may_block_threshold = Optional<TimeDelta>());
 
+  // Restricts the workers of this thread group to run on the CPUs in |cpus|,
+  // e.g. those of a NUMA node. Must be called before Start(). Has no effect on
+  // platforms other than Linux.
+  void SetWorkerCpuAffinity(std::vector<int> cpus);
+
   // Destroying a ThreadGroupImpl returned by Create() is not allowed in
   // production; it is always leaked. In tests, it can only be destroyed after
   // JoinForTesting() has returned.
@@ -137,6 +155,7 @@ class BASE_EXPORT ThreadGroupImpl : public ThreadGroup {
  private:
   class ScopedWorkersExecutor;
   class WorkerThreadDelegateImpl;
+  struct WorkerQueueItem;
 
   // Friend tests so that they can access |blocked_workers_poll_period| and
   // may_block_threshold().
@@ -146,11 +165,15 @@ class BASE_EXPORT ThreadGroupImpl : public ThreadGroup {
                            ThreadBlockUnblockPremature);
 
   // ThreadGroup:
+  RegisteredTaskSource RemoveTaskSource(
+      scoped_refptr<TaskSource> task_source) override;
   void UpdateSortKey(
       TransactionWithOwnedTaskSource transaction_with_task_source) override;
   void PushTaskSourceAndWakeUpWorkers(
       TransactionWithRegisteredTaskSource transaction_with_task_source)
       override;
+  void PushTaskSourcesAndWakeUpWorkers(
+      std::vector<RegisteredTaskSource> task_sources) override;
   void EnsureEnoughWorkersLockRequired(BaseScopedWorkersExecutor* executor)
       override EXCLUSIVE_LOCKS_REQUIRED(lock_);
 
@@ -175,6 +198,26 @@ class BASE_EXPORT ThreadGroupImpl : public ThreadGroup {
   size_t GetDesiredNumAwakeWorkersLockRequired() const
       EXCLUSIVE_LOCKS_REQUIRED(lock_);
 
+  // Returns the number of BEST_EFFORT / USER_VISIBLE and USER_BLOCKING task
+  // sources in the queues of workers that are allowed to run by the current
+  // CanRunPolicy.
+  size_t GetNumBestEffortTaskSourcesInWorkerQueues() const;
+  size_t GetNumForegroundTaskSourcesInWorkerQueues() const;
+
+  // Takes the most important task source that is allowed to run from the queue
+  // of |thief| or of another worker, unless the task source at the top of
+  // |priority_queue_| is at least as important. Returns nullptr if there is no
+  // such task source.
+  std::unique_ptr<WorkerQueueItem> StealTaskSourceLockRequired(
+      WorkerThreadDelegateImpl* thief) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Moves the task sources in the queues of all workers to |priority_queue_|,
+  // unless |task_source| is already in |priority_queue_|. Called before
+  // removing |task_source| or updating its sort key, which can only be done in
+  // |priority_queue_|.
+  void MoveWorkerQueuesToPriorityQueueLockRequired(
+      const TaskSource* task_source) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
   // Examines the list of WorkerThreads and increments |max_tasks_| for each
   // worker that has been within the scope of a MAY_BLOCK ScopedBlockingCall for
   // more than BlockedThreshold(). Reschedules a call if necessary.
@@ -206,9 +249,10 @@ class BASE_EXPORT ThreadGroupImpl : public ThreadGroup {
   bool ShouldPeriodicallyAdjustMaxTasksLockRequired()
       EXCLUSIVE_LOCKS_REQUIRED(lock_);
 
-  // Updates the minimum priority allowed to run below which tasks should yield.
-  // This should be called whenever |num_running_tasks_| or |max_tasks| changes,
-  // or when a new task is added to |priority_queue_|.
+  // Updates the minimum priority allowed to run below which tasks should yield,
+  // and whether workers can run task sources from their queue without
+  // acquiring |lock_|. This should be called whenever |num_running_tasks_| or
+  // |max_tasks| changes, or when a new task is added to |priority_queue_|.
   void UpdateMinAllowedPriorityLockRequired() EXCLUSIVE_LOCKS_REQUIRED(lock_);
 
   // Increments/decrements the number of tasks of |priority| that are currently
@@ -250,8 +294,14 @@ class BASE_EXPORT ThreadGroupImpl : public ThreadGroup {
     // Optional observer notified when a worker enters and exits its main.
     WorkerThreadObserver* worker_thread_observer = nullptr;
 
+    // CPUs on which workers run, or empty if they can run on any CPU.
+    std::vector<int> worker_cpu_affinity;
+
     bool may_block_without_delay;
 
+    // Whether the ThreadGroupWorkStealing feature is enabled.
+    bool work_stealing = false;
+
     // Threshold after which the max tasks is increased to compensate for a
     // worker that is within a MAY_BLOCK ScopedBlockingCall.
     TimeDelta may_block_threshold;
@@ -303,6 +353,24 @@ class BASE_EXPORT ThreadGroupImpl : public ThreadGroup {
   // is pushed on this stack when it receives nullptr from GetWork().
   WorkerThreadStack idle_workers_stack_ GUARDED_BY(lock_);
 
+  // Size of |idle_workers_stack_|, readable without |lock_|. Workers that
+  // queue a task source without |lock_| only wake up a worker when it's
+  // non-zero.
+  std::atomic<size_t> num_idle_workers_{0};
+
+  // Number of task sources of each priority in the queues of workers. Task
+  // sources are counted after they are pushed to a queue and uncounted after
+  // they are taken from it, so this can transiently be negative.
+  std::array<std::atomic<int>,
+             static_cast<TaskPriorityType>(TaskPriority::HIGHEST) + 1>
+      num_task_sources_in_worker_queues_ = {};
+
+  // Whether a worker can run the next task source from its queue without
+  // acquiring |lock_|: true when |priority_queue_| is empty and the thread
+  // group isn't running more tasks than allowed. Updated under |lock_| along
+  // with |min_allowed_priority_|.
+  std::atomic<bool> can_run_worker_queues_without_lock_{false};
+
   // Signaled when a worker is added to the idle workers stack.
   std::unique_ptr<ConditionVariable> idle_workers_stack_cv_for_testing_
       GUARDED_BY(lock_);
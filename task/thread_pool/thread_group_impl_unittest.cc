@@ -29,6 +29,7 @@
 #include "base/synchronization/waitable_event.h"
 #include "base/task/task_features.h"
 #include "base/task/thread_pool/delayed_task_manager.h"
+#include "base/task/thread_pool/pooled_sequenced_task_runner.h"
 #include "base/task/thread_pool/pooled_task_runner_delegate.h"
 #include "base/task/thread_pool/sequence.h"
 #include "base/task/thread_pool/sequence_sort_key.h"
@@ -128,7 +129,8 @@ class ThreadGroupImplImplTestBase : public ThreadGroup::Delegate {
 
  private:
   // ThreadGroup::Delegate:
-  ThreadGroup* GetThreadGroupForTraits(const TaskTraits& traits) override {
+  ThreadGroup* GetThreadGroupForTaskSource(
+      const TaskSource::Transaction& transaction) override {
     return thread_group_.get();
   }
 
@@ -1962,6 +1964,190 @@ TEST_F(ThreadGroupImplImplStartInBodyTest, RacyCleanup) {
   thread_group_.reset();
 }
 
+namespace {
+
+class ThreadGroupImplWorkStealingTest : public ThreadGroupImplImplTestBase,
+                                        public testing::Test {
+ protected:
+  ThreadGroupImplWorkStealingTest() = default;
+
+  void SetUp() override {
+    feature_list_.InitAndEnableFeature(kThreadGroupWorkStealing);
+    CreateThreadGroup();
+    // Let the test start the thread group.
+  }
+
+  void TearDown() override { ThreadGroupImplImplTestBase::CommonTearDown(); }
+
+ private:
+  base::test::ScopedFeatureList feature_list_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadGroupImplWorkStealingTest);
+};
+
+}  // namespace
+
+// Verify that task sources queued by a busy worker run on other workers.
+TEST_F(ThreadGroupImplWorkStealingTest, TasksPostedFromTaskRunConcurrently) {
+  StartThreadGroup(TimeDelta::Max(), kMaxTasks);
+  const scoped_refptr<TaskRunner> task_runner = test::CreateTaskRunner(
+      {ThreadPool()}, &mock_pooled_task_runner_delegate_);
+
+  WaitableEvent subtasks_running;
+  WaitableEvent unblock_subtasks;
+  RepeatingClosure subtasks_running_barrier = BarrierClosure(
+      kMaxTasks - 1,
+      BindOnce(&WaitableEvent::Signal, Unretained(&subtasks_running)));
+
+  task_runner->PostTask(
+      FROM_HERE, BindLambdaForTesting([&]() {
+        for (size_t i = 0; i < kMaxTasks - 1; ++i) {
+          task_runner->PostTask(FROM_HERE, BindLambdaForTesting([&]() {
+                                  subtasks_running_barrier.Run();
+                                  test::WaitWithoutBlockingObserver(
+                                      &unblock_subtasks);
+                                }));
+        }
+        // The worker running this task can't run the subtasks it posted.
+        test::WaitWithoutBlockingObserver(&subtasks_running);
+        unblock_subtasks.Signal();
+      }));
+
+  task_tracker_.FlushForTesting();
+}
+
+// Verify that a task source queued by a worker runs after task sources of
+// higher priority, wherever they are queued.
+TEST_F(ThreadGroupImplWorkStealingTest, PriorityOfTasksPostedFromTask) {
+  StartThreadGroup(TimeDelta::Max(), 1);
+  const scoped_refptr<TaskRunner> task_runner = test::CreateTaskRunner(
+      {ThreadPool()}, &mock_pooled_task_runner_delegate_);
+  const scoped_refptr<TaskRunner> best_effort_task_runner =
+      test::CreateTaskRunner({ThreadPool(), TaskPriority::BEST_EFFORT},
+                             &mock_pooled_task_runner_delegate_);
+  const scoped_refptr<TaskRunner> user_blocking_task_runner =
+      test::CreateTaskRunner({ThreadPool(), TaskPriority::USER_BLOCKING},
+                             &mock_pooled_task_runner_delegate_);
+
+  std::vector<TaskPriority> run_order;
+  task_runner->PostTask(
+      FROM_HERE, BindLambdaForTesting([&]() {
+        best_effort_task_runner->PostTask(
+            FROM_HERE, BindLambdaForTesting([&]() {
+              run_order.push_back(TaskPriority::BEST_EFFORT);
+            }));
+        user_blocking_task_runner->PostTask(
+            FROM_HERE, BindLambdaForTesting([&]() {
+              run_order.push_back(TaskPriority::USER_BLOCKING);
+            }));
+        task_runner->PostTask(FROM_HERE, BindLambdaForTesting([&]() {
+                                run_order.push_back(TaskPriority::USER_VISIBLE);
+                              }));
+      }));
+
+  task_tracker_.FlushForTesting();
+  EXPECT_EQ(std::vector<TaskPriority>({TaskPriority::USER_BLOCKING,
+                                       TaskPriority::USER_VISIBLE,
+                                       TaskPriority::BEST_EFFORT}),
+            run_order);
+}
+
+// Verify that tasks posted from tasks to sequences run in posting order, and
+// that long chains of tasks posted from tasks run to completion.
+TEST_F(ThreadGroupImplWorkStealingTest, SequencesPostedFromTasks) {
+  StartThreadGroup(TimeDelta::Max(), kMaxTasks);
+  const scoped_refptr<TaskRunner> task_runner = test::CreateTaskRunner(
+      {ThreadPool()}, &mock_pooled_task_runner_delegate_);
+
+  std::vector<scoped_refptr<SequencedTaskRunner>> sequenced_task_runners;
+  std::vector<std::vector<size_t>> run_orders(kMaxTasks);
+  for (size_t i = 0; i < kMaxTasks; ++i) {
+    sequenced_task_runners.push_back(test::CreateSequencedTaskRunner(
+        {ThreadPool()}, &mock_pooled_task_runner_delegate_));
+  }
+
+  task_runner->PostTask(FROM_HERE, BindLambdaForTesting([&]() {
+                          for (size_t i = 0; i < kLargeNumber; ++i) {
+                            for (size_t j = 0; j < kMaxTasks; ++j) {
+                              sequenced_task_runners[j]->PostTask(
+                                  FROM_HERE, BindLambdaForTesting([&, i, j]() {
+                                    run_orders[j].push_back(i);
+                                  }));
+                            }
+                          }
+                        }));
+
+  std::atomic_size_t num_chained_tasks(0);
+  RepeatingClosure post_chained_task;
+  post_chained_task = BindLambdaForTesting([&]() {
+    if (++num_chained_tasks < kLargeNumber)
+      task_runner->PostTask(FROM_HERE, post_chained_task);
+  });
+  task_runner->PostTask(FROM_HERE, post_chained_task);
+
+  task_tracker_.FlushForTesting();
+  for (const auto& run_order : run_orders) {
+    ASSERT_EQ(kLargeNumber, run_order.size());
+    EXPECT_TRUE(std::is_sorted(run_order.begin(), run_order.end()));
+  }
+  EXPECT_EQ(kLargeNumber, num_chained_tasks.load());
+}
+
+// Verify that updating the priority of a sequence queued by a worker affects
+// when it runs.
+TEST_F(ThreadGroupImplWorkStealingTest, UpdatePriorityOfSequenceInWorkerQueue) {
+  StartThreadGroup(TimeDelta::Max(), 1);
+  const scoped_refptr<TaskRunner> task_runner = test::CreateTaskRunner(
+      {ThreadPool()}, &mock_pooled_task_runner_delegate_);
+  const auto updateable_task_runner =
+      MakeRefCounted<PooledSequencedTaskRunner>(
+          TaskTraits(ThreadPool(), TaskPriority::BEST_EFFORT),
+          &mock_pooled_task_runner_delegate_);
+
+  std::vector<TaskPriority> run_order;
+  task_runner->PostTask(
+      FROM_HERE, BindLambdaForTesting([&]() {
+        updateable_task_runner->PostTask(
+            FROM_HERE, BindLambdaForTesting([&]() {
+              run_order.push_back(TaskPriority::USER_BLOCKING);
+            }));
+        task_runner->PostTask(FROM_HERE, BindLambdaForTesting([&]() {
+                                run_order.push_back(TaskPriority::USER_VISIBLE);
+                              }));
+        // The sequence is in the BEST_EFFORT queue of this worker.
+        updateable_task_runner->UpdatePriority(TaskPriority::USER_BLOCKING);
+      }));
+
+  task_tracker_.FlushForTesting();
+  EXPECT_EQ(std::vector<TaskPriority>(
+                {TaskPriority::USER_BLOCKING, TaskPriority::USER_VISIBLE}),
+            run_order);
+}
+
+// Verify that a task source queued by a worker can be removed from the thread
+// group.
+TEST_F(ThreadGroupImplWorkStealingTest, RemoveTaskSourceInWorkerQueue) {
+  StartThreadGroup(TimeDelta::Max(), 1);
+  const scoped_refptr<TaskRunner> task_runner = test::CreateTaskRunner(
+      {ThreadPool()}, &mock_pooled_task_runner_delegate_);
+  scoped_refptr<Sequence> sequence = test::CreateSequenceWithTask(
+      Task(FROM_HERE, MakeExpectedNotRunClosure(FROM_HERE), TimeDelta()),
+      TaskTraits(ThreadPool()));
+  ThreadGroup* const thread_group = thread_group_.get();
+
+  task_runner->PostTask(
+      FROM_HERE, BindLambdaForTesting([&]() {
+        auto transaction = sequence->BeginTransaction();
+        thread_group->PushTaskSourceAndWakeUpWorkers(
+            {task_tracker_.WillQueueTaskSource(sequence),
+             std::move(transaction)});
+        // The sequence is in the queue of this worker.
+        EXPECT_TRUE(thread_group->RemoveTaskSource(sequence).Unregister());
+      }));
+
+  task_tracker_.FlushForTesting();
+}
+
 TEST_P(ThreadGroupImplImplTestParam, ReportHeartbeatMetrics) {
   HistogramTester tester;
   thread_group_->ReportHeartbeatMetrics();
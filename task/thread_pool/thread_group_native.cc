@@ -142,6 +142,12 @@ void ThreadGroupNative::PushTaskSourceAndWakeUpWorkers(
                                      std::move(transaction_with_task_source));
 }
 
+void ThreadGroupNative::PushTaskSourcesAndWakeUpWorkers(
+    std::vector<RegisteredTaskSource> task_sources) {
+  ScopedWorkersExecutor executor(this);
+  PushTaskSourcesAndWakeUpWorkersImpl(&executor, std::move(task_sources));
+}
+
 void ThreadGroupNative::EnsureEnoughWorkersLockRequired(
     BaseScopedWorkersExecutor* executor) {
   if (!started_)
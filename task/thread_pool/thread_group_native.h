@@ -53,6 +53,8 @@ class BASE_EXPORT ThreadGroupNative : public ThreadGroup {
   void PushTaskSourceAndWakeUpWorkers(
       TransactionWithRegisteredTaskSource transaction_with_task_source)
       override;
+  void PushTaskSourcesAndWakeUpWorkers(
+      std::vector<RegisteredTaskSource> task_sources) override;
   void EnsureEnoughWorkersLockRequired(BaseScopedWorkersExecutor* executor)
       override EXCLUSIVE_LOCKS_REQUIRED(lock_);
 
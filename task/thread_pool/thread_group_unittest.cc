@@ -171,7 +171,8 @@ class ThreadGroupTestBase : public testing::Test, public ThreadGroup::Delegate {
 
  private:
   // ThreadGroup::Delegate:
-  ThreadGroup* GetThreadGroupForTraits(const TaskTraits& traits) override {
+  ThreadGroup* GetThreadGroupForTaskSource(
+      const TaskSource::Transaction& transaction) override {
     return thread_group_.get();
   }
 
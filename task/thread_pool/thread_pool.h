@@ -78,6 +78,16 @@ class BASE_EXPORT ThreadPoolInstance {
 
     // Suggested time after which an unused thread can be reclaimed.
     TimeDelta suggested_reclaim_time = TimeDelta::FromSeconds(30);
+
+    // Whether the foreground thread group is split into one thread group per
+    // NUMA node, whose workers only run on the CPUs of that node. The
+    // |max_num_foreground_threads| are divided among nodes in proportion to
+    // their number of CPUs. Tasks posted to a task runner run on the node on
+    // which the task runner was created, and other tasks on the node from
+    // which they are posted, which avoids moving the data that tasks share
+    // across sockets. Has no effect on machines with a single NUMA node and
+    // on platforms other than Linux.
+    bool numa_aware_thread_groups = false;
   };
 
   // A Scoped(BestEffort)ExecutionFence prevents new tasks of any/BEST_EFFORT
@@ -17,6 +17,8 @@
 #include "base/message_loop/message_loop.h"
 #include "base/metrics/field_trial_params.h"
 #include "base/stl_util.h"
+#include "base/strings/strcat.h"
+#include "base/strings/string_number_conversions.h"
 #include "base/strings/string_util.h"
 #include "base/task/task_features.h"
 #include "base/task/thread_pool/pooled_parallel_task_runner.h"
@@ -51,6 +53,10 @@ constexpr EnvironmentParams kBackgroundPoolEnvironmentParams{
 
 constexpr int kMaxBestEffortTasks = 2;
 
+// Suffix of the labels of the foreground thread groups of NUMA nodes other than
+// the first, followed by the index of the node.
+constexpr char kNumaNodeThreadGroupLabelSuffix[] = "Node";
+
 // Indicates whether BEST_EFFORT tasks are disabled by a command line switch.
 bool HasDisableBestEffortTasksSwitch() {
   // The CommandLine might not be initialized if ThreadPool is initialized in a
@@ -78,6 +84,7 @@ ThreadPoolImpl::ThreadPoolImpl(StringPiece histogram_label,
                         Unretained(this)))),
       single_thread_task_runner_manager_(task_tracker_->GetTrackedRef(),
                                          &delayed_task_manager_),
+      histogram_label_(histogram_label.as_string()),
       has_disable_best_effort_switch_(HasDisableBestEffortTasksSwitch()),
       tracked_ref_factory_(this) {
   DCHECK(!histogram_label.empty());
@@ -108,6 +115,7 @@ ThreadPoolImpl::~ThreadPoolImpl() {
   // Reset thread groups to release held TrackedRefs, which block teardown.
   foreground_thread_group_.reset();
   background_thread_group_.reset();
+  numa_node_thread_groups_.clear();
 }
 
 void ThreadPoolImpl::Start(const ThreadPoolInstance::InitParams& init_params,
@@ -127,6 +135,15 @@ void ThreadPoolImpl::Start(const ThreadPoolInstance::InitParams& init_params,
   if (FeatureList::IsEnabled(kAllTasksUserBlocking))
     all_tasks_user_blocking_.Set();
 
+  // The thread groups of NUMA nodes are created before the service thread
+  // starts reporting their heartbeat metrics.
+  std::vector<int> max_tasks_per_numa_node = {
+      init_params.max_num_foreground_threads};
+  if (init_params.numa_aware_thread_groups) {
+    max_tasks_per_numa_node =
+        CreateNumaNodeThreadGroups(init_params.max_num_foreground_threads);
+  }
+
 #if HAS_NATIVE_THREAD_POOL()
   if (FeatureList::IsEnabled(kUseNativeThreadPool)) {
     std::unique_ptr<ThreadGroup> pool = std::move(foreground_thread_group_);
@@ -197,10 +214,21 @@ void ThreadPoolImpl::Start(const ThreadPoolInstance::InitParams& init_params,
     // tasks that can run in foreground pools to ensure that there is always
     // room for incoming foreground tasks and to minimize the performance impact
     // of best-effort tasks.
-    static_cast<ThreadGroupImpl*>(foreground_thread_group_.get())
-        ->Start(init_params.max_num_foreground_threads, max_best_effort_tasks,
-                suggested_reclaim_time, service_thread_task_runner,
-                worker_thread_observer, worker_environment);
+    for (size_t node = 0; node < max_tasks_per_numa_node.size(); ++node) {
+      ThreadGroupImpl* const thread_group =
+          node == 0
+              ? static_cast<ThreadGroupImpl*>(foreground_thread_group_.get())
+              : numa_node_thread_groups_[node - 1].get();
+      if (max_tasks_per_numa_node.size() > 1)
+        thread_group->SetWorkerCpuAffinity(cpu_topology_.nodes[node]);
+      thread_group->Start(
+          max_tasks_per_numa_node[node],
+          std::min(max_best_effort_tasks, max_tasks_per_numa_node[node]),
+          suggested_reclaim_time, service_thread_task_runner,
+          worker_thread_observer, worker_environment);
+    }
+    num_numa_nodes_.store(max_tasks_per_numa_node.size(),
+                          std::memory_order_release);
   }
 
   if (background_thread_group_) {
@@ -229,19 +257,22 @@ bool ThreadPoolImpl::PostDelayedTask(const Location& from_here,
   return PostTaskWithSequence(
       Task(from_here, std::move(task), delay),
       MakeRefCounted<Sequence>(new_traits, nullptr,
-                               TaskSourceExecutionMode::kParallel));
+                               TaskSourceExecutionMode::kParallel,
+                               GetNumaNodeForCurrentThread()));
 }
 
 scoped_refptr<TaskRunner> ThreadPoolImpl::CreateTaskRunner(
     const TaskTraits& traits) {
   const TaskTraits new_traits = SetUserBlockingPriorityIfNeeded(traits);
-  return MakeRefCounted<PooledParallelTaskRunner>(new_traits, this);
+  return MakeRefCounted<PooledParallelTaskRunner>(
+      new_traits, this, GetNumaNodeForCurrentThread());
 }
 
 scoped_refptr<SequencedTaskRunner> ThreadPoolImpl::CreateSequencedTaskRunner(
     const TaskTraits& traits) {
   const TaskTraits new_traits = SetUserBlockingPriorityIfNeeded(traits);
-  return MakeRefCounted<PooledSequencedTaskRunner>(new_traits, this);
+  return MakeRefCounted<PooledSequencedTaskRunner>(
+      new_traits, this, GetNumaNodeForCurrentThread());
 }
 
 scoped_refptr<SingleThreadTaskRunner>
@@ -264,7 +295,8 @@ scoped_refptr<SingleThreadTaskRunner> ThreadPoolImpl::CreateCOMSTATaskRunner(
 scoped_refptr<UpdateableSequencedTaskRunner>
 ThreadPoolImpl::CreateUpdateableSequencedTaskRunner(const TaskTraits& traits) {
   const TaskTraits new_traits = SetUserBlockingPriorityIfNeeded(traits);
-  return MakeRefCounted<PooledSequencedTaskRunner>(new_traits, this);
+  return MakeRefCounted<PooledSequencedTaskRunner>(
+      new_traits, this, GetNumaNodeForCurrentThread());
 }
 
 Optional<TimeTicks> ThreadPoolImpl::NextScheduledRunTimeForTesting() const {
@@ -277,6 +309,12 @@ void ThreadPoolImpl::ProcessRipeDelayedTasksForTesting() {
   delayed_task_manager_.ProcessRipeTasks();
 }
 
+void ThreadPoolImpl::SetCpuTopologyForTesting(const CpuTopology& cpu_topology) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  DCHECK(!started_);
+  cpu_topology_for_testing_ = cpu_topology;
+}
+
 int ThreadPoolImpl::GetMaxConcurrentNonBlockedTasksWithTraitsDeprecated(
     const TaskTraits& traits) const {
   // This method does not support getting the maximum number of BEST_EFFORT
@@ -326,6 +364,8 @@ void ThreadPoolImpl::JoinForTesting() {
   service_thread_->Stop();
   single_thread_task_runner_manager_.JoinForTesting();
   foreground_thread_group_->JoinForTesting();
+  for (const auto& thread_group : numa_node_thread_groups_)
+    thread_group->JoinForTesting();
   if (background_thread_group_)
     background_thread_group_->JoinForTesting();
 #if DCHECK_IS_ON()
@@ -362,8 +402,9 @@ bool ThreadPoolImpl::PostTaskWithSequenceNow(Task task,
   transaction.PushTask(std::move(task));
   if (task_source) {
     const TaskTraits traits = transaction.traits();
-    GetThreadGroupForTraits(traits)->PushTaskSourceAndWakeUpWorkers(
-        {std::move(task_source), std::move(transaction)});
+    GetThreadGroupForTraits(traits, sequence->numa_node())
+        ->PushTaskSourceAndWakeUpWorkers(
+            {std::move(task_source), std::move(transaction)});
   }
   return true;
 }
@@ -399,6 +440,97 @@ bool ThreadPoolImpl::PostTaskWithSequence(Task task,
   return true;
 }
 
+bool ThreadPoolImpl::PostTasksWithSequence(std::vector<Task> tasks,
+                                           scoped_refptr<Sequence> sequence) {
+  DCHECK(sequence);
+
+  bool all_posted = true;
+  size_t num_tasks_to_push = 0;
+  for (Task& task : tasks) {
+    // Use CHECK instead of DCHECK to crash earlier. See
+    // http://crbug.com/711167 for details.
+    CHECK(task.task);
+    DCHECK(task.delayed_run_time.is_null());
+    if (task_tracker_->WillPostTask(&task, sequence->shutdown_behavior())) {
+      ++num_tasks_to_push;
+    } else {
+      task.task.Reset();
+      all_posted = false;
+    }
+  }
+  if (num_tasks_to_push == 0)
+    return false;
+
+  // Unlike PostTaskWithSequenceNow() called for each task, this acquires the
+  // lock of |sequence| and queues it in a thread group at most once.
+  auto transaction = sequence->BeginTransaction();
+  const bool sequence_should_be_queued = transaction.WillPushTask();
+  RegisteredTaskSource task_source;
+  if (sequence_should_be_queued) {
+    task_source = task_tracker_->WillQueueTaskSource(sequence);
+    // We shouldn't push |tasks| if we're not allowed to queue |task_source|.
+    if (!task_source)
+      return false;
+  }
+  const TaskPriority priority = transaction.traits().priority();
+  for (Task& task : tasks) {
+    if (!task.task)
+      continue;
+    task_tracker_->WillPostTaskNow(task, priority);
+    transaction.PushTask(std::move(task));
+  }
+  if (task_source) {
+    const TaskTraits traits = transaction.traits();
+    GetThreadGroupForTraits(traits, sequence->numa_node())
+        ->PushTaskSourceAndWakeUpWorkers(
+            {std::move(task_source), std::move(transaction)});
+  }
+  return all_posted;
+}
+
+bool ThreadPoolImpl::PostTasksWithSequences(
+    std::vector<Task> tasks,
+    std::vector<scoped_refptr<Sequence>> sequences) {
+  DCHECK_EQ(tasks.size(), sequences.size());
+
+  bool all_posted = true;
+  ThreadGroup* thread_group = nullptr;
+  std::vector<RegisteredTaskSource> task_sources;
+  task_sources.reserve(tasks.size());
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    Task& task = tasks[i];
+    const scoped_refptr<Sequence>& sequence = sequences[i];
+    // Use CHECK instead of DCHECK to crash earlier. See
+    // http://crbug.com/711167 for details.
+    CHECK(task.task);
+    DCHECK(task.delayed_run_time.is_null());
+    if (!task_tracker_->WillPostTask(&task, sequence->shutdown_behavior())) {
+      all_posted = false;
+      continue;
+    }
+
+    auto transaction = sequence->BeginTransaction();
+    DCHECK(transaction.WillPushTask());
+    RegisteredTaskSource task_source =
+        task_tracker_->WillQueueTaskSource(sequence);
+    if (!task_source) {
+      all_posted = false;
+      continue;
+    }
+    const TaskTraits traits = transaction.traits();
+    task_tracker_->WillPostTaskNow(task, traits.priority());
+    transaction.PushTask(std::move(task));
+    thread_group = GetThreadGroupForTraits(traits, sequence->numa_node());
+    task_sources.push_back(std::move(task_source));
+  }
+
+  // All the sequences have the same traits, so they go to the same thread
+  // group, which queues them under a single lock acquisition.
+  if (!task_sources.empty())
+    thread_group->PushTaskSourcesAndWakeUpWorkers(std::move(task_sources));
+  return all_posted;
+}
+
 bool ThreadPoolImpl::EnqueueJobTaskSource(
     scoped_refptr<JobTaskSource> task_source) {
   auto registered_task_source =
@@ -406,14 +538,25 @@ bool ThreadPoolImpl::EnqueueJobTaskSource(
   if (registered_task_source)
     return false;
   auto transaction = task_source->BeginTransaction();
-  const TaskTraits traits = transaction.traits();
-  GetThreadGroupForTraits(traits)->PushTaskSourceAndWakeUpWorkers(
+  ThreadGroup* const thread_group = GetThreadGroupForTaskSource(transaction);
+  thread_group->PushTaskSourceAndWakeUpWorkers(
       {std::move(registered_task_source), std::move(transaction)});
   return true;
 }
 
 bool ThreadPoolImpl::IsRunningPoolWithTraits(const TaskTraits& traits) const {
-  return GetThreadGroupForTraits(traits)->IsBoundToCurrentThread();
+  const ThreadGroup* const thread_group = GetThreadGroupForTraits(traits);
+  if (thread_group->IsBoundToCurrentThread())
+    return true;
+  // Foreground tasks also run in the thread groups of other NUMA nodes.
+  if (thread_group != foreground_thread_group_.get())
+    return false;
+  const size_t num_numa_nodes = num_numa_nodes_.load(std::memory_order_acquire);
+  for (size_t node = 1; node < num_numa_nodes; ++node) {
+    if (numa_node_thread_groups_[node - 1]->IsBoundToCurrentThread())
+      return true;
+  }
+  return false;
 }
 
 void ThreadPoolImpl::UpdatePriority(scoped_refptr<TaskSource> task_source,
@@ -431,10 +574,10 @@ void ThreadPoolImpl::UpdatePriority(scoped_refptr<TaskSource> task_source,
   }
 
   ThreadGroup* const current_thread_group =
-      GetThreadGroupForTraits(transaction.traits());
+      GetThreadGroupForTaskSource(transaction);
   transaction.UpdatePriority(priority);
   ThreadGroup* const new_thread_group =
-      GetThreadGroupForTraits(transaction.traits());
+      GetThreadGroupForTaskSource(transaction);
 
   if (new_thread_group == current_thread_group) {
     // |task_source|'s position needs to be updated within its current thread
@@ -454,19 +597,95 @@ void ThreadPoolImpl::UpdatePriority(scoped_refptr<TaskSource> task_source,
   }
 }
 
+std::vector<int> ThreadPoolImpl::CreateNumaNodeThreadGroups(
+    int max_num_foreground_threads) {
+  DCHECK(numa_node_thread_groups_.empty());
+
+#if HAS_NATIVE_THREAD_POOL()
+  // The native thread pool doesn't support CPU affinity.
+  if (FeatureList::IsEnabled(kUseNativeThreadPool))
+    return {max_num_foreground_threads};
+#endif
+
+  cpu_topology_ = cpu_topology_for_testing_ ? cpu_topology_for_testing_.value()
+                                            : CpuTopology::Get();
+  const size_t num_nodes = cpu_topology_.nodes.size();
+  if (num_nodes == 1)
+    return {max_num_foreground_threads};
+
+  size_t num_cpus = 0;
+  for (const std::vector<int>& node_cpus : cpu_topology_.nodes)
+    num_cpus += node_cpus.size();
+
+  // Divide the foreground threads among nodes in proportion to their number of
+  // CPUs, rounding to the nearest, with at least one thread per node.
+  std::vector<int> max_tasks_per_node;
+  for (size_t node = 0; node < num_nodes; ++node) {
+    const size_t node_num_cpus = cpu_topology_.nodes[node].size();
+    const int max_tasks =
+        num_cpus == 0
+            ? max_num_foreground_threads / static_cast<int>(num_nodes)
+            : static_cast<int>(
+                  (max_num_foreground_threads * node_num_cpus + num_cpus / 2) /
+                  num_cpus);
+    max_tasks_per_node.push_back(std::max(max_tasks, 1));
+
+    if (node == 0)
+      continue;
+    const std::string thread_group_label =
+        StrCat({kForegroundPoolEnvironmentParams.name_suffix,
+                kNumaNodeThreadGroupLabelSuffix, NumberToString(node)});
+    numa_node_thread_groups_.push_back(std::make_unique<ThreadGroupImpl>(
+        JoinString({histogram_label_, thread_group_label}, "."),
+        thread_group_label, kForegroundPoolEnvironmentParams.priority_hint,
+        task_tracker_->GetTrackedRef(), tracked_ref_factory_.GetTrackedRef()));
+  }
+  return max_tasks_per_node;
+}
+
+size_t ThreadPoolImpl::GetNumaNodeForCurrentThread() const {
+  const size_t num_numa_nodes = num_numa_nodes_.load(std::memory_order_acquire);
+  if (num_numa_nodes == 1)
+    return 0;
+  // Workers are bound to the CPUs of their node, but checking their thread
+  // group is cheaper and works even if the affinity couldn't be set.
+  if (foreground_thread_group_->IsBoundToCurrentThread())
+    return 0;
+  for (size_t node = 1; node < num_numa_nodes; ++node) {
+    if (numa_node_thread_groups_[node - 1]->IsBoundToCurrentThread())
+      return node;
+  }
+  return cpu_topology_.GetNodeForCurrentThread();
+}
+
+ThreadGroup* ThreadPoolImpl::GetForegroundThreadGroup(size_t numa_node) const {
+  if (numa_node > 0 &&
+      numa_node < num_numa_nodes_.load(std::memory_order_acquire)) {
+    return numa_node_thread_groups_[numa_node - 1].get();
+  }
+  return foreground_thread_group_.get();
+}
+
 const ThreadGroup* ThreadPoolImpl::GetThreadGroupForTraits(
     const TaskTraits& traits) const {
-  return const_cast<ThreadPoolImpl*>(this)->GetThreadGroupForTraits(traits);
+  return const_cast<ThreadPoolImpl*>(this)->GetThreadGroupForTraits(traits, 0);
 }
 
-ThreadGroup* ThreadPoolImpl::GetThreadGroupForTraits(const TaskTraits& traits) {
+ThreadGroup* ThreadPoolImpl::GetThreadGroupForTraits(const TaskTraits& traits,
+                                                     size_t numa_node) {
   if (traits.priority() == TaskPriority::BEST_EFFORT &&
       traits.thread_policy() == ThreadPolicy::PREFER_BACKGROUND &&
       background_thread_group_) {
     return background_thread_group_.get();
   }
 
-  return foreground_thread_group_.get();
+  return GetForegroundThreadGroup(numa_node);
+}
+
+ThreadGroup* ThreadPoolImpl::GetThreadGroupForTaskSource(
+    const TaskSource::Transaction& transaction) {
+  return GetThreadGroupForTraits(transaction.traits(),
+                                 transaction.task_source()->numa_node());
 }
 
 void ThreadPoolImpl::UpdateCanRunPolicy() {
@@ -486,6 +705,8 @@ void ThreadPoolImpl::UpdateCanRunPolicy() {
 
   task_tracker_->SetCanRunPolicy(can_run_policy);
   foreground_thread_group_->DidUpdateCanRunPolicy();
+  for (const auto& thread_group : numa_node_thread_groups_)
+    thread_group->DidUpdateCanRunPolicy();
   if (background_thread_group_)
     background_thread_group_->DidUpdateCanRunPolicy();
   single_thread_task_runner_manager_.DidUpdateCanRunPolicy();
@@ -500,6 +721,9 @@ TaskTraits ThreadPoolImpl::SetUserBlockingPriorityIfNeeded(
 
 void ThreadPoolImpl::ReportHeartbeatMetrics() const {
   foreground_thread_group_->ReportHeartbeatMetrics();
+  const size_t num_numa_nodes = num_numa_nodes_.load(std::memory_order_acquire);
+  for (size_t node = 1; node < num_numa_nodes; ++node)
+    numa_node_thread_groups_[node - 1]->ReportHeartbeatMetrics();
   if (background_thread_group_)
     background_thread_group_->ReportHeartbeatMetrics();
 }
@@ -5,7 +5,11 @@
 #ifndef BASE_TASK_THREAD_POOL_THREAD_POOL_IMPL_H_
 #define BASE_TASK_THREAD_POOL_THREAD_POOL_IMPL_H_
 
+#include <stddef.h>
+
+#include <atomic>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "base/base_export.h"
@@ -21,6 +25,7 @@
 #include "base/task/single_thread_task_runner_thread_mode.h"
 #include "base/task/task_executor.h"
 #include "base/task/task_traits.h"
+#include "base/task/thread_pool/cpu_topology.h"
 #include "base/task/thread_pool/delayed_task_manager.h"
 #include "base/task/thread_pool/environment_config.h"
 #include "base/task/thread_pool/pooled_single_thread_task_runner_manager.h"
@@ -114,6 +119,11 @@ class BASE_EXPORT ThreadPoolImpl : public ThreadPoolInstance,
   // advances faster than the real-time delay on ServiceThread).
   void ProcessRipeDelayedTasksForTesting();
 
+  // Makes Start() use |cpu_topology| instead of the topology of the machine
+  // when InitParams::numa_aware_thread_groups is set. Must be called before
+  // Start().
+  void SetCpuTopologyForTesting(const CpuTopology& cpu_topology);
+
  private:
   // Invoked after |has_fence_| or |has_best_effort_fence_| is updated. Sets the
   // CanRunPolicy in TaskTracker and wakes up workers as appropriate.
@@ -125,10 +135,28 @@ class BASE_EXPORT ThreadPoolImpl : public ThreadPoolInstance,
 
   void ReportHeartbeatMetrics() const;
 
+  // Creates a foreground thread group for each NUMA node of |cpu_topology_|
+  // but the first and returns the max number of tasks of each node's thread
+  // group, which add up to about |max_num_foreground_threads|.
+  std::vector<int> CreateNumaNodeThreadGroups(int max_num_foreground_threads);
+
+  // Returns the index of the NUMA node on which the current thread runs, or 0
+  // if there is a single foreground thread group.
+  size_t GetNumaNodeForCurrentThread() const;
+
+  // Returns the foreground thread group of |numa_node| if it exists, or
+  // |foreground_thread_group_| otherwise.
+  ThreadGroup* GetForegroundThreadGroup(size_t numa_node) const;
+
+  // Returns the thread group that runs tasks with |traits| from a TaskSource
+  // of |numa_node|.
   const ThreadGroup* GetThreadGroupForTraits(const TaskTraits& traits) const;
+  ThreadGroup* GetThreadGroupForTraits(const TaskTraits& traits,
+                                       size_t numa_node);
 
   // ThreadGroup::Delegate:
-  ThreadGroup* GetThreadGroupForTraits(const TaskTraits& traits) override;
+  ThreadGroup* GetThreadGroupForTaskSource(
+      const TaskSource::Transaction& transaction) override;
 
   // Posts |task| to be executed by the appropriate thread group as part of
   // |sequence|. This must only be called after |task| has gone through
@@ -138,6 +166,11 @@ class BASE_EXPORT ThreadPoolImpl : public ThreadPoolInstance,
   // PooledTaskRunnerDelegate:
   bool PostTaskWithSequence(Task task,
                             scoped_refptr<Sequence> sequence) override;
+  bool PostTasksWithSequence(std::vector<Task> tasks,
+                             scoped_refptr<Sequence> sequence) override;
+  bool PostTasksWithSequences(
+      std::vector<Task> tasks,
+      std::vector<scoped_refptr<Sequence>> sequences) override;
   bool EnqueueJobTaskSource(scoped_refptr<JobTaskSource> task_source) override;
   bool IsRunningPoolWithTraits(const TaskTraits& traits) const override;
   void UpdatePriority(scoped_refptr<TaskSource> task_source,
@@ -160,9 +193,25 @@ class BASE_EXPORT ThreadPoolImpl : public ThreadPoolInstance,
   // TODO(fdoray): Remove after experiment. https://crbug.com/757022
   AtomicFlag all_tasks_user_blocking_;
 
+  const std::string histogram_label_;
+
   std::unique_ptr<ThreadGroup> foreground_thread_group_;
   std::unique_ptr<ThreadGroupImpl> background_thread_group_;
 
+  // Under InitParams::numa_aware_thread_groups, |foreground_thread_group_| runs
+  // the foreground tasks of the first NUMA node of |cpu_topology_| and these
+  // thread groups, created in Start(), those of the other nodes, in order.
+  std::vector<std::unique_ptr<ThreadGroupImpl>> numa_node_thread_groups_;
+
+  // The number of NUMA nodes with a foreground thread group. Set in Start()
+  // after |numa_node_thread_groups_| and |cpu_topology_|, which are not
+  // modified afterwards and can thus be read from any thread after loading a
+  // value greater than 1 from this.
+  std::atomic<size_t> num_numa_nodes_{1};
+
+  CpuTopology cpu_topology_;
+  Optional<CpuTopology> cpu_topology_for_testing_;
+
   // Whether this TaskScheduler was started. Access controlled by
   // |sequence_checker_|.
   bool started_ = false;
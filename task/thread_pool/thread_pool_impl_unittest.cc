@@ -19,6 +19,7 @@
 #include "base/macros.h"
 #include "base/metrics/field_trial.h"
 #include "base/metrics/field_trial_params.h"
+#include "base/synchronization/lock.h"
 #include "base/synchronization/waitable_event.h"
 #include "base/task/task_features.h"
 #include "base/task/task_traits.h"
@@ -49,6 +50,10 @@
 #include "base/posix/eintr_wrapper.h"
 #endif  // defined(OS_POSIX)
 
+#if defined(OS_LINUX)
+#include <sched.h>
+#endif  // defined(OS_LINUX)
+
 #if defined(OS_WIN)
 #include "base/win/com_init_util.h"
 #endif  // defined(OS_WIN)
@@ -395,6 +400,40 @@ TEST_P(ThreadPoolImplTestAllTraitsExecutionModes, PostTasksViaTaskRunner) {
   factory.WaitForAllTasksToRun();
 }
 
+// Verifies that tasks posted together via TaskRunner::PostTasks() all run, in
+// posting order if the TaskRunner is sequenced.
+TEST_P(ThreadPoolImplTestAllTraitsExecutionModes, PostTasksAsBatch) {
+  StartThreadPool();
+  auto task_runner = CreateTaskRunnerAndExecutionMode(
+      thread_pool_.get(), GetTraits(), GetExecutionMode());
+
+  constexpr size_t kNumTasks = 150;
+  Lock lock;
+  std::vector<size_t> run_order;
+  WaitableEvent all_tasks_ran;
+  std::vector<OnceClosure> tasks;
+  for (size_t i = 0; i < kNumTasks; ++i) {
+    tasks.push_back(BindLambdaForTesting([&, i]() {
+      VerifyTaskEnvironment(GetTraits(), GetPoolType());
+      bool is_last_task;
+      {
+        AutoLock auto_lock(lock);
+        run_order.push_back(i);
+        is_last_task = run_order.size() == kNumTasks;
+      }
+      if (is_last_task)
+        all_tasks_ran.Signal();
+    }));
+  }
+  EXPECT_TRUE(task_runner->PostTasks(FROM_HERE, std::move(tasks)));
+  all_tasks_ran.Wait();
+
+  if (GetExecutionMode() != TaskSourceExecutionMode::kParallel) {
+    for (size_t i = 0; i < kNumTasks; ++i)
+      EXPECT_EQ(i, run_order[i]);
+  }
+}
+
 // Verifies that a task posted via PostDelayedTask without a delay doesn't run
 // before Start() is called.
 TEST_P(ThreadPoolImplTestAllTraitsExecutionModes,
@@ -1331,6 +1370,83 @@ TEST_P(ThreadPoolImplTest, UpdatePriorityFromBestEffortNoThreadPolicy) {
   }
 }
 
+#if defined(OS_LINUX)
+namespace {
+
+// Expects to run in the thread group of the second NUMA node and posts
+// |num_nested_tasks| more tasks through a new task runner, which should run in
+// the same thread group.
+void VerifyRunsOnSecondNumaNode(ThreadPoolImpl* thread_pool,
+                                int num_nested_tasks,
+                                OnceClosure done) {
+  EXPECT_NE(std::string::npos,
+            std::string(PlatformThread::GetName()).find("ForegroundNode1"));
+  if (num_nested_tasks == 0) {
+    std::move(done).Run();
+    return;
+  }
+  thread_pool->CreateSequencedTaskRunner({ThreadPool()})
+      ->PostTask(FROM_HERE, BindOnce(&VerifyRunsOnSecondNumaNode,
+                                     Unretained(thread_pool),
+                                     num_nested_tasks - 1, std::move(done)));
+}
+
+}  // namespace
+
+// Verifies that with InitParams::numa_aware_thread_groups, the tasks of a task
+// runner run in the thread group of the NUMA node on which it was created, as
+// do tasks posted without a task runner.
+TEST(ThreadPoolImplNumaTest, TasksRunOnNumaNodeOfPoster) {
+  // The CPUs of the first node don't exist, so every thread that isn't bound
+  // to the first node runs on the second.
+  CpuTopology cpu_topology;
+  cpu_topology.nodes.resize(2);
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    cpu_topology.nodes[1].push_back(cpu);
+
+  ThreadPoolImpl thread_pool("Test");
+  thread_pool.SetCpuTopologyForTesting(cpu_topology);
+  ThreadPoolInstance::InitParams init_params(kMaxNumForegroundThreads);
+  init_params.numa_aware_thread_groups = true;
+  thread_pool.Start(init_params, nullptr);
+
+  constexpr int kNumNestedTasks = 3;
+  WaitableEvent sequenced_task_ran;
+  thread_pool.CreateSequencedTaskRunner({ThreadPool()})
+      ->PostTask(FROM_HERE,
+                 BindOnce(&VerifyRunsOnSecondNumaNode, Unretained(&thread_pool),
+                          kNumNestedTasks,
+                          BindOnce(&WaitableEvent::Signal,
+                                   Unretained(&sequenced_task_ran))));
+
+  WaitableEvent parallel_task_ran;
+  scoped_refptr<TaskRunner> parallel_task_runner =
+      thread_pool.CreateTaskRunner({ThreadPool()});
+  parallel_task_runner->PostTask(
+      FROM_HERE, BindLambdaForTesting([&]() {
+        EXPECT_TRUE(parallel_task_runner->RunsTasksInCurrentSequence());
+        VerifyRunsOnSecondNumaNode(
+            &thread_pool, 0,
+            BindOnce(&WaitableEvent::Signal, Unretained(&parallel_task_ran)));
+      }));
+
+  WaitableEvent one_off_task_ran;
+  thread_pool.PostDelayedTask(
+      FROM_HERE, {ThreadPool()},
+      BindOnce(&VerifyRunsOnSecondNumaNode, Unretained(&thread_pool), 0,
+               BindOnce(&WaitableEvent::Signal,
+                        Unretained(&one_off_task_ran))),
+      TimeDelta());
+
+  sequenced_task_ran.Wait();
+  parallel_task_ran.Wait();
+  one_off_task_ran.Wait();
+
+  thread_pool.FlushForTesting();
+  thread_pool.JoinForTesting();
+}
+#endif  // defined(OS_LINUX)
+
 INSTANTIATE_TEST_SUITE_P(,
                          ThreadPoolImplTest,
                          ::testing::Values(test::PoolType::GENERIC
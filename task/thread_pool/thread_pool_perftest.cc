@@ -14,7 +14,9 @@
 #include "base/optional.h"
 #include "base/synchronization/waitable_event.h"
 #include "base/task/post_task.h"
+#include "base/task/task_features.h"
 #include "base/task/thread_pool/thread_pool.h"
+#include "base/test/scoped_feature_list.h"
 #include "base/threading/simple_thread.h"
 #include "base/time/time.h"
 #include "testing/gtest/include/gtest/gtest.h"
@@ -112,6 +114,30 @@ class ThreadPoolPerfTest : public testing::Test {
     }
   }
 
+  // Posts tasks that each post |num_subtasks| no-op tasks, as a task that
+  // splits its work does, until |num_tasks| tasks were posted in total.
+  void ContinuouslyPostTasksThatPostNoOpTasks(size_t num_tasks,
+                                              size_t num_subtasks) {
+    scoped_refptr<TaskRunner> task_runner = CreateTaskRunner({ThreadPool()});
+    base::RepeatingClosure subtask = base::BindRepeating(
+        [](std::atomic_size_t* num_task_pending) { (*num_task_pending)--; },
+        &num_tasks_pending_);
+    base::RepeatingClosure task = base::BindRepeating(
+        [](TaskRunner* task_runner, const base::RepeatingClosure& subtask,
+           size_t num_subtasks, std::atomic_size_t* num_task_pending) {
+          for (size_t i = 0; i < num_subtasks; ++i)
+            task_runner->PostTask(FROM_HERE, subtask);
+          (*num_task_pending)--;
+        },
+        base::RetainedRef(task_runner), subtask, num_subtasks,
+        Unretained(&num_tasks_pending_));
+    for (size_t i = 0; i < num_tasks; i += num_subtasks + 1) {
+      num_tasks_pending_ += num_subtasks + 1;
+      num_posted_tasks_ += num_subtasks + 1;
+      task_runner->PostTask(FROM_HERE, task);
+    }
+  }
+
  protected:
   ThreadPoolPerfTest() { ThreadPoolInstance::Create("PerfTest"); }
 
@@ -188,6 +214,19 @@ class ThreadPoolPerfTest : public testing::Test {
   DISALLOW_COPY_AND_ASSIGN(ThreadPoolPerfTest);
 };
 
+// Runs the benchmarks with per-worker queues and work stealing.
+class ThreadPoolWorkStealingPerfTest : public ThreadPoolPerfTest {
+ protected:
+  ThreadPoolWorkStealingPerfTest() {
+    feature_list_.InitAndEnableFeature(kThreadGroupWorkStealing);
+  }
+
+ private:
+  test::ScopedFeatureList feature_list_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadPoolWorkStealingPerfTest);
+};
+
 }  // namespace
 
 TEST_F(ThreadPoolPerfTest, BindPostThenRunNoOpTasks) {
@@ -244,5 +283,48 @@ TEST_F(ThreadPoolPerfTest, PostRunBusyTasksManyThreads) {
   Benchmark("Post/run busy tasks many threads", ExecutionMode::kPostAndRun);
 }
 
+TEST_F(ThreadPoolPerfTest, PostRunNoOpTasksFromTasks) {
+  StartThreadPool(
+      4, 1,
+      BindRepeating(&ThreadPoolPerfTest::ContinuouslyPostTasksThatPostNoOpTasks,
+                    Unretained(this), 10000, 9));
+  Benchmark("Post/run no-op tasks from tasks", ExecutionMode::kPostAndRun);
+}
+
+TEST_F(ThreadPoolPerfTest, PostRunNoOpTasksFromTasksManyThreads) {
+  StartThreadPool(
+      8, 4,
+      BindRepeating(&ThreadPoolPerfTest::ContinuouslyPostTasksThatPostNoOpTasks,
+                    Unretained(this), 10000, 9));
+  Benchmark("Post/run no-op tasks from tasks many threads",
+            ExecutionMode::kPostAndRun);
+}
+
+TEST_F(ThreadPoolWorkStealingPerfTest, PostRunNoOpTasksManyThreads) {
+  StartThreadPool(4, 4,
+                  BindRepeating(&ThreadPoolPerfTest::ContinuouslyPostNoOpTasks,
+                                Unretained(this), 10000));
+  Benchmark("Work stealing post/run no-op tasks many threads",
+            ExecutionMode::kPostAndRun);
+}
+
+TEST_F(ThreadPoolWorkStealingPerfTest, PostRunNoOpTasksFromTasks) {
+  StartThreadPool(
+      4, 1,
+      BindRepeating(&ThreadPoolPerfTest::ContinuouslyPostTasksThatPostNoOpTasks,
+                    Unretained(this), 10000, 9));
+  Benchmark("Work stealing post/run no-op tasks from tasks",
+            ExecutionMode::kPostAndRun);
+}
+
+TEST_F(ThreadPoolWorkStealingPerfTest, PostRunNoOpTasksFromTasksManyThreads) {
+  StartThreadPool(
+      8, 4,
+      BindRepeating(&ThreadPoolPerfTest::ContinuouslyPostTasksThatPostNoOpTasks,
+                    Unretained(this), 10000, 9));
+  Benchmark("Work stealing post/run no-op tasks from tasks many threads",
+            ExecutionMode::kPostAndRun);
+}
+
 }  // namespace internal
 }  // namespace base
@@ -0,0 +1,96 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_TASK_THREAD_POOL_WORK_STEALING_QUEUE_H_
+#define BASE_TASK_THREAD_POOL_WORK_STEALING_QUEUE_H_
+
+#include <stddef.h>
+
+#include <atomic>
+#include <memory>
+
+#include "base/macros.h"
+#include "base/memory/ptr_util.h"
+
+namespace base {
+namespace internal {
+
+// A bounded FIFO queue of owned |T|s, filled by the single thread that owns it
+// and drained by any thread. Only the owner may call Push(); any thread may
+// call Take(), which is how idle workers steal work from busy ones. Since the
+// owner takes from the same end as other threads, items come out in the order
+// in which they were pushed.
+//
+// Neither operation blocks or allocates. The queue is a ring buffer of
+// |kCapacity| pointers indexed by two ever-increasing positions: the owner
+// writes a slot and then publishes it by advancing |tail_|, consumers claim
+// the slot at |head_| by advancing it with a compare-and-swap.
+template <typename T, size_t kCapacity>
+class WorkStealingQueue {
+ public:
+  static_assert(kCapacity > 0 && (kCapacity & (kCapacity - 1)) == 0,
+                "kCapacity must be a power of 2");
+
+  WorkStealingQueue() = default;
+
+  // Deletes the items left in the queue. No other thread may access the queue.
+  ~WorkStealingQueue() {
+    while (Take()) {
+    }
+  }
+
+  // Appends |*item| to the queue and returns true, or returns false and leaves
+  // |*item| untouched if the queue is full. Must only be called by the owner.
+  bool Push(std::unique_ptr<T>* item) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) >= kCapacity)
+      return false;
+    slots_[tail % kCapacity].store(item->release(), std::memory_order_relaxed);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Removes and returns the oldest item in the queue, or nullptr if the queue
+  // is empty. Thread-safe.
+  std::unique_ptr<T> Take() {
+    size_t head = head_.load(std::memory_order_acquire);
+    while (head != tail_.load(std::memory_order_acquire)) {
+      // The slot may be overwritten by Push() once another consumer advanced
+      // |head_|, in which case the compare-and-swap below fails.
+      T* const item = slots_[head % kCapacity].load(std::memory_order_relaxed);
+      if (head_.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel,
+                                      std::memory_order_acquire)) {
+        return WrapUnique(item);
+      }
+    }
+    return nullptr;
+  }
+
+  // Returns true if the queue is empty. The result may be outdated unless
+  // called by the owner and no other thread can call Take().
+  bool IsEmpty() const {
+    return head_.load(std::memory_order_acquire) ==
+           tail_.load(std::memory_order_acquire);
+  }
+
+  // Returns true if Push() would fail. Must only be called by the owner, for
+  // which the result remains valid until it calls Push().
+  bool IsFull() const {
+    return tail_.load(std::memory_order_relaxed) -
+               head_.load(std::memory_order_acquire) >=
+           kCapacity;
+  }
+
+ private:
+  std::atomic<size_t> head_{0};
+  std::atomic<size_t> tail_{0};
+  std::atomic<T*> slots_[kCapacity] = {};
+
+  DISALLOW_COPY_AND_ASSIGN(WorkStealingQueue);
+};
+
+}  // namespace internal
+}  // namespace base
+
+#endif  // BASE_TASK_THREAD_POOL_WORK_STEALING_QUEUE_H_
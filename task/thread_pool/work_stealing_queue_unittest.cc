@@ -0,0 +1,141 @@
+// Copyright 2019 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/task/thread_pool/work_stealing_queue.h"
+
+#include <stddef.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/threading/simple_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace internal {
+
+namespace {
+
+constexpr size_t kCapacity = 8;
+using TestQueue = WorkStealingQueue<size_t, kCapacity>;
+
+bool Push(TestQueue* queue, size_t value) {
+  auto item = std::make_unique<size_t>(value);
+  return queue->Push(&item);
+}
+
+// Takes items from a queue until |*done| is set and the queue is empty, and
+// records how many times each item was taken.
+class ThiefThread : public SimpleThread {
+ public:
+  ThiefThread(TestQueue* queue,
+              const std::atomic<bool>* done,
+              size_t num_items)
+      : SimpleThread("ThiefThread"),
+        queue_(queue),
+        done_(done),
+        times_taken_(num_items) {}
+
+  const std::vector<size_t>& times_taken() const { return times_taken_; }
+
+ private:
+  void Run() override {
+    while (true) {
+      const bool done = done_->load();
+      std::unique_ptr<size_t> item = queue_->Take();
+      if (item)
+        ++times_taken_[*item];
+      else if (done)
+        return;
+    }
+  }
+
+  TestQueue* const queue_;
+  const std::atomic<bool>* const done_;
+  std::vector<size_t> times_taken_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThiefThread);
+};
+
+}  // namespace
+
+TEST(ThreadPoolWorkStealingQueueTest, PushTake) {
+  TestQueue queue;
+  EXPECT_TRUE(queue.IsEmpty());
+  EXPECT_FALSE(queue.Take());
+
+  // Items come out in the order in which they were pushed, across wrap-arounds
+  // of the ring buffer.
+  for (size_t round = 0; round < 3; ++round) {
+    for (size_t i = 0; i < kCapacity; ++i)
+      EXPECT_TRUE(Push(&queue, i));
+    EXPECT_FALSE(queue.IsEmpty());
+    for (size_t i = 0; i < kCapacity; ++i) {
+      std::unique_ptr<size_t> item = queue.Take();
+      ASSERT_TRUE(item);
+      EXPECT_EQ(i, *item);
+    }
+    EXPECT_TRUE(queue.IsEmpty());
+    EXPECT_FALSE(queue.Take());
+  }
+}
+
+TEST(ThreadPoolWorkStealingQueueTest, PushFull) {
+  TestQueue queue;
+  for (size_t i = 0; i < kCapacity; ++i)
+    EXPECT_TRUE(Push(&queue, i));
+  EXPECT_TRUE(queue.IsFull());
+
+  // A push to a full queue fails without consuming the item.
+  auto item = std::make_unique<size_t>(kCapacity);
+  EXPECT_FALSE(queue.Push(&item));
+  ASSERT_TRUE(item);
+  EXPECT_EQ(kCapacity, *item);
+
+  EXPECT_EQ(0U, *queue.Take());
+  EXPECT_FALSE(queue.IsFull());
+  EXPECT_TRUE(queue.Push(&item));
+  EXPECT_FALSE(item);
+}
+
+// Verifies that every item pushed by the owner is taken exactly once when
+// several threads take from the queue concurrently.
+TEST(ThreadPoolWorkStealingQueueTest, ConcurrentTake) {
+  constexpr size_t kNumThieves = 4;
+  constexpr size_t kNumItems = 100000;
+
+  TestQueue queue;
+  std::atomic<bool> done(false);
+  std::vector<std::unique_ptr<ThiefThread>> thieves;
+  for (size_t i = 0; i < kNumThieves; ++i) {
+    thieves.push_back(std::make_unique<ThiefThread>(&queue, &done, kNumItems));
+    thieves.back()->Start();
+  }
+
+  // The owner also takes items, as a worker does when it runs out of work.
+  std::vector<size_t> times_taken(kNumItems);
+  for (size_t i = 0; i < kNumItems; ++i) {
+    auto item = std::make_unique<size_t>(i);
+    while (!queue.Push(&item)) {
+      std::unique_ptr<size_t> taken = queue.Take();
+      if (taken)
+        ++times_taken[*taken];
+    }
+  }
+  done.store(true);
+
+  for (const auto& thief : thieves) {
+    thief->Join();
+    for (size_t i = 0; i < kNumItems; ++i)
+      times_taken[i] += thief->times_taken()[i];
+  }
+  for (size_t i = 0; i < kNumItems; ++i)
+    EXPECT_EQ(1U, times_taken[i]) << i;
+  EXPECT_TRUE(queue.IsEmpty());
+}
+
+}  // namespace internal
+}  // namespace base
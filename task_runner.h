@@ -7,6 +7,8 @@
 
 #include <stddef.h>
 
+#include <vector>
+
 #include "base/base_export.h"
 #include "base/callback.h"
 #include "base/location.h"
@@ -74,6 +76,17 @@ class BASE_EXPORT TaskRunner
                                OnceClosure task,
                                base::TimeDelta delay) = 0;
 
+  // Posts each of |tasks| as if by PostTask(), in order. Returns true if all
+  // the tasks may be run at some point in the future, and false if at least
+  // one of them definitely will not be run.
+  //
+  // Implementations may enqueue the whole batch at once, e.g. under a single
+  // lock acquisition and with a single wake-up of the thread(s) running the
+  // tasks, which is cheaper than posting many small tasks one at a time. The
+  // default implementation calls PostTask() for each task.
+  virtual bool PostTasks(const Location& from_here,
+                         std::vector<OnceClosure> tasks);
+
   // Returns true iff tasks posted to this TaskRunner are sequenced
   // with this call.
   //
@@ -11,6 +11,8 @@
 
 #include <stddef.h>
 
+#include <vector>
+
 #include "base/base_export.h"
 #include "base/macros.h"
 #include "base/time/time.h"
@@ -232,6 +234,11 @@ class BASE_EXPORT PlatformThread {
   // whole thread group's (i.e. process) priority.
   static void SetThreadPriority(PlatformThreadId thread_id,
                                 ThreadPriority priority);
+
+  // Restricts the current thread to run on the CPUs in |cpus|. Returns false
+  // if the affinity couldn't be changed, e.g. because none of |cpus| is
+  // available to the process.
+  static bool SetCurrentThreadAffinity(const std::vector<int>& cpus);
 #endif
 
   // Returns the default thread stack size set by chrome. If we do not
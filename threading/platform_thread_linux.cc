@@ -178,6 +178,23 @@ void PlatformThread::SetThreadPriority(PlatformThreadId thread_id,
               << nice_setting;
   }
 }
+
+// static
+bool PlatformThread::SetCurrentThreadAffinity(const std::vector<int>& cpus) {
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (int cpu : cpus) {
+    if (cpu >= 0 && cpu < CPU_SETSIZE)
+      CPU_SET(cpu, &cpu_set);
+  }
+  // A thread id of 0 designates the calling thread.
+  if (sched_setaffinity(0, sizeof(cpu_set), &cpu_set) != 0) {
+    DVPLOG(1) << "Failed to set the CPU affinity of thread ("
+              << PlatformThread::CurrentId() << ")";
+    return false;
+  }
+  return true;
+}
 #endif  //  !defined(OS_NACL) && !defined(OS_AIX)
 
 void InitThreading() {}
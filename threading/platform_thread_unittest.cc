@@ -19,6 +19,10 @@
 #include "base/threading/platform_thread_win.h"
 #endif
 
+#if defined(OS_LINUX)
+#include <sched.h>
+#endif
+
 namespace base {
 
 // Trivial tests that thread runs and doesn't crash on create, join, or detach -
@@ -413,6 +417,42 @@ TEST(PlatformThreadTest, SetHugeThreadName) {
   PlatformThread::SetName(long_name);
 }
 
+#if defined(OS_LINUX) && !defined(OS_NACL) && !defined(OS_AIX)
+namespace {
+
+class AffinityTestThread : public PlatformThread::Delegate {
+ public:
+  AffinityTestThread() = default;
+
+  void ThreadMain() override {
+    const int cpu = sched_getcpu();
+    ASSERT_GE(cpu, 0);
+    EXPECT_TRUE(PlatformThread::SetCurrentThreadAffinity({cpu}));
+    cpu_set_t cpu_set;
+    ASSERT_EQ(0, sched_getaffinity(0, sizeof(cpu_set), &cpu_set));
+    EXPECT_EQ(1, CPU_COUNT(&cpu_set));
+    EXPECT_TRUE(CPU_ISSET(cpu, &cpu_set));
+    EXPECT_EQ(cpu, sched_getcpu());
+
+    // An affinity without any valid CPU is rejected.
+    EXPECT_FALSE(PlatformThread::SetCurrentThreadAffinity({}));
+    EXPECT_FALSE(PlatformThread::SetCurrentThreadAffinity({-1}));
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(AffinityTestThread);
+};
+
+}  // namespace
+
+TEST(PlatformThreadTest, SetCurrentThreadAffinity) {
+  AffinityTestThread thread;
+  PlatformThreadHandle handle;
+  ASSERT_TRUE(PlatformThread::Create(0, &thread, &handle));
+  PlatformThread::Join(handle);
+}
+#endif  // defined(OS_LINUX) && !defined(OS_NACL) && !defined(OS_AIX)
+
 TEST(PlatformThreadTest, GetDefaultThreadStackSize) {
   size_t stack_size = PlatformThread::GetDefaultThreadStackSize();
 #if defined(OS_WIN) || defined(OS_IOS) || defined(OS_FUCHSIA) || \
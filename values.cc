@@ -8,6 +8,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <iterator>
 #include <new>
 #include <ostream>
 #include <utility>
@@ -451,6 +452,18 @@ Value* Value::SetStringKey(StringPiece key, StringPiece16 value) {
   return SetKeyInternal(key, std::make_unique<Value>(value));
 }
 
+void Value::SetKeys(std::vector<std::pair<std::string, Value>> items) {
+  CHECK(is_dict());
+  std::vector<DictStorage::value_type> storage;
+  storage.reserve(items.size());
+  for (auto& item : items) {
+    storage.emplace_back(std::move(item.first),
+                         std::make_unique<Value>(std::move(item.second)));
+  }
+  dict_.insert(std::make_move_iterator(storage.begin()),
+               std::make_move_iterator(storage.end()), KEEP_LAST_OF_DUPES);
+}
+
 bool Value::RemoveKey(StringPiece key) {
   CHECK(is_dict());
   return dict_.erase(key) != 0;
@@ -736,6 +749,7 @@ bool Value::DictEmpty() const {
 void Value::MergeDictionary(const Value* dictionary) {
   CHECK(is_dict());
   CHECK(dictionary->is_dict());
+  std::vector<DictStorage::value_type> copies;
   for (const auto& pair : dictionary->dict_) {
     const auto& key = pair.first;
     const auto& val = pair.second;
@@ -749,8 +763,13 @@ void Value::MergeDictionary(const Value* dictionary) {
     }
 
     // All other cases: Make a copy and hook it up.
-    SetKey(key, val->Clone());
+    copies.emplace_back(key, std::make_unique<Value>(val->Clone()));
   }
+
+  // Insert the copies in one batch, so that the existing items are moved at
+  // most once rather than once per new key.
+  dict_.insert(std::make_move_iterator(copies.begin()),
+               std::make_move_iterator(copies.end()), KEEP_LAST_OF_DUPES);
 }
 
 bool Value::GetAsBoolean(bool* out_value) const {
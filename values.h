@@ -81,6 +81,9 @@ class Value;
 class BASE_EXPORT Value {
  public:
   using BlobStorage = std::vector<uint8_t>;
+  // Dictionaries are kept sorted in a vector rather than indexed by a hash:
+  // DictItems() and the DictStorage iterators expose that order. Add many keys
+  // with SetKeys() rather than one SetKey() at a time.
   using DictStorage = flat_map<std::string, std::unique_ptr<Value>>;
   using ListStorage = std::vector<Value>;
   // See technical note below explaining why this is used.
@@ -251,6 +254,15 @@ class BASE_EXPORT Value {
   Value* SetStringKey(StringPiece key, std::string&& val);
   Value* SetStringKey(StringPiece key, StringPiece16 val);
 
+  // Sets all of |items| at once, with the same result as calling SetKey() for
+  // each of them in order: existing keys are overwritten, and the last of
+  // duplicate keys in |items| wins. Prefer this to SetKey() when adding many
+  // keys. The dictionary keeps its items sorted in a vector, so each SetKey()
+  // of a new key moves all greater items, which makes adding keys one by one
+  // quadratic. This sorts the new keys once and merges them in.
+  // Note: This CHECKs that type() is Type::DICTIONARY.
+  void SetKeys(std::vector<std::pair<std::string, Value>> items);
+
   // This attempts to remove the value associated with |key|. In case of
   // failure, e.g. the key does not exist, false is returned and the underlying
   // dictionary is not changed. In case of success, |key| is deleted from the
@@ -19,6 +19,7 @@
 #include "base/logging.h"
 #include "base/strings/string16.h"
 #include "base/strings/string_piece.h"
+#include "base/strings/stringprintf.h"
 #include "base/strings/utf_string_conversions.h"
 #include "build/build_config.h"
 #include "testing/gmock/include/gmock/gmock.h"
@@ -929,6 +930,41 @@ TEST(ValuesTest, SetStringKey) {
   ASSERT_FALSE(value);
 }
 
+TEST(ValuesTest, SetKeys) {
+  Value dict(Value::Type::DICTIONARY);
+  dict.SetIntKey("b", 1);
+  dict.SetIntKey("d", 2);
+
+  std::vector<std::pair<std::string, Value>> items;
+  items.emplace_back("c", Value(3));
+  items.emplace_back("d", Value(4));
+  items.emplace_back("a", Value(5));
+  items.emplace_back("c", Value(6));
+  dict.SetKeys(std::move(items));
+
+  Value expected(Value::Type::DICTIONARY);
+  expected.SetIntKey("a", 5);
+  expected.SetIntKey("b", 1);
+  expected.SetIntKey("c", 6);
+  expected.SetIntKey("d", 4);
+  EXPECT_EQ(expected, dict);
+
+  // Many keys in reverse order end up sorted, as with SetKey().
+  items.clear();
+  for (int i = 999; i >= 0; --i)
+    items.emplace_back(StringPrintf("key%04d", i), Value(i));
+  dict.SetKeys(std::move(items));
+  EXPECT_EQ(1004u, dict.DictSize());
+  int previous = -1;
+  for (const auto& item : dict.DictItems()) {
+    if (item.first.compare(0, 3, "key") != 0)
+      continue;
+    EXPECT_EQ(previous + 1, item.second.GetInt());
+    previous = item.second.GetInt();
+  }
+  EXPECT_EQ(999, previous);
+}
+
 TEST(ValuesTest, FindPath) {
   // Construct a dictionary path {root}.foo.bar = 123
   Value foo(Value::Type::DICTIONARY);